@@ -0,0 +1,151 @@
+#include "AssetPacker.h"
+#include "Content/AssetArchive.h"
+#include "Utilities/Compression.h"
+#include "Utilities/Threading.h"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+namespace lightning::tools {
+	namespace {
+		using namespace lightning::content::archive;
+
+		// Don't bother compressing assets that would shrink less than this.
+		constexpr f32 min_compression_ratio{ .9f };
+
+		struct PackedFile {
+			TocEntry entry;
+			u32 file_index;
+		};
+
+		void write_padding(std::ofstream& file, u64 size) {
+			constexpr u8 zeros[archive_page_size]{};
+			assert(size < archive_page_size);
+			file.write((const char*)&zeros[0], size);
+		}
+
+		// Compresses the data in independent blocks. Blocks that don't shrink are stored as they are.
+		// Returns false if the payload as a whole isn't worth compressing.
+		bool compress_payload(const u8* const data, u64 size, util::vector<u8>& payload) {
+			const u32 block_size{ compression::default_block_size };
+			const u32 block_count{ (u32)((size + block_size - 1) / block_size) };
+			util::vector<util::vector<u8>> blocks(block_count);
+
+			util::parallel_for(block_count, [&](u32 i) {
+				const u64 raw_offset{ (u64)i * block_size };
+				const u32 raw_size{ (u32)std::min((u64)block_size, size - raw_offset) };
+				util::vector<u8>& block{ blocks[i] };
+				block.resize(compression::max_compressed_size(raw_size));
+
+				u32 compressed_size{ compression::compress_block(&data[raw_offset], raw_size, block.data(), (u32)block.size()) };
+
+				if (!compressed_size || compressed_size >= raw_size) {
+					memcpy(block.data(), &data[raw_offset], raw_size);
+					compressed_size = raw_size;
+				}
+
+				block.resize(compressed_size);
+			});
+
+			u64 payload_size{ block_count * sizeof(u32) };
+			for (const auto& block : blocks) payload_size += block.size();
+
+			if ((f32)payload_size > (f32)size * min_compression_ratio) return false;
+
+			payload.resize(payload_size);
+			u8* out{ payload.data() };
+
+			for (const auto& block : blocks) {
+				const u32 block_stored_size{ (u32)block.size() };
+				memcpy(out, &block_stored_size, sizeof(u32));
+				out += sizeof(u32);
+			}
+
+			for (const auto& block : blocks) {
+				memcpy(out, block.data(), block.size());
+				out += block.size();
+			}
+
+			return true;
+		}
+	}
+
+	EDITOR_INTERFACE bool pack_assets(const char* const* files, const char* const* names, u32 file_count, const char* archive_path, bool compress) {
+		assert(files && file_count && archive_path);
+		if (!files || !file_count || !archive_path) return false;
+
+		util::vector<PackedFile> packed_files(file_count);
+
+		for (u32 i{ 0 }; i < file_count; ++i) {
+			assert(files[i]);
+			if (!file_exists(files[i])) return false;
+
+			PackedFile& packed_file{ packed_files[i] };
+			packed_file.entry = {};
+			packed_file.entry.name_hash = hash_asset_name(names ? names[i] : files[i]);
+			packed_file.entry.raw_size = std::filesystem::file_size(files[i]);
+			packed_file.file_index = i;
+		}
+
+		std::sort(packed_files.begin(), packed_files.end(), [](const PackedFile& a, const PackedFile& b) { return a.entry.name_hash < b.entry.name_hash; });
+
+		for (u32 i{ 1 }; i < file_count; ++i) {
+			// NOTE: either the same asset was added twice or two names collide. Both are errors.
+			if (packed_files[i - 1].entry.name_hash == packed_files[i].entry.name_hash) return false;
+		}
+
+		ArchiveHeader header{};
+		header.magic = archive_magic;
+		header.version = archive_version;
+		header.entry_count = file_count;
+		header.page_size = archive_page_size;
+		header.toc_offset = sizeof(ArchiveHeader);
+
+		std::ofstream archive{ archive_path, std::ios::out | std::ios::binary | std::ios::trunc };
+		if (!archive) return false;
+
+		// The header and the table of contents are written last, when the payload sizes are known.
+		// Payloads are page aligned, so they can be read with unbuffered I/O and mapped without copying.
+		u64 offset{ math::align_size_up<archive_page_size>(header.toc_offset + file_count * sizeof(TocEntry)) };
+		archive.seekp(offset);
+
+		util::vector<u8> buffer{};
+		util::vector<u8> payload{};
+
+		for (auto& packed_file : packed_files) {
+			TocEntry& entry{ packed_file.entry };
+			buffer.resize(entry.raw_size);
+
+			std::ifstream file{ files[packed_file.file_index], std::ios::in | std::ios::binary };
+			if (!file || !file.read((char*)buffer.data(), entry.raw_size)) return false;
+
+			entry.offset = offset;
+			entry.size = entry.raw_size;
+
+			if (compress && entry.raw_size && compress_payload(buffer.data(), entry.raw_size, payload)) {
+				entry.size = payload.size();
+				entry.block_size = compression::default_block_size;
+				entry.flags = EntryFlags::COMPRESSED;
+				archive.write((const char*)payload.data(), entry.size);
+			}
+			else {
+				archive.write((const char*)buffer.data(), entry.size);
+			}
+
+			offset = math::align_size_up<archive_page_size>(offset + entry.size);
+			write_padding(archive, offset - (u64)archive.tellp());
+		}
+
+		header.file_size = offset;
+
+		archive.seekp(0);
+		archive.write((const char*)&header, sizeof(ArchiveHeader));
+
+		for (const auto& packed_file : packed_files) {
+			archive.write((const char*)&packed_file.entry, sizeof(TocEntry));
+		}
+
+		return archive.good();
+	}
+}
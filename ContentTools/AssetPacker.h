@@ -0,0 +1,9 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace lightning::tools {
+
+	// Packs the given files into a single archive. Assets are looked up by the hash of their name.
+	// If names is null the file paths are used as asset names.
+	EDITOR_INTERFACE bool pack_assets(const char* const* files, const char* const* names, u32 file_count, const char* archive_path, bool compress);
+}
@@ -0,0 +1,1473 @@
+#include "BlockCompression.h"
+#include "Utilities/Threading.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <limits>
+
+// Color blocks fit the endpoints along the principal axis of the pixels and refine them with least squares, like the
+// range fit in squish. Single channel blocks fit the 8 value mode and, if the block has pure black or white, the
+// 6 value mode as well. All 16 pixels of a block are processed at once, 8 lanes at a time with AVX2, 4 with SSE4.1.
+// BC7 and BC6H fit the subsets of each mode the same way, the quality decides how many modes, partitions and
+// p-bits are tried. BC7 uses modes 1, 3, 5, 6 and 7, BC6H the single region modes 11 and 12.
+namespace lightning::tools {
+	namespace {
+
+		#if defined(__AVX2__)
+		using f32v = __m256;
+		constexpr u32 lane_count{ 8 };
+
+		inline f32v v_load(const f32* const p) { return _mm256_load_ps(p); }
+		inline void v_store(f32* const p, f32v a) { _mm256_store_ps(p, a); }
+		inline f32v v_set(f32 f) { return _mm256_set1_ps(f); }
+		inline f32v v_add(f32v a, f32v b) { return _mm256_add_ps(a, b); }
+		inline f32v v_sub(f32v a, f32v b) { return _mm256_sub_ps(a, b); }
+		inline f32v v_mul(f32v a, f32v b) { return _mm256_mul_ps(a, b); }
+		inline f32v v_div(f32v a, f32v b) { return _mm256_div_ps(a, b); }
+		inline f32v v_min(f32v a, f32v b) { return _mm256_min_ps(a, b); }
+		inline f32v v_max(f32v a, f32v b) { return _mm256_max_ps(a, b); }
+		inline f32v v_less(f32v a, f32v b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		inline f32v v_select(f32v mask, f32v a, f32v b) { return _mm256_blendv_ps(b, a, mask); }
+		inline f32v v_round(f32v a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+		inline f32 v_sum(f32v a) {
+			const __m128 half{ _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)) };
+			const __m128 pairs{ _mm_add_ps(half, _mm_movehl_ps(half, half)) };
+			return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+
+		inline f32 v_reduce_min(f32v a) {
+			const __m128 half{ _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)) };
+			const __m128 pairs{ _mm_min_ps(half, _mm_movehl_ps(half, half)) };
+			return _mm_cvtss_f32(_mm_min_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+
+		inline f32 v_reduce_max(f32v a) {
+			const __m128 half{ _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)) };
+			const __m128 pairs{ _mm_max_ps(half, _mm_movehl_ps(half, half)) };
+			return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+		#else
+		using f32v = __m128;
+		constexpr u32 lane_count{ 4 };
+
+		inline f32v v_load(const f32* const p) { return _mm_load_ps(p); }
+		inline void v_store(f32* const p, f32v a) { _mm_store_ps(p, a); }
+		inline f32v v_set(f32 f) { return _mm_set1_ps(f); }
+		inline f32v v_add(f32v a, f32v b) { return _mm_add_ps(a, b); }
+		inline f32v v_sub(f32v a, f32v b) { return _mm_sub_ps(a, b); }
+		inline f32v v_mul(f32v a, f32v b) { return _mm_mul_ps(a, b); }
+		inline f32v v_div(f32v a, f32v b) { return _mm_div_ps(a, b); }
+		inline f32v v_min(f32v a, f32v b) { return _mm_min_ps(a, b); }
+		inline f32v v_max(f32v a, f32v b) { return _mm_max_ps(a, b); }
+		inline f32v v_less(f32v a, f32v b) { return _mm_cmplt_ps(a, b); }
+		inline f32v v_select(f32v mask, f32v a, f32v b) { return _mm_blendv_ps(b, a, mask); }
+		inline f32v v_round(f32v a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+		inline f32 v_sum(f32v a) {
+			const __m128 pairs{ _mm_add_ps(a, _mm_movehl_ps(a, a)) };
+			return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+
+		inline f32 v_reduce_min(f32v a) {
+			const __m128 pairs{ _mm_min_ps(a, _mm_movehl_ps(a, a)) };
+			return _mm_cvtss_f32(_mm_min_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+
+		inline f32 v_reduce_max(f32v a) {
+			const __m128 pairs{ _mm_max_ps(a, _mm_movehl_ps(a, a)) };
+			return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+		}
+		#endif
+
+		constexpr u32 block_pixels{ 16 };
+		constexpr u32 refine_iterations{ 2 };
+
+		// The pixels of a block, one channel after the other, as floats in [0, 255].
+		struct alignas(32) Block {
+			f32 channels[4][block_pixels];
+		};
+
+		// Pixels that don't take part in a fit (transparent pixels in the 3 color mode) have zero weight.
+		struct alignas(32) PixelWeights {
+			f32 weights[block_pixels];
+		};
+
+		// Best pair of 5 or 6 bit endpoints for a solid color, where the color is 2/3 of the first endpoint and
+		// 1/3 of the second one.
+		struct SolidColorTables {
+			u8 match5[256][2];
+			u8 match6[256][2];
+
+			SolidColorTables() {
+				build(match5, 5);
+				build(match6, 6);
+			}
+
+			static void build(u8(&table)[256][2], u32 bits) {
+				const u32 count{ 1u << bits };
+
+				for (u32 value{ 0 }; value < 256; ++value) {
+					u32 best_error{ u32_invalid_id };
+
+					for (u32 e0{ 0 }; e0 < count; ++e0) {
+						for (u32 e1{ 0 }; e1 < count; ++e1) {
+							const u32 c0{ expand(e0, bits) };
+							const u32 c1{ expand(e1, bits) };
+							const s32 color{ (s32)((2 * c0 + c1) / 3) };
+							const u32 error{ (u32)std::abs(color - (s32)value) };
+
+							if (error < best_error) {
+								best_error = error;
+								table[value][0] = (u8)e0;
+								table[value][1] = (u8)e1;
+							}
+						}
+					}
+				}
+			}
+
+			[[nodiscard]] constexpr static u32 expand(u32 value, u32 bits) {
+				return (value << (8 - bits)) | (value >> (2 * bits - 8));
+			}
+		};
+
+		const SolidColorTables solid_color_tables{};
+		const PixelWeights opaque_weights{ { 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f } };
+
+		void load_block(const BlockSurface& surface, u32 block_x, u32 block_y, Block& block) {
+			const u32 x0{ block_x * 4 };
+			const u32 y0{ block_y * 4 };
+			const bool is_partial{ x0 + 4 > surface.width || y0 + 4 > surface.height };
+			const __m128i byte_mask{ _mm_set1_epi32(0xff) };
+
+			for (u32 y{ 0 }; y < 4; ++y) {
+				const u32 row{ std::min(y0 + y, surface.height - 1) };
+				const u8* const source{ &surface.source[(u64)row * surface.source_pitch] };
+				__m128i pixels;
+
+				if (is_partial) {
+					u32 row_pixels[4];
+					for (u32 x{ 0 }; x < 4; ++x) memcpy(&row_pixels[x], &source[std::min(x0 + x, surface.width - 1) * 4], sizeof(u32));
+					pixels = _mm_loadu_si128((const __m128i*)&row_pixels[0]);
+				}
+				else {
+					pixels = _mm_loadu_si128((const __m128i*)&source[x0 * 4]);
+				}
+
+				_mm_store_ps(&block.channels[0][y * 4], _mm_cvtepi32_ps(_mm_and_si128(pixels, byte_mask)));
+				_mm_store_ps(&block.channels[1][y * 4], _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), byte_mask)));
+				_mm_store_ps(&block.channels[2][y * 4], _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), byte_mask)));
+				_mm_store_ps(&block.channels[3][y * 4], _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24)));
+			}
+		}
+
+		[[nodiscard]] u16 quantize_565(const f32* const color) {
+			const u32 r{ (u32)std::clamp((s32)(color[0] * (31.f / 255.f) + .5f), 0, 31) };
+			const u32 g{ (u32)std::clamp((s32)(color[1] * (63.f / 255.f) + .5f), 0, 63) };
+			const u32 b{ (u32)std::clamp((s32)(color[2] * (31.f / 255.f) + .5f), 0, 31) };
+
+			return (u16)((r << 11) | (g << 5) | b);
+		}
+
+		void expand_565(u16 color, f32* const out) {
+			out[0] = (f32)SolidColorTables::expand((color >> 11) & 31, 5);
+			out[1] = (f32)SolidColorTables::expand((color >> 5) & 63, 6);
+			out[2] = (f32)SolidColorTables::expand(color & 31, 5);
+		}
+
+		// Picks the closest of the steps + 1 evenly spaced colors between p0 and p1 for every pixel.
+		// Returns the weighted squared error, and the step of every pixel.
+		f32 fit_color_steps(const Block& block, const PixelWeights& weights, const f32* const p0, const f32* const p1, f32 steps, f32* const pixel_steps) {
+			const f32 d[3]{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const f32 length_sq{ d[0] * d[0] + d[1] * d[1] + d[2] * d[2] };
+			const f32 scale{ length_sq > 0.f ? steps / length_sq : 0.f };
+			const f32v dr{ v_set(d[0] * scale) }, dg{ v_set(d[1] * scale) }, db{ v_set(d[2] * scale) };
+			const f32v step_r{ v_set(d[0] / steps) }, step_g{ v_set(d[1] / steps) }, step_b{ v_set(d[2] / steps) };
+			const f32v r0{ v_set(p0[0]) }, g0{ v_set(p0[1]) }, b0{ v_set(p0[2]) };
+			f32v error{ v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v r{ v_sub(v_load(&block.channels[0][i]), r0) };
+				const f32v g{ v_sub(v_load(&block.channels[1][i]), g0) };
+				const f32v b{ v_sub(v_load(&block.channels[2][i]), b0) };
+				f32v t{ v_add(v_add(v_mul(r, dr), v_mul(g, dg)), v_mul(b, db)) };
+				t = v_min(v_max(v_round(t), v_set(0.f)), v_set(steps));
+				v_store(&pixel_steps[i], t);
+
+				const f32v er{ v_sub(r, v_mul(t, step_r)) };
+				const f32v eg{ v_sub(g, v_mul(t, step_g)) };
+				const f32v eb{ v_sub(b, v_mul(t, step_b)) };
+				const f32v e{ v_add(v_add(v_mul(er, er), v_mul(eg, eg)), v_mul(eb, eb)) };
+				error = v_add(error, v_mul(e, v_load(&weights.weights[i])));
+			}
+
+			return v_sum(error);
+		}
+
+		// Least squares endpoints for the steps the pixels were assigned to. Returns false if the system is singular,
+		// which happens when every pixel is on the same step.
+		bool refine_endpoints(const u32 channel_count, const f32* const* const channels, const f32* const weights,
+			const f32* const pixel_steps, f32 steps, f32* const e0, f32* const e1, f32 max_value = 255.f) {
+			assert(channel_count <= 4);
+			const f32v inverse_steps{ v_set(1.f / steps) };
+			const f32v one{ v_set(1.f) };
+			f32v aa{ v_set(0.f) }, ab{ v_set(0.f) }, bb{ v_set(0.f) };
+			f32v ax[4]{ v_set(0.f), v_set(0.f), v_set(0.f), v_set(0.f) };
+			f32v bx[4]{ v_set(0.f), v_set(0.f), v_set(0.f), v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v w{ v_load(&weights[i]) };
+				const f32v beta{ v_mul(v_load(&pixel_steps[i]), inverse_steps) };
+				const f32v alpha{ v_sub(one, beta) };
+				const f32v walpha{ v_mul(w, alpha) };
+				const f32v wbeta{ v_mul(w, beta) };
+
+				aa = v_add(aa, v_mul(walpha, alpha));
+				ab = v_add(ab, v_mul(walpha, beta));
+				bb = v_add(bb, v_mul(wbeta, beta));
+
+				for (u32 c{ 0 }; c < channel_count; ++c) {
+					const f32v x{ v_load(&channels[c][i]) };
+					ax[c] = v_add(ax[c], v_mul(walpha, x));
+					bx[c] = v_add(bx[c], v_mul(wbeta, x));
+				}
+			}
+
+			const f32 a{ v_sum(aa) }, b{ v_sum(ab) }, c{ v_sum(bb) };
+			const f32 determinant{ a * c - b * b };
+
+			if (std::abs(determinant) < 1e-6f) return false;
+
+			const f32 inverse{ 1.f / determinant };
+
+			for (u32 i{ 0 }; i < channel_count; ++i) {
+				const f32 x{ v_sum(ax[i]) }, y{ v_sum(bx[i]) };
+				e0[i] = std::clamp((c * x - b * y) * inverse, 0.f, max_value);
+				e1[i] = std::clamp((a * y - b * x) * inverse, 0.f, max_value);
+			}
+
+			return true;
+		}
+
+		struct ColorFit {
+			alignas(32) f32 pixel_steps[block_pixels];
+			f32 error{ std::numeric_limits<f32>::max() };
+			u16 c0{ 0 };
+			u16 c1{ 0 };
+		};
+
+		void try_color_endpoints(const Block& block, const PixelWeights& weights, const f32* const e0, const f32* const e1, f32 steps, ColorFit& best) {
+			ColorFit fit{};
+			fit.c0 = quantize_565(e0);
+			fit.c1 = quantize_565(e1);
+
+			f32 p0[3], p1[3];
+			expand_565(fit.c0, p0);
+			expand_565(fit.c1, p1);
+			fit.error = fit_color_steps(block, weights, p0, p1, steps, fit.pixel_steps);
+
+			if (fit.error < best.error) best = fit;
+		}
+
+		// Fits the endpoints along the principal axis of the weighted pixels, then refines them.
+		void fit_color(const Block& block, const PixelWeights& weights, f32 steps, ColorFit& best) {
+			f32v sum_w{ v_set(0.f) };
+			f32v sum[3]{ v_set(0.f), v_set(0.f), v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v w{ v_load(&weights.weights[i]) };
+				sum_w = v_add(sum_w, w);
+				for (u32 c{ 0 }; c < 3; ++c) sum[c] = v_add(sum[c], v_mul(w, v_load(&block.channels[c][i])));
+			}
+
+			const f32 total_weight{ v_sum(sum_w) };
+			assert(total_weight > 0.f);
+			const f32 mean[3]{ v_sum(sum[0]) / total_weight, v_sum(sum[1]) / total_weight, v_sum(sum[2]) / total_weight };
+			const f32v mean_r{ v_set(mean[0]) }, mean_g{ v_set(mean[1]) }, mean_b{ v_set(mean[2]) };
+
+			// Covariance: rr, rg, rb, gg, gb, bb.
+			f32v cov[6]{ v_set(0.f), v_set(0.f), v_set(0.f), v_set(0.f), v_set(0.f), v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v w{ v_load(&weights.weights[i]) };
+				const f32v r{ v_sub(v_load(&block.channels[0][i]), mean_r) };
+				const f32v g{ v_sub(v_load(&block.channels[1][i]), mean_g) };
+				const f32v b{ v_sub(v_load(&block.channels[2][i]), mean_b) };
+				const f32v wr{ v_mul(w, r) }, wg{ v_mul(w, g) };
+				cov[0] = v_add(cov[0], v_mul(wr, r));
+				cov[1] = v_add(cov[1], v_mul(wr, g));
+				cov[2] = v_add(cov[2], v_mul(wr, b));
+				cov[3] = v_add(cov[3], v_mul(wg, g));
+				cov[4] = v_add(cov[4], v_mul(wg, b));
+				cov[5] = v_add(cov[5], v_mul(v_mul(w, b), b));
+			}
+
+			f32 c[6];
+			for (u32 i{ 0 }; i < 6; ++i) c[i] = v_sum(cov[i]);
+
+			// Power iteration, starting from the row of the channel that varies the most.
+			f32 axis[3]{ c[0], c[1], c[2] };
+			if (c[3] > c[0] && c[3] >= c[5]) { axis[0] = c[1]; axis[1] = c[3]; axis[2] = c[4]; }
+			else if (c[5] > c[0] && c[5] > c[3]) { axis[0] = c[2]; axis[1] = c[4]; axis[2] = c[5]; }
+
+			for (u32 i{ 0 }; i < 4; ++i) {
+				const f32 x{ c[0] * axis[0] + c[1] * axis[1] + c[2] * axis[2] };
+				const f32 y{ c[1] * axis[0] + c[3] * axis[1] + c[4] * axis[2] };
+				const f32 z{ c[2] * axis[0] + c[4] * axis[1] + c[5] * axis[2] };
+				const f32 length{ std::max({ std::abs(x), std::abs(y), std::abs(z) }) };
+
+				if (length < 1e-12f) break;
+
+				axis[0] = x / length;
+				axis[1] = y / length;
+				axis[2] = z / length;
+			}
+
+			const f32 length_sq{ axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] };
+
+			if (length_sq < 1e-12f) {
+				try_color_endpoints(block, weights, mean, mean, steps, best);
+				return;
+			}
+
+			// Extent of the weighted pixels along the axis.
+			const f32v ar{ v_set(axis[0] / length_sq) }, ag{ v_set(axis[1] / length_sq) }, ab{ v_set(axis[2] / length_sq) };
+			f32v t_min{ v_set(std::numeric_limits<f32>::max()) };
+			f32v t_max{ v_set(-std::numeric_limits<f32>::max()) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v r{ v_sub(v_load(&block.channels[0][i]), mean_r) };
+				const f32v g{ v_sub(v_load(&block.channels[1][i]), mean_g) };
+				const f32v b{ v_sub(v_load(&block.channels[2][i]), mean_b) };
+				const f32v t{ v_add(v_add(v_mul(r, ar), v_mul(g, ag)), v_mul(b, ab)) };
+				const f32v is_used{ v_less(v_set(0.f), v_load(&weights.weights[i])) };
+				t_min = v_select(is_used, v_min(t_min, t), t_min);
+				t_max = v_select(is_used, v_max(t_max, t), t_max);
+			}
+
+			// Inset the endpoints a little, the pixels at the extremes are usually closer to the interpolated colors.
+			f32 low{ v_reduce_min(t_min) };
+			f32 high{ v_reduce_max(t_max) };
+			const f32 inset{ (high - low) / 32.f };
+			low += inset;
+			high -= inset;
+
+			f32 e0[3], e1[3];
+			for (u32 i{ 0 }; i < 3; ++i) {
+				e0[i] = std::clamp(mean[i] + axis[i] * low, 0.f, 255.f);
+				e1[i] = std::clamp(mean[i] + axis[i] * high, 0.f, 255.f);
+			}
+
+			try_color_endpoints(block, weights, e0, e1, steps, best);
+
+			const f32* const channels[3]{ &block.channels[0][0], &block.channels[1][0], &block.channels[2][0] };
+
+			for (u32 i{ 0 }; i < refine_iterations; ++i) {
+				const f32 error{ best.error };
+
+				if (!refine_endpoints(3, channels, weights.weights, best.pixel_steps, steps, e0, e1)) break;
+
+				try_color_endpoints(block, weights, e0, e1, steps, best);
+
+				if (best.error >= error) break;
+			}
+		}
+
+		// 4 color mode: color0 > color1. The palette is color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1.
+		// BC2 and BC3 always decode 4 colors, BC1 only if color0 > color1.
+		[[nodiscard]] u64 encode_color_block(const Block& block) {
+			const f32* const r{ block.channels[0] };
+			const f32* const g{ block.channels[1] };
+			const f32* const b{ block.channels[2] };
+			bool is_solid{ true };
+
+			for (u32 i{ 1 }; i < block_pixels && is_solid; ++i) {
+				is_solid = r[i] == r[0] && g[i] == g[0] && b[i] == b[0];
+			}
+
+			u16 c0, c1;
+			u32 indicies{ 0 };
+
+			if (is_solid) {
+				const u32 red{ (u32)r[0] }, green{ (u32)g[0] }, blue{ (u32)b[0] };
+				c0 = (u16)((solid_color_tables.match5[red][0] << 11) | (solid_color_tables.match6[green][0] << 5) | solid_color_tables.match5[blue][0]);
+				c1 = (u16)((solid_color_tables.match5[red][1] << 11) | (solid_color_tables.match6[green][1] << 5) | solid_color_tables.match5[blue][1]);
+
+				if (c0 > c1) indicies = 0xaaaaaaaa;
+				else if (c0 < c1) {
+					std::swap(c0, c1);
+					indicies = 0xffffffff;
+				}
+			}
+			else {
+				ColorFit fit{};
+				fit_color(block, opaque_weights, 3.f, fit);
+				c0 = fit.c0;
+				c1 = fit.c1;
+
+				constexpr u32 step_to_index[4]{ 0, 2, 3, 1 };
+				const bool swap{ c0 < c1 };
+				if (swap) std::swap(c0, c1);
+
+				if (c0 != c1) {
+					for (u32 i{ 0 }; i < block_pixels; ++i) {
+						const u32 step{ (u32)fit.pixel_steps[i] };
+						indicies |= step_to_index[swap ? 3 - step : step] << (2 * i);
+					}
+				}
+			}
+
+			return (u64)c0 | ((u64)c1 << 16) | ((u64)indicies << 32);
+		}
+
+		// 3 color mode: color0 <= color1. The palette is color0, color1, 1/2 color0 + 1/2 color1 and transparent black.
+		[[nodiscard]] u64 encode_color_block_with_alpha(const Block& block, f32 alpha_threshold) {
+			PixelWeights weights;
+			u32 transparent{ 0 };
+			f32 total_weight{ 0.f };
+
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				const bool is_transparent{ block.channels[3][i] < alpha_threshold };
+				weights.weights[i] = is_transparent ? 0.f : 1.f;
+				transparent |= (u32)is_transparent << i;
+				total_weight += weights.weights[i];
+			}
+
+			if (!transparent) return encode_color_block(block);
+			if (total_weight == 0.f) return 0xffffffff00000000ull;
+
+			ColorFit fit{};
+			fit_color(block, weights, 2.f, fit);
+			u16 c0{ fit.c0 };
+			u16 c1{ fit.c1 };
+
+			constexpr u32 step_to_index[3]{ 0, 2, 1 };
+			const bool swap{ c0 > c1 };
+			if (swap) std::swap(c0, c1);
+
+			u32 indicies{ 0 };
+
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				const u32 step{ (u32)fit.pixel_steps[i] };
+				const u32 index{ (transparent & (1u << i)) ? 3 : step_to_index[swap ? 2 - step : step] };
+				indicies |= index << (2 * i);
+			}
+
+			return (u64)c0 | ((u64)c1 << 16) | ((u64)indicies << 32);
+		}
+
+		struct AlphaFit {
+			alignas(32) f32 pixel_steps[block_pixels];
+			f32 error{ std::numeric_limits<f32>::max() };
+			u32 e0{ 0 };
+			u32 e1{ 0 };
+		};
+
+		// 8 value mode: endpoint0 > endpoint1, the steps go from endpoint1 (0) to endpoint0 (7).
+		void try_alpha_endpoints_8(const f32* const values, u32 e0, u32 e1, AlphaFit& best) {
+			assert(e0 > e1);
+			AlphaFit fit{};
+			fit.e0 = e0;
+			fit.e1 = e1;
+
+			const f32v low{ v_set((f32)e1) };
+			const f32v range{ v_set((f32)(e0 - e1)) };
+			const f32v scale{ v_set(7.f / (f32)(e0 - e1)) };
+			f32v error{ v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v v{ v_sub(v_load(&values[i]), low) };
+				const f32v t{ v_min(v_max(v_round(v_mul(v, scale)), v_set(0.f)), v_set(7.f)) };
+				v_store(&fit.pixel_steps[i], t);
+				const f32v e{ v_sub(v, v_mul(t, v_mul(range, v_set(1.f / 7.f)))) };
+				error = v_add(error, v_mul(e, e));
+			}
+
+			fit.error = v_sum(error);
+			if (fit.error < best.error) best = fit;
+		}
+
+		// 6 value mode: endpoint0 <= endpoint1, steps 0 to 5 go from endpoint0 to endpoint1, 6 is 0 and 7 is 255.
+		void try_alpha_endpoints_6(const f32* const values, u32 e0, u32 e1, AlphaFit& best) {
+			assert(e0 <= e1);
+			AlphaFit fit{};
+			fit.e0 = e0;
+			fit.e1 = e1;
+
+			const f32v low{ v_set((f32)e0) };
+			const f32v range{ v_set((f32)(e1 - e0)) };
+			const f32v scale{ v_set(e1 > e0 ? 5.f / (f32)(e1 - e0) : 0.f) };
+			f32v error{ v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v x{ v_load(&values[i]) };
+				const f32v v{ v_sub(x, low) };
+				f32v t{ v_min(v_max(v_round(v_mul(v, scale)), v_set(0.f)), v_set(5.f)) };
+				const f32v e{ v_sub(v, v_mul(t, v_mul(range, v_set(1.f / 5.f)))) };
+				f32v e_sq{ v_mul(e, e) };
+
+				const f32v zero_error{ v_mul(x, x) };
+				const f32v use_zero{ v_less(zero_error, e_sq) };
+				t = v_select(use_zero, v_set(6.f), t);
+				e_sq = v_min(e_sq, zero_error);
+
+				const f32v white{ v_sub(v_set(255.f), x) };
+				const f32v white_error{ v_mul(white, white) };
+				const f32v use_white{ v_less(white_error, e_sq) };
+				t = v_select(use_white, v_set(7.f), t);
+				e_sq = v_min(e_sq, white_error);
+
+				v_store(&fit.pixel_steps[i], t);
+				error = v_add(error, e_sq);
+			}
+
+			fit.error = v_sum(error);
+			if (fit.error < best.error) best = fit;
+		}
+
+		[[nodiscard]] u32 round_endpoint(f32 value) {
+			return (u32)std::clamp((s32)(value + .5f), 0, 255);
+		}
+
+		[[nodiscard]] u64 encode_alpha_block(const f32* const values) {
+			f32v v_low{ v_load(values) };
+			f32v v_high{ v_low };
+
+			for (u32 i{ lane_count }; i < block_pixels; i += lane_count) {
+				v_low = v_min(v_low, v_load(&values[i]));
+				v_high = v_max(v_high, v_load(&values[i]));
+			}
+
+			const u32 low{ (u32)v_reduce_min(v_low) };
+			const u32 high{ (u32)v_reduce_max(v_high) };
+
+			if (low == high) return (u64)low | ((u64)low << 8);
+
+			AlphaFit fit{};
+			try_alpha_endpoints_8(values, high, low, fit);
+
+			for (u32 i{ 0 }; i < refine_iterations; ++i) {
+				const f32 error{ fit.error };
+				f32 e1, e0;
+
+				if (!refine_endpoints(1, &values, opaque_weights.weights, fit.pixel_steps, 7.f, &e1, &e0)) break;
+
+				const u32 q0{ round_endpoint(e0) };
+				const u32 q1{ round_endpoint(e1) };
+
+				if (q0 <= q1) break;
+
+				try_alpha_endpoints_8(values, q0, q1, fit);
+
+				if (fit.error >= error) break;
+			}
+
+			const bool use_6_values{ fit.error > 0.f && (low == 0 || high == 255) };
+
+			if (use_6_values) {
+				// The endpoints only have to cover the values between black and white.
+				u32 inner_low{ 255 }, inner_high{ 0 };
+
+				for (u32 i{ 0 }; i < block_pixels; ++i) {
+					const u32 value{ (u32)values[i] };
+					if (value == 0 || value == 255) continue;
+					inner_low = std::min(inner_low, value);
+					inner_high = std::max(inner_high, value);
+				}
+
+				if (inner_low > inner_high) inner_low = inner_high = 0;
+
+				try_alpha_endpoints_6(values, inner_low, inner_high, fit);
+			}
+
+			u64 block{ 0 };
+
+			if (fit.e0 > fit.e1) {
+				// Steps from endpoint1 to endpoint0 to indicies: 0 is endpoint1 (1), 7 is endpoint0 (0), the rest is 8 - step.
+				for (u32 i{ 0 }; i < block_pixels; ++i) {
+					const u32 step{ (u32)fit.pixel_steps[i] };
+					const u64 index{ step == 0 ? 1u : step == 7 ? 0u : 8 - step };
+					block |= index << (16 + 3 * i);
+				}
+			}
+			else {
+				// Steps from endpoint0 to endpoint1 to indicies: 0 is endpoint0 (0), 5 is endpoint1 (1), the rest is step + 1.
+				for (u32 i{ 0 }; i < block_pixels; ++i) {
+					const u32 step{ (u32)fit.pixel_steps[i] };
+					const u64 index{ step == 0 ? 0u : step == 5 ? 1u : step >= 6 ? step : step + 1 };
+					block |= index << (16 + 3 * i);
+				}
+			}
+
+			return block | (u64)fit.e0 | ((u64)fit.e1 << 8);
+		}
+
+		// Subset 1 pixels of the 2 subset partitions of BC7 (and BC6H, which uses the first 32), bit i is pixel i.
+		constexpr u16 partition_table[64]{
+			0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+			0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+			0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+			0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+		};
+
+		// The anchor pixel of subset 1, the anchor of subset 0 is always pixel 0.
+		constexpr u8 anchor_table[64]{
+			15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+			15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+		};
+
+		constexpr u32 partition_count{ _countof(partition_table) };
+
+		// Interpolation weights out of 64 for 2, 3 and 4 bit indicies.
+		constexpr u8 weights2[4]{ 0, 21, 43, 64 };
+		constexpr u8 weights3[8]{ 0, 9, 18, 27, 37, 46, 55, 64 };
+		constexpr u8 weights4[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		[[nodiscard]] constexpr const u8* get_weights(u32 index_bits) {
+			return index_bits == 2 ? &weights2[0] : index_bits == 3 ? &weights3[0] : &weights4[0];
+		}
+
+		struct QualitySettings {
+			u32 refine_iterations;
+			u32 partitions_to_fit;		// 2 subset partitions fitted, the best ones by estimated error
+			bool try_all_rotations;		// BC7 mode 5 rotations, only the first one otherwise
+			bool try_all_pbits;			// every p-bit combination instead of the one closest to the endpoints
+			bool try_more_modes;		// BC7 modes 1, 3, 5 and 7, BC6H mode 12
+			bool perturb_endpoints;		// BC6H: tries the neighbours of the quantized endpoints
+		};
+
+		constexpr QualitySettings quality_settings[BlockQuality::count]{
+			{ 1, 0, false, false, false, false },	// FAST
+			{ 2, 4, false, false, true, false },	// NORMAL
+			{ 3, partition_count, true, true, true, true },	// PRODUCTION
+		};
+
+		struct PBits {
+			enum Type : u32 {
+				NONE = 0,
+				SHARED,
+				UNIQUE,
+			};
+		};
+
+		// How a mode stores the endpoints of a subset. The channels have the same number of bits, p-bits not included.
+		struct EndpointFormat {
+			u32 bits;
+			PBits::Type pbits;
+		};
+
+		// 16 bytes of a block, written from the lowest bit.
+		struct BlockWriter {
+			u64 bits[2]{};
+			u32 position{ 0 };
+
+			void write(u32 value, u32 count) {
+				assert(count <= 32 && position + count <= 128);
+				const u64 v{ value & ((1ull << count) - 1) };
+
+				if (position < 64) {
+					bits[0] |= v << position;
+					if (position + count > 64) bits[1] |= v >> (64 - position);
+				}
+				else {
+					bits[1] |= v << (position - 64);
+				}
+
+				position += count;
+			}
+		};
+
+		// The channels of the block a subset is fitted to, and the pixels that belong to the subset.
+		struct FitInput {
+			const f32* channels[4];
+			u32 channel_count;
+			const f32* weights;
+			u32 index_bits;
+			f32 max_value;
+		};
+
+		struct SubsetFit {
+			alignas(32) f32 betas[block_pixels];	// interpolation weight of every pixel, out of 64
+			u32 codes[2][4];
+			u32 pbits[2];
+			u8 indicies[block_pixels];
+			f32 error{ std::numeric_limits<f32>::max() };
+		};
+
+		// Fits the endpoints along the principal axis of the pixels of the subset, without insetting them.
+		void principal_endpoints(const FitInput& in, f32 (&e)[2][4]) {
+			const u32 n{ in.channel_count };
+			f32v sum_w{ v_set(0.f) };
+			f32v sum[4]{ v_set(0.f), v_set(0.f), v_set(0.f), v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v w{ v_load(&in.weights[i]) };
+				sum_w = v_add(sum_w, w);
+				for (u32 c{ 0 }; c < n; ++c) sum[c] = v_add(sum[c], v_mul(w, v_load(&in.channels[c][i])));
+			}
+
+			const f32 total_weight{ v_sum(sum_w) };
+			assert(total_weight > 0.f);
+			f32 mean[4]{};
+			for (u32 c{ 0 }; c < n; ++c) mean[c] = v_sum(sum[c]) / total_weight;
+
+			f32v cov[4][4];
+			for (u32 a{ 0 }; a < n; ++a) for (u32 b{ a }; b < n; ++b) cov[a][b] = v_set(0.f);
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				const f32v w{ v_load(&in.weights[i]) };
+				f32v d[4];
+				for (u32 c{ 0 }; c < n; ++c) d[c] = v_sub(v_load(&in.channels[c][i]), v_set(mean[c]));
+
+				for (u32 a{ 0 }; a < n; ++a) {
+					const f32v wd{ v_mul(w, d[a]) };
+					for (u32 b{ a }; b < n; ++b) cov[a][b] = v_add(cov[a][b], v_mul(wd, d[b]));
+				}
+			}
+
+			f32 c[4][4]{};
+			for (u32 a{ 0 }; a < n; ++a) for (u32 b{ a }; b < n; ++b) c[a][b] = c[b][a] = v_sum(cov[a][b]);
+
+			// Power iteration, starting from the row of the channel that varies the most.
+			u32 largest{ 0 };
+			for (u32 a{ 1 }; a < n; ++a) if (c[a][a] > c[largest][largest]) largest = a;
+
+			f32 axis[4]{};
+			for (u32 a{ 0 }; a < n; ++a) axis[a] = c[largest][a];
+
+			for (u32 i{ 0 }; i < 4; ++i) {
+				f32 next[4]{};
+				f32 length{ 0.f };
+
+				for (u32 a{ 0 }; a < n; ++a) {
+					for (u32 b{ 0 }; b < n; ++b) next[a] += c[a][b] * axis[b];
+					length = std::max(length, std::abs(next[a]));
+				}
+
+				if (length < 1e-12f) break;
+
+				for (u32 a{ 0 }; a < n; ++a) axis[a] = next[a] / length;
+			}
+
+			f32 length_sq{ 0.f };
+			for (u32 a{ 0 }; a < n; ++a) length_sq += axis[a] * axis[a];
+
+			f32 low{ 0.f }, high{ 0.f };
+
+			if (length_sq > 1e-12f) {
+				low = std::numeric_limits<f32>::max();
+				high = -std::numeric_limits<f32>::max();
+
+				for (u32 i{ 0 }; i < block_pixels; ++i) {
+					if (in.weights[i] == 0.f) continue;
+
+					f32 t{ 0.f };
+					for (u32 a{ 0 }; a < n; ++a) t += (in.channels[a][i] - mean[a]) * axis[a];
+					t /= length_sq;
+					low = std::min(low, t);
+					high = std::max(high, t);
+				}
+			}
+
+			for (u32 a{ 0 }; a < n; ++a) {
+				e[0][a] = std::clamp(mean[a] + axis[a] * low, 0.f, in.max_value);
+				e[1][a] = std::clamp(mean[a] + axis[a] * high, 0.f, in.max_value);
+			}
+		}
+
+		// Picks the closest palette entry for every pixel of the subset, testing all of them.
+		// Returns the squared error of the subset.
+		f32 assign_indicies(const FitInput& in, const s32 (&palette)[16][4], SubsetFit& fit) {
+			const u32 n{ in.channel_count };
+			const u32 entry_count{ 1u << in.index_bits };
+			const u8* const weights{ get_weights(in.index_bits) };
+			alignas(32) f32 indicies[block_pixels];
+			f32v error{ v_set(0.f) };
+
+			for (u32 i{ 0 }; i < block_pixels; i += lane_count) {
+				f32v x[4];
+				for (u32 c{ 0 }; c < n; ++c) x[c] = v_load(&in.channels[c][i]);
+
+				f32v best_error{ v_set(std::numeric_limits<f32>::max()) };
+				f32v best_index{ v_set(0.f) };
+
+				for (u32 k{ 0 }; k < entry_count; ++k) {
+					const f32v d{ v_sub(x[0], v_set((f32)palette[k][0])) };
+					f32v e{ v_mul(d, d) };
+
+					for (u32 c{ 1 }; c < n; ++c) {
+						const f32v dc{ v_sub(x[c], v_set((f32)palette[k][c])) };
+						e = v_add(e, v_mul(dc, dc));
+					}
+
+					best_index = v_select(v_less(e, best_error), v_set((f32)k), best_index);
+					best_error = v_min(e, best_error);
+				}
+
+				v_store(&indicies[i], best_index);
+				error = v_add(error, v_mul(best_error, v_load(&in.weights[i])));
+			}
+
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				if (in.weights[i] == 0.f) continue;
+
+				const u32 index{ (u32)indicies[i] };
+				fit.indicies[i] = (u8)index;
+				fit.betas[i] = (f32)weights[index];
+			}
+
+			return v_sum(error);
+		}
+
+		[[nodiscard]] constexpr u32 expand_bits(u32 value, u32 bits) {
+			return bits >= 8 ? value : (value << (8 - bits)) | (value >> (2 * bits - 8));
+		}
+
+		// Closest code to value with the p-bit given, or with no p-bit if pbit is u32_invalid_id.
+		u32 quantize_bc7_channel(f32 value, u32 bits, u32 pbit, u32& expanded) {
+			const bool has_pbit{ pbit != u32_invalid_id };
+			const u32 total_bits{ bits + (has_pbit ? 1 : 0) };
+			const s32 max_code{ (1 << bits) - 1 };
+			f32 code{ value * (f32)((1 << total_bits) - 1) / 255.f };
+			if (has_pbit) code = (code - (f32)pbit) * .5f;
+
+			const s32 low{ std::clamp((s32)code, 0, max_code) };
+			const s32 high{ std::min(low + 1, max_code) };
+			const auto expand = [&](s32 q) { return expand_bits(has_pbit ? ((u32)q << 1) | pbit : (u32)q, total_bits); };
+			const u32 low_value{ expand(low) };
+			const u32 high_value{ expand(high) };
+
+			if (std::abs((f32)low_value - value) <= std::abs((f32)high_value - value)) {
+				expanded = low_value;
+				return (u32)low;
+			}
+
+			expanded = high_value;
+			return (u32)high;
+		}
+
+		// Quantizes the endpoints with the given p-bits, bit 0 for endpoint 0 and bit 1 for endpoint 1 (p-bits shared
+		// by the endpoints only use bit 0). Returns the quantization error, colors are the expanded endpoints.
+		f32 quantize_bc7_endpoints(const FitInput& in, const f32 (&e)[2][4], EndpointFormat format, u32 pbits, SubsetFit& fit, s32 (&colors)[2][4]) {
+			f32 error{ 0.f };
+
+			for (u32 j{ 0 }; j < 2; ++j) {
+				const u32 pbit{ format.pbits == PBits::NONE ? u32_invalid_id : format.pbits == PBits::SHARED ? pbits & 1 : (pbits >> j) & 1 };
+				fit.pbits[j] = pbit;
+
+				for (u32 c{ 0 }; c < in.channel_count; ++c) {
+					u32 expanded;
+					fit.codes[j][c] = quantize_bc7_channel(e[j][c], format.bits, pbit, expanded);
+					colors[j][c] = (s32)expanded;
+					error += ((f32)expanded - e[j][c]) * ((f32)expanded - e[j][c]);
+				}
+			}
+
+			return error;
+		}
+
+		void try_bc7_endpoints(const FitInput& in, const f32 (&e)[2][4], EndpointFormat format, bool try_all_pbits, SubsetFit& best) {
+			const u32 combinations{ format.pbits == PBits::NONE ? 1u : format.pbits == PBits::SHARED ? 2u : 4u };
+			const u8* const weights{ get_weights(in.index_bits) };
+			f32 closest{ std::numeric_limits<f32>::max() };
+			SubsetFit fit{};
+			s32 colors[2][4];
+
+			for (u32 p{ 0 }; p < combinations; ++p) {
+				SubsetFit candidate{};
+				s32 candidate_colors[2][4];
+				const f32 quantization_error{ quantize_bc7_endpoints(in, e, format, p, candidate, candidate_colors) };
+
+				// Without trying them all, only the p-bits closest to the endpoints are evaluated.
+				if (!try_all_pbits) {
+					if (quantization_error < closest) {
+						closest = quantization_error;
+						fit = candidate;
+						memcpy(colors, candidate_colors, sizeof(colors));
+					}
+
+					if (p + 1 < combinations) continue;
+				}
+				else {
+					fit = candidate;
+					memcpy(colors, candidate_colors, sizeof(colors));
+				}
+
+				s32 palette[16][4];
+				for (u32 k{ 0 }; k < (1u << in.index_bits); ++k) {
+					for (u32 c{ 0 }; c < in.channel_count; ++c) {
+						palette[k][c] = (colors[0][c] * (64 - weights[k]) + colors[1][c] * weights[k] + 32) >> 6;
+					}
+				}
+
+				fit.error = assign_indicies(in, palette, fit);
+				if (fit.error < best.error) best = fit;
+			}
+		}
+
+		void fit_bc7_subset(const FitInput& in, EndpointFormat format, const QualitySettings& quality, SubsetFit& best) {
+			f32 e[2][4];
+			principal_endpoints(in, e);
+			try_bc7_endpoints(in, e, format, quality.try_all_pbits, best);
+
+			for (u32 i{ 0 }; i < quality.refine_iterations; ++i) {
+				const f32 error{ best.error };
+
+				if (!refine_endpoints(in.channel_count, in.channels, in.weights, best.betas, 64.f, e[0], e[1])) break;
+
+				try_bc7_endpoints(in, e, format, quality.try_all_pbits, best);
+
+				if (best.error >= error) break;
+			}
+		}
+
+		// The index of the anchor pixel is stored without its highest bit, which has to be 0.
+		// If it isn't, the endpoints of the subset swap, which mirrors the indicies.
+		void fix_anchor(SubsetFit& fit, const f32* const weights, u32 anchor, u32 index_bits, u32 channel_count) {
+			const u32 last{ (1u << index_bits) - 1 };
+
+			if (fit.indicies[anchor] <= last / 2) return;
+
+			for (u32 c{ 0 }; c < channel_count; ++c) std::swap(fit.codes[0][c], fit.codes[1][c]);
+			std::swap(fit.pbits[0], fit.pbits[1]);
+
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				if (weights[i] != 0.f) fit.indicies[i] = (u8)(last - fit.indicies[i]);
+			}
+		}
+
+		struct EncodedBlock {
+			u64 bits[2]{};
+			f32 error{ std::numeric_limits<f32>::max() };
+		};
+
+		void write_indicies(BlockWriter& writer, const u8* const indicies, u32 index_bits, u32 anchor0, u32 anchor1 = u32_invalid_id) {
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				writer.write(indicies[i], i == anchor0 || i == anchor1 ? index_bits - 1 : index_bits);
+			}
+		}
+
+		// Mode 6: one subset, RGBA 7 bit endpoints with a p-bit each and 4 bit indicies.
+		void encode_bc7_mode6(const Block& block, const QualitySettings& quality, EncodedBlock& best) {
+			const FitInput in{ { block.channels[0], block.channels[1], block.channels[2], block.channels[3] }, 4, opaque_weights.weights, 4, 255.f };
+			SubsetFit fit{};
+			fit_bc7_subset(in, { 7, PBits::UNIQUE }, quality, fit);
+
+			if (fit.error >= best.error) return;
+
+			fix_anchor(fit, in.weights, 0, 4, 4);
+
+			BlockWriter writer{};
+			writer.write(1u << 6, 7);
+			for (u32 c{ 0 }; c < 4; ++c) {
+				writer.write(fit.codes[0][c], 7);
+				writer.write(fit.codes[1][c], 7);
+			}
+			writer.write(fit.pbits[0], 1);
+			writer.write(fit.pbits[1], 1);
+			write_indicies(writer, fit.indicies, 4, 0);
+			assert(writer.position == 128);
+
+			best.bits[0] = writer.bits[0];
+			best.bits[1] = writer.bits[1];
+			best.error = fit.error;
+		}
+
+		// Mode 5: one subset, 7 bit RGB and 8 bit alpha endpoints, with 2 bit indicies for each. The rotation swaps
+		// alpha with one of the color channels, so that channel gets its own indicies.
+		void encode_bc7_mode5(const Block& block, u32 rotation, const QualitySettings& quality, EncodedBlock& best) {
+			const f32* channels[4]{ block.channels[0], block.channels[1], block.channels[2], block.channels[3] };
+			if (rotation) std::swap(channels[rotation - 1], channels[3]);
+
+			const FitInput color_in{ { channels[0], channels[1], channels[2] }, 3, opaque_weights.weights, 2, 255.f };
+			const FitInput alpha_in{ { channels[3] }, 1, opaque_weights.weights, 2, 255.f };
+			SubsetFit color{}, alpha{};
+			fit_bc7_subset(color_in, { 7, PBits::NONE }, quality, color);
+			fit_bc7_subset(alpha_in, { 8, PBits::NONE }, quality, alpha);
+
+			if (color.error + alpha.error >= best.error) return;
+
+			fix_anchor(color, opaque_weights.weights, 0, 2, 3);
+			fix_anchor(alpha, opaque_weights.weights, 0, 2, 1);
+
+			BlockWriter writer{};
+			writer.write(1u << 5, 6);
+			writer.write(rotation, 2);
+			for (u32 c{ 0 }; c < 3; ++c) {
+				writer.write(color.codes[0][c], 7);
+				writer.write(color.codes[1][c], 7);
+			}
+			writer.write(alpha.codes[0][0], 8);
+			writer.write(alpha.codes[1][0], 8);
+			write_indicies(writer, color.indicies, 2, 0);
+			write_indicies(writer, alpha.indicies, 2, 0);
+			assert(writer.position == 128);
+
+			best.bits[0] = writer.bits[0];
+			best.bits[1] = writer.bits[1];
+			best.error = color.error + alpha.error;
+		}
+
+		struct TwoSubsetMode {
+			u32 mode;
+			u32 channel_count;
+			EndpointFormat format;
+			u32 index_bits;
+		};
+
+		// Modes 1 and 3 are RGB only and decode to opaque alpha, mode 7 is RGBA.
+		constexpr TwoSubsetMode bc7_mode1{ 1, 3, { 6, PBits::SHARED }, 3 };
+		constexpr TwoSubsetMode bc7_mode3{ 3, 3, { 7, PBits::UNIQUE }, 2 };
+		constexpr TwoSubsetMode bc7_mode7{ 7, 4, { 5, PBits::UNIQUE }, 2 };
+
+		// The pixels of the two subsets of every partition, as weights for the fits, and by pixel for the estimates.
+		struct PartitionMasks {
+			PixelWeights subsets[partition_count][2];
+			alignas(32) f32 by_pixel[block_pixels][partition_count];
+
+			PartitionMasks() {
+				for (u32 p{ 0 }; p < partition_count; ++p) {
+					for (u32 i{ 0 }; i < block_pixels; ++i) {
+						const bool is_subset1{ ((partition_table[p] >> i) & 1) != 0 };
+						subsets[p][0].weights[i] = is_subset1 ? 0.f : 1.f;
+						subsets[p][1].weights[i] = is_subset1 ? 1.f : 0.f;
+						by_pixel[i][p] = is_subset1 ? 1.f : 0.f;
+					}
+				}
+			}
+		};
+
+		const PartitionMasks partition_masks{};
+
+		void encode_bc7_two_subsets(const Block& block, const TwoSubsetMode& mode, u32 partition, const QualitySettings& quality, EncodedBlock& best) {
+			const PixelWeights (&subsets)[2]{ partition_masks.subsets[partition] };
+			const u32 n{ mode.channel_count };
+			SubsetFit fits[2]{};
+			f32 error{ 0.f };
+
+			for (u32 s{ 0 }; s < 2; ++s) {
+				const FitInput in{ { block.channels[0], block.channels[1], block.channels[2], block.channels[3] }, n, subsets[s].weights, mode.index_bits, 255.f };
+				fit_bc7_subset(in, mode.format, quality, fits[s]);
+				error += fits[s].error;
+
+				if (error >= best.error) return;
+			}
+
+			fix_anchor(fits[0], subsets[0].weights, 0, mode.index_bits, n);
+			fix_anchor(fits[1], subsets[1].weights, anchor_table[partition], mode.index_bits, n);
+
+			u8 indicies[block_pixels];
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				indicies[i] = fits[(partition_table[partition] >> i) & 1].indicies[i];
+			}
+
+			BlockWriter writer{};
+			writer.write(1u << mode.mode, mode.mode + 1);
+			writer.write(partition, 6);
+			for (u32 c{ 0 }; c < n; ++c) {
+				for (u32 s{ 0 }; s < 2; ++s) {
+					writer.write(fits[s].codes[0][c], mode.format.bits);
+					writer.write(fits[s].codes[1][c], mode.format.bits);
+				}
+			}
+
+			if (mode.format.pbits == PBits::SHARED) {
+				writer.write(fits[0].pbits[0], 1);
+				writer.write(fits[1].pbits[0], 1);
+			}
+			else {
+				for (u32 s{ 0 }; s < 2; ++s) {
+					writer.write(fits[s].pbits[0], 1);
+					writer.write(fits[s].pbits[1], 1);
+				}
+			}
+
+			write_indicies(writer, indicies, mode.index_bits, 0, anchor_table[partition]);
+			assert(writer.position == 128);
+
+			best.bits[0] = writer.bits[0];
+			best.bits[1] = writer.bits[1];
+			best.error = error;
+		}
+
+		// Sorts the partitions by how far the pixels of their subsets are from a line, the error a subset has even
+		// with unquantized endpoints and indicies. The first count partitions are written to partitions.
+		// The lanes work on different partitions, from the sums of the channels and of their products.
+		void estimate_partitions(const Block& block, u32 channel_count, u32* const partitions, u32 count) {
+			constexpr u32 max_terms{ 1 + 4 + 10 };
+			const u32 n{ channel_count };
+			const u32 term_count{ 1 + n + n * (n + 1) / 2 };
+			f32 terms[block_pixels][max_terms];
+			f32 totals[max_terms]{};
+
+			for (u32 i{ 0 }; i < block_pixels; ++i) {
+				u32 t{ 0 };
+				terms[i][t++] = 1.f;
+				for (u32 a{ 0 }; a < n; ++a) terms[i][t++] = block.channels[a][i];
+				for (u32 a{ 0 }; a < n; ++a) for (u32 b{ a }; b < n; ++b) terms[i][t++] = block.channels[a][i] * block.channels[b][i];
+				for (u32 t{ 0 }; t < term_count; ++t) totals[t] += terms[i][t];
+			}
+
+			alignas(32) f32 errors[partition_count];
+			const f32v zero{ v_set(0.f) };
+
+			for (u32 p{ 0 }; p < partition_count; p += lane_count) {
+				f32v sums[2][max_terms];
+				for (u32 t{ 0 }; t < term_count; ++t) sums[1][t] = zero;
+
+				for (u32 i{ 0 }; i < block_pixels; ++i) {
+					const f32v mask{ v_load(&partition_masks.by_pixel[i][p]) };
+					for (u32 t{ 0 }; t < term_count; ++t) sums[1][t] = v_add(sums[1][t], v_mul(mask, v_set(terms[i][t])));
+				}
+
+				for (u32 t{ 0 }; t < term_count; ++t) sums[0][t] = v_sub(v_set(totals[t]), sums[1][t]);
+
+				f32v error{ zero };
+
+				for (u32 s{ 0 }; s < 2; ++s) {
+					const f32v* const sum{ sums[s] };
+					const f32v inverse_count{ v_div(v_set(1.f), sum[0]) };
+					f32v c[4][4];
+					f32v trace{ zero };
+					u32 t{ 1 + n };
+
+					for (u32 a{ 0 }; a < n; ++a) {
+						for (u32 b{ a }; b < n; ++b) {
+							c[a][b] = c[b][a] = v_sub(sum[t++], v_mul(v_mul(sum[1 + a], sum[1 + b]), inverse_count));
+						}
+						trace = v_add(trace, c[a][a]);
+					}
+
+					// Power iteration, the largest component of the axis is kept at 1, so it converges to the eigenvalue.
+					f32v axis[4]{ v_set(1.f), v_set(1.f), v_set(1.f), v_set(1.f) };
+					f32v eigenvalue{ zero };
+
+					for (u32 i{ 0 }; i < 3; ++i) {
+						f32v next[4];
+						eigenvalue = zero;
+
+						for (u32 a{ 0 }; a < n; ++a) {
+							next[a] = v_mul(c[a][0], axis[0]);
+							for (u32 b{ 1 }; b < n; ++b) next[a] = v_add(next[a], v_mul(c[a][b], axis[b]));
+							eigenvalue = v_max(eigenvalue, v_max(next[a], v_sub(zero, next[a])));
+						}
+
+						const f32v inverse{ v_div(v_set(1.f), v_max(eigenvalue, v_set(1e-12f))) };
+						for (u32 a{ 0 }; a < n; ++a) axis[a] = v_mul(next[a], inverse);
+					}
+
+					error = v_add(error, v_max(v_sub(trace, eigenvalue), zero));
+				}
+
+				v_store(&errors[p], error);
+			}
+
+			u32 order[partition_count];
+			for (u32 p{ 0 }; p < partition_count; ++p) order[p] = p;
+			std::partial_sort(&order[0], &order[count], &order[partition_count], [&](u32 a, u32 b) { return errors[a] < errors[b]; });
+			memcpy(partitions, &order[0], count * sizeof(u32));
+		}
+
+		void encode_bc7_block(const Block& block, BlockQuality::Type quality_level, u64 (&encoded)[2]) {
+			const QualitySettings& quality{ quality_settings[quality_level] };
+			bool is_opaque{ true };
+
+			for (u32 i{ 0 }; i < block_pixels && is_opaque; ++i) is_opaque = block.channels[3][i] == 255.f;
+
+			EncodedBlock best{};
+			encode_bc7_mode6(block, quality, best);
+
+			if (best.error > 0.f && quality.try_more_modes) {
+				if (!is_opaque) {
+					const u32 rotations{ quality.try_all_rotations ? 4u : 1u };
+					for (u32 r{ 0 }; r < rotations; ++r) encode_bc7_mode5(block, r, quality, best);
+				}
+
+				u32 partitions[partition_count];
+				const u32 count{ std::min(quality.partitions_to_fit, partition_count) };
+				estimate_partitions(block, is_opaque ? 3 : 4, partitions, count);
+
+				for (u32 i{ 0 }; i < count && best.error > 0.f; ++i) {
+					if (is_opaque) {
+						encode_bc7_two_subsets(block, bc7_mode1, partitions[i], quality, best);
+						encode_bc7_two_subsets(block, bc7_mode3, partitions[i], quality, best);
+					}
+					else {
+						encode_bc7_two_subsets(block, bc7_mode7, partitions[i], quality, best);
+					}
+				}
+			}
+
+			encoded[0] = best.bits[0];
+			encoded[1] = best.bits[1];
+		}
+
+		// BC6H works on the bits of the half floats, which is what it interpolates. Negative values, infinity and NaN
+		// aren't representable in the unsigned format, they're clamped.
+		constexpr u32 max_half{ 0x7bff };
+
+		void load_half_block(const BlockSurface& surface, u32 block_x, u32 block_y, Block& block) {
+			const u32 x0{ block_x * 4 };
+			const u32 y0{ block_y * 4 };
+
+			for (u32 y{ 0 }; y < 4; ++y) {
+				const u32 row{ std::min(y0 + y, surface.height - 1) };
+				const u16* const source{ (const u16*)&surface.source[(u64)row * surface.source_pitch] };
+
+				for (u32 x{ 0 }; x < 4; ++x) {
+					const u16* const pixel{ &source[std::min(x0 + x, surface.width - 1) * 4] };
+
+					for (u32 c{ 0 }; c < 3; ++c) {
+						const u32 half{ pixel[c] };
+						block.channels[c][y * 4 + x] = (f32)((half & 0x8000) ? 0 : std::min(half, max_half));
+					}
+
+					block.channels[3][y * 4 + x] = 0.f;
+				}
+			}
+		}
+
+		[[nodiscard]] constexpr u32 unquantize_bc6h(u32 code, u32 bits) {
+			return code == 0 ? 0 : code == (1u << bits) - 1 ? 0xffff : ((code << 16) + 0x8000) >> bits;
+		}
+
+		[[nodiscard]] constexpr u32 finish_bc6h(u32 value) {
+			return (value * 31) >> 6;
+		}
+
+		// Closest code with the given bits to a half value, in what the endpoint decodes to.
+		u32 quantize_bc6h_channel(f32 value, u32 bits) {
+			const s32 max_code{ (1 << bits) - 1 };
+			const s32 guess{ (s32)(value * (64.f / 31.f) * (f32)(1 << bits) / 65536.f) };
+			u32 best_code{ 0 };
+			f32 best_error{ std::numeric_limits<f32>::max() };
+
+			for (s32 code{ std::max(guess - 1, 0) }; code <= std::min(guess + 1, max_code); ++code) {
+				const f32 error{ std::abs((f32)finish_bc6h(unquantize_bc6h((u32)code, bits)) - value) };
+
+				if (error < best_error) {
+					best_error = error;
+					best_code = (u32)code;
+				}
+			}
+
+			return best_code;
+		}
+
+		struct BC6HMode {
+			u32 mode_bits;
+			u32 endpoint_bits;
+			u32 delta_bits;		// 0 if the second endpoint isn't stored as a delta from the first one
+		};
+
+		// Modes 11 and 12 of the single region modes: 10 bit endpoints, and 11 bit first endpoint with a 9 bit delta.
+		constexpr BC6HMode bc6h_mode11{ 0x03, 10, 0 };
+		constexpr BC6HMode bc6h_mode12{ 0x07, 11, 9 };
+
+		// Limits the second endpoint to what the delta can reach from the first one.
+		void clamp_bc6h_delta(const BC6HMode& mode, SubsetFit& fit) {
+			if (!mode.delta_bits) return;
+
+			const s32 delta_min{ -(1 << (mode.delta_bits - 1)) };
+			const s32 delta_max{ (1 << (mode.delta_bits - 1)) - 1 };
+			const s32 max_code{ (1 << mode.endpoint_bits) - 1 };
+
+			for (u32 c{ 0 }; c < 3; ++c) {
+				const s32 base{ (s32)fit.codes[0][c] };
+				fit.codes[1][c] = (u32)std::clamp((s32)fit.codes[1][c], std::max(base + delta_min, 0), std::min(base + delta_max, max_code));
+			}
+		}
+
+		[[nodiscard]] bool is_bc6h_delta_valid(const BC6HMode& mode, const SubsetFit& fit) {
+			if (!mode.delta_bits) return true;
+
+			for (u32 c{ 0 }; c < 3; ++c) {
+				const s32 delta{ (s32)fit.codes[1][c] - (s32)fit.codes[0][c] };
+				if (delta < -(1 << (mode.delta_bits - 1)) || delta >= (1 << (mode.delta_bits - 1))) return false;
+			}
+
+			return true;
+		}
+
+		void evaluate_bc6h_codes(const FitInput& in, const BC6HMode& mode, SubsetFit& fit) {
+			s32 palette[16][4];
+			u32 endpoints[2][3];
+
+			for (u32 j{ 0 }; j < 2; ++j) {
+				for (u32 c{ 0 }; c < 3; ++c) endpoints[j][c] = unquantize_bc6h(fit.codes[j][c], mode.endpoint_bits);
+			}
+
+			for (u32 k{ 0 }; k < 16; ++k) {
+				for (u32 c{ 0 }; c < 3; ++c) {
+					palette[k][c] = (s32)finish_bc6h((endpoints[0][c] * (64 - weights4[k]) + endpoints[1][c] * weights4[k] + 32) >> 6);
+				}
+			}
+
+			fit.error = assign_indicies(in, palette, fit);
+		}
+
+		void try_bc6h_endpoints(const FitInput& in, const BC6HMode& mode, const f32 (&e)[2][4], SubsetFit& best) {
+			SubsetFit fit{};
+
+			for (u32 j{ 0 }; j < 2; ++j) {
+				for (u32 c{ 0 }; c < 3; ++c) fit.codes[j][c] = quantize_bc6h_channel(e[j][c], mode.endpoint_bits);
+			}
+
+			clamp_bc6h_delta(mode, fit);
+			evaluate_bc6h_codes(in, mode, fit);
+
+			if (fit.error < best.error) best = fit;
+		}
+
+		// Moves every endpoint channel one code up or down while that lowers the error.
+		void perturb_bc6h_endpoints(const FitInput& in, const BC6HMode& mode, SubsetFit& best) {
+			const u32 max_code{ (1u << mode.endpoint_bits) - 1 };
+
+			for (u32 j{ 0 }; j < 2; ++j) {
+				for (u32 c{ 0 }; c < 3; ++c) {
+					for (s32 step : { -1, 1 }) {
+						while (best.error > 0.f) {
+							const s32 code{ (s32)best.codes[j][c] + step };
+							if (code < 0 || code > (s32)max_code) break;
+
+							SubsetFit fit{ best };
+							fit.codes[j][c] = (u32)code;
+							if (!is_bc6h_delta_valid(mode, fit)) break;
+
+							evaluate_bc6h_codes(in, mode, fit);
+							if (fit.error >= best.error) break;
+
+							best = fit;
+						}
+					}
+				}
+			}
+		}
+
+		void encode_bc6h_mode(const Block& block, const BC6HMode& mode, const QualitySettings& quality, EncodedBlock& best) {
+			const FitInput in{ { block.channels[0], block.channels[1], block.channels[2] }, 3, opaque_weights.weights, 4, (f32)max_half };
+			SubsetFit fit{};
+			f32 e[2][4];
+			principal_endpoints(in, e);
+			try_bc6h_endpoints(in, mode, e, fit);
+
+			for (u32 i{ 0 }; i < quality.refine_iterations; ++i) {
+				const f32 error{ fit.error };
+
+				if (!refine_endpoints(3, in.channels, in.weights, fit.betas, 64.f, e[0], e[1], (f32)max_half)) break;
+
+				try_bc6h_endpoints(in, mode, e, fit);
+
+				if (fit.error >= error) break;
+			}
+
+			if (quality.perturb_endpoints) perturb_bc6h_endpoints(in, mode, fit);
+
+			if (fit.error >= best.error) return;
+
+			fix_anchor(fit, in.weights, 0, 4, 3);
+
+			if (!is_bc6h_delta_valid(mode, fit)) return;
+
+			BlockWriter writer{};
+			writer.write(mode.mode_bits, 5);
+			for (u32 c{ 0 }; c < 3; ++c) writer.write(fit.codes[0][c], 10);
+
+			for (u32 c{ 0 }; c < 3; ++c) {
+				if (mode.delta_bits) {
+					writer.write((u32)((s32)fit.codes[1][c] - (s32)fit.codes[0][c]), mode.delta_bits);
+					writer.write(fit.codes[0][c] >> 10, mode.endpoint_bits - 10);
+				}
+				else {
+					writer.write(fit.codes[1][c], 10);
+				}
+			}
+
+			write_indicies(writer, fit.indicies, 4, 0);
+			assert(writer.position == 128);
+
+			best.bits[0] = writer.bits[0];
+			best.bits[1] = writer.bits[1];
+			best.error = fit.error;
+		}
+
+		void encode_bc6h_block(const Block& block, BlockQuality::Type quality_level, u64 (&encoded)[2]) {
+			const QualitySettings& quality{ quality_settings[quality_level] };
+			EncodedBlock best{};
+			encode_bc6h_mode(block, bc6h_mode11, quality, best);
+
+			if (best.error > 0.f && quality.try_more_modes) encode_bc6h_mode(block, bc6h_mode12, quality, best);
+
+			encoded[0] = best.bits[0];
+			encoded[1] = best.bits[1];
+		}
+
+		void compress_block_row(const BlockSurface& surface, u32 block_y, BlockFormat::Type format, BlockQuality::Type quality, f32 alpha_threshold) {
+			const u32 block_count{ (surface.width + 3) / 4 };
+			u8* at{ &surface.destination[(u64)block_y * surface.destination_pitch] };
+			Block block;
+
+			for (u32 block_x{ 0 }; block_x < block_count; ++block_x) {
+				if (format == BlockFormat::BC6H) load_half_block(surface, block_x, block_y, block);
+				else load_block(surface, block_x, block_y, block);
+
+				u64 encoded[2];
+
+				switch (format) {
+					case BlockFormat::BC1:
+						encoded[0] = encode_color_block_with_alpha(block, alpha_threshold);
+						break;
+					case BlockFormat::BC3:
+						encoded[0] = encode_alpha_block(block.channels[3]);
+						encoded[1] = encode_color_block(block);
+						break;
+					case BlockFormat::BC4:
+						encoded[0] = encode_alpha_block(block.channels[0]);
+						break;
+					case BlockFormat::BC5:
+						encoded[0] = encode_alpha_block(block.channels[0]);
+						encoded[1] = encode_alpha_block(block.channels[1]);
+						break;
+					case BlockFormat::BC6H:
+						encode_bc6h_block(block, quality, encoded);
+						break;
+					case BlockFormat::BC7:
+						encode_bc7_block(block, quality, encoded);
+						break;
+					default:
+						assert(false);
+						return;
+				}
+
+				const u32 block_size{ get_block_size(format) };
+				memcpy(at, &encoded[0], block_size);
+				at += block_size;
+			}
+		}
+	}
+
+	void compress_blocks(const BlockSurface* const surfaces, u32 surface_count, BlockFormat::Type format, BlockQuality::Type quality, f32 alpha_threshold) {
+		assert(surfaces && surface_count && format < BlockFormat::count && quality < BlockQuality::count);
+
+		// A row of blocks is the unit of work, so the small mips of a chain are spread over the threads as well.
+		struct BlockRow {
+			u32 surface;
+			u32 block_y;
+		};
+
+		util::vector<BlockRow> rows;
+
+		for (u32 i{ 0 }; i < surface_count; ++i) {
+			assert(surfaces[i].source && surfaces[i].destination && surfaces[i].width && surfaces[i].height);
+			const u32 row_count{ (surfaces[i].height + 3) / 4 };
+			for (u32 y{ 0 }; y < row_count; ++y) rows.emplace_back(BlockRow{ i, y });
+		}
+
+		const f32 threshold{ alpha_threshold * 255.f };
+
+		util::parallel_for((u32)rows.size(), [&](u32 i) {
+			compress_block_row(surfaces[rows[i].surface], rows[i].block_y, format, quality, threshold);
+		});
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace lightning::tools {
+
+	struct BlockFormat {
+		enum Type : u32 {
+			BC1 = 0,
+			BC3,
+			BC4,
+			BC5,
+			BC6H,
+			BC7,
+
+			count
+		};
+	};
+
+	// How hard BC6H and BC7 search for the best mode, from fast for iteration to production for shipping.
+	struct BlockQuality {
+		enum Type : u32 {
+			FAST = 0,
+			NORMAL,
+			PRODUCTION,
+
+			count
+		};
+	};
+
+	// One image to compress: 8 bit RGBA source pixels (16 bit float RGBA for BC6H) and the rows of 4x4 blocks they are
+	// compressed to. Partial blocks at the right and bottom edges are padded by repeating the last pixel.
+	struct BlockSurface {
+		const u8* source;
+		u8* destination;
+		u32 width;
+		u32 height;
+		u32 source_pitch;
+		u32 destination_pitch;
+	};
+
+	[[nodiscard]] constexpr u32 get_block_size(BlockFormat::Type format) {
+		return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+	}
+
+	// Compresses the surfaces on all hardware threads. BC4 reads the red channel, BC5 red and green, BC6H is unsigned.
+	// BC1 blocks that have a pixel with alpha below alpha_threshold use the 3 color mode with transparent black.
+	// The quality is only used by BC6H and BC7.
+	void compress_blocks(const BlockSurface* const surfaces, u32 surface_count, BlockFormat::Type format, BlockQuality::Type quality = BlockQuality::NORMAL, f32 alpha_threshold = .5f);
+}
@@ -0,0 +1,92 @@
+#include "CookCache.h"
+
+#include <fstream>
+#include <filesystem>
+
+namespace lightning::tools::cook_cache {
+	namespace {
+
+		constexpr u32 cache_magic{ 0x4b4f4f43 }; // "COOK"
+
+		struct CacheHeader {
+			u32 magic;
+			u32 version;
+			u64 key;
+			u64 data_size;
+			u64 data_hash;
+		};
+
+		std::filesystem::path cache_directory() {
+			std::error_code error{};
+			std::filesystem::path path{ std::filesystem::temp_directory_path(error) };
+			if (error) return {};
+
+			path /= "Lightning";
+			path /= "CookCache";
+			std::filesystem::create_directories(path, error);
+
+			return error ? std::filesystem::path{} : path;
+		}
+
+		std::filesystem::path entry_path(u64 key) {
+			std::filesystem::path path{ cache_directory() };
+			if (path.empty()) return {};
+
+			char name[32];
+			sprintf_s(name, "%016llx.cook", key);
+
+			return path / name;
+		}
+	}
+
+	// Returns false if there is no valid entry for the key. Truncated or corrupt entries count as misses.
+	bool load(u64 key, util::vector<u8>& data) {
+		const std::filesystem::path path{ entry_path(key) };
+		if (path.empty()) return false;
+
+		std::ifstream file{ path, std::ios::in | std::ios::binary };
+		if (!file) return false;
+
+		CacheHeader header{};
+		if (!file.read((char*)&header, sizeof(CacheHeader))) return false;
+		if (header.magic != cache_magic || header.version != cook_cache_version || header.key != key) return false;
+
+		data.resize(header.data_size);
+		if (!file.read((char*)data.data(), header.data_size) || math::calc_hash_u64(data.data(), data.size()) != header.data_hash) {
+			data.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	// Failing to write the cache isn't an error, the asset just gets cooked again next time.
+	void store(u64 key, const u8* const data, u64 size) {
+		assert(data && size);
+		const std::filesystem::path path{ entry_path(key) };
+		if (path.empty()) return;
+
+		// NOTE: the entry is written to a temporary file first, so other importers never see a partial entry.
+		std::filesystem::path temp_path{ path };
+		temp_path += "." + std::to_string(GetCurrentThreadId()) + ".tmp";
+
+		{
+			std::ofstream file{ temp_path, std::ios::out | std::ios::binary | std::ios::trunc };
+			if (!file) return;
+
+			const CacheHeader header{ cache_magic, cook_cache_version, key, size, math::calc_hash_u64(data, size) };
+			file.write((const char*)&header, sizeof(CacheHeader));
+			file.write((const char*)data, size);
+			if (!file.good()) {
+				file.close();
+				std::error_code error{};
+				std::filesystem::remove(temp_path, error);
+				return;
+			}
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(temp_path, path, error);
+		if (error) std::filesystem::remove(temp_path, error);
+	}
+}
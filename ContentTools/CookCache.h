@@ -0,0 +1,31 @@
+#pragma once
+#include "ToolsCommon.h"
+
+// On-disk cache of cooked assets. Entries are keyed by a hash of everything the cooked data depends on:
+// the source bytes, the import settings and cook_cache_version.
+namespace lightning::tools::cook_cache {
+
+	// NOTE: bump this whenever a change to the import or processing code changes the cooked output.
+	constexpr u32 cook_cache_version{ 8 };
+
+	class KeyBuilder {
+		public:
+			void add(const void* const data, u64 size) {
+				assert(data || !size);
+				_hash = math::calc_hash_u64((const u8*)data, size, _hash);
+			}
+
+			template<typename T> void add(T value) {
+				static_assert(std::is_arithmetic_v<T>);
+				add(&value, sizeof(T));
+			}
+
+			[[nodiscard]] constexpr u64 key() const { return _hash; }
+
+		private:
+			u64 _hash{ cook_cache_version };
+	};
+
+	bool load(u64 key, util::vector<u8>& data);
+	void store(u64 key, const u8* const data, u64 size);
+}
@@ -1,5 +1,8 @@
 #include "FBXImporter.h"
 #include "Geometry.h"
+#include "SceneImporter.h"
+
+#include <algorithm>
 
 #if _DEBUG
 #pragma comment (lib, "../packages/FBX SDK/lib/x64/debug/libfbxsdk-md.lib")
@@ -15,7 +18,6 @@ namespace lightning::tools {
 	namespace {
 	
 		std::mutex fbx_mutex{};
-
 	}
 
 	bool FbxContext::initialize_fbx() {
@@ -73,7 +75,7 @@ namespace lightning::tools {
 				}
 				#endif
 
-				_scene->lod_groups.emplace_back(lod);
+				_scene->lod_groups.emplace_back(std::move(lod));
 			}
 
 		}
@@ -86,7 +88,7 @@ namespace lightning::tools {
 				get_meshes(node, lod.meshes, 0, -1.f);
 				if (lod.meshes.size()) {
 					lod.name = lod.meshes[0].name;
-					_scene->lod_groups.emplace_back(lod);
+					_scene->lod_groups.emplace_back(std::move(lod));
 				}
 			}
 		}
@@ -137,7 +139,7 @@ namespace lightning::tools {
 		m.lod_threshold = lod_threshold;
 		m.name = (node->GetName()[0] != '\0') ? node->GetName() : fbx_mesh->GetName();
 		if (get_mesh_data(fbx_mesh, m)) {
-			meshes.emplace_back(m);
+			meshes.emplace_back(std::move(m));
 			_progression->callback(_progression->value(), _progression->max_value() + 1);
 		}
 	}
@@ -164,7 +166,7 @@ namespace lightning::tools {
 			get_meshes(node->GetChild(i), lod.meshes, (u32)lod.meshes.size(), lod_threshold);
 		}
 
-		if (lod.meshes.size()) _scene->lod_groups.emplace_back(lod);
+		if (lod.meshes.size()) _scene->lod_groups.emplace_back(std::move(lod));
 	}
 
 	bool FbxContext::get_mesh_data(FbxMesh* fbx_mesh, Mesh& m) {
@@ -281,23 +283,14 @@ namespace lightning::tools {
 
 	EDITOR_INTERFACE void import_fbx(const char* file, SceneData* data, Progression::progress_callback callback) {
 		assert(file && data);
-		Scene scene{};
-		Progression progression{ callback };
 
-		{
+		import_scene(file, data, callback, [](const char* file, const MappedFile&, Scene& scene, SceneData* data, Progression* const progression) {
 			std::lock_guard lock{ fbx_mutex };
 
-			FbxContext fbx_context{ file, &scene, data, &progression };
+			FbxContext fbx_context{ file, &scene, data, progression };
 			if (fbx_context.is_valid()) {
 				fbx_context.get_scene();
 			}
-		}
-		
-		if(scene.lod_groups.empty()) {
-			return;
-		}
-
-		process_scene(scene, data->settings, &progression);
-		pack_data(scene, *data);
+		});
 	}
 }
\ No newline at end of file
@@ -1,6 +1,13 @@
 #include "Geometry.h"
+#include "MeshOptimization.h"
+#include "MeshSimplification.h"
 #include "../packages/MikkTSpace/mikktspace.h"
 #include "Utilities/IOStream.h"
+#include "Utilities/Threading.h"
+
+#include <algorithm>
+#include <limits>
+#include <immintrin.h>
 
 namespace lightning::tools {
 	namespace {
@@ -157,7 +164,46 @@ namespace lightning::tools {
 			}
 		}
 
-		void process_normals(Mesh& m, f32 smoothing_angle) {
+		// Index buffer entries (corners) grouped by the vertex they reference. The corners of vertex i are
+		// corners[offsets[i]] to corners[offsets[i + 1] - 1], in the order they appear in the index buffer.
+		struct CornerGroups {
+			util::vector<u32> offsets;
+			util::vector<u32> corners;
+		};
+
+		struct WeldKey {
+			s64 value[4];
+		};
+
+		// Temporary buffers of one mesh processing task. They are reused by every processing step of the mesh,
+		// and tasks running in parallel each have their own.
+		struct ProcessingScratch {
+			CornerGroups groups;
+			util::vector<XMVECTOR> group_normals;
+			util::vector<u32> group_verticies;
+			util::vector<u32> table;
+			util::vector<u32> used_slots;
+			util::vector<WeldKey> keys;
+			util::vector<u32> key_verticies;
+			util::vector<u32> key_corners;
+		};
+
+		void group_corners(const util::vector<u32>& indicies, u32 num_verticies, CornerGroups& groups) {
+			const u32 num_indicies{ (u32)indicies.size() };
+			groups.offsets.resize(num_verticies + 1);
+			groups.corners.resize(num_indicies);
+			memset(groups.offsets.data(), 0, groups.offsets.size() * sizeof(u32));
+
+			for (u32 i{ 0 }; i < num_indicies; ++i) ++groups.offsets[indicies[i] + 1];
+			for (u32 i{ 0 }; i < num_verticies; ++i) groups.offsets[i + 1] += groups.offsets[i];
+
+			// NOTE: scattering moves every offset to the start of the next group, so shift them back afterwards.
+			for (u32 i{ 0 }; i < num_indicies; ++i) groups.corners[groups.offsets[indicies[i]]++] = i;
+			for (u32 i{ num_verticies }; i > 0; --i) groups.offsets[i] = groups.offsets[i - 1];
+			groups.offsets[0] = 0;
+		}
+
+		void process_normals(Mesh& m, f32 smoothing_angle, ProcessingScratch& scratch) {
 			const f32 cos_alpha{ XMScalarCos(PI - smoothing_angle * PI / 180.f) };
 			const bool is_hard_edge{ XMScalarNearEqual(smoothing_angle, 180.f, EPSILON) };
 			const bool is_soft_edge{ XMScalarNearEqual(smoothing_angle, 0.f, EPSILON) };
@@ -166,333 +212,443 @@ namespace lightning::tools {
 			assert(num_indicies && num_verticies);
 
 			m.indicies.resize(num_indicies);
+			m.verticies.reserve(num_verticies);
 
-			util::vector<util::vector<u32>> idx_ref(num_verticies);
-			for (u32 i{ 0 }; i < num_indicies; ++i) {
-				idx_ref[m.raw_indicies[i]].emplace_back(i);
-			}
+			CornerGroups& groups{ scratch.groups };
+			group_corners(m.raw_indicies, num_verticies, groups);
+
+			// Corners of a vertex are merged into the first smoothing group whose normal is within the smoothing angle.
+			// The number of groups per vertex is small, so this is linear in the number of corners.
+			util::vector<XMVECTOR>& group_normals{ scratch.group_normals };
+			util::vector<u32>& group_verticies{ scratch.group_verticies };
 
 			for (u32 i{ 0 }; i < num_verticies; ++i) {
-				util::vector<u32>& refs{ idx_ref[i] };
-				u32 num_refs{ (u32)refs.size() };
+				group_normals.clear();
+				group_verticies.clear();
 
-				for (u32 j{ 0 }; j < num_refs; ++j) {
-					m.indicies[refs[j]] = (u32)m.verticies.size();
-					Vertex& v{ m.verticies.emplace_back() };
-					v.position = m.positions[m.raw_indicies[refs[j]]];
+				for (u32 j{ groups.offsets[i] }; j < groups.offsets[i + 1]; ++j) {
+					const u32 corner{ groups.corners[j] };
+					const XMVECTOR n2{ XMLoadFloat3(&m.normals[corner]) };
+					u32 group{ u32_invalid_id };
 
-					XMVECTOR n1{ XMLoadFloat3(&m.normals[refs[j]]) };
 					if (!is_hard_edge) {
-						for (u32 k{ j + 1 }; k < num_refs; ++k) {
-							f32 cos_theta{ 0.f };
-							XMVECTOR n2{ XMLoadFloat3(&m.normals[refs[k]]) };
-							if (!is_soft_edge) {
-								// cos(angle) = dot(n1, n2) / (|n1| * |n2|)
-								XMStoreFloat(&cos_theta, XMVector3Dot(n1, n2) * XMVector3ReciprocalLength(n1));
+						for (u32 k{ 0 }; k < group_normals.size(); ++k) {
+							if (is_soft_edge) {
+								group = k;
+								break;
 							}
 
-							if (is_soft_edge || cos_theta >= cos_alpha) {
-								n1 += n2;
-								m.indicies[refs[k]] = m.indicies[refs[j]];
-								refs.erase(refs.begin() + k);
-								--num_refs;
-								--k;
+							// cos(angle) = dot(n1, n2) / (|n1| * |n2|)
+							const XMVECTOR& n1{ group_normals[k] };
+							f32 cos_theta;
+							XMStoreFloat(&cos_theta, XMVector3Dot(n1, n2) * XMVector3ReciprocalLength(n1));
+
+							if (cos_theta >= cos_alpha) {
+								group = k;
+								break;
 							}
 						}
 					}
-					XMStoreFloat3(&v.normal, XMVector3Normalize(n1));
+
+					if (group == u32_invalid_id) {
+						group = (u32)group_normals.size();
+						group_normals.emplace_back(n2);
+						group_verticies.emplace_back((u32)m.verticies.size());
+						m.verticies.emplace_back().position = m.positions[i];
+					}
+					else {
+						group_normals[group] += n2;
+					}
+
+					m.indicies[corner] = group_verticies[group];
+				}
+
+				for (u32 k{ 0 }; k < group_normals.size(); ++k) {
+					XMStoreFloat3(&m.verticies[group_verticies[k]].normal, XMVector3Normalize(group_normals[k]));
 				}
 			}
 		}
 
-		void process_uvs(Mesh& m) {
+		// Splits the verticies so each corner gets its own attribute, but corners of the same vertex with equal
+		// attributes (within tolerance) share one vertex. A corner joins the first vertex whose attribute is within
+		// tolerance of its own, like the pairwise scan this replaces. Attributes are hashed by cells of twice the
+		// tolerance, so every possible match is either in the corner's cell or in the neighbouring cell it's closer to,
+		// and only 2^components cells are probed. This runs in expected linear time. The hash table only holds the
+		// corners of one vertex at a time, which keeps it in cache.
+		template<typename T, typename F> void weld_verticies(Mesh& m, const util::vector<T>& attributes, f32 tolerance, ProcessingScratch& scratch, F&& set_attribute) {
+			constexpr u32 num_components{ sizeof(T) / sizeof(f32) };
+			constexpr u32 num_probes{ 1u << num_components };
+			static_assert(num_components <= 4);
+
 			util::vector<Vertex> old_verticies;
 			old_verticies.swap(m.verticies);
-			util::vector<u32> old_indicies(m.indicies.size());
-			old_indicies.swap(m.indicies);
 
-			const u32 num_indicies{ (u32)old_indicies.size() };
+			const u32 num_indicies{ (u32)m.indicies.size() };
 			const u32 num_verticies{ (u32)old_verticies.size() };
+			assert(num_verticies && num_indicies && attributes.size() == num_indicies);
 
-			assert(num_verticies && num_indicies);
+			CornerGroups& groups{ scratch.groups };
+			group_corners(m.indicies, num_verticies, groups);
+
+			u32 max_valence{ 0 };
+			for (u32 i{ 0 }; i < num_verticies; ++i) max_valence = std::max(max_valence, groups.offsets[i + 1] - groups.offsets[i]);
+
+			u32 table_size{ 1 };
+			while (table_size < max_valence * 2) table_size <<= 1;
+
+			util::vector<u32>& table{ scratch.table };
+			util::vector<u32>& used_slots{ scratch.used_slots };
+			util::vector<WeldKey>& keys{ scratch.keys };
+			util::vector<u32>& key_verticies{ scratch.key_verticies };
+			util::vector<u32>& key_corners{ scratch.key_corners };
+
+			table.resize(table_size);
+			memset(table.data(), 0xff, table_size * sizeof(u32));
+			m.verticies.reserve(num_verticies);
+
+			const f32 inv_cell_size{ .5f / tolerance };
+
+			auto first_slot = [table_size](const WeldKey& key) {
+				u64 hash{ 0 };
+				for (u32 c{ 0 }; c < num_components; ++c) hash = (hash ^ (u64)key.value[c]) * 0x9e3779b185ebca87ull;
+				return (u32)(hash >> 32) & (table_size - 1);
+			};
+
+			auto is_near = [tolerance](const f32* const a, const f32* const b) {
+				for (u32 c{ 0 }; c < num_components; ++c) {
+					if (!XMScalarNearEqual(a[c], b[c], tolerance)) return false;
+				}
+				return true;
+			};
 
-			util::vector<util::vector<u32>> idx_ref(num_verticies);
-			for (u32 i{ 0 }; i < num_indicies; ++i) {
-				idx_ref[old_indicies[i]].emplace_back(i);
-			}
 			for (u32 i{ 0 }; i < num_verticies; ++i) {
-				util::vector<u32>& refs{ idx_ref[i] };
-				u32 num_refs{ (u32)refs.size() };
-				for (u32 j{ 0 }; j < num_refs; ++j) {
-					m.indicies[refs[j]] = (u32)m.verticies.size();
-					Vertex& v{ old_verticies[old_indicies[refs[j]]] };
-					v.uv = m.uv_sets[0][refs[j]];
-					m.verticies.emplace_back(v);
-
-					for (u32 k{ j + 1 }; k < num_refs; ++k) {
-						v2& uv1{ m.uv_sets[0][refs[k]] };
-						if (XMScalarNearEqual(v.uv.x, uv1.x, EPSILON) && XMScalarNearEqual(v.uv.y, uv1.y, EPSILON)) {
-							m.indicies[refs[k]] = m.indicies[refs[j]];
-							refs.erase(refs.begin() + k);
-							--num_refs;
-							--k;
+				for (u32 j{ groups.offsets[i] }; j < groups.offsets[i + 1]; ++j) {
+					const u32 corner{ groups.corners[j] };
+					const f32* const attribute{ (const f32*)&attributes[corner] };
+
+					WeldKey cell{};
+					s64 neighbour[4]{};
+					for (u32 c{ 0 }; c < num_components; ++c) {
+						const f32 position{ attribute[c] * inv_cell_size };
+						cell.value[c] = (s64)std::floor(position);
+						neighbour[c] = position - (f32)cell.value[c] < .5f ? -1 : 1;
+					}
+
+					// Keys are numbered in the order the verticies were added, so the lowest match is the first vertex.
+					u32 match{ u32_invalid_id };
+
+					for (u32 probe{ 0 }; probe < num_probes; ++probe) {
+						WeldKey key{ cell };
+						for (u32 c{ 0 }; c < num_components; ++c) {
+							if (probe & (1u << c)) key.value[c] += neighbour[c];
 						}
+
+						// NOTE: a cell can hold more than one vertex. They all sit in the same probe sequence.
+						for (u32 slot{ first_slot(key) }; table[slot] != u32_invalid_id; slot = (slot + 1) & (table_size - 1)) {
+							const u32 entry{ table[slot] };
+
+							if (entry < match && !memcmp(&keys[entry], &key, sizeof(WeldKey)) &&
+								is_near((const f32*)&attributes[key_corners[entry]], attribute)) {
+								match = entry;
+							}
+						}
+					}
+
+					if (match == u32_invalid_id) {
+						u32 slot{ first_slot(cell) };
+						while (table[slot] != u32_invalid_id) slot = (slot + 1) & (table_size - 1);
+
+						match = (u32)keys.size();
+						table[slot] = match;
+						used_slots.emplace_back(slot);
+						keys.emplace_back(cell);
+						key_corners.emplace_back(corner);
+						key_verticies.emplace_back((u32)m.verticies.size());
+						set_attribute(m.verticies.emplace_back(old_verticies[i]), attributes[corner]);
 					}
+
+					m.indicies[corner] = key_verticies[match];
 				}
+
+				for (const u32 slot : used_slots) table[slot] = u32_invalid_id;
+				used_slots.clear();
+				keys.clear();
+				key_corners.clear();
+				key_verticies.clear();
 			}
 		}
 
-		void process_tangents(Mesh& m) {
+		void process_uvs(Mesh& m, ProcessingScratch& scratch) {
+			weld_verticies(m, m.uv_sets[0], EPSILON, scratch, [](Vertex& v, const v2& uv) { v.uv = uv; });
+		}
+
+		void process_tangents(Mesh& m, ProcessingScratch& scratch) {
 			if (m.tangents.size() != m.raw_indicies.size()) { return; }
 
-			util::vector<Vertex> old_vertices;
-			old_vertices.swap(m.verticies);
-			util::vector<u32> old_indices(m.indicies.size());
-			old_indices.swap(m.indicies);
+			weld_verticies(m, m.tangents, EPSILON, scratch, [](Vertex& v, const v4& tangent) { v.tangent = tangent; });
+		}
+
+		template<u32... types> u64 get_vertex_elements_size(elements::ElementsType::Type elements_type, std::integer_sequence<u32, types...>) {
+			u64 size{ 0 };
+			((elements_type == types ? (size = sizeof(typename elements::Layout<types>::type), true) : false) || ...);
+			return size;
+		}
 
-			const u32 num_vertices{ (u32)old_vertices.size() };
-			const u32 num_indices{ (u32)old_indices.size() };
-			assert(num_vertices && num_indices);
+		u64 get_vertex_elements_size(elements::ElementsType::Type elements_type) {
+			return get_vertex_elements_size(elements_type, elements::Layouts{});
+		}
 
-			util::vector<util::vector<u32>> idx_ref{ num_vertices };
+		u32 get_position_size(PositionFormat::Type position_format) {
+			return position_format == PositionFormat::UNORM16 ? 3 * sizeof(u16) : sizeof(math::v3);
+		}
 
-			for (u32 i{ 0 }; i < num_indices; ++i) {
-				idx_ref[old_indices[i]].emplace_back(i);
+		struct PositionBounds {
+			v3 min;
+			v3 max;
+		};
+
+		PositionBounds calc_position_bounds(const util::vector<v3>& positions) {
+			PositionBounds bounds{ positions[0], positions[0] };
+
+			for (const v3& p : positions) {
+				bounds.min = { std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y), std::min(bounds.min.z, p.z) };
+				bounds.max = { std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y), std::max(bounds.max.z, p.z) };
 			}
 
-			for (u32 i{ 0 }; i < num_vertices; ++i) {
-				util::vector<u32>& refs{ idx_ref[i] };
-				u32 num_refs{ (u32)refs.size() };
+			return bounds;
+		}
 
-				for (u32 j{ 0 }; j < num_refs; ++j) {
-					const v4& tj{ m.tangents[refs[j]] };
-					Vertex& v{ old_vertices[old_indices[refs[j]]] };
-					v.tangent = tj;
-					m.indicies[refs[j]] = (u32)m.verticies.size();
-					m.verticies.emplace_back(v);
+		// Stores the positions as 16-bit values relative to the bounds of the mesh. The verticies get the decoded
+		// positions, so everything that is calculated from them later on matches what the GPU sees.
+		// Chunks of a mesh are given the bounds of the whole mesh, so a vertex on a seam has the same value in every chunk.
+		void quantize_positions(Mesh& m, const PositionBounds* const bounds) {
+			const u32 num_verticies{ (u32)m.verticies.size() };
+			v3 min{ m.verticies[0].position }, max{ m.verticies[0].position };
 
-					XMVECTOR xm_tj{ XMLoadFloat4(&tj) };
-					XMVECTOR xm_epsilon(XMVectorReplicate(EPSILON));
+			if (bounds) {
+				min = bounds->min;
+				max = bounds->max;
+			}
+			else {
+				for (u32 i{ 1 }; i < num_verticies; ++i) {
+					const v3& p{ m.verticies[i].position };
+					min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+					max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+				}
+			}
 
-					for (u32 k{ j + 1 }; k < num_refs; ++k) {
-						XMVECTOR xm_tangent{ XMLoadFloat4(&m.tangents[refs[k]]) };
+			constexpr f32 intervals{ (f32)((1 << 16) - 1) };
+			const f32 mins[3]{ min.x, min.y, min.z };
+			const f32 maxs[3]{ max.x, max.y, max.z };
+			m.position_offset = min;
+			m.position_scale = { (max.x - min.x) / intervals, (max.y - min.y) / intervals, (max.z - min.z) / intervals };
+			const f32 scales[3]{ m.position_scale.x, m.position_scale.y, m.position_scale.z };
 
-						if (XMVector4NearEqual(xm_tj, xm_tangent, xm_epsilon)) {
-							m.indicies[refs[k]] = m.indicies[refs[j]];
-							refs.erase(refs.begin() + k);
-							--num_refs;
-							--k;
-						}
-					}
+			m.position_buffer.resize(3 * sizeof(u16) * num_verticies);
+			u16* const position_buffer{ (u16* const)m.position_buffer.data() };
+
+			for (u32 i{ 0 }; i < num_verticies; ++i) {
+				f32* const p{ &m.verticies[i].position.x };
+
+				for (u32 j{ 0 }; j < 3; ++j) {
+					const u16 q{ (u16)(mins[j] < maxs[j] ? pack_float<16>(p[j], mins[j], maxs[j]) : 0) };
+					position_buffer[i * 3 + j] = q;
+					p[j] = mins[j] + (f32)q * scales[j];
 				}
 			}
 		}
 
-		u64 get_vertex_elements_size(elements::ElementsType::Type elements_type) {
-			using namespace elements;
+		constexpr u32 pack_batch_size{ 8 };
+
+		// The attributes of a batch of verticies packed to the sizes of the element fields.
+		struct PackedBatch {
+			u32 colors[pack_batch_size];			// red, green and blue in the low 3 bytes
+			u32 normals[pack_batch_size];			// 16-bit x and y
+			u32 tangents[pack_batch_size];			// 16-bit x and y
+			u32 joint_weights[pack_batch_size];		// 8-bit x, y and z in the low 3 bytes
+			u64 joint_indicies[pack_batch_size];	// 4 16-bit indicies
+			u8 t_signs[pack_batch_size];			// bit 0: tangent.w > 0, bit 1: tangent.z > 0, bit 2: normal.z > 0
+		};
+
+		// Loads the 4 floats at offset in 4 consecutive verticies and transposes them, so each register holds the same
+		// component of the 4 verticies.
+		void load_components_x4(const Vertex* const v, u32 offset, __m128(&c)[4]) {
+			const u8* const at{ (const u8*)v + offset };
+			c[0] = _mm_loadu_ps((const f32*)at);
+			c[1] = _mm_loadu_ps((const f32*)(at + sizeof(Vertex)));
+			c[2] = _mm_loadu_ps((const f32*)(at + 2 * sizeof(Vertex)));
+			c[3] = _mm_loadu_ps((const f32*)(at + 3 * sizeof(Vertex)));
+			_MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+		}
 
-			switch (elements_type) {
-				case ElementsType::STATIC_NORMAL: return sizeof(StaticNormal);
-				case ElementsType::STATIC_NORMAL_TEXTURE: return sizeof(StaticNormalTexture);
-				case ElementsType::STATIC_COLOR: return sizeof(StaticColor);
-				case ElementsType::SKELETAL: return sizeof(Skeletal);
-				case ElementsType::SKELETAL_COLOR: return sizeof(SkeletalColor);
-				case ElementsType::SKELETAL_NORMAL: return sizeof(SkeletalNormal);
-				case ElementsType::SKELETAL_NORMAL_COLOR: return sizeof(SkeletalNormalColor);
-				case ElementsType::SKELETAL_NORMAL_TEXTURE: return sizeof(SkeletalNormalTexture);
-				case ElementsType::SKELETAL_NORMAL_TEXTURE_COLOR: return sizeof(SkeletalNormalTextureColor);
-				default: return 0;
-			}
+		// Same as pack_float<16>(f, -1.f, 1.f) for 4 values.
+		__m128i pack_snorm16_x4(__m128 f) {
+			const __m128 distance{ _mm_mul_ps(_mm_add_ps(f, _mm_set1_ps(1.f)), _mm_set1_ps(.5f)) };
+			__m128 q{ _mm_add_ps(_mm_mul_ps(distance, _mm_set1_ps(65535.f)), _mm_set1_ps(.5f)) };
+			q = _mm_min_ps(_mm_max_ps(q, _mm_setzero_ps()), _mm_set1_ps(65535.f));
+			return _mm_cvttps_epi32(q);
 		}
 
-		void pack_verticies(Mesh& m) {
-			const u32 num_verticies{ (u32)m.verticies.size() };
-			assert(num_verticies);
+		// Same as pack_unit_float<8>(f) for 4 values.
+		__m128i pack_unorm8_x4(__m128 f) {
+			__m128 q{ _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.f)), _mm_set1_ps(.5f)) };
+			q = _mm_min_ps(_mm_max_ps(q, _mm_setzero_ps()), _mm_set1_ps(255.f));
+			return _mm_cvttps_epi32(q);
+		}
 
-			m.position_buffer.resize(sizeof(math::v3) * num_verticies);
-			math::v3* const position_buffer{ (math::v3* const)m.position_buffer.data() };
+		// Narrows 8 32-bit values in 0..255 to bytes and stores them.
+		void store_bytes_x8(__m128i a, __m128i b, u8* const out) {
+			_mm_storel_epi64((__m128i*)out, _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_setzero_si128()));
+		}
 
-			for (u32 i{ 0 }; i < num_verticies; ++i) {
-				position_buffer[i] = m.verticies[i].position;
+		void pack_colors_x8(const Vertex* const v, u32* const colors) {
+			const __m128i mask{ _mm_set1_epi32(0x00ffffff) };
+
+			for (u32 i{ 0 }; i < pack_batch_size; i += 4) {
+				u32 rgb[4];
+				for (u32 j{ 0 }; j < 4; ++j) memcpy(&rgb[j], &v[i + j].red, sizeof(u32));
+
+				_mm_storeu_si128((__m128i*)&colors[i], _mm_and_si128(_mm_loadu_si128((const __m128i*)rgb), mask));
 			}
+		}
 
-			struct u16v2 { u16 x, y; };
-			struct u8v3 { u8 x, y, z; };
+		void pack_normals_x8(const Vertex* const v, u32* const normals, u8* const t_signs) {
+			__m128i signs[2];
 
-			util::vector<u8> t_signs{ num_verticies };
-			util::vector<u16v2> normals{ num_verticies };
-			util::vector<u16v2> tangents{ num_verticies };
-			util::vector<u8v3> joint_weights{ num_verticies };
+			for (u32 i{ 0 }; i < pack_batch_size; i += 4) {
+				__m128 n[4];
+				load_components_x4(&v[i], offsetof(Vertex, normal), n);
 
-			if (m.elements_type & elements::ElementsType::STATIC_NORMAL) {
-				for (u32 i{ 0 }; i < num_verticies; ++i) {
-					Vertex& v{ m.verticies[i] };
-					t_signs[i] = (u8)((v.normal.z > 0.f) << 2);
-					normals[i] = {
-						(u16)pack_float<16>(v.normal.x, -1.f, 1.f),
-						(u16)pack_float<16>(v.normal.y, -1.f, 1.f)
-					};
-				}
+				const __m128i packed{ _mm_or_si128(pack_snorm16_x4(n[0]), _mm_slli_epi32(pack_snorm16_x4(n[1]), 16)) };
+				_mm_storeu_si128((__m128i*)&normals[i], packed);
 
-				if (m.elements_type & elements::ElementsType::STATIC_NORMAL_TEXTURE) {
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						t_signs[i] |= (u8)((v.tangent.w > 0.f) | ((v.tangent.z > 0.f) << 1));
-						tangents[i] = {
-							(u16)pack_float<16>(v.tangent.x, -1.f, 1.f),
-							(u16)pack_float<16>(v.tangent.y, -1.f, 1.f)
-						};
-					}
-				}
+				signs[i / 4] = _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(n[2], _mm_setzero_ps())), _mm_set1_epi32(4));
 			}
 
-			if (m.elements_type & elements::ElementsType::SKELETAL) {
-				for (u32 i{ 0 }; i < num_verticies; ++i) {
-					Vertex& v{ m.verticies[i] };
-					joint_weights[i] = {
-						(u8)pack_unit_float<8>(v.joint_weights.x),
-						(u8)pack_unit_float<8>(v.joint_weights.y),
-						(u8)pack_unit_float<8>(v.joint_weights.z)
-					};
-				}
+			store_bytes_x8(signs[0], signs[1], t_signs);
+		}
+
+		// Expects the sign bit of the normals in t_signs already.
+		void pack_tangents_x8(const Vertex* const v, u32* const tangents, u8* const t_signs) {
+			__m128i signs[2];
+
+			for (u32 i{ 0 }; i < pack_batch_size; i += 4) {
+				__m128 t[4];
+				load_components_x4(&v[i], offsetof(Vertex, tangent), t);
+
+				const __m128i packed{ _mm_or_si128(pack_snorm16_x4(t[0]), _mm_slli_epi32(pack_snorm16_x4(t[1]), 16)) };
+				_mm_storeu_si128((__m128i*)&tangents[i], packed);
+
+				const __m128i w{ _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(t[3], _mm_setzero_ps())), _mm_set1_epi32(1)) };
+				const __m128i z{ _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(t[2], _mm_setzero_ps())), _mm_set1_epi32(2)) };
+				signs[i / 4] = _mm_or_si128(w, z);
 			}
 
-			m.element_buffer.resize(get_vertex_elements_size(m.elements_type)* num_verticies);
+			u8 tangent_signs[pack_batch_size];
+			store_bytes_x8(signs[0], signs[1], tangent_signs);
 
-			using namespace elements;
+			u64 bits, normal_bits;
+			memcpy(&bits, tangent_signs, sizeof(u64));
+			memcpy(&normal_bits, t_signs, sizeof(u64));
+			bits |= normal_bits;
+			memcpy(t_signs, &bits, sizeof(u64));
+		}
 
-			switch (m.elements_type) {
-				case ElementsType::STATIC_COLOR: {
-					StaticColor* const element_buffer{ (StaticColor* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						element_buffer[i] = { { v.red, v.green, v.blue }, {} };
-					}
-				}
-				break;
+		void pack_joints_x8(const Vertex* const v, u32* const joint_weights, u64* const joint_indicies) {
+			// Keeps the low 16 bits of each index, the same as casting them to u16.
+			const __m128i low_halves{ _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1) };
 
-				case ElementsType::STATIC_NORMAL: {
-					StaticNormal* const element_buffer{ (StaticNormal* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						element_buffer[i] = { { v.red, v.green, v.blue }, t_signs[i], { normals[i].x, normals[i].y } };
-					}
-				}
-				break;
-
-				case ElementsType::STATIC_NORMAL_TEXTURE: {
-					StaticNormalTexture* const element_buffer{ (StaticNormalTexture* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						element_buffer[i] = {
-							{ v.red, v.green, v.blue },
-							t_signs[i],
-							{ normals[i].x, normals[i].y },
-							{ tangents[i].x, tangents[i].y },
-							v.uv
-						};
-					}
-				}
-				break;
-
-				case ElementsType::SKELETAL: {
-					Skeletal* const element_buffer{ (Skeletal* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						const u16 indicies[4]{ (u16)v.joint_indicies.x, (u16)v.joint_indicies.y, (u16)v.joint_indicies.z, (u16)v.joint_indicies.w };
-						element_buffer[i] = { 
-							{ joint_weights[i].x, joint_weights[i].y, joint_weights[i].z },
-							{},
-							{ indicies[0], indicies[1], indicies[2], indicies[3] }
-						};
-					}
-				}
-				break;
-
-				case ElementsType::SKELETAL_COLOR: {
-					SkeletalColor* const element_buffer{ (SkeletalColor* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						const u16 indicies[4]{ (u16)v.joint_indicies.x, (u16)v.joint_indicies.y, (u16)v.joint_indicies.z, (u16)v.joint_indicies.w };
-						element_buffer[i] = {
-							{ joint_weights[i].x, joint_weights[i].y, joint_weights[i].z },
-							{},
-							{ indicies[0], indicies[1], indicies[2], indicies[3] },
-							{ v.red, v.green, v.blue },
-							{}
-						};
-					}
+			for (u32 i{ 0 }; i < pack_batch_size; i += 4) {
+				__m128 w[4];
+				load_components_x4(&v[i], offsetof(Vertex, joint_weights), w);
+
+				__m128i packed{ pack_unorm8_x4(w[0]) };
+				packed = _mm_or_si128(packed, _mm_slli_epi32(pack_unorm8_x4(w[1]), 8));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(pack_unorm8_x4(w[2]), 16));
+				_mm_storeu_si128((__m128i*)&joint_weights[i], packed);
+			}
+
+			for (u32 i{ 0 }; i < pack_batch_size; i += 2) {
+				const __m128i a{ _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&v[i].joint_indicies), low_halves) };
+				const __m128i b{ _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&v[i + 1].joint_indicies), low_halves) };
+				_mm_storeu_si128((__m128i*)&joint_indicies[i], _mm_unpacklo_epi64(a, b));
+			}
+		}
+
+		// Packs the verticies into the layout T. Only the kernels for the fields T has are run, and every field is
+		// filled by name.
+		template<typename T> void pack_elements(const util::vector<Vertex>& verticies, u8* const buffer) {
+			constexpr bool has_color{ requires(T & t) { t.color; } };
+			constexpr bool has_normal{ requires(T & t) { t.normal; } };
+			constexpr bool has_tangent{ requires(T & t) { t.tangent; } };
+			constexpr bool has_uv{ requires(T & t) { t.uv; } };
+			constexpr bool has_joints{ requires(T & t) { t.joint_weights; } };
+			static_assert(has_normal == requires(T & t) { t.t_sign; });
+
+			T* const elements{ (T* const)buffer };
+			const u32 num_verticies{ (u32)verticies.size() };
+			Vertex tail[pack_batch_size]{};
+			PackedBatch batch;
+
+			for (u32 i{ 0 }; i < num_verticies; i += pack_batch_size) {
+				const u32 count{ std::min(pack_batch_size, num_verticies - i) };
+				const Vertex* v{ &verticies[i] };
+
+				if (count < pack_batch_size) {
+					for (u32 j{ 0 }; j < count; ++j) tail[j] = verticies[i + j];
+					v = tail;
 				}
-				break;
-
-				case ElementsType::SKELETAL_NORMAL: {
-					SkeletalNormal* const element_buffer{ (SkeletalNormal* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						const u16 indicies[4]{ (u16)v.joint_indicies.x, (u16)v.joint_indicies.y, (u16)v.joint_indicies.z, (u16)v.joint_indicies.w };
-						element_buffer[i] = {
-							{ joint_weights[i].x, joint_weights[i].y, joint_weights[i].z },
-							t_signs[i],
-							{ indicies[0], indicies[1], indicies[2], indicies[3] },
-							{ normals[i].x, normals[i].y }
-						};
-					}
+
+				if constexpr (has_color) pack_colors_x8(v, batch.colors);
+				if constexpr (has_normal) {
+					// The tangent signs are stored for every layout with normals.
+					pack_normals_x8(v, batch.normals, batch.t_signs);
+					pack_tangents_x8(v, batch.tangents, batch.t_signs);
 				}
-				break;
-
-				case ElementsType::SKELETAL_NORMAL_COLOR: {
-					SkeletalNormalColor* const element_buffer{ (SkeletalNormalColor* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						const u16 indicies[4]{ (u16)v.joint_indicies.x, (u16)v.joint_indicies.y, (u16)v.joint_indicies.z, (u16)v.joint_indicies.w };
-						element_buffer[i] = {
-							{ joint_weights[i].x, joint_weights[i].y, joint_weights[i].z },
-							t_signs[i],
-							{ indicies[0], indicies[1], indicies[2], indicies[3] },
-							{ normals[i].x, normals[i].y },
-							{ v.red, v.green, v.blue },
-							{}
-						};
+				if constexpr (has_joints) pack_joints_x8(v, batch.joint_weights, batch.joint_indicies);
+
+				for (u32 j{ 0 }; j < count; ++j) {
+					T e{};
+
+					if constexpr (has_joints) {
+						memcpy(e.joint_weights, &batch.joint_weights[j], sizeof(e.joint_weights));
+						memcpy(e.joint_indicies, &batch.joint_indicies[j], sizeof(e.joint_indicies));
 					}
-				}
-				break;
-
-				case ElementsType::SKELETAL_NORMAL_TEXTURE: {
-					SkeletalNormalTexture* const element_buffer{ (SkeletalNormalTexture* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						const u16 indicies[4]{ (u16)v.joint_indicies.x, (u16)v.joint_indicies.y, (u16)v.joint_indicies.z, (u16)v.joint_indicies.w };
-						element_buffer[i] = {
-							{ joint_weights[i].x, joint_weights[i].y, joint_weights[i].z },
-							t_signs[i],
-							{ indicies[0], indicies[1], indicies[2], indicies[3] },
-							{ normals[i].x, normals[i].y },
-							{ tangents[i].x, tangents[i].y },
-							v.uv
-						};
+					if constexpr (has_color) memcpy(e.color, &batch.colors[j], sizeof(e.color));
+					if constexpr (has_normal) {
+						e.t_sign = batch.t_signs[j];
+						memcpy(e.normal, &batch.normals[j], sizeof(e.normal));
 					}
+					if constexpr (has_tangent) memcpy(e.tangent, &batch.tangents[j], sizeof(e.tangent));
+					if constexpr (has_uv) e.uv = v[j].uv;
+
+					elements[i + j] = e;
 				}
-				break;
-
-				case ElementsType::SKELETAL_NORMAL_TEXTURE_COLOR: {
-					SkeletalNormalTextureColor* const element_buffer{ (SkeletalNormalTextureColor* const)m.element_buffer.data() };
-					for (u32 i{ 0 }; i < num_verticies; ++i) {
-						Vertex& v{ m.verticies[i] };
-						const u16 indicies[4]{ (u16)v.joint_indicies.x, (u16)v.joint_indicies.y, (u16)v.joint_indicies.z, (u16)v.joint_indicies.w };
-						element_buffer[i] = {
-							{ joint_weights[i].x, joint_weights[i].y, joint_weights[i].z },
-							t_signs[i],
-							{ indicies[0], indicies[1], indicies[2], indicies[3] },
-							{ normals[i].x, normals[i].y },
-							{ tangents[i].x, tangents[i].y },
-							v.uv,
-							{ v.red, v.green, v.blue },
-							{}
-						};
-					}
+			}
+		}
+
+		template<u32... types> void pack_elements(const Mesh& m, u8* const buffer, std::integer_sequence<u32, types...>) {
+			((m.elements_type == types ? (pack_elements<typename elements::Layout<types>::type>(m.verticies, buffer), true) : false) || ...);
+		}
+
+		void pack_verticies(Mesh& m, const PositionBounds* const bounds) {
+			const u32 num_verticies{ (u32)m.verticies.size() };
+			assert(num_verticies);
+
+			if (m.position_format == PositionFormat::UNORM16) {
+				quantize_positions(m, bounds);
+			}
+			else {
+				m.position_buffer.resize(sizeof(math::v3) * num_verticies);
+				math::v3* const position_buffer{ (math::v3* const)m.position_buffer.data() };
+
+				for (u32 i{ 0 }; i < num_verticies; ++i) {
+					position_buffer[i] = m.verticies[i].position;
 				}
-				break;
 			}
+
+			m.element_buffer.resize(get_vertex_elements_size(m.elements_type) * num_verticies);
+			pack_elements(m, m.element_buffer.data(), elements::Layouts{});
 		}
 
 		elements::ElementsType::Type determine_elements_type(const Mesh& m) {
@@ -517,15 +673,101 @@ namespace lightning::tools {
 			return type;
 		}
 
-		void process_verticies(Mesh& m, const GeometryImportSettings& settings) {
+		// Reorders the triangles for the post-transform vertex cache and for less overdraw.
+		// In debug builds the vertex cache statistics are written to the debug output, so the gain can be checked per mesh.
+		void reorder_indicies(Mesh& m) {
+			const u32 num_verticies{ (u32)m.verticies.size() };
+			const u32 num_indicies{ (u32)m.indicies.size() };
+			util::vector<math::v3> positions(num_verticies);
+
+			for (u32 i{ 0 }; i < num_verticies; ++i) positions[i] = m.verticies[i].position;
+
+			DEBUG_OP(const VertexCacheStats before{ analyze_vertex_cache(m.indicies.data(), num_indicies, num_verticies) });
+			optimize_index_order(m.indicies.data(), num_indicies, positions.data(), num_verticies);
+
+			#ifdef _DEBUG
+			const VertexCacheStats after{ analyze_vertex_cache(m.indicies.data(), num_indicies, num_verticies) };
+			char message[512];
+			sprintf_s(message, "Mesh \"%s\" (%u triangles): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+				m.name.c_str(), num_indicies / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+			OutputDebugStringA(message);
+			#endif
+		}
+
+		// Merges verticies that ended up identical after packing and renumbers the rest in first-use order, so the GPU
+		// fetches the vertex buffers mostly sequentially. Fewer verticies may also let the mesh use 16-bit indicies.
+		void optimize_vertex_fetch(Mesh& m) {
+			const u32 num_verticies{ (u32)m.verticies.size() };
+			const u32 num_indicies{ (u32)m.indicies.size() };
+			const u32 elements_size{ (u32)get_vertex_elements_size(m.elements_type) };
+
+			util::vector<VertexStream> streams;
+			const u32 position_size{ get_position_size(m.position_format) };
+			streams.emplace_back(VertexStream{ m.position_buffer.data(), position_size });
+			if (elements_size) streams.emplace_back(VertexStream{ m.element_buffer.data(), elements_size });
+
+			util::vector<u32> remap(num_verticies);
+			const u32 new_num_verticies{ generate_vertex_remap(m.indicies.data(), num_indicies, num_verticies, streams.data(), (u32)streams.size(), remap.data()) };
+			remap_indicies(m.indicies.data(), num_indicies, remap.data());
+
+			util::vector<u8> position_buffer(position_size * new_num_verticies);
+			remap_verticies(position_buffer.data(), m.position_buffer.data(), num_verticies, position_size, remap.data());
+			m.position_buffer.swap(position_buffer);
+
+			util::vector<u8> element_buffer(elements_size * new_num_verticies);
+			if (elements_size) remap_verticies(element_buffer.data(), m.element_buffer.data(), num_verticies, elements_size, remap.data());
+			m.element_buffer.swap(element_buffer);
+
+			util::vector<Vertex> verticies(new_num_verticies);
+			remap_verticies(verticies.data(), m.verticies.data(), num_verticies, (u32)sizeof(Vertex), remap.data());
+			m.verticies.swap(verticies);
+
+			#ifdef _DEBUG
+			if (new_num_verticies != num_verticies) {
+				char message[512];
+				sprintf_s(message, "Mesh \"%s\": %u verticies -> %u%s\n", m.name.c_str(), num_verticies, new_num_verticies,
+					(num_verticies >= (1 << 16) && new_num_verticies < (1 << 16)) ? " (16-bit indicies)" : "");
+				OutputDebugStringA(message);
+			}
+			#endif
+		}
+
+		void build_meshlets(Mesh& m) {
+			const u32 num_verticies{ (u32)m.verticies.size() };
+			util::vector<math::v3> positions(num_verticies);
+
+			for (u32 i{ 0 }; i < num_verticies; ++i) positions[i] = m.verticies[i].position;
+
+			tools::build_meshlets(m.indicies.data(), (u32)m.indicies.size(), positions.data(), num_verticies, m.meshlets);
+		}
+
+		void pack_and_optimize(Mesh& m, const GeometryImportSettings& settings, const PositionBounds* const bounds = nullptr) {
+			m.position_format = settings.quantize_positions ? PositionFormat::UNORM16 : PositionFormat::F32;
+			pack_verticies(m, bounds);
+			optimize_vertex_fetch(m);
+
+			// NOTE: the triangles are reordered after merging the identical verticies, so the cache sees the shared ones.
+			// The new order changes which vertex is used first, so the verticies are renumbered again.
+			if (settings.optimize_index_order) {
+				reorder_indicies(m);
+				optimize_vertex_fetch(m);
+			}
+
+			if (settings.generate_meshlets) {
+				build_meshlets(m);
+			}
+		}
+
+		// Turns the per corner attributes into verticies and indicies.
+		void process_attributes(Mesh& m, const GeometryImportSettings& settings, ProcessingScratch& scratch) {
 			assert((m.raw_indicies.size() % 3) == 0);
 			if (settings.calculate_normals || m.normals.empty()) {
 				recalculate_normals(m);
 			}
-			process_normals(m, settings.smoothing_angle);
+			process_normals(m, settings.smoothing_angle, scratch);
 
 			if (!m.uv_sets.empty()) {
-				process_uvs(m);
+				process_uvs(m, scratch);
 			}
 
 			if ((settings.calculate_tangents || m.tangents.empty()) && !m.uv_sets.empty()) {
@@ -534,20 +776,38 @@ namespace lightning::tools {
 			}
 
 			if (!m.tangents.empty()) {
-				process_tangents(m);
+				process_tangents(m, scratch);
 			}
+		}
 
+		void process_verticies(Mesh& m, const GeometryImportSettings& settings, ProcessingScratch& scratch) {
+			process_attributes(m, settings, scratch);
 			m.elements_type = determine_elements_type(m);
-			pack_verticies(m);
+			pack_and_optimize(m, settings);
 		}
+
+		u64 get_meshlet_section_size(const Mesh& m) {
+			if (m.meshlets.meshlets.empty()) return 0;
+
+			return
+				sizeof(u32) +											// number of meshlet vertex indicies
+				sizeof(u32) +											// number of meshlet triangles
+				sizeof(Meshlet) * m.meshlets.meshlets.size() +			// meshlets
+				sizeof(u32) * m.meshlets.verticies.size() +				// meshlet vertex indicies
+				math::align_size_up<sizeof(u32)>(m.meshlets.triangles.size());	// local triangle indicies, padded to 4 bytes
+		}
+
 		u64 get_mesh_size(const Mesh& m) {
+			if (m.packed_size) return m.packed_size;
+
 			const u64 num_verticies{ m.verticies.size() };
 			const u64 position_buffer_size{ m.position_buffer.size() };
-			assert(position_buffer_size == sizeof(math::v3) * num_verticies);
+			assert(position_buffer_size == get_position_size(m.position_format) * num_verticies);
 			const u64 element_buffer_size{ m.element_buffer.size() };
 			assert(element_buffer_size == get_vertex_elements_size(m.elements_type) * num_verticies);
 			const u64 index_size{ (num_verticies < (1 << 16)) ? sizeof(u16) : sizeof(u32) };
 			const u64 index_buffer_size{ index_size * m.indicies.size() };
+			const u64 meshlet_section_size{ get_meshlet_section_size(m) };
 			constexpr u64 su32{ sizeof(u32) };
 			const u64 size{
 				su32 +					// name length
@@ -555,13 +815,18 @@ namespace lightning::tools {
 				su32 +					// lod id
 				su32 +					// vertex element size
 				su32 +					// element type enum
+				su32 +					// position format enum
+				sizeof(math::v3) +		// position decode scale
+				sizeof(math::v3) +		// position decode offset
 				su32 +					// number of verticies
 				su32 +					// index size (16 bit || 32 bit)
 				su32 +					// number of indicies
 				sizeof(f32) +			// LOD threshold
 				position_buffer_size +	// room for vertex positions
 				element_buffer_size +	// room for vertex elements
-				index_buffer_size		// room for indicies
+				index_buffer_size +		// room for indicies
+				su32 +					// number of meshlets
+				meshlet_section_size	// room for meshlets, if there are any
 			};
 			return size;
 		}
@@ -590,6 +855,7 @@ namespace lightning::tools {
 		}
 
 		void pack_mesh_data(const Mesh& m, util::BlobStreamWriter& blob) {
+			assert(!m.packed_size);
 
 			blob.write((u32)m.name.size());
 			blob.write(m.name.c_str(), m.name.size());
@@ -598,6 +864,9 @@ namespace lightning::tools {
 			const u32 elements_size{ (u32)get_vertex_elements_size(m.elements_type) };
 			blob.write(elements_size);
 			blob.write((u32)m.elements_type);
+			blob.write((u32)m.position_format);
+			blob.write((const u8*)&m.position_scale, sizeof(math::v3));
+			blob.write((const u8*)&m.position_offset, sizeof(math::v3));
 
 			const u32 num_verticies{ (u32)m.verticies.size() };
 			blob.write(num_verticies);
@@ -610,7 +879,7 @@ namespace lightning::tools {
 
 			blob.write(m.lod_threshold);
 
-			assert(m.position_buffer.size() == sizeof(math::v3) * num_verticies);
+			assert(m.position_buffer.size() == get_position_size(m.position_format) * num_verticies);
 			blob.write(m.position_buffer.data(), m.position_buffer.size());
 
 			assert(m.element_buffer.size() == elements_size * num_verticies);
@@ -625,50 +894,100 @@ namespace lightning::tools {
 				data = (const u8*)indicies.data();
 			}
 			blob.write(data, index_buffer_size);
-		}
 
-		bool split_meshes_by_material(u32 material_idx, const Mesh& m, Mesh& submesh) {
-			submesh.name = m.name;
-			submesh.lod_threshold = m.lod_threshold;
-			submesh.lod_id = m.lod_id;
-			submesh.material_used.emplace_back(material_idx);
-			submesh.uv_sets.resize(m.uv_sets.size());
+			// Optional section: a meshlet count of 0 means the mesh has no meshlets.
+			const MeshletData& meshlets{ m.meshlets };
+			blob.write((u32)meshlets.meshlets.size());
+			if (meshlets.meshlets.empty()) return;
+
+			blob.write((u32)meshlets.verticies.size());
+			blob.write((u32)meshlets.triangles.size() / 3);
+			blob.write((const u8*)meshlets.meshlets.data(), sizeof(Meshlet) * meshlets.meshlets.size());
+			blob.write((const u8*)meshlets.verticies.data(), sizeof(u32) * meshlets.verticies.size());
+			blob.write(meshlets.triangles.data(), meshlets.triangles.size());
+			for (u64 i{ meshlets.triangles.size() }; i < math::align_size_up<sizeof(u32)>(meshlets.triangles.size()); ++i) blob.write((u8)0);
+		}
 
+		// Splits a mesh that uses several materials into one submesh per material, in the order of material_used, and
+		// leaves out the materials that have no triangles. The triangles are bucketed by material with a counting sort,
+		// so the split takes a few passes over the mesh, no matter how many materials it has.
+		void split_mesh_by_material(const Mesh& m, util::vector<Mesh>& submeshes) {
+			const u32 num_materials{ (u32)m.material_used.size() };
 			const u32 num_polys{ (u32)m.raw_indicies.size() / 3 };
-			util::vector<u32> vertex_ref(m.positions.size(), u32_invalid_id);
+
+			// Slot of each material index in material_used. Triangles with any other material are dropped.
+			u32 max_material{ 0 };
+			for (const u32 mtl_idx : m.material_used) max_material = std::max(max_material, mtl_idx);
+
+			util::vector<u32> material_slots(max_material + 1, u32_invalid_id);
+			for (u32 i{ 0 }; i < num_materials; ++i) {
+				u32& slot{ material_slots[m.material_used[i]] };
+				if (slot == u32_invalid_id) slot = i;
+			}
+
+			util::vector<u32> offsets(num_materials + 1, 0);
+			util::vector<u32> triangle_slots(num_polys);
 
 			for (u32 i{ 0 }; i < num_polys; ++i) {
 				const u32 mtl_idx{ m.material_indicies[i] };
-				if (mtl_idx != material_idx) continue;
+				const u32 slot{ mtl_idx <= max_material ? material_slots[mtl_idx] : u32_invalid_id };
+				triangle_slots[i] = slot;
+				if (slot != u32_invalid_id) ++offsets[slot + 1];
+			}
 
-				const u32 index{ i * 3 };
+			for (u32 i{ 0 }; i < num_materials; ++i) offsets[i + 1] += offsets[i];
 
-				for (u32 j = index; j < index + 3; ++j) {
+			util::vector<u32> triangles(offsets[num_materials]);
+			{
+				util::vector<u32> cursors{ offsets };
+				for (u32 i{ 0 }; i < num_polys; ++i) {
+					if (triangle_slots[i] != u32_invalid_id) triangles[cursors[triangle_slots[i]]++] = i;
+				}
+			}
+
+			// Maps the positions of the mesh to the positions of the submesh being filled. Entries are only valid if
+			// vertex_slots says they belong to that submesh, so the table doesn't have to be cleared between materials.
+			util::vector<u32> vertex_ref(m.positions.size());
+			util::vector<u32> vertex_slots(m.positions.size(), u32_invalid_id);
+
+			for (u32 slot{ 0 }; slot < num_materials; ++slot) {
+				const u32 first{ offsets[slot] };
+				const u32 num_corners{ (offsets[slot + 1] - first) * 3 };
+				if (!num_corners) continue;
+
+				Mesh& submesh{ submeshes.emplace_back() };
+				submesh.name = m.name;
+				submesh.lod_threshold = m.lod_threshold;
+				submesh.lod_id = m.lod_id;
+				submesh.material_used.emplace_back(m.material_used[slot]);
+				submesh.raw_indicies.resize(num_corners);
+				if (m.normals.size()) submesh.normals.resize(num_corners);
+				if (m.tangents.size()) submesh.tangents.resize(num_corners);
+
+				submesh.uv_sets.resize(m.uv_sets.size());
+				for (u32 k{ 0 }; k < m.uv_sets.size(); ++k) {
+					if (m.uv_sets[k].size()) submesh.uv_sets[k].resize(num_corners);
+				}
+
+				for (u32 i{ 0 }; i < num_corners; ++i) {
+					const u32 j{ triangles[first + i / 3] * 3 + i % 3 };
 					const u32 v_idx{ m.raw_indicies[j] };
 
-					if (vertex_ref[v_idx] != u32_invalid_id) {
-						submesh.raw_indicies.emplace_back(vertex_ref[v_idx]);
-					}
-					else {
-						submesh.raw_indicies.emplace_back((u32)submesh.positions.size());
-						vertex_ref[v_idx] = submesh.raw_indicies.back();
+					if (vertex_slots[v_idx] != slot) {
+						vertex_slots[v_idx] = slot;
+						vertex_ref[v_idx] = (u32)submesh.positions.size();
 						submesh.positions.emplace_back(m.positions[v_idx]);
 					}
 
-					if (m.normals.size()) submesh.normals.emplace_back(m.normals[j]);
-					if (m.tangents.size()) submesh.tangents.emplace_back(m.tangents[j]);
+					submesh.raw_indicies[i] = vertex_ref[v_idx];
+					if (m.normals.size()) submesh.normals[i] = m.normals[j];
+					if (m.tangents.size()) submesh.tangents[i] = m.tangents[j];
 
 					for (u32 k{ 0 }; k < m.uv_sets.size(); ++k) {
-						if (m.uv_sets[k].size()) {
-							submesh.uv_sets[k].emplace_back(m.uv_sets[k][j]);
-						}
+						if (m.uv_sets[k].size()) submesh.uv_sets[k][i] = m.uv_sets[k][j];
 					}
 				}
 			}
-
-			assert((submesh.raw_indicies.size() % 3) == 0);
-
-			return !submesh.raw_indicies.empty();
 		}
 
 		void split_meshes_by_material(Scene& scene, Progression* const progression) {
@@ -678,18 +997,14 @@ namespace lightning::tools {
 			for (auto& lod : scene.lod_groups) {
 				util::vector<Mesh> new_meshes;
 
-				for (const auto& m : lod.meshes) {
-					const u32 num_materials{ (u32)m.material_used.size() };
-					if (num_materials > 1) {
-						for (u32 i{ 0 }; i < num_materials; ++i) {
-							Mesh submesh{};
-							if (split_meshes_by_material(m.material_used[i], m, submesh)) {
-								new_meshes.emplace_back(submesh);
-							}
-						}
+				// Meshes are moved or released as soon as they're split, so the scene isn't held twice.
+				for (auto& m : lod.meshes) {
+					if (m.material_used.size() > 1) {
+						split_mesh_by_material(m, new_meshes);
+						m = {};
 					}
 					else {
-						new_meshes.emplace_back(m);
+						new_meshes.emplace_back(std::move(m));
 					}
 				}
 				progression->callback(progression->value(), progression->max_value() + (u32)new_meshes.size());
@@ -697,6 +1012,368 @@ namespace lightning::tools {
 			}
 		}
 
+		// Distance at which one unit of simplification error covers about one pixel: 1080 pixels high with a 60 degree
+		// vertical field of view, that is 1080 / (2 * tan(30 degrees)).
+		constexpr f32 lod_distance_per_error{ 935.3f };
+
+		// Adds simplified versions of the meshes to the LOD groups that only have one level of detail. Groups that come with
+		// their own levels of detail are left alone. All meshes of a group switch together, so a level is only added if it
+		// removes enough of the triangles of the whole group, and its threshold comes from the largest error in the group.
+		void generate_lods(Scene& scene, const GeometryImportSettings& settings, Progression* const progression) {
+			if (!settings.lod_count || settings.lod_triangle_ratio <= 0.f || settings.lod_triangle_ratio >= 1.f) return;
+
+			util::vector<LodGroup*> groups;
+			util::vector<const Mesh*> sources;
+
+			for (auto& lod : scene.lod_groups) {
+				if (lod.meshes.empty()) continue;
+
+				// Meshes that were processed in chunks are already packed, so their groups are left alone too.
+				bool single_level{ true };
+				for (const auto& m : lod.meshes) single_level &= m.lod_id == lod.meshes[0].lod_id && !m.packed_size;
+				if (!single_level) continue;
+
+				groups.emplace_back(&lod);
+				for (const auto& m : lod.meshes) sources.emplace_back(&m);
+			}
+
+			if (sources.empty()) return;
+
+			util::vector<util::vector<SimplifiedMesh>> simplified(sources.size());
+
+			util::parallel_for((u32)sources.size(), [&](u32 i) {
+				const Mesh& m{ *sources[i] };
+				const u32 num_verticies{ (u32)m.verticies.size() };
+				util::vector<math::v3> positions(num_verticies);
+
+				for (u32 j{ 0 }; j < num_verticies; ++j) positions[j] = m.verticies[j].position;
+
+				simplify_mesh(m.indicies.data(), (u32)m.indicies.size(), positions.data(), num_verticies, settings.lod_triangle_ratio, settings.lod_count, simplified[i]);
+			});
+
+			util::vector<Mesh> lod_meshes;
+			util::vector<u32> lod_mesh_groups;
+			u32 source_idx{ 0 };
+
+			for (u32 group_idx{ 0 }; group_idx < groups.size(); ++group_idx) {
+				const LodGroup& lod{ *groups[group_idx] };
+				const u32 num_meshes{ (u32)lod.meshes.size() };
+				const u32 first{ source_idx };
+				source_idx += num_meshes;
+
+				u32 previous_triangle_count{ 0 };
+				for (const auto& m : lod.meshes) previous_triangle_count += (u32)m.indicies.size() / 3;
+				f32 previous_threshold{ lod.meshes[0].lod_threshold };
+
+				// A mesh that simplified away completely, or couldn't be simplified any further, ends the levels of the
+				// whole group. Packing can't handle a mesh without triangles, and a level equal to the one before is useless.
+				u32 lod_count{ settings.lod_count };
+
+				for (u32 i{ first }; i < source_idx; ++i) {
+					u32 previous_index_count{ (u32)sources[i]->indicies.size() };
+					u32 level{ 0 };
+
+					for (; level < lod_count; ++level) {
+						const u32 index_count{ (u32)simplified[i][level].indicies.size() };
+						if (!index_count || index_count == previous_index_count) break;
+						previous_index_count = index_count;
+					}
+
+					lod_count = level;
+				}
+
+				for (u32 level{ 0 }; level < lod_count; ++level) {
+					u32 triangle_count{ 0 };
+					f32 error{ 0.f };
+
+					for (u32 i{ first }; i < source_idx; ++i) {
+						triangle_count += (u32)simplified[i][level].indicies.size() / 3;
+						error = std::max(error, simplified[i][level].error);
+					}
+
+					// NOTE: the levels only get smaller, so once a level doesn't pay off the following ones don't either.
+					if ((f32)triangle_count > (f32)previous_triangle_count * .9f) break;
+
+					// The engine expects the thresholds of the levels to increase.
+					const f32 threshold{ std::max(error * lod_distance_per_error, previous_threshold + EPSILON) };
+
+					for (u32 i{ first }; i < source_idx; ++i) {
+						const Mesh& source{ *sources[i] };
+						Mesh& m{ lod_meshes.emplace_back() };
+						m.name = source.name + "_LOD" + std::to_string(level + 1);
+						m.material_used = source.material_used;
+						m.verticies = source.verticies;
+						m.indicies = simplified[i][level].indicies;
+						m.elements_type = source.elements_type;
+						m.lod_threshold = threshold;
+						m.lod_id = source.lod_id + level + 1;
+						lod_mesh_groups.emplace_back(group_idx);
+					}
+
+					previous_triangle_count = triangle_count;
+					previous_threshold = threshold;
+				}
+			}
+
+			if (lod_meshes.empty()) return;
+
+			progression->callback(progression->value(), progression->max_value() + (u32)lod_meshes.size());
+
+			// Unused verticies of the source mesh are dropped by the vertex fetch optimization.
+			util::parallel_for((u32)lod_meshes.size(), [&](u32 i) {
+				pack_and_optimize(lod_meshes[i], settings);
+				progression->advance();
+			});
+
+			for (u32 i{ 0 }; i < lod_meshes.size(); ++i) {
+				groups[lod_mesh_groups[i]]->meshes.emplace_back(std::move(lod_meshes[i]));
+			}
+		}
+
+		// Meshes with more triangles than this are processed in chunks of at most this many triangles. Chunks are processed
+		// in parallel, so the memory used by processing is bounded by this times the number of threads.
+		constexpr u32 max_chunk_triangles{ 1 << 20 };
+
+		// Marks the verticies that are used by more than one chunk.
+		constexpr u32 shared_vertex{ u32_invalid_id - 1 };
+
+		// Spreads the lower 10 bits of x to every third bit.
+		constexpr u32 morton_spread(u32 x) {
+			x &= 0x3ff;
+			x = (x | (x << 16)) & 0x030000ff;
+			x = (x | (x << 8)) & 0x0300f00f;
+			x = (x | (x << 4)) & 0x030c30c3;
+			x = (x | (x << 2)) & 0x09249249;
+			return x;
+		}
+
+		// Orders the triangles along a Morton curve through the bounds of the mesh, so any range of them is spatially
+		// coherent. The 30-bit keys are radix sorted in 3 passes.
+		void sort_triangles_spatially(const Mesh& m, util::vector<u32>& triangles) {
+			const u32 num_triangles{ (u32)m.raw_indicies.size() / 3 };
+
+			const PositionBounds bounds{ calc_position_bounds(m.positions) };
+			const v3& min{ bounds.min };
+			const v3& max{ bounds.max };
+
+			// Centroids are taken as the sum of the 3 positions, so the scale maps 3 * (max - min) to the 10-bit grid.
+			const v3 scale{
+				1023.f / std::max((max.x - min.x) * 3.f, EPSILON),
+				1023.f / std::max((max.y - min.y) * 3.f, EPSILON),
+				1023.f / std::max((max.z - min.z) * 3.f, EPSILON)
+			};
+
+			auto cell = [](f32 sum, f32 min, f32 scale) { return (u32)std::clamp((sum - min * 3.f) * scale, 0.f, 1023.f); };
+
+			util::vector<u32> keys(num_triangles);
+			for (u32 i{ 0 }; i < num_triangles; ++i) {
+				const v3& p0{ m.positions[m.raw_indicies[i * 3]] };
+				const v3& p1{ m.positions[m.raw_indicies[i * 3 + 1]] };
+				const v3& p2{ m.positions[m.raw_indicies[i * 3 + 2]] };
+
+				keys[i] =
+					morton_spread(cell(p0.x + p1.x + p2.x, min.x, scale.x)) |
+					(morton_spread(cell(p0.y + p1.y + p2.y, min.y, scale.y)) << 1) |
+					(morton_spread(cell(p0.z + p1.z + p2.z, min.z, scale.z)) << 2);
+			}
+
+			triangles.resize(num_triangles);
+			for (u32 i{ 0 }; i < num_triangles; ++i) triangles[i] = i;
+
+			util::vector<u32> sorted_keys(num_triangles);
+			util::vector<u32> sorted_triangles(num_triangles);
+
+			for (u32 shift{ 0 }; shift < 30; shift += 10) {
+				u32 offsets[1024]{};
+				for (u32 i{ 0 }; i < num_triangles; ++i) ++offsets[(keys[i] >> shift) & 0x3ff];
+
+				u32 sum{ 0 };
+				for (u32& offset : offsets) {
+					const u32 count{ offset };
+					offset = sum;
+					sum += count;
+				}
+
+				for (u32 i{ 0 }; i < num_triangles; ++i) {
+					const u32 slot{ offsets[(keys[i] >> shift) & 0x3ff]++ };
+					sorted_keys[slot] = keys[i];
+					sorted_triangles[slot] = triangles[i];
+				}
+
+				keys.swap(sorted_keys);
+				triangles.swap(sorted_triangles);
+			}
+		}
+
+		// Copies a chunk of triangles into a mesh of its own, followed by the triangles of other chunks that share a vertex
+		// with it. With those, the verticies along the boundary see all of their corners, so their normals and tangents come
+		// out the same in the neighbouring chunks. Returns the number of corners that belong to the chunk itself.
+		u32 get_chunk(const Mesh& m, const u32* const triangles, u32 num_triangles, u32 chunk_idx, const util::vector<u32>& triangle_chunks,
+			const util::vector<u32>& vertex_chunks, const CornerGroups& groups, Mesh& chunk) {
+			util::vector<u32> chunk_triangles(num_triangles);
+			memcpy(chunk_triangles.data(), triangles, num_triangles * sizeof(u32));
+
+			util::vector<u32> boundary_triangles;
+			for (u32 i{ 0 }; i < num_triangles * 3; ++i) {
+				const u32 v_idx{ m.raw_indicies[triangles[i / 3] * 3 + i % 3] };
+				if (vertex_chunks[v_idx] != shared_vertex) continue;
+
+				for (u32 j{ groups.offsets[v_idx] }; j < groups.offsets[v_idx + 1]; ++j) {
+					const u32 triangle{ groups.corners[j] / 3 };
+					if (triangle_chunks[triangle] != chunk_idx) boundary_triangles.emplace_back(triangle);
+				}
+			}
+
+			std::sort(boundary_triangles.begin(), boundary_triangles.end());
+			boundary_triangles.resize(std::unique(boundary_triangles.begin(), boundary_triangles.end()) - boundary_triangles.begin());
+			for (const u32 triangle : boundary_triangles) chunk_triangles.emplace_back(triangle);
+
+			const u32 num_corners{ (u32)chunk_triangles.size() * 3 };
+
+			// Maps the positions of the mesh to the positions of the chunk, in first use order. Entries are the position of
+			// the mesh in the high and the position of the chunk in the low 32 bits. The table is sized for the chunk, not
+			// for the mesh, and can't fill up, because a chunk has fewer positions than corners.
+			u32 table_size{ 1 };
+			while (table_size <= num_corners) table_size <<= 1;
+
+			util::vector<u64> table(table_size);
+			memset(table.data(), 0xff, table_size * sizeof(u64));
+
+			chunk.raw_indicies.resize(num_corners);
+			if (m.normals.size()) chunk.normals.resize(num_corners);
+			if (m.tangents.size()) chunk.tangents.resize(num_corners);
+
+			chunk.uv_sets.resize(m.uv_sets.size());
+			for (u32 k{ 0 }; k < m.uv_sets.size(); ++k) {
+				if (m.uv_sets[k].size()) chunk.uv_sets[k].resize(num_corners);
+			}
+
+			for (u32 i{ 0 }; i < num_corners; ++i) {
+				const u32 j{ chunk_triangles[i / 3] * 3 + i % 3 };
+				const u32 v_idx{ m.raw_indicies[j] };
+
+				// Runs of 8 consecutive positions hash to the same cache line, because nearby corners mostly use nearby
+				// positions.
+				u32 slot{ ((u32)(((v_idx >> 3) * 0x9e3779b185ebca87ull) >> 32) * 8 + (v_idx & 7)) & (table_size - 1) };
+				while (table[slot] != ~0ull && (u32)(table[slot] >> 32) != v_idx) slot = (slot + 1) & (table_size - 1);
+
+				if (table[slot] == ~0ull) {
+					table[slot] = ((u64)v_idx << 32) | (u32)chunk.positions.size();
+					chunk.positions.emplace_back(m.positions[v_idx]);
+				}
+
+				chunk.raw_indicies[i] = (u32)table[slot];
+				if (m.normals.size()) chunk.normals[i] = m.normals[j];
+				if (m.tangents.size()) chunk.tangents[i] = m.tangents[j];
+
+				for (u32 k{ 0 }; k < m.uv_sets.size(); ++k) {
+					if (m.uv_sets[k].size()) chunk.uv_sets[k][i] = m.uv_sets[k][j];
+				}
+			}
+
+			return num_triangles * 3;
+		}
+
+		// Splits a mesh into spatially coherent chunks that are processed and packed one at a time. Each packed chunk is
+		// written to the chunk file and released before the thread takes the next one, and only a mesh that refers to its
+		// data is added to chunks. Apart from the input, only index sized arrays cover the whole mesh.
+		void process_in_chunks(const Mesh& m, const GeometryImportSettings& settings, ChunkFile& file, util::vector<Mesh>& chunks, Progression* const progression) {
+			const u32 num_triangles{ (u32)m.raw_indicies.size() / 3 };
+			const u32 num_chunks{ (num_triangles + max_chunk_triangles - 1) / max_chunk_triangles };
+			const u32 chunk_size{ (num_triangles + num_chunks - 1) / num_chunks };
+
+			util::vector<u32> triangles;
+			sort_triangles_spatially(m, triangles);
+
+			util::vector<u32> triangle_chunks(num_triangles);
+			for (u32 i{ 0 }; i < num_triangles; ++i) triangle_chunks[triangles[i]] = i / chunk_size;
+
+			// Within a chunk the triangles keep the order of the mesh, so the chunks read the mesh mostly sequentially.
+			{
+				util::vector<u32> cursors(num_chunks);
+				for (u32 i{ 0 }; i < num_chunks; ++i) cursors[i] = i * chunk_size;
+				for (u32 i{ 0 }; i < num_triangles; ++i) triangles[cursors[triangle_chunks[i]]++] = i;
+			}
+
+			util::vector<u32> vertex_chunks(m.positions.size(), u32_invalid_id);
+			for (u32 i{ 0 }; i < num_triangles * 3; ++i) {
+				u32& vertex_chunk{ vertex_chunks[m.raw_indicies[i]] };
+				const u32 triangle_chunk{ triangle_chunks[i / 3] };
+				if (vertex_chunk == u32_invalid_id) vertex_chunk = triangle_chunk;
+				else if (vertex_chunk != triangle_chunk) vertex_chunk = shared_vertex;
+			}
+
+			CornerGroups groups;
+			group_corners(m.raw_indicies, (u32)m.positions.size(), groups);
+
+			const PositionBounds bounds{ calc_position_bounds(m.positions) };
+
+			const u32 first_chunk{ (u32)chunks.size() };
+			chunks.resize(first_chunk + num_chunks);
+			progression->callback(progression->value(), progression->max_value() + num_chunks - 1);
+
+			util::parallel_for(num_chunks, [&](u32 i) {
+				const u32 first{ i * chunk_size };
+				const u32 count{ std::min(chunk_size, num_triangles - first) };
+
+				Mesh chunk{};
+				chunk.name = m.name;
+				const u32 num_indicies{ get_chunk(m, &triangles[first], count, i, triangle_chunks, vertex_chunks, groups, chunk) };
+
+				ProcessingScratch scratch{};
+				process_attributes(chunk, settings, scratch);
+
+				// The triangles of the neighbouring chunks were only needed for the attributes. Their verticies are
+				// dropped by the vertex fetch optimization.
+				chunk.indicies.resize(num_indicies);
+				chunk.elements_type = determine_elements_type(chunk);
+				pack_and_optimize(chunk, settings, &bounds);
+
+				util::vector<u8> buffer(get_mesh_size(chunk));
+				util::BlobStreamWriter blob{ buffer.data(), buffer.size() };
+				pack_mesh_data(chunk, blob);
+				assert(blob.offset() == buffer.size());
+
+				Mesh& packed{ chunks[first_chunk + i] };
+				packed.name = m.name;
+				packed.material_used = m.material_used;
+				packed.lod_threshold = m.lod_threshold;
+				packed.lod_id = m.lod_id;
+				packed.packed_offset = file.write(buffer.data(), buffer.size());
+				packed.packed_size = buffer.size();
+
+				progression->advance();
+			});
+		}
+
+		// Replaces the meshes that are too large to be processed at once by their packed chunks. Each mesh is released as
+		// soon as its chunks are done. If the chunk file can't be created, the meshes are processed whole.
+		void process_large_meshes(Scene& scene, const GeometryImportSettings& settings, Progression* const progression) {
+			for (auto& lod : scene.lod_groups) {
+				bool has_large_mesh{ false };
+				for (const auto& m : lod.meshes) has_large_mesh |= m.raw_indicies.size() / 3 > max_chunk_triangles;
+				if (!has_large_mesh) continue;
+
+				if (!scene.chunk_file) scene.chunk_file = std::make_unique<ChunkFile>();
+				if (!scene.chunk_file->is_valid()) return;
+
+				util::vector<Mesh> meshes;
+				meshes.reserve(lod.meshes.size());
+
+				for (auto& m : lod.meshes) {
+					if (m.raw_indicies.size() / 3 > max_chunk_triangles) {
+						process_in_chunks(m, settings, *scene.chunk_file, meshes, progression);
+						m = {};
+					}
+					else {
+						meshes.emplace_back(std::move(m));
+					}
+				}
+
+				meshes.swap(lod.meshes);
+			}
+		}
+
 		template <typename T> void append_to_vector_pod(util::vector<T>& dst, const util::vector<T>& src) {
 			if (src.empty()) return;
 
@@ -706,23 +1383,98 @@ namespace lightning::tools {
 		}
 	}
 
+	ChunkFile::ChunkFile() {
+		std::error_code error{};
+		_path = std::filesystem::temp_directory_path(error);
+		if (error) return;
+
+		static std::atomic<u32> file_count{ 0 };
+		_path /= "Lightning";
+		std::filesystem::create_directories(_path, error);
+		if (error) return;
+
+		_path /= "chunks." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(file_count++) + ".tmp";
+
+		_file.open(_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	}
+
+	ChunkFile::~ChunkFile() {
+		if (!_file.is_open()) return;
+
+		_file.close();
+		std::error_code error{};
+		std::filesystem::remove(_path, error);
+	}
+
+	u64 ChunkFile::write(const u8* const data, u64 size) {
+		assert(is_valid() && data && size);
+		std::lock_guard lock{ _mutex };
+		const u64 offset{ _size };
+
+		_file.seekp(offset);
+		_file.write((const char*)data, size);
+		assert(_file.good());
+		_size += size;
+
+		return offset;
+	}
+
+	// The data is copied through a small buffer, so a chunk is never held in memory twice.
+	void ChunkFile::read(u64 offset, u64 size, util::BlobStreamWriter& blob) {
+		assert(is_valid() && offset + size <= _size);
+		std::lock_guard lock{ _mutex };
+		u8 buffer[16 * 1024];
+
+		_file.seekg(offset);
+		while (size) {
+			const u64 count{ std::min(size, (u64)sizeof(buffer)) };
+			_file.read((char*)buffer, count);
+			assert(_file.good());
+			blob.write(buffer, count);
+			size -= count;
+		}
+	}
+
 	void process_scene(Scene& scene, const GeometryImportSettings& settings, Progression* const progression) {
 		assert(progression);
 		split_meshes_by_material(scene, progression);
-		
+		process_large_meshes(scene, settings, progression);
+
+		// Meshes are independent, so they are processed in parallel. Each mesh is processed in place, so the output
+		// doesn't depend on the number of threads or on the order in which the tasks finish.
+		util::vector<Mesh*> meshes;
 		for (auto& lod : scene.lod_groups) {
 			for (auto& m : lod.meshes) {
-				process_verticies(m, settings);
-				progression->callback(progression->value() + 1, progression->max_value());
+				if (!m.packed_size) meshes.emplace_back(&m);
 			}
 		}
+
+		// Start with the largest meshes, so a big mesh doesn't end up running alone at the end.
+		std::stable_sort(meshes.begin(), meshes.end(), [](const Mesh* a, const Mesh* b) { return a->raw_indicies.size() > b->raw_indicies.size(); });
+
+		util::parallel_for((u32)meshes.size(), [&](u32 i) {
+			ProcessingScratch scratch{};
+			process_verticies(*meshes[i], settings, scratch);
+			progression->advance();
+		});
+
+		generate_lods(scene, settings, progression);
 	}
 
+	// NOTE: the whole scene is returned in one buffer, which the editor copies into a managed array. Those are indexed
+	//       by s32, so larger scenes are rejected here rather than truncated. Chunked meshes don't raise this limit.
 	void pack_data(const Scene& scene, SceneData& data) {
 		const u64 scene_size{ get_scene_size(scene) };
-		data.buffer_size = (u32)scene_size;
+		data.buffer = nullptr;
+		data.buffer_size = 0;
+
+		if (scene_size > (u64)std::numeric_limits<s32>::max()) return;
+
 		data.buffer = (u8*)CoTaskMemAlloc(scene_size);
 		assert(data.buffer);
+		if (!data.buffer) return;
+
+		data.buffer_size = (u32)scene_size;
 
 		util::BlobStreamWriter blob{ data.buffer, data.buffer_size };
 
@@ -738,13 +1490,15 @@ namespace lightning::tools {
 			blob.write((u32)lod.meshes.size());
 
 			for (const auto& m : lod.meshes) {
-				pack_mesh_data(m, blob);
+				if (m.packed_size) scene.chunk_file->read(m.packed_offset, m.packed_size, blob);
+				else pack_mesh_data(m, blob);
 			}
 		}
 		assert(scene_size == blob.offset());
 	}
 
-	bool coalesce_meshes(const LodGroup& lod, Mesh& combined_mesh, Progression* const progression) {
+	// The meshes of the group are released as they are appended, so the group is only held in memory about once.
+	bool coalesce_meshes(LodGroup& lod, Mesh& combined_mesh, Progression* const progression) {
 		assert(lod.meshes.size());
 		const Mesh& first_mesh{ lod.meshes[0] };
 		combined_mesh.name = first_mesh.name;
@@ -762,8 +1516,21 @@ namespace lightning::tools {
 			}
 		}
 
+		u64 num_positions{ 0 }, num_indicies{ 0 };
+		for (const auto& m : lod.meshes) {
+			num_positions += m.positions.size();
+			num_indicies += m.raw_indicies.size();
+		}
+
+		combined_mesh.positions.reserve(num_positions);
+		combined_mesh.raw_indicies.reserve(num_indicies);
+		if (first_mesh.normals.size()) combined_mesh.normals.reserve(num_indicies);
+		if (first_mesh.tangents.size()) combined_mesh.tangents.reserve(num_indicies);
+		if (first_mesh.material_indicies.size()) combined_mesh.material_indicies.reserve(num_indicies / 3);
+		for (auto& uvs : combined_mesh.uv_sets) uvs.reserve(num_indicies);
+
 		for (u32 mesh_idx{ 0 }; mesh_idx < lod.meshes.size(); ++mesh_idx) {
-			const Mesh& m{ lod.meshes[mesh_idx] };
+			Mesh& m{ lod.meshes[mesh_idx] };
 			const u32 position_count{ (u32)combined_mesh.positions.size() };
 			const u32 raw_index_base{ (u32)combined_mesh.raw_indicies.size() };
 
@@ -783,6 +1550,8 @@ namespace lightning::tools {
 				combined_mesh.raw_indicies[i] += position_count;
 			}
 
+			m = {};
+
 			progression->callback(progression->value(), progression->max_value() > 1 ? progression->max_value() - 1 : 1);
 		}
 
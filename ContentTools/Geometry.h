@@ -1,5 +1,13 @@
 #pragma once
 #include "ToolsCommon.h"
+#include "MeshOptimization.h"
+#include <utility>
+#include <filesystem>
+#include <fstream>
+
+namespace lightning::util {
+	class BlobStreamWriter;
+}
 
 namespace lightning::tools {
 
@@ -98,8 +106,39 @@ namespace lightning::tools {
 			u8 color[3];
 			u8 pad;
 		};
+
+		// Maps each elements type to the struct that describes its layout. The vertex packer fills the fields of the
+		// struct by name, so a new layout only needs a struct, a specialization and an entry in Layouts.
+		template<u32 type> struct Layout;
+		template<> struct Layout<ElementsType::STATIC_COLOR> { using type = StaticColor; };
+		template<> struct Layout<ElementsType::STATIC_NORMAL> { using type = StaticNormal; };
+		template<> struct Layout<ElementsType::STATIC_NORMAL_TEXTURE> { using type = StaticNormalTexture; };
+		template<> struct Layout<ElementsType::SKELETAL> { using type = Skeletal; };
+		template<> struct Layout<ElementsType::SKELETAL_COLOR> { using type = SkeletalColor; };
+		template<> struct Layout<ElementsType::SKELETAL_NORMAL> { using type = SkeletalNormal; };
+		template<> struct Layout<ElementsType::SKELETAL_NORMAL_COLOR> { using type = SkeletalNormalColor; };
+		template<> struct Layout<ElementsType::SKELETAL_NORMAL_TEXTURE> { using type = SkeletalNormalTexture; };
+		template<> struct Layout<ElementsType::SKELETAL_NORMAL_TEXTURE_COLOR> { using type = SkeletalNormalTextureColor; };
+
+		using Layouts = std::integer_sequence<u32,
+			ElementsType::STATIC_COLOR,
+			ElementsType::STATIC_NORMAL,
+			ElementsType::STATIC_NORMAL_TEXTURE,
+			ElementsType::SKELETAL,
+			ElementsType::SKELETAL_COLOR,
+			ElementsType::SKELETAL_NORMAL,
+			ElementsType::SKELETAL_NORMAL_COLOR,
+			ElementsType::SKELETAL_NORMAL_TEXTURE,
+			ElementsType::SKELETAL_NORMAL_TEXTURE_COLOR>;
 	}
 
+	struct PositionFormat {
+		enum Type : u32 {
+			F32 = 0,	// 3 floats
+			UNORM16,	// 3 16-bit unsigned normalized values, decoded as position_offset + position * position_scale
+		};
+	};
+
 	struct Mesh {
 		util::vector<math::v3> positions;
 		util::vector<math::v3> normals;
@@ -115,10 +154,19 @@ namespace lightning::tools {
 
 		std::string name;
 		elements::ElementsType::Type elements_type{ };
+		PositionFormat::Type position_format{ };
+		math::v3 position_scale{};
+		math::v3 position_offset{};
 		util::vector<u8> position_buffer;
 		util::vector<u8> element_buffer;
+		MeshletData meshlets;
 		f32 lod_threshold{ -1.f };
 		u32 lod_id{ u32_invalid_id };
+
+		// Meshes too large to process at once are packed chunk by chunk. Each chunk only keeps where its packed data is
+		// in the chunk file of the scene.
+		u64 packed_offset{ u64_invalid_id };
+		u64 packed_size{ 0 };
 	};
 
 	struct LodGroup {
@@ -126,9 +174,31 @@ namespace lightning::tools {
 		util::vector<Mesh> meshes;
 	};
 
+	// Temporary file for the packed chunks of large meshes, so they don't stay in memory until the scene is packed.
+	// Chunks can be written from several threads. The file is deleted with the object.
+	class ChunkFile {
+		public:
+			ChunkFile();
+			~ChunkFile();
+			DISABLE_COPY_AND_MOVE(ChunkFile);
+
+			// Returns the offset of the data in the file.
+			u64 write(const u8* const data, u64 size);
+			void read(u64 offset, u64 size, util::BlobStreamWriter& blob);
+
+			[[nodiscard]] bool is_valid() const { return _file.is_open(); }
+
+		private:
+			std::filesystem::path _path;
+			std::fstream _file;
+			std::mutex _mutex{};
+			u64 _size{ 0 };
+	};
+
 	struct Scene {
 		std::string name;
 		util::vector<LodGroup> lod_groups;
+		std::unique_ptr<ChunkFile> chunk_file;
 	};
 
 	struct GeometryImportSettings {
@@ -139,6 +209,11 @@ namespace lightning::tools {
 		u8 import_embeded_textures;
 		u8 import_animations;
 		u8 coalesce_meshes;
+		u8 optimize_index_order;
+		u8 generate_meshlets;
+		u8 quantize_positions;
+		u8 lod_count;
+		f32 lod_triangle_ratio;
 	};
 
 	struct SceneData {
@@ -149,5 +224,5 @@ namespace lightning::tools {
 
 	void process_scene(Scene& scene, const GeometryImportSettings& settings, Progression* const progression);
 	void pack_data(const Scene& scene, SceneData& data);
-	bool coalesce_meshes(const LodGroup& lod, Mesh& combined_mesh, Progression* const progression);
+	bool coalesce_meshes(LodGroup& lod, Mesh& combined_mesh, Progression* const progression);
 }
\ No newline at end of file
@@ -0,0 +1,909 @@
+#include "Geometry.h"
+#include "SceneImporter.h"
+#include "CookCache.h"
+#include "Utilities/Threading.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <string_view>
+#include <filesystem>
+
+namespace lightning::tools {
+	namespace {
+
+		using namespace DirectX;
+
+		// Accessors are read in parallel, in ranges of this many elements. A multiple of 3, so ranges of corners never
+		// split a triangle.
+		constexpr u32 gltf_range_size{ 3 << 14 };
+		constexpr u32 max_uv_sets{ 4 };
+		constexpr u32 max_json_depth{ 64 };
+
+		constexpr u32 glb_magic{ 0x46546c67 };			// "glTF"
+		constexpr u32 glb_chunk_json{ 0x4e4f534a };		// "JSON"
+		constexpr u32 glb_chunk_bin{ 0x004e4942 };		// "BIN\0"
+
+		struct JsonType {
+			enum Type : u32 {
+				NULL_VALUE = 0,
+				BOOLEAN,
+				NUMBER,
+				STRING,
+				ARRAY,
+				OBJECT,
+			};
+		};
+
+		// Values point into the source text. The children of arrays and objects are linked through next.
+		struct JsonValue {
+			std::string_view key;		// name of the member if the parent is an object
+			std::string_view text;		// numbers, literals and strings without the quotes, escapes aren't resolved
+			u32 first_child{ u32_invalid_id };
+			u32 next{ u32_invalid_id };
+			u32 child_count{ 0 };
+			JsonType::Type type{ JsonType::NULL_VALUE };
+		};
+
+		class JsonDocument {
+			public:
+				bool parse(std::string_view text) {
+					_values.clear();
+					const char* at{ text.data() };
+					const char* const end{ text.data() + text.size() };
+
+					u32 root;
+					if (!parse_value(at, end, 0, root)) return false;
+
+					at = skip_whitespace(at, end);
+					return at == end;
+				}
+
+				[[nodiscard]] const JsonValue* root() const { return _values.empty() ? nullptr : &_values[0]; }
+
+				[[nodiscard]] const JsonValue* member(const JsonValue* object, std::string_view key) const {
+					if (!object || object->type != JsonType::OBJECT) return nullptr;
+
+					for (u32 i{ object->first_child }; i != u32_invalid_id; i = _values[i].next) {
+						if (_values[i].key == key) return &_values[i];
+					}
+
+					return nullptr;
+				}
+
+				// The elements of an array, in order. Empty if the value isn't an array.
+				[[nodiscard]] util::vector<const JsonValue*> elements(const JsonValue* array) const {
+					util::vector<const JsonValue*> elements;
+					if (!array || array->type != JsonType::ARRAY) return elements;
+
+					elements.reserve(array->child_count);
+					for (u32 i{ array->first_child }; i != u32_invalid_id; i = _values[i].next) elements.emplace_back(&_values[i]);
+
+					return elements;
+				}
+
+			private:
+				[[nodiscard]] static const char* skip_whitespace(const char* at, const char* const end) {
+					while (at < end && (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r')) ++at;
+					return at;
+				}
+
+				// Expects at to point at the opening quote, and leaves it after the closing quote.
+				static bool parse_string(const char*& at, const char* const end, std::string_view& text) {
+					const char* const begin{ ++at };
+
+					while (at < end && *at != '"') {
+						if (*at == '\\') ++at;
+						++at;
+					}
+
+					if (at >= end) return false;
+
+					text = { begin, (size_t)(at - begin) };
+					++at;
+					return true;
+				}
+
+				bool parse_value(const char*& at, const char* const end, u32 depth, u32& index) {
+					at = skip_whitespace(at, end);
+					if (at >= end || depth > max_json_depth) return false;
+
+					index = (u32)_values.size();
+					_values.emplace_back();
+
+					const char c{ *at };
+
+					if (c == '{' || c == '[') {
+						const bool is_object{ c == '{' };
+						const char close{ is_object ? '}' : ']' };
+						_values[index].type = is_object ? JsonType::OBJECT : JsonType::ARRAY;
+
+						at = skip_whitespace(at + 1, end);
+						if (at < end && *at == close) {
+							++at;
+							return true;
+						}
+
+						u32 last{ u32_invalid_id };
+
+						while (true) {
+							std::string_view key{};
+
+							if (is_object) {
+								at = skip_whitespace(at, end);
+								if (at >= end || *at != '"' || !parse_string(at, end, key)) return false;
+
+								at = skip_whitespace(at, end);
+								if (at >= end || *at != ':') return false;
+								++at;
+							}
+
+							u32 child;
+							if (!parse_value(at, end, depth + 1, child)) return false;
+
+							_values[child].key = key;
+							if (last == u32_invalid_id) _values[index].first_child = child;
+							else _values[last].next = child;
+							last = child;
+							++_values[index].child_count;
+
+							at = skip_whitespace(at, end);
+							if (at >= end) return false;
+							if (*at == ',') {
+								++at;
+								continue;
+							}
+							if (*at != close) return false;
+
+							++at;
+							return true;
+						}
+					}
+
+					if (c == '"') {
+						_values[index].type = JsonType::STRING;
+						return parse_string(at, end, _values[index].text);
+					}
+
+					const char* const begin{ at };
+					while (at < end && (isalnum((u8)*at) || *at == '-' || *at == '+' || *at == '.')) ++at;
+					if (at == begin) return false;
+
+					const std::string_view text{ begin, (size_t)(at - begin) };
+					_values[index].text = text;
+
+					if (text == "true" || text == "false") _values[index].type = JsonType::BOOLEAN;
+					else if (text == "null") _values[index].type = JsonType::NULL_VALUE;
+					else if (c == '-' || (c >= '0' && c <= '9')) _values[index].type = JsonType::NUMBER;
+					else return false;
+
+					return true;
+				}
+
+				util::vector<JsonValue> _values;
+		};
+
+		[[nodiscard]] f32 get_f32(const JsonValue* value, f32 default_value) {
+			if (!value || value->type != JsonType::NUMBER) return default_value;
+
+			f32 result{ default_value };
+			std::from_chars(value->text.data(), value->text.data() + value->text.size(), result);
+			return result;
+		}
+
+		[[nodiscard]] u64 get_u64(const JsonValue* value, u64 default_value) {
+			if (!value || value->type != JsonType::NUMBER) return default_value;
+
+			u64 result{ default_value };
+			const std::from_chars_result r{ std::from_chars(value->text.data(), value->text.data() + value->text.size(), result) };
+
+			// Integers may be written with a fraction or an exponent.
+			if (r.ec != std::errc{} || r.ptr != value->text.data() + value->text.size()) {
+				const f32 f{ get_f32(value, -1.f) };
+				return f >= 0.f ? (u64)f : default_value;
+			}
+
+			return result;
+		}
+
+		[[nodiscard]] u32 get_u32(const JsonValue* value, u32 default_value) {
+			const u64 result{ get_u64(value, default_value) };
+			return result <= u32_invalid_id ? (u32)result : default_value;
+		}
+
+		void append_utf8(std::string& s, u32 code_point) {
+			if (code_point < 0x80) {
+				s += (char)code_point;
+			}
+			else if (code_point < 0x800) {
+				s += (char)(0xc0 | (code_point >> 6));
+				s += (char)(0x80 | (code_point & 0x3f));
+			}
+			else if (code_point < 0x10000) {
+				s += (char)(0xe0 | (code_point >> 12));
+				s += (char)(0x80 | ((code_point >> 6) & 0x3f));
+				s += (char)(0x80 | (code_point & 0x3f));
+			}
+			else {
+				s += (char)(0xf0 | (code_point >> 18));
+				s += (char)(0x80 | ((code_point >> 12) & 0x3f));
+				s += (char)(0x80 | ((code_point >> 6) & 0x3f));
+				s += (char)(0x80 | (code_point & 0x3f));
+			}
+		}
+
+		// Resolves the escape sequences of a string value.
+		[[nodiscard]] std::string get_string(const JsonValue* value) {
+			std::string s;
+			if (!value || value->type != JsonType::STRING) return s;
+
+			const std::string_view text{ value->text };
+			s.reserve(text.size());
+
+			for (u64 i{ 0 }; i < text.size(); ++i) {
+				if (text[i] != '\\' || i + 1 >= text.size()) {
+					s += text[i];
+					continue;
+				}
+
+				const char c{ text[++i] };
+				switch (c) {
+					case 'b': s += '\b'; break;
+					case 'f': s += '\f'; break;
+					case 'n': s += '\n'; break;
+					case 'r': s += '\r'; break;
+					case 't': s += '\t'; break;
+					case 'u': {
+						u32 code_point{ 0 };
+						if (i + 4 < text.size()) std::from_chars(&text[i + 1], &text[i + 5], code_point, 16);
+						i += 4;
+
+						// Characters outside the basic plane are written as surrogate pairs.
+						if (code_point >= 0xd800 && code_point < 0xdc00 && i + 6 < text.size() && text[i + 1] == '\\' && text[i + 2] == 'u') {
+							u32 low{ 0 };
+							std::from_chars(&text[i + 3], &text[i + 7], low, 16);
+							code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+							i += 6;
+						}
+
+						append_utf8(s, code_point);
+					}
+					break;
+					default: s += c; break;
+				}
+			}
+
+			return s;
+		}
+
+		void decode_base64(std::string_view text, util::vector<u8>& data) {
+			auto decode = [](char c) -> s32 {
+				if (c >= 'A' && c <= 'Z') return c - 'A';
+				if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+				if (c >= '0' && c <= '9') return c - '0' + 52;
+				if (c == '+' || c == '-') return 62;
+				if (c == '/' || c == '_') return 63;
+				return -1;
+			};
+
+			data.reserve(text.size() * 3 / 4);
+			u32 bits{ 0 };
+			u32 num_bits{ 0 };
+
+			for (const char c : text) {
+				const s32 value{ decode(c) };
+				if (value < 0) continue;
+
+				bits = (bits << 6) | (u32)value;
+				num_bits += 6;
+
+				if (num_bits >= 8) {
+					num_bits -= 8;
+					data.emplace_back((u8)(bits >> num_bits));
+				}
+			}
+		}
+
+		[[nodiscard]] std::string decode_uri(const std::string& uri) {
+			std::string path;
+			path.reserve(uri.size());
+
+			for (u64 i{ 0 }; i < uri.size(); ++i) {
+				u32 c{ 0 };
+				if (uri[i] == '%' && i + 2 < uri.size() && std::from_chars(&uri[i + 1], &uri[i + 3], c, 16).ec == std::errc{}) {
+					path += (char)c;
+					i += 2;
+				}
+				else {
+					path += uri[i];
+				}
+			}
+
+			return path;
+		}
+
+		struct GltfBuffer {
+			const u8* data;
+			u64 size;
+		};
+
+		struct GltfAccessor {
+			const u8* data;			// first element, nullptr if the accessor has no buffer view and reads as zeros
+			u64 stride;
+			u32 count;				// 0 if the accessor is invalid
+			u32 component_type;
+			u32 component_size;
+			u32 num_components;
+			bool normalized;
+		};
+
+		struct GltfPrimitive {
+			u32 positions;
+			u32 normals;
+			u32 tangents;
+			u32 uv_sets[max_uv_sets];
+			u32 indicies;
+			u32 material;
+		};
+
+		struct GltfMesh {
+			std::string name;
+			util::vector<GltfPrimitive> primitives;
+		};
+
+		struct GltfNode {
+			std::string name;
+			util::vector<u32> children;
+			u32 mesh;
+			XMFLOAT4X4 transform;
+		};
+
+		// A mesh placed in the scene by a node.
+		struct GltfInstance {
+			Mesh* mesh;
+			u32 gltf_mesh;
+			XMFLOAT4X4 world;
+			XMFLOAT4X4 normal_world;
+			bool is_mirrored;			// the world matrix has a negative determinant, the triangles have to be flipped
+		};
+
+		// The JSON and the binary chunk of a .glb file, or the whole file for .gltf.
+		bool get_chunks(const MappedFile& source, std::string_view& json, GltfBuffer& bin) {
+			bin = {};
+
+			u32 header[3];
+			if (source.size() < sizeof(header)) return false;
+			memcpy(header, source.data(), sizeof(header));
+
+			if (header[0] != glb_magic) {
+				json = { (const char*)source.data(), (size_t)source.size() };
+				return true;
+			}
+
+			const u64 size{ std::min((u64)header[2], source.size()) };
+			u64 offset{ sizeof(header) };
+			json = {};
+
+			while (offset + 2 * sizeof(u32) <= size) {
+				u32 chunk[2];
+				memcpy(chunk, source.data() + offset, sizeof(chunk));
+				offset += sizeof(chunk);
+				if (chunk[0] > size - offset) return false;
+
+				if (chunk[1] == glb_chunk_json && json.empty()) json = { (const char*)source.data() + offset, chunk[0] };
+				else if (chunk[1] == glb_chunk_bin && !bin.data) bin = { source.data() + offset, chunk[0] };
+
+				offset += math::align_size_up<4>(chunk[0]);
+			}
+
+			return !json.empty();
+		}
+
+		// External buffers are mapped and kept in files, embedded ones are decoded into embedded.
+		void get_buffers(const char* file, const JsonDocument& json, const GltfBuffer& bin, util::vector<GltfBuffer>& buffers,
+			util::vector<MappedFile>& files, util::vector<util::vector<u8>>& embedded) {
+			const util::vector<const JsonValue*> values{ json.elements(json.member(json.root(), "buffers")) };
+			const std::filesystem::path directory{ std::filesystem::path{ file }.parent_path() };
+
+			buffers.resize(values.size());
+			files.reserve(values.size());
+			embedded.reserve(values.size());
+
+			for (u32 i{ 0 }; i < values.size(); ++i) {
+				const JsonValue* const uri_value{ json.member(values[i], "uri") };
+				GltfBuffer& buffer{ buffers[i] };
+				buffer = {};
+
+				if (!uri_value) {
+					buffer = bin;
+				}
+				else {
+					const std::string uri{ get_string(uri_value) };
+
+					if (uri.starts_with("data:")) {
+						const u64 comma{ uri.find(',') };
+						if (comma != std::string::npos && uri.rfind(";base64", comma) != std::string::npos) {
+							util::vector<u8>& data{ embedded.emplace_back() };
+							decode_base64(std::string_view{ uri }.substr(comma + 1), data);
+							buffer = { data.data(), data.size() };
+						}
+					}
+					else {
+						const MappedFile& mapped{ files.emplace_back((directory / decode_uri(uri)).string().c_str()) };
+						buffer = { mapped.data(), mapped.size() };
+					}
+				}
+
+				buffer.size = std::min(buffer.size, get_u64(json.member(values[i], "byteLength"), buffer.size));
+			}
+		}
+
+		void get_accessors(const JsonDocument& json, const util::vector<GltfBuffer>& buffers, util::vector<GltfAccessor>& accessors) {
+			const util::vector<const JsonValue*> views{ json.elements(json.member(json.root(), "bufferViews")) };
+			const util::vector<const JsonValue*> values{ json.elements(json.member(json.root(), "accessors")) };
+
+			accessors.resize(values.size());
+
+			for (u32 i{ 0 }; i < values.size(); ++i) {
+				const JsonValue* const value{ values[i] };
+				GltfAccessor& accessor{ accessors[i] };
+				accessor = {};
+
+				const std::string type{ get_string(json.member(value, "type")) };
+				accessor.num_components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+				accessor.component_type = get_u32(json.member(value, "componentType"), 0);
+				accessor.normalized = json.member(value, "normalized") && json.member(value, "normalized")->text == "true";
+
+				switch (accessor.component_type) {
+					case 5120: case 5121: accessor.component_size = 1; break;
+					case 5122: case 5123: accessor.component_size = 2; break;
+					case 5125: case 5126: accessor.component_size = 4; break;
+					default: accessor.component_size = 0; break;
+				}
+
+				const u32 count{ get_u32(json.member(value, "count"), 0) };
+				const u64 element_size{ (u64)accessor.component_size * accessor.num_components };
+				if (!element_size || !count) continue;
+
+				const u32 view_index{ get_u32(json.member(value, "bufferView"), u32_invalid_id) };
+				if (view_index == u32_invalid_id) {
+					accessor.count = count;
+					continue;
+				}
+
+				if (view_index >= views.size()) continue;
+
+				const JsonValue* const view{ views[view_index] };
+				const u32 buffer_index{ get_u32(json.member(view, "buffer"), u32_invalid_id) };
+				if (buffer_index >= buffers.size() || !buffers[buffer_index].data) continue;
+
+				const GltfBuffer& buffer{ buffers[buffer_index] };
+				const u64 view_offset{ get_u64(json.member(view, "byteOffset"), 0) };
+				const u64 view_length{ get_u64(json.member(view, "byteLength"), 0) };
+				const u64 offset{ get_u64(json.member(value, "byteOffset"), 0) };
+				const u64 stride{ get_u64(json.member(view, "byteStride"), element_size) };
+
+				// The last element has to fit into the view, and the view into the buffer.
+				if (view_offset > buffer.size || view_length > buffer.size - view_offset) continue;
+				if (stride < element_size || offset > view_length || (count - 1) * stride + element_size > view_length - offset) continue;
+
+				accessor.data = buffer.data + view_offset + offset;
+				accessor.stride = stride;
+				accessor.count = count;
+			}
+		}
+
+		[[nodiscard]] f32 read_component(const u8* const at, u32 component_type, bool normalized) {
+			switch (component_type) {
+				case 5120: { s8 v; memcpy(&v, at, sizeof(v)); return normalized ? std::max(v / 127.f, -1.f) : (f32)v; }
+				case 5121: { u8 v; memcpy(&v, at, sizeof(v)); return normalized ? v / 255.f : (f32)v; }
+				case 5122: { s16 v; memcpy(&v, at, sizeof(v)); return normalized ? std::max(v / 32767.f, -1.f) : (f32)v; }
+				case 5123: { u16 v; memcpy(&v, at, sizeof(v)); return normalized ? v / 65535.f : (f32)v; }
+				case 5125: { u32 v; memcpy(&v, at, sizeof(v)); return (f32)v; }
+				case 5126: { f32 v; memcpy(&v, at, sizeof(v)); return v; }
+				default: return 0.f;
+			}
+		}
+
+		// Reads n floats of an element. Components the accessor doesn't have read as 0.
+		void read_floats(const GltfAccessor& accessor, u32 index, f32* const values, u32 n) {
+			const u8* const element{ accessor.data ? accessor.data + index * accessor.stride : nullptr };
+
+			for (u32 i{ 0 }; i < n; ++i) {
+				values[i] = element && i < accessor.num_components
+					? read_component(element + i * accessor.component_size, accessor.component_type, accessor.normalized)
+					: 0.f;
+			}
+		}
+
+		[[nodiscard]] u32 read_index(const GltfAccessor& accessor, u32 index) {
+			if (!accessor.data) return 0;
+
+			const u8* const at{ accessor.data + index * accessor.stride };
+			switch (accessor.component_type) {
+				case 5121: return *at;
+				case 5123: { u16 v; memcpy(&v, at, sizeof(v)); return v; }
+				case 5125: { u32 v; memcpy(&v, at, sizeof(v)); return v; }
+				default: return 0;
+			}
+		}
+
+		[[nodiscard]] bool is_vertex_attribute(const util::vector<GltfAccessor>& accessors, u32 index, u32 num_components, u32 vertex_count) {
+			return index < accessors.size() && accessors[index].count == vertex_count && accessors[index].num_components == num_components;
+		}
+
+		void get_meshes(const JsonDocument& json, const util::vector<GltfAccessor>& accessors, util::vector<GltfMesh>& meshes) {
+			const util::vector<const JsonValue*> values{ json.elements(json.member(json.root(), "meshes")) };
+			meshes.resize(values.size());
+
+			for (u32 i{ 0 }; i < values.size(); ++i) {
+				GltfMesh& mesh{ meshes[i] };
+				mesh.name = get_string(json.member(values[i], "name"));
+
+				for (const JsonValue* const value : json.elements(json.member(values[i], "primitives"))) {
+					// Only triangle lists are imported.
+					if (get_u32(json.member(value, "mode"), 4) != 4) continue;
+
+					const JsonValue* const attributes{ json.member(value, "attributes") };
+					GltfPrimitive primitive{};
+					primitive.positions = get_u32(json.member(attributes, "POSITION"), u32_invalid_id);
+					if (primitive.positions >= accessors.size() || accessors[primitive.positions].num_components != 3) continue;
+
+					const u32 vertex_count{ accessors[primitive.positions].count };
+					if (!vertex_count) continue;
+
+					primitive.normals = get_u32(json.member(attributes, "NORMAL"), u32_invalid_id);
+					if (!is_vertex_attribute(accessors, primitive.normals, 3, vertex_count)) primitive.normals = u32_invalid_id;
+
+					primitive.tangents = get_u32(json.member(attributes, "TANGENT"), u32_invalid_id);
+					if (!is_vertex_attribute(accessors, primitive.tangents, 4, vertex_count)) primitive.tangents = u32_invalid_id;
+
+					for (u32 j{ 0 }; j < max_uv_sets; ++j) {
+						const std::string name{ "TEXCOORD_" + std::to_string(j) };
+						primitive.uv_sets[j] = get_u32(json.member(attributes, name), u32_invalid_id);
+						if (!is_vertex_attribute(accessors, primitive.uv_sets[j], 2, vertex_count)) primitive.uv_sets[j] = u32_invalid_id;
+					}
+
+					primitive.indicies = get_u32(json.member(value, "indices"), u32_invalid_id);
+					if (primitive.indicies != u32_invalid_id &&
+						(primitive.indicies >= accessors.size() || accessors[primitive.indicies].num_components != 1 || !accessors[primitive.indicies].count)) continue;
+
+					primitive.material = get_u32(json.member(value, "material"), u32_invalid_id);
+					mesh.primitives.emplace_back(primitive);
+				}
+			}
+		}
+
+		void get_nodes(const JsonDocument& json, util::vector<GltfNode>& nodes) {
+			const util::vector<const JsonValue*> values{ json.elements(json.member(json.root(), "nodes")) };
+			nodes.resize(values.size());
+
+			for (u32 i{ 0 }; i < values.size(); ++i) {
+				const JsonValue* const value{ values[i] };
+				GltfNode& node{ nodes[i] };
+				node.name = get_string(json.member(value, "name"));
+				node.mesh = get_u32(json.member(value, "mesh"), u32_invalid_id);
+
+				for (const JsonValue* const child : json.elements(json.member(value, "children"))) {
+					const u32 index{ get_u32(child, u32_invalid_id) };
+					if (index < values.size()) node.children.emplace_back(index);
+				}
+
+				// Matrices are stored column by column, which is the row vector layout DirectXMath uses.
+				const util::vector<const JsonValue*> matrix{ json.elements(json.member(value, "matrix")) };
+				if (matrix.size() == 16) {
+					f32* const m{ &node.transform.m[0][0] };
+					for (u32 j{ 0 }; j < 16; ++j) m[j] = get_f32(matrix[j], 0.f);
+					continue;
+				}
+
+				f32 trs[10]{ 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f };
+				const char* const names[3]{ "translation", "rotation", "scale" };
+				const u32 offsets[3]{ 0, 3, 7 };
+				const u32 sizes[3]{ 3, 4, 3 };
+
+				for (u32 j{ 0 }; j < 3; ++j) {
+					const util::vector<const JsonValue*> elements{ json.elements(json.member(value, names[j])) };
+					if (elements.size() != sizes[j]) continue;
+					for (u32 k{ 0 }; k < sizes[j]; ++k) trs[offsets[j] + k] = get_f32(elements[k], trs[offsets[j] + k]);
+				}
+
+				const XMMATRIX transform{
+					XMMatrixScaling(trs[7], trs[8], trs[9]) *
+					XMMatrixRotationQuaternion(XMVectorSet(trs[3], trs[4], trs[5], trs[6])) *
+					XMMatrixTranslation(trs[0], trs[1], trs[2])
+				};
+				XMStoreFloat4x4(&node.transform, transform);
+			}
+		}
+
+		// The nodes that aren't the child of another node, if the file has no scenes.
+		void get_root_nodes(const JsonDocument& json, const util::vector<GltfNode>& nodes, util::vector<u32>& roots) {
+			const util::vector<const JsonValue*> scenes{ json.elements(json.member(json.root(), "scenes")) };
+
+			if (scenes.size()) {
+				const u32 scene{ std::min(get_u32(json.member(json.root(), "scene"), 0), (u32)scenes.size() - 1) };
+				for (const JsonValue* const value : json.elements(json.member(scenes[scene], "nodes"))) {
+					const u32 index{ get_u32(value, u32_invalid_id) };
+					if (index < nodes.size()) roots.emplace_back(index);
+				}
+
+				return;
+			}
+
+			util::vector<u8> is_child(nodes.size(), 0);
+			for (const GltfNode& node : nodes) {
+				for (const u32 child : node.children) is_child[child] = 1;
+			}
+
+			for (u32 i{ 0 }; i < nodes.size(); ++i) {
+				if (!is_child[i]) roots.emplace_back(i);
+			}
+		}
+
+		struct GltfPlacement {
+			u32 node;
+			u32 mesh;
+			XMFLOAT4X4 world;
+		};
+
+		void get_placements(const util::vector<GltfNode>& nodes, const util::vector<GltfMesh>& meshes, u32 node_index,
+			FXMMATRIX parent, u32 depth, util::vector<GltfPlacement>& placements) {
+			// Deeper hierarchies are cycles in broken files.
+			if (depth > nodes.size()) return;
+
+			const GltfNode& node{ nodes[node_index] };
+			const XMMATRIX world{ XMLoadFloat4x4(&node.transform) * parent };
+
+			if (node.mesh < meshes.size() && meshes[node.mesh].primitives.size()) {
+				GltfPlacement& placement{ placements.emplace_back() };
+				placement.node = node_index;
+				placement.mesh = node.mesh;
+				XMStoreFloat4x4(&placement.world, world);
+			}
+
+			for (const u32 child : node.children) get_placements(nodes, meshes, child, world, depth + 1, placements);
+		}
+
+		// Work for one of the threads: a range of the verticies or of the corners of a primitive.
+		struct GltfRange {
+			const GltfInstance* instance;
+			const GltfPrimitive* primitive;
+			u32 first;
+			u32 count;
+			u32 position_offset;
+			u32 corner_offset;			// u32_invalid_id for ranges of verticies
+			u32 material;
+		};
+
+		void read_positions(const util::vector<GltfAccessor>& accessors, const GltfRange& range) {
+			const GltfAccessor& positions{ accessors[range.primitive->positions] };
+			const XMMATRIX world{ XMLoadFloat4x4(&range.instance->world) };
+			Mesh& m{ *range.instance->mesh };
+
+			for (u32 i{ range.first }; i < range.first + range.count; ++i) {
+				f32 p[3];
+				read_floats(positions, i, p, 3);
+				XMStoreFloat3(&m.positions[range.position_offset + i], XMVector3Transform(XMVectorSet(p[0], p[1], p[2], 1.f), world));
+			}
+		}
+
+		void read_corners(const util::vector<GltfAccessor>& accessors, const GltfRange& range) {
+			const GltfPrimitive& primitive{ *range.primitive };
+			const u32 vertex_count{ accessors[primitive.positions].count };
+			const XMMATRIX world{ XMLoadFloat4x4(&range.instance->world) };
+			const XMMATRIX normal_world{ XMLoadFloat4x4(&range.instance->normal_world) };
+			Mesh& m{ *range.instance->mesh };
+
+			for (u32 i{ range.first }; i < range.first + range.count; ++i) {
+				// A mirroring transform turns the triangles inside out, so the last two corners of each triangle are swapped.
+				const u32 source{ range.instance->is_mirrored && (i % 3) ? (i % 3 == 1 ? i + 1 : i - 1) : i };
+				u32 index{ primitive.indicies != u32_invalid_id ? read_index(accessors[primitive.indicies], source) : source };
+				if (index >= vertex_count) index = 0;
+
+				const u32 corner{ range.corner_offset + i };
+				m.raw_indicies[corner] = range.position_offset + index;
+
+				if (m.material_indicies.size() && !(i % 3)) m.material_indicies[corner / 3] = range.material;
+
+				if (m.normals.size()) {
+					f32 n[3];
+					read_floats(accessors[primitive.normals], index, n, 3);
+					XMStoreFloat3(&m.normals[corner], XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(n[0], n[1], n[2], 0.f), normal_world)));
+				}
+
+				if (m.tangents.size()) {
+					f32 t[4];
+					read_floats(accessors[primitive.tangents], index, t, 4);
+					const XMVECTOR tangent{ XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(t[0], t[1], t[2], 0.f), world)) };
+					XMStoreFloat4(&m.tangents[corner], XMVectorSetW(tangent, (t[3] < 0.f) != range.instance->is_mirrored ? -1.f : 1.f));
+				}
+
+				for (u32 j{ 0 }; j < m.uv_sets.size(); ++j) {
+					f32 uv[2];
+					read_floats(accessors[primitive.uv_sets[j]], index, uv, 2);
+					m.uv_sets[j][corner] = { uv[0], uv[1] };
+				}
+			}
+		}
+
+		// Sizes the mesh for all of its primitives and adds the ranges that fill it. Normals, tangents and uv sets are only
+		// used if every primitive has them.
+		void prepare_mesh(const util::vector<GltfAccessor>& accessors, const GltfMesh& gltf_mesh, u32 num_materials,
+			const GltfInstance& instance, util::vector<GltfRange>& ranges) {
+			Mesh& m{ *instance.mesh };
+			u32 num_positions{ 0 };
+			u32 num_corners{ 0 };
+			bool has_normals{ true };
+			bool has_tangents{ true };
+			u32 num_uv_sets{ max_uv_sets };
+
+			for (const GltfPrimitive& primitive : gltf_mesh.primitives) {
+				has_normals &= primitive.normals != u32_invalid_id;
+				has_tangents &= primitive.tangents != u32_invalid_id;
+
+				u32 uv_sets{ 0 };
+				while (uv_sets < max_uv_sets && primitive.uv_sets[uv_sets] != u32_invalid_id) ++uv_sets;
+				num_uv_sets = std::min(num_uv_sets, uv_sets);
+
+				const u32 vertex_count{ accessors[primitive.positions].count };
+				const u32 corner_count{ primitive.indicies != u32_invalid_id ? accessors[primitive.indicies].count : vertex_count };
+				const u32 material{ primitive.material < num_materials ? primitive.material : num_materials };
+
+				for (u32 first{ 0 }; first < vertex_count; first += gltf_range_size) {
+					ranges.emplace_back(GltfRange{ &instance, &primitive, first, std::min(gltf_range_size, vertex_count - first), num_positions, u32_invalid_id, material });
+				}
+
+				const u32 num_triangle_corners{ corner_count - corner_count % 3 };
+				for (u32 first{ 0 }; first < num_triangle_corners; first += gltf_range_size) {
+					ranges.emplace_back(GltfRange{ &instance, &primitive, first, std::min(gltf_range_size, num_triangle_corners - first), num_positions, num_corners, material });
+				}
+
+				if (num_triangle_corners && std::find(m.material_used.begin(), m.material_used.end(), material) == m.material_used.end()) {
+					m.material_used.emplace_back(material);
+				}
+
+				num_positions += vertex_count;
+				num_corners += num_triangle_corners;
+			}
+
+			m.positions.resize(num_positions);
+			m.raw_indicies.resize(num_corners);
+			if (has_normals) m.normals.resize(num_corners);
+			if (has_tangents) m.tangents.resize(num_corners);
+
+			m.uv_sets.resize(num_uv_sets);
+			for (auto& uvs : m.uv_sets) uvs.resize(num_corners);
+
+			if (m.material_used.size() > 1) m.material_indicies.resize(num_corners / 3);
+			else m.material_used.clear();
+		}
+
+		// Parses the JSON and finds the buffers of the file. Returns false if the file isn't a valid glTF file.
+		bool open_gltf(const char* file, const MappedFile& source, JsonDocument& json, util::vector<GltfBuffer>& buffers,
+			util::vector<MappedFile>& files, util::vector<util::vector<u8>>& embedded) {
+			std::string_view text;
+			GltfBuffer bin;
+
+			if (!get_chunks(source, text, bin) || !json.parse(text) || !json.root() || json.root()->type != JsonType::OBJECT) return false;
+
+			get_buffers(file, json, bin, buffers, files, embedded);
+			return true;
+		}
+
+		bool hash_gltf_buffers(const char* file, const MappedFile& source, cook_cache::KeyBuilder& key) {
+			JsonDocument json;
+			util::vector<GltfBuffer> buffers;
+			util::vector<MappedFile> files;
+			util::vector<util::vector<u8>> embedded;
+			if (!open_gltf(file, source, json, buffers, files, embedded)) return true;
+
+			for (const MappedFile& mapped : files) {
+				if (!mapped.is_valid()) return false;
+				key.add(mapped.data(), mapped.size());
+			}
+
+			return true;
+		}
+
+		void load_gltf(const char* file, const MappedFile& source, Scene& scene, SceneData* data, Progression* const progression) {
+			JsonDocument json;
+			util::vector<GltfBuffer> buffers;
+			util::vector<MappedFile> files;
+			util::vector<util::vector<u8>> embedded;
+			if (!open_gltf(file, source, json, buffers, files, embedded)) return;
+
+			util::vector<GltfAccessor> accessors;
+			util::vector<GltfMesh> gltf_meshes;
+			util::vector<GltfNode> nodes;
+			util::vector<u32> roots;
+
+			get_accessors(json, buffers, accessors);
+			get_meshes(json, accessors, gltf_meshes);
+			get_nodes(json, nodes);
+			get_root_nodes(json, nodes, roots);
+
+			const u32 num_materials{ (u32)json.elements(json.member(json.root(), "materials")).size() };
+
+			// Like with FBX files, each root node becomes a LOD group, or all of them become one with coalesce_meshes.
+			util::vector<util::vector<GltfPlacement>> groups;
+			for (const u32 root : roots) {
+				if (groups.empty() || !data->settings.coalesce_meshes) groups.emplace_back();
+				get_placements(nodes, gltf_meshes, root, XMMatrixIdentity(), 0, groups.back());
+			}
+
+			u32 num_groups{ 0 };
+			u32 num_meshes{ 0 };
+			for (const auto& group : groups) {
+				num_groups += group.size() ? 1 : 0;
+				num_meshes += (u32)group.size();
+			}
+
+			if (!num_meshes) return;
+
+			progression->callback(progression->value(), progression->max_value() + num_meshes);
+
+			// The meshes are filled in place, so the groups are never reallocated after this.
+			const std::string file_name{ std::filesystem::path{ file }.stem().string() };
+			util::vector<GltfInstance> instances;
+			instances.reserve(num_meshes);
+			scene.lod_groups.reserve(num_groups);
+
+			for (const auto& group : groups) {
+				if (group.empty()) continue;
+
+				LodGroup& lod{ scene.lod_groups.emplace_back() };
+				lod.meshes.reserve(group.size());
+
+				for (const GltfPlacement& placement : group) {
+					Mesh& m{ lod.meshes.emplace_back() };
+					m.name = nodes[placement.node].name;
+					if (m.name.empty()) m.name = gltf_meshes[placement.mesh].name;
+					if (m.name.empty()) m.name = file_name;
+					m.lod_id = 0;
+					m.lod_threshold = -1.f;
+
+					GltfInstance& instance{ instances.emplace_back() };
+					instance.mesh = &m;
+					instance.gltf_mesh = placement.mesh;
+					instance.world = placement.world;
+
+					const XMMATRIX world{ XMLoadFloat4x4(&placement.world) };
+					XMStoreFloat4x4(&instance.normal_world, XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+					instance.is_mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.f;
+				}
+
+				lod.name = lod.meshes[0].name;
+			}
+
+			util::vector<GltfRange> ranges;
+			std::unique_ptr<std::atomic<u32>[]> pending_ranges{ new std::atomic<u32>[num_meshes]{} };
+
+			for (u32 i{ 0 }; i < num_meshes; ++i) {
+				const GltfInstance& instance{ instances[i] };
+				const u32 first_range{ (u32)ranges.size() };
+				prepare_mesh(accessors, gltf_meshes[instance.gltf_mesh], num_materials, instance, ranges);
+				pending_ranges[i] = (u32)ranges.size() - first_range;
+
+				// Meshes without any triangles have no ranges.
+				if (!pending_ranges[i]) progression->advance();
+
+				if (instance.mesh->normals.empty()) data->settings.calculate_normals = true;
+				if (instance.mesh->tangents.empty()) data->settings.calculate_tangents = true;
+			}
+
+			// A mesh is done when the last of its ranges is.
+			util::parallel_for((u32)ranges.size(), [&](u32 i) {
+				if (ranges[i].corner_offset == u32_invalid_id) read_positions(accessors, ranges[i]);
+				else read_corners(accessors, ranges[i]);
+
+				if (pending_ranges[ranges[i].instance - instances.data()].fetch_sub(1) == 1) progression->advance();
+			});
+		}
+	}
+
+	EDITOR_INTERFACE void import_gltf(const char* file, SceneData* data, Progression::progress_callback callback) {
+		assert(file && data);
+		import_scene(file, data, callback, load_gltf, hash_gltf_buffers);
+	}
+}
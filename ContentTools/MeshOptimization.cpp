@@ -0,0 +1,518 @@
+#include "MeshOptimization.h"
+
+#include <algorithm>
+
+// Tipsify and the overdraw clustering follow "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// (Sander, Nehab, Barczak, 2007).
+namespace lightning::tools {
+	namespace {
+
+		using namespace DirectX;
+
+		// Triangles grouped by the verticies they use.
+		struct VertexAdjacency {
+			util::vector<u32> offsets;
+			util::vector<u32> triangles;
+		};
+
+		void build_adjacency(const u32* const indicies, u32 index_count, u32 vertex_count, VertexAdjacency& adjacency) {
+			adjacency.offsets.resize(vertex_count + 1);
+			adjacency.triangles.resize(index_count);
+			memset(adjacency.offsets.data(), 0, adjacency.offsets.size() * sizeof(u32));
+
+			for (u32 i{ 0 }; i < index_count; ++i) ++adjacency.offsets[indicies[i] + 1];
+			for (u32 i{ 0 }; i < vertex_count; ++i) adjacency.offsets[i + 1] += adjacency.offsets[i];
+
+			for (u32 i{ 0 }; i < index_count; ++i) adjacency.triangles[adjacency.offsets[indicies[i]]++] = i / 3;
+			for (u32 i{ vertex_count }; i > 0; --i) adjacency.offsets[i] = adjacency.offsets[i - 1];
+			adjacency.offsets[0] = 0;
+		}
+
+		// Picks the next fanning vertex: the candidate that stays in the cache while its remaining triangles are
+		// emitted, preferring the one that entered the cache first. Returns u32_invalid_id if there is none.
+		u32 next_fanning_vertex(const util::vector<u32>& candidates, const util::vector<u32>& live_triangles,
+			const util::vector<u32>& cache_time, u32 time, u32 cache_size) {
+
+			u32 best_vertex{ u32_invalid_id };
+			s32 best_priority{ -1 };
+
+			for (const u32 v : candidates) {
+				if (!live_triangles[v]) continue;
+
+				s32 priority{ 0 };
+				const u32 age{ time - cache_time[v] };
+				if (age + 2 * live_triangles[v] <= cache_size) priority = (s32)age;
+
+				if (priority > best_priority) {
+					best_priority = priority;
+					best_vertex = v;
+				}
+			}
+
+			return best_vertex;
+		}
+
+		// Returns the triangle order and the triangles where Tipsify had to restart from a dead end.
+		void tipsify(const u32* const indicies, u32 index_count, u32 vertex_count, u32 cache_size,
+			util::vector<u32>& triangle_order, util::vector<u32>& hard_boundaries) {
+
+			const u32 triangle_count{ index_count / 3 };
+
+			VertexAdjacency adjacency{};
+			build_adjacency(indicies, index_count, vertex_count, adjacency);
+
+			util::vector<u32> live_triangles(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i) live_triangles[i] = adjacency.offsets[i + 1] - adjacency.offsets[i];
+
+			util::vector<u32> cache_time(vertex_count, 0);
+			util::vector<u8> is_emitted(triangle_count, 0);
+			util::vector<u32> dead_end_stack;
+			util::vector<u32> candidates;
+
+			triangle_order.clear();
+			triangle_order.reserve(triangle_count);
+			hard_boundaries.clear();
+
+			u32 time{ cache_size + 1 };
+			u32 cursor{ 0 };
+			u32 fanning_vertex{ 0 };
+
+			while (fanning_vertex < vertex_count && !live_triangles[fanning_vertex]) ++fanning_vertex;
+			cursor = fanning_vertex;
+
+			if (fanning_vertex < vertex_count) hard_boundaries.emplace_back(0);
+
+			while (fanning_vertex != u32_invalid_id && fanning_vertex < vertex_count) {
+				candidates.clear();
+
+				for (u32 i{ adjacency.offsets[fanning_vertex] }; i < adjacency.offsets[fanning_vertex + 1]; ++i) {
+					const u32 triangle{ adjacency.triangles[i] };
+					if (is_emitted[triangle]) continue;
+
+					for (u32 j{ 0 }; j < 3; ++j) {
+						const u32 v{ indicies[triangle * 3 + j] };
+						dead_end_stack.emplace_back(v);
+						candidates.emplace_back(v);
+						--live_triangles[v];
+
+						if (time - cache_time[v] > cache_size) cache_time[v] = time++;
+					}
+
+					is_emitted[triangle] = 1;
+					triangle_order.emplace_back(triangle);
+				}
+
+				fanning_vertex = next_fanning_vertex(candidates, live_triangles, cache_time, time, cache_size);
+
+				if (fanning_vertex != u32_invalid_id) continue;
+
+				// Dead end: go back to a recently used vertex that still has triangles, or to the next unused vertex.
+				while (!dead_end_stack.empty()) {
+					const u32 v{ dead_end_stack.back() };
+					dead_end_stack.resize(dead_end_stack.size() - 1);
+
+					if (live_triangles[v]) {
+						fanning_vertex = v;
+						break;
+					}
+				}
+
+				while (fanning_vertex == u32_invalid_id && cursor < vertex_count) {
+					if (live_triangles[cursor]) fanning_vertex = cursor;
+					else ++cursor;
+				}
+
+				if (fanning_vertex != u32_invalid_id) hard_boundaries.emplace_back((u32)triangle_order.size());
+			}
+
+			assert(triangle_order.size() == triangle_count);
+		}
+
+		// Splits the hard clusters where the ACMR so far, including the cost of starting with an empty cache,
+		// is already within the threshold of the ACMR of the whole mesh. Sorting the clusters afterwards can't
+		// make the vertex cache reuse much worse than that.
+		void split_clusters(const u32* const indicies, const util::vector<u32>& triangle_order, const util::vector<u32>& hard_boundaries,
+			u32 vertex_count, u32 cache_size, f32 threshold, util::vector<u32>& clusters) {
+
+			const u32 triangle_count{ (u32)triangle_order.size() };
+			util::vector<u32> cache_time(vertex_count, 0);
+			u32 time{ cache_size + 1 };
+			u32 total_misses{ 0 };
+
+			for (const u32 triangle : triangle_order) {
+				for (u32 j{ 0 }; j < 3; ++j) {
+					const u32 v{ indicies[triangle * 3 + j] };
+					if (time - cache_time[v] > cache_size) {
+						cache_time[v] = time++;
+						++total_misses;
+					}
+				}
+			}
+
+			const f32 target_acmr{ threshold * (f32)total_misses / (f32)triangle_count };
+
+			clusters.clear();
+			u32 next_hard_boundary{ 0 };
+			u32 cluster_start{ 0 };
+			u32 cluster_misses{ 0 };
+
+			for (u32 i{ 0 }; i < triangle_count; ++i) {
+				const bool is_hard_boundary{ next_hard_boundary < hard_boundaries.size() && hard_boundaries[next_hard_boundary] == i };
+
+				if (i == cluster_start || is_hard_boundary) {
+					if (is_hard_boundary) ++next_hard_boundary;
+
+					// Start the new cluster with an empty cache.
+					time += cache_size + 1;
+					cluster_start = i;
+					cluster_misses = 0;
+					clusters.emplace_back(i);
+				}
+
+				const u32 triangle{ triangle_order[i] };
+				for (u32 j{ 0 }; j < 3; ++j) {
+					const u32 v{ indicies[triangle * 3 + j] };
+					if (time - cache_time[v] > cache_size) {
+						cache_time[v] = time++;
+						++cluster_misses;
+					}
+				}
+
+				if ((f32)cluster_misses / (f32)(i + 1 - cluster_start) <= target_acmr) cluster_start = i + 1;
+			}
+		}
+
+		void calculate_meshlet_bounds(const MeshletData& data, const math::v3* const positions, Meshlet& meshlet) {
+			const u32* const verticies{ &data.verticies[meshlet.vertex_offset] };
+			const u8* const triangles{ &data.triangles[meshlet.triangle_offset * 3] };
+
+			// Ritter's bounding sphere: start from the most distant pair of axis extremes and grow to enclose the rest.
+			u32 min_vertex[3]{}, max_vertex[3]{};
+			for (u32 i{ 1 }; i < meshlet.vertex_count; ++i) {
+				const f32* const p{ &positions[verticies[i]].x };
+				for (u32 axis{ 0 }; axis < 3; ++axis) {
+					if (p[axis] < (&positions[verticies[min_vertex[axis]]].x)[axis]) min_vertex[axis] = i;
+					if (p[axis] > (&positions[verticies[max_vertex[axis]]].x)[axis]) max_vertex[axis] = i;
+				}
+			}
+
+			f32 max_distance{ -1.f };
+			XMVECTOR center{}, radius{};
+			for (u32 axis{ 0 }; axis < 3; ++axis) {
+				const XMVECTOR p0{ XMLoadFloat3(&positions[verticies[min_vertex[axis]]]) };
+				const XMVECTOR p1{ XMLoadFloat3(&positions[verticies[max_vertex[axis]]]) };
+				const f32 distance{ XMVectorGetX(XMVector3LengthSq(p1 - p0)) };
+				if (distance > max_distance) {
+					max_distance = distance;
+					center = (p0 + p1) * .5f;
+					radius = XMVector3Length(p1 - p0) * .5f;
+				}
+			}
+
+			for (u32 i{ 0 }; i < meshlet.vertex_count; ++i) {
+				const XMVECTOR p{ XMLoadFloat3(&positions[verticies[i]]) };
+				const XMVECTOR distance{ XMVector3Length(p - center) };
+				if (XMVector3Greater(distance, radius)) {
+					const XMVECTOR new_radius{ (radius + distance) * .5f };
+					center += (p - center) * ((new_radius - radius) / distance);
+					radius = new_radius;
+				}
+			}
+
+			XMStoreFloat3(&meshlet.center, center);
+			meshlet.radius = XMVectorGetX(radius);
+
+			// Normal cone: the axis is the average triangle normal, and the spread is the largest angle between a normal and the axis.
+			util::vector<XMVECTOR> normals;
+			XMVECTOR axis{ XMVectorZero() };
+
+			for (u32 i{ 0 }; i < meshlet.triangle_count; ++i) {
+				const XMVECTOR p0{ XMLoadFloat3(&positions[verticies[triangles[i * 3 + 0]]]) };
+				const XMVECTOR p1{ XMLoadFloat3(&positions[verticies[triangles[i * 3 + 1]]]) };
+				const XMVECTOR p2{ XMLoadFloat3(&positions[verticies[triangles[i * 3 + 2]]]) };
+				const XMVECTOR normal{ XMVector3Cross(p1 - p0, p2 - p0) };
+				if (XMVectorGetX(XMVector3LengthSq(normal)) <= 0.f) continue;
+
+				normals.emplace_back(XMVector3Normalize(normal));
+				axis += normals.back();
+			}
+
+			meshlet.cone_axis = {};
+			meshlet.cone_cutoff = 1.f;
+			if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) <= math::EPSILON) return;
+
+			axis = XMVector3Normalize(axis);
+			f32 min_dot{ 1.f };
+			for (const XMVECTOR& normal : normals) min_dot = std::min(min_dot, XMVectorGetX(XMVector3Dot(normal, axis)));
+
+			// NOTE: with a spread close to 90 degrees the cone almost never culls anything, so it is left disabled.
+			if (min_dot <= .1f) return;
+
+			XMStoreFloat3(&meshlet.cone_axis, axis);
+			meshlet.cone_cutoff = sqrtf(1.f - min_dot * min_dot);
+		}
+	}
+
+	VertexCacheStats analyze_vertex_cache(const u32* const indicies, u32 index_count, u32 vertex_count, u32 cache_size) {
+		assert(indicies && index_count && !(index_count % 3) && vertex_count);
+		util::vector<u32> cache_time(vertex_count, 0);
+		util::vector<u8> is_used(vertex_count, 0);
+		u32 time{ cache_size + 1 };
+		u32 misses{ 0 };
+		u32 used_verticies{ 0 };
+
+		for (u32 i{ 0 }; i < index_count; ++i) {
+			const u32 v{ indicies[i] };
+			assert(v < vertex_count);
+
+			if (time - cache_time[v] > cache_size) {
+				cache_time[v] = time++;
+				++misses;
+			}
+
+			if (!is_used[v]) {
+				is_used[v] = 1;
+				++used_verticies;
+			}
+		}
+
+		return { (f32)misses / (f32)(index_count / 3), (f32)misses / (f32)used_verticies };
+	}
+
+	void optimize_index_order(u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count, f32 overdraw_threshold, u32 cache_size) {
+		assert(indicies && index_count && !(index_count % 3) && positions && vertex_count && cache_size);
+		const u32 triangle_count{ index_count / 3 };
+
+		util::vector<u32> triangle_order;
+		util::vector<u32> hard_boundaries;
+		tipsify(indicies, index_count, vertex_count, cache_size, triangle_order, hard_boundaries);
+
+		// Some meshes already come in a good order. Keep that order if Tipsify can't improve it and only sort for overdraw.
+		util::vector<u32> tipsified(index_count);
+		for (u32 i{ 0 }; i < triangle_count; ++i) memcpy(&tipsified[i * 3], &indicies[triangle_order[i] * 3], 3 * sizeof(u32));
+
+		if (analyze_vertex_cache(indicies, index_count, vertex_count, cache_size).acmr <= analyze_vertex_cache(tipsified.data(), index_count, vertex_count, cache_size).acmr) {
+			for (u32 i{ 0 }; i < triangle_count; ++i) triangle_order[i] = i;
+			hard_boundaries.clear();
+			hard_boundaries.emplace_back(0);
+		}
+
+		util::vector<u32> clusters;
+		split_clusters(indicies, triangle_order, hard_boundaries, vertex_count, cache_size, overdraw_threshold, clusters);
+
+		// Occlusion potential of a cluster is how far it is in front of the center of the mesh, along its own normal.
+		// Clusters with a high potential are likely to hide the others, so they are drawn first.
+		const u32 cluster_count{ (u32)clusters.size() };
+		util::vector<XMVECTOR> cluster_centers(cluster_count, XMVectorZero());
+		util::vector<XMVECTOR> cluster_normals(cluster_count, XMVectorZero());
+		util::vector<f32> cluster_areas(cluster_count, 0.f);
+		XMVECTOR mesh_center{ XMVectorZero() };
+		f32 mesh_area{ 0.f };
+
+		for (u32 c{ 0 }; c < cluster_count; ++c) {
+			const u32 end{ c + 1 < cluster_count ? clusters[c + 1] : triangle_count };
+
+			for (u32 i{ clusters[c] }; i < end; ++i) {
+				const u32* const triangle{ &indicies[triangle_order[i] * 3] };
+				const XMVECTOR p0{ XMLoadFloat3(&positions[triangle[0]]) };
+				const XMVECTOR p1{ XMLoadFloat3(&positions[triangle[1]]) };
+				const XMVECTOR p2{ XMLoadFloat3(&positions[triangle[2]]) };
+
+				// NOTE: the length of the cross product is twice the area of the triangle.
+				const XMVECTOR normal{ XMVector3Cross(p1 - p0, p2 - p0) };
+				const f32 area{ XMVectorGetX(XMVector3Length(normal)) };
+				const XMVECTOR center{ (p0 + p1 + p2) * (area / 3.f) };
+
+				cluster_centers[c] += center;
+				cluster_normals[c] += normal;
+				cluster_areas[c] += area;
+				mesh_center += center;
+				mesh_area += area;
+			}
+		}
+
+		if (mesh_area > 0.f) mesh_center /= mesh_area;
+
+		util::vector<f32> occlusion_potentials(cluster_count, 0.f);
+		util::vector<u32> cluster_order(cluster_count);
+
+		for (u32 c{ 0 }; c < cluster_count; ++c) {
+			cluster_order[c] = c;
+			if (cluster_areas[c] <= 0.f) continue;
+
+			const XMVECTOR center{ cluster_centers[c] / cluster_areas[c] };
+			occlusion_potentials[c] = XMVectorGetX(XMVector3Dot(center - mesh_center, XMVector3Normalize(cluster_normals[c])));
+		}
+
+		std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](u32 a, u32 b) { return occlusion_potentials[a] > occlusion_potentials[b]; });
+
+		util::vector<u32> result(index_count);
+		u32 index{ 0 };
+
+		for (const u32 c : cluster_order) {
+			const u32 end{ c + 1 < cluster_count ? clusters[c + 1] : triangle_count };
+
+			for (u32 i{ clusters[c] }; i < end; ++i) {
+				const u32* const triangle{ &indicies[triangle_order[i] * 3] };
+				result[index++] = triangle[0];
+				result[index++] = triangle[1];
+				result[index++] = triangle[2];
+			}
+		}
+
+		assert(index == index_count);
+		memcpy(indicies, result.data(), index_count * sizeof(u32));
+	}
+
+	void build_meshlets(const u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		MeshletData& data, u32 max_verticies, u32 max_triangles) {
+
+		assert(indicies && index_count && !(index_count % 3) && positions && vertex_count);
+		assert(max_verticies >= 3 && max_verticies < 0xff && max_triangles);
+		const u32 triangle_count{ index_count / 3 };
+
+		VertexAdjacency adjacency{};
+		build_adjacency(indicies, index_count, vertex_count, adjacency);
+
+		data.meshlets.clear();
+		data.verticies.clear();
+		data.triangles.clear();
+
+		util::vector<u8> is_emitted(triangle_count, 0);
+		util::vector<u8> local_index(vertex_count, 0xff);
+		util::vector<u32> candidates;
+		u32 cursor{ 0 };
+		u32 emitted_count{ 0 };
+
+		while (emitted_count < triangle_count) {
+			Meshlet meshlet{};
+			meshlet.vertex_offset = (u32)data.verticies.size();
+			meshlet.triangle_offset = (u32)data.triangles.size() / 3;
+			candidates.clear();
+
+			while (meshlet.triangle_count < max_triangles) {
+				// Grow over the neighbouring triangle that adds the fewest verticies. Ties go to the one found first.
+				// Emitted triangles are dropped from the candidates on the way, so the list stays short.
+				u32 triangle{ u32_invalid_id };
+				u32 best_new_verticies{ 4 };
+				u32 candidate_count{ 0 };
+
+				for (u32 i{ 0 }; i < candidates.size(); ++i) {
+					const u32 t{ candidates[i] };
+					if (is_emitted[t]) continue;
+					candidates[candidate_count++] = t;
+
+					u32 new_verticies{ 0 };
+					for (u32 j{ 0 }; j < 3; ++j) new_verticies += local_index[indicies[t * 3 + j]] == 0xff;
+
+					if (new_verticies < best_new_verticies && meshlet.vertex_count + new_verticies <= max_verticies) {
+						best_new_verticies = new_verticies;
+						triangle = t;
+					}
+				}
+
+				candidates.resize(candidate_count);
+
+				if (triangle == u32_invalid_id) {
+					// Neighbours that don't fit close the meshlet. If there are none left at all, continue with the next
+					// triangle in index order, which is usually close by after the index order optimization.
+					if (candidate_count) break;
+					while (is_emitted[cursor]) ++cursor;
+
+					u32 new_verticies{ 0 };
+					for (u32 j{ 0 }; j < 3; ++j) new_verticies += local_index[indicies[cursor * 3 + j]] == 0xff;
+					if (meshlet.vertex_count + new_verticies > max_verticies) break;
+
+					triangle = cursor;
+				}
+
+				for (u32 j{ 0 }; j < 3; ++j) {
+					const u32 v{ indicies[triangle * 3 + j] };
+
+					if (local_index[v] == 0xff) {
+						local_index[v] = (u8)meshlet.vertex_count++;
+						data.verticies.emplace_back(v);
+
+						for (u32 i{ adjacency.offsets[v] }; i < adjacency.offsets[v + 1]; ++i) {
+							if (!is_emitted[adjacency.triangles[i]]) candidates.emplace_back(adjacency.triangles[i]);
+						}
+					}
+
+					data.triangles.emplace_back(local_index[v]);
+				}
+
+				is_emitted[triangle] = 1;
+				++meshlet.triangle_count;
+				if (++emitted_count == triangle_count) break;
+			}
+
+			for (u32 i{ 0 }; i < meshlet.vertex_count; ++i) local_index[data.verticies[meshlet.vertex_offset + i]] = 0xff;
+
+			calculate_meshlet_bounds(data, positions, meshlet);
+			data.meshlets.emplace_back(meshlet);
+		}
+	}
+
+	u32 generate_vertex_remap(const u32* const indicies, u32 index_count, u32 vertex_count, const VertexStream* const streams, u32 stream_count, u32* const remap) {
+		assert(indicies && index_count && vertex_count && streams && stream_count && remap);
+
+		auto hash_vertex = [&](u32 v) {
+			u64 hash{ 0 };
+			for (u32 s{ 0 }; s < stream_count; ++s) hash = math::calc_hash_u64(&streams[s].data[(u64)v * streams[s].stride], streams[s].stride, hash);
+			return hash;
+		};
+
+		auto is_equal = [&](u32 a, u32 b) {
+			for (u32 s{ 0 }; s < stream_count; ++s) {
+				const u32 stride{ streams[s].stride };
+				if (memcmp(&streams[s].data[(u64)a * stride], &streams[s].data[(u64)b * stride], stride)) return false;
+			}
+			return true;
+		};
+
+		// Open addressing with linear probing, at most half full. Each used vertex is looked up once, in first-use order,
+		// so the first vertex of a set of identical ones gets the new index and the others reuse it.
+		u32 table_size{ 1 };
+		while (table_size < vertex_count * 2) table_size <<= 1;
+		const u32 mask{ table_size - 1 };
+		util::vector<u32> table(table_size, u32_invalid_id);
+
+		for (u32 i{ 0 }; i < vertex_count; ++i) remap[i] = u32_invalid_id;
+
+		u32 new_vertex_count{ 0 };
+
+		for (u32 i{ 0 }; i < index_count; ++i) {
+			const u32 v{ indicies[i] };
+			assert(v < vertex_count);
+			if (remap[v] != u32_invalid_id) continue;
+
+			u32 slot{ (u32)hash_vertex(v) & mask };
+			while (table[slot] != u32_invalid_id && !is_equal(table[slot], v)) slot = (slot + 1) & mask;
+
+			if (table[slot] == u32_invalid_id) {
+				table[slot] = v;
+				remap[v] = new_vertex_count++;
+			}
+			else {
+				remap[v] = remap[table[slot]];
+			}
+		}
+
+		return new_vertex_count;
+	}
+
+	void remap_indicies(u32* const indicies, u32 index_count, const u32* const remap) {
+		for (u32 i{ 0 }; i < index_count; ++i) {
+			assert(remap[indicies[i]] != u32_invalid_id);
+			indicies[i] = remap[indicies[i]];
+		}
+	}
+
+	void remap_verticies(void* const dst, const void* const src, u32 vertex_count, u32 stride, const u32* const remap) {
+		assert(dst && src && dst != src);
+		for (u32 i{ 0 }; i < vertex_count; ++i) {
+			if (remap[i] == u32_invalid_id) continue;
+			memcpy((u8*)dst + (u64)remap[i] * stride, (const u8*)src + (u64)i * stride, stride);
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace lightning::tools {
+
+	// Meshlet limits that suit the mesh shader output limits of current GPUs.
+	constexpr u32 meshlet_max_verticies{ 64 };
+	constexpr u32 meshlet_max_triangles{ 124 };
+
+	// Size of the simulated post-transform vertex cache. Tipsify doesn't depend much on the exact size,
+	// and 16 is a reasonable match for the FIFO caches of current GPUs.
+	constexpr u32 default_vertex_cache_size{ 16 };
+
+	// ACMR: average cache miss ratio, transformed verticies per triangle. 0.5 is the optimum for large regular meshes.
+	// ATVR: average transform to vertex ratio, transformed verticies per vertex. 1.0 is the optimum.
+	struct VertexCacheStats {
+		f32 acmr;
+		f32 atvr;
+	};
+
+	[[nodiscard]] VertexCacheStats analyze_vertex_cache(const u32* const indicies, u32 index_count, u32 vertex_count, u32 cache_size = default_vertex_cache_size);
+
+	// Reorders the triangles with Tipsify for vertex cache reuse, then groups them into clusters and sorts the
+	// clusters so triangles facing out of the mesh are drawn first, which reduces overdraw.
+	// overdraw_threshold is how much worse the ACMR may get to give the overdraw pass more clusters to sort.
+	void optimize_index_order(u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		f32 overdraw_threshold = 1.05f, u32 cache_size = default_vertex_cache_size);
+
+	// A small cluster of triangles for mesh shaders. The triangles index the meshlet's own vertex list, which indexes the
+	// vertex buffers of the mesh. The bounds are for culling the whole meshlet: it is facing away from the camera if
+	// dot(center - camera_position, cone_axis) >= cone_cutoff * length(center - camera_position) + radius.
+	// A cone_cutoff of 1 means the triangles face too many directions to cull by the cone.
+	struct Meshlet {
+		u32 vertex_offset;
+		u32 triangle_offset;
+		u32 vertex_count;
+		u32 triangle_count;
+		math::v3 center;
+		f32 radius;
+		math::v3 cone_axis;
+		f32 cone_cutoff;
+	};
+
+	struct MeshletData {
+		util::vector<Meshlet> meshlets;
+		util::vector<u32> verticies;
+		// Three local vertex indicies per triangle.
+		util::vector<u8> triangles;
+	};
+
+	// Splits the triangles into meshlets. A meshlet grows over neighbouring triangles, preferring the ones that add the
+	// fewest verticies, so the meshlets stay compact and their bounds tight. The result only depends on the input.
+	void build_meshlets(const u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		MeshletData& data, u32 max_verticies = meshlet_max_verticies, u32 max_triangles = meshlet_max_triangles);
+
+	// One packed vertex buffer: vertex i starts at data + i * stride.
+	struct VertexStream {
+		const u8* data;
+		u32 stride;
+	};
+
+	// Builds the vertex fetch remap table. Verticies whose bytes are identical in every stream are merged, and the
+	// remaining verticies are numbered in the order the indicies first use them, so the GPU reads the vertex buffers
+	// mostly sequentially. Verticies that no index uses map to u32_invalid_id. Returns the new vertex count.
+	[[nodiscard]] u32 generate_vertex_remap(const u32* const indicies, u32 index_count, u32 vertex_count,
+		const VertexStream* const streams, u32 stream_count, u32* const remap);
+	void remap_indicies(u32* const indicies, u32 index_count, const u32* const remap);
+	// NOTE: dst has to be a different buffer than src, with room for the new vertex count.
+	void remap_verticies(void* const dst, const void* const src, u32 vertex_count, u32 stride, const u32* const remap);
+}
@@ -0,0 +1,493 @@
+#include "MeshSimplification.h"
+
+#include <algorithm>
+
+// Half-edge collapses ordered by the quadric error metric of "Surface Simplification Using Quadric Error Metrics"
+// (Garland, Heckbert, 1997). The collapses are done in passes: a pass finds the cheapest collapse of every vertex,
+// then does them in the order of their error, skipping the ones next to a collapse that was already done in the pass.
+namespace lightning::tools {
+	namespace {
+
+		struct Quadric {
+			f32 a2, b2, c2, d2;
+			f32 ab, ac, ad, bc, bd, cd;
+			f32 weight;
+		};
+
+		struct VertexKind {
+			enum Kind : u8 {
+				INTERIOR,	// one set of attributes, surrounded by triangles
+				BORDER,		// one set of attributes, on an open border
+				SEAM,		// two sets of attributes, on an attribute seam
+				LOCKED,		// anything else, like corners of seams and non-manifold verticies
+			};
+		};
+
+		struct EdgeKind {
+			enum Kind : u8 {
+				REGULAR,
+				BORDER,
+				SEAM,
+				NON_MANIFOLD,
+			};
+		};
+
+		struct Collapse {
+			u32 from;
+			u32 to;
+			f32 error;
+		};
+
+		// Border and seam edges get an extra plane through the edge, perpendicular to the triangle,
+		// so the collapses along them keep their shape.
+		constexpr f32 edge_constraint_weight{ 10.f };
+
+		// Flipping a triangle or turning it more than about 75 degrees in one collapse is not allowed.
+		constexpr f32 min_normal_cos{ .25f };
+
+		// Positions are identified by the first vertex at the same position. Verticies at the same position are wedges
+		// of that position, they only differ in their attributes.
+		struct Simplifier {
+			util::vector<math::v3> positions;
+			util::vector<u32> position_ids;
+			util::vector<Quadric> quadrics;
+			util::vector<u32> triangles;
+			// Normal of each triangle in the input mesh. Small turns can add up, so they are checked against it as well.
+			util::vector<math::v3> normals;
+			u32 vertex_count;
+			f32 error;
+
+			// Triangles around each position and the kind of each position, rebuilt for every pass.
+			util::vector<u32> offsets;
+			util::vector<u32> adjacency;
+			util::vector<u8> kinds;
+			util::vector<u8> is_locked;
+			util::vector<u8> is_removed;
+		};
+
+		math::v3 sub(const math::v3& a, const math::v3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		math::v3 cross(const math::v3& a, const math::v3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		f32 dot(const math::v3& a, const math::v3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+		void add_plane(Quadric& q, const math::v3& n, f32 d, f32 weight) {
+			q.a2 += n.x * n.x * weight;
+			q.b2 += n.y * n.y * weight;
+			q.c2 += n.z * n.z * weight;
+			q.d2 += d * d * weight;
+			q.ab += n.x * n.y * weight;
+			q.ac += n.x * n.z * weight;
+			q.ad += n.x * d * weight;
+			q.bc += n.y * n.z * weight;
+			q.bd += n.y * d * weight;
+			q.cd += n.z * d * weight;
+			q.weight += weight;
+		}
+
+		void add_quadric(Quadric& dst, const Quadric& src) {
+			dst.a2 += src.a2;
+			dst.b2 += src.b2;
+			dst.c2 += src.c2;
+			dst.d2 += src.d2;
+			dst.ab += src.ab;
+			dst.ac += src.ac;
+			dst.ad += src.ad;
+			dst.bc += src.bc;
+			dst.bd += src.bd;
+			dst.cd += src.cd;
+			dst.weight += src.weight;
+		}
+
+		// Weighted sum of the squared distances from p to the planes of the quadric.
+		f32 evaluate(const Quadric& q, const math::v3& p) {
+			const f32 error{
+				p.x * p.x * q.a2 + p.y * p.y * q.b2 + p.z * p.z * q.c2 + q.d2 +
+				2.f * (p.x * p.y * q.ab + p.x * p.z * q.ac + p.y * p.z * q.bc + p.x * q.ad + p.y * q.bd + p.z * q.cd)
+			};
+
+			return error > 0.f ? error : 0.f;
+		}
+
+		u32 position_of(const Simplifier& s, u32 vertex) { return s.position_ids[vertex]; }
+
+		void build_adjacency(Simplifier& s) {
+			const u32 index_count{ (u32)s.triangles.size() };
+			s.offsets.resize(s.vertex_count + 1);
+			s.adjacency.resize(index_count);
+			memset(s.offsets.data(), 0, s.offsets.size() * sizeof(u32));
+
+			for (u32 i{ 0 }; i < index_count; ++i) ++s.offsets[position_of(s, s.triangles[i]) + 1];
+			for (u32 i{ 0 }; i < s.vertex_count; ++i) s.offsets[i + 1] += s.offsets[i];
+
+			for (u32 i{ 0 }; i < index_count; ++i) s.adjacency[s.offsets[position_of(s, s.triangles[i])]++] = i / 3;
+			for (u32 i{ s.vertex_count }; i > 0; --i) s.offsets[i] = s.offsets[i - 1];
+			s.offsets[0] = 0;
+		}
+
+		// Corner of the triangle at the position, the triangle is known to use it.
+		u32 corner_of(const Simplifier& s, u32 triangle, u32 position) {
+			const u32* const t{ &s.triangles[triangle * 3] };
+			return position_of(s, t[0]) == position ? 0 : position_of(s, t[1]) == position ? 1 : 2;
+		}
+
+		bool has_position(const Simplifier& s, u32 triangle, u32 position) {
+			const u32* const t{ &s.triangles[triangle * 3] };
+			return position_of(s, t[0]) == position || position_of(s, t[1]) == position || position_of(s, t[2]) == position;
+		}
+
+		void get_neighbours(const Simplifier& s, u32 position, util::vector<u32>& neighbours) {
+			neighbours.clear();
+
+			for (u32 i{ s.offsets[position] }; i < s.offsets[position + 1]; ++i) {
+				const u32 t{ s.adjacency[i] };
+				const u32 corner{ corner_of(s, t, position) };
+				neighbours.emplace_back(position_of(s, s.triangles[t * 3 + (corner + 1) % 3]));
+				neighbours.emplace_back(position_of(s, s.triangles[t * 3 + (corner + 2) % 3]));
+			}
+
+			std::sort(neighbours.begin(), neighbours.end());
+			neighbours.resize((u32)(std::unique(neighbours.begin(), neighbours.end()) - neighbours.begin()));
+		}
+
+		EdgeKind::Kind classify_edge(const Simplifier& s, u32 a, u32 b) {
+			u32 forward{ 0 }, backward{ 0 };
+			u32 forward_wedges[2]{}, backward_wedges[2]{};
+
+			for (u32 i{ s.offsets[a] }; i < s.offsets[a + 1]; ++i) {
+				const u32 t{ s.adjacency[i] };
+				const u32 corner{ corner_of(s, t, a) };
+				const u32 next{ s.triangles[t * 3 + (corner + 1) % 3] };
+				const u32 previous{ s.triangles[t * 3 + (corner + 2) % 3] };
+
+				if (position_of(s, next) == b) {
+					forward_wedges[0] = s.triangles[t * 3 + corner];
+					forward_wedges[1] = next;
+					++forward;
+				}
+				else if (position_of(s, previous) == b) {
+					backward_wedges[0] = s.triangles[t * 3 + corner];
+					backward_wedges[1] = previous;
+					++backward;
+				}
+			}
+
+			if (forward + backward == 1) return EdgeKind::BORDER;
+			if (forward != 1 || backward != 1) return EdgeKind::NON_MANIFOLD;
+
+			return (forward_wedges[0] == backward_wedges[0] && forward_wedges[1] == backward_wedges[1]) ? EdgeKind::REGULAR : EdgeKind::SEAM;
+		}
+
+		VertexKind::Kind classify_vertex(const Simplifier& s, u32 position, util::vector<u32>& neighbours) {
+			u32 wedges[3]{};
+			u32 wedge_count{ 0 };
+
+			for (u32 i{ s.offsets[position] }; i < s.offsets[position + 1]; ++i) {
+				const u32 t{ s.adjacency[i] };
+				const u32 wedge{ s.triangles[t * 3 + corner_of(s, t, position)] };
+
+				if (std::find(wedges, wedges + wedge_count, wedge) != wedges + wedge_count) continue;
+				if (wedge_count == 2) return VertexKind::LOCKED;
+				wedges[wedge_count++] = wedge;
+			}
+
+			u32 border_count{ 0 }, seam_count{ 0 };
+			get_neighbours(s, position, neighbours);
+
+			for (const u32 neighbour : neighbours) {
+				const EdgeKind::Kind kind{ classify_edge(s, position, neighbour) };
+				if (kind == EdgeKind::NON_MANIFOLD) return VertexKind::LOCKED;
+				border_count += kind == EdgeKind::BORDER;
+				seam_count += kind == EdgeKind::SEAM;
+			}
+
+			if (wedge_count == 1 && !border_count && !seam_count) return VertexKind::INTERIOR;
+			if (wedge_count == 1 && border_count == 2 && !seam_count) return VertexKind::BORDER;
+			if (wedge_count == 2 && !border_count && seam_count == 2) return VertexKind::SEAM;
+
+			return VertexKind::LOCKED;
+		}
+
+		void initialize(Simplifier& s, const u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count, f32& scale) {
+			s.vertex_count = vertex_count;
+			s.error = 0.f;
+
+			// Work in the unit cube, so the precision of the quadrics doesn't depend on the size and the position of the mesh.
+			math::v3 min{ positions[0] }, max{ positions[0] };
+			for (u32 i{ 1 }; i < vertex_count; ++i) {
+				min = { std::min(min.x, positions[i].x), std::min(min.y, positions[i].y), std::min(min.z, positions[i].z) };
+				max = { std::max(max.x, positions[i].x), std::max(max.y, positions[i].y), std::max(max.z, positions[i].z) };
+			}
+
+			const f32 extent{ std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z)) };
+			scale = extent > 0.f ? extent : 1.f;
+
+			s.positions.resize(vertex_count);
+			for (u32 i{ 0 }; i < vertex_count; ++i) {
+				s.positions[i] = { (positions[i].x - min.x) / scale, (positions[i].y - min.y) / scale, (positions[i].z - min.z) / scale };
+			}
+
+			u32 table_size{ 1 };
+			while (table_size < vertex_count * 2) table_size <<= 1;
+			const u32 mask{ table_size - 1 };
+			util::vector<u32> table(table_size, u32_invalid_id);
+			s.position_ids.resize(vertex_count);
+
+			for (u32 i{ 0 }; i < vertex_count; ++i) {
+				u32 slot{ (u32)math::calc_hash_u64((const u8*)&positions[i], sizeof(math::v3)) & mask };
+				while (table[slot] != u32_invalid_id && memcmp(&positions[table[slot]], &positions[i], sizeof(math::v3))) slot = (slot + 1) & mask;
+
+				if (table[slot] == u32_invalid_id) table[slot] = i;
+				s.position_ids[i] = table[slot];
+			}
+
+			// Triangles with two corners at the same position have no area, they can't be seen.
+			s.triangles.clear();
+			for (u32 i{ 0 }; i < index_count; i += 3) {
+				const u32 p0{ s.position_ids[indicies[i]] }, p1{ s.position_ids[indicies[i + 1]] }, p2{ s.position_ids[indicies[i + 2]] };
+				if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+
+				s.triangles.emplace_back(indicies[i]);
+				s.triangles.emplace_back(indicies[i + 1]);
+				s.triangles.emplace_back(indicies[i + 2]);
+			}
+
+			build_adjacency(s);
+
+			s.quadrics.resize(vertex_count);
+			memset(s.quadrics.data(), 0, s.quadrics.size() * sizeof(Quadric));
+
+			const u32 triangle_count{ (u32)s.triangles.size() / 3 };
+			s.normals.clear();
+			s.normals.reserve(triangle_count);
+
+			for (u32 t{ 0 }; t < triangle_count; ++t) {
+				const u32 p[3]{ position_of(s, s.triangles[t * 3]), position_of(s, s.triangles[t * 3 + 1]), position_of(s, s.triangles[t * 3 + 2]) };
+				math::v3 normal{ cross(sub(s.positions[p[1]], s.positions[p[0]]), sub(s.positions[p[2]], s.positions[p[0]])) };
+				s.normals.emplace_back(normal);
+				const f32 length{ sqrtf(dot(normal, normal)) };
+				if (length <= 0.f) continue;
+
+				normal = { normal.x / length, normal.y / length, normal.z / length };
+				const f32 d{ -dot(normal, s.positions[p[0]]) };
+				for (u32 j{ 0 }; j < 3; ++j) add_plane(s.quadrics[p[j]], normal, d, length * .5f);
+
+				for (u32 j{ 0 }; j < 3; ++j) {
+					const u32 a{ p[j] }, b{ p[(j + 1) % 3] };
+					const EdgeKind::Kind kind{ classify_edge(s, a, b) };
+					if (kind != EdgeKind::BORDER && kind != EdgeKind::SEAM) continue;
+
+					const math::v3 edge{ sub(s.positions[b], s.positions[a]) };
+					math::v3 edge_normal{ cross(edge, normal) };
+					const f32 edge_length{ sqrtf(dot(edge_normal, edge_normal)) };
+					if (edge_length <= 0.f) continue;
+
+					edge_normal = { edge_normal.x / edge_length, edge_normal.y / edge_length, edge_normal.z / edge_length };
+					const f32 edge_d{ -dot(edge_normal, s.positions[a]) };
+					add_plane(s.quadrics[a], edge_normal, edge_d, dot(edge, edge) * edge_constraint_weight);
+					add_plane(s.quadrics[b], edge_normal, edge_d, dot(edge, edge) * edge_constraint_weight);
+				}
+			}
+		}
+
+		f32 collapse_error(const Simplifier& s, u32 from, u32 to) {
+			Quadric q{ s.quadrics[from] };
+			add_quadric(q, s.quadrics[to]);
+			return q.weight > 0.f ? sqrtf(evaluate(q, s.positions[to]) / q.weight) : 0.f;
+		}
+
+		bool try_collapse(Simplifier& s, u32 from, u32 to, u32 triangles_left, util::vector<u32>& from_neighbours, util::vector<u32>& to_neighbours, u32& removed_count) {
+			get_neighbours(s, from, from_neighbours);
+			get_neighbours(s, to, to_neighbours);
+
+			// Link condition: the only neighbours the two positions share are the ones of the triangles on the edge.
+			// Otherwise the collapse would fold the surface onto itself.
+			u32 shared_triangles{ 0 };
+			for (u32 i{ s.offsets[from] }; i < s.offsets[from + 1]; ++i) shared_triangles += has_position(s, s.adjacency[i], to);
+
+			u32 shared_neighbours{ 0 };
+			for (u32 i{ 0 }, j{ 0 }; i < from_neighbours.size() && j < to_neighbours.size();) {
+				if (from_neighbours[i] < to_neighbours[j]) ++i;
+				else if (from_neighbours[i] > to_neighbours[j]) ++j;
+				else { ++shared_neighbours; ++i; ++j; }
+			}
+
+			// NOTE: small closed meshes could otherwise collapse until there are no triangles left.
+			if (shared_neighbours != shared_triangles || shared_triangles >= triangles_left) return false;
+
+			// Each wedge moves onto the wedge of the other position on the same side of the seam.
+			u32 wedge_map[2][2]{};
+			u32 wedge_count{ 0 };
+
+			for (u32 i{ s.offsets[from] }; i < s.offsets[from + 1]; ++i) {
+				const u32 t{ s.adjacency[i] };
+				if (!has_position(s, t, to)) continue;
+
+				const u32 from_wedge{ s.triangles[t * 3 + corner_of(s, t, from)] };
+				const u32 to_wedge{ s.triangles[t * 3 + corner_of(s, t, to)] };
+				u32 k{ 0 };
+				while (k < wedge_count && wedge_map[k][0] != from_wedge) ++k;
+
+				if (k < wedge_count) {
+					if (wedge_map[k][1] != to_wedge) return false;
+				}
+				else {
+					if (wedge_count == 2) return false;
+					wedge_map[wedge_count][0] = from_wedge;
+					wedge_map[wedge_count][1] = to_wedge;
+					++wedge_count;
+				}
+			}
+
+			for (u32 i{ s.offsets[from] }; i < s.offsets[from + 1]; ++i) {
+				const u32 t{ s.adjacency[i] };
+				if (has_position(s, t, to)) continue;
+
+				const u32 corner{ corner_of(s, t, from) };
+				const u32 wedge{ s.triangles[t * 3 + corner] };
+				if (wedge_count < 1 || (wedge_map[0][0] != wedge && (wedge_count < 2 || wedge_map[1][0] != wedge))) return false;
+
+				const math::v3& p0{ s.positions[position_of(s, s.triangles[t * 3 + (corner + 1) % 3])] };
+				const math::v3& p1{ s.positions[position_of(s, s.triangles[t * 3 + (corner + 2) % 3])] };
+				const math::v3 before{ cross(sub(p0, s.positions[from]), sub(p1, s.positions[from])) };
+				const math::v3 after{ cross(sub(p0, s.positions[to]), sub(p1, s.positions[to])) };
+
+				if (dot(before, after) <= min_normal_cos * sqrtf(dot(before, before) * dot(after, after))) return false;
+				if (dot(s.normals[t], after) <= 0.f) return false;
+			}
+
+			for (u32 i{ s.offsets[from] }; i < s.offsets[from + 1]; ++i) {
+				const u32 t{ s.adjacency[i] };
+
+				if (has_position(s, t, to)) {
+					s.is_removed[t] = 1;
+					++removed_count;
+					continue;
+				}
+
+				u32& wedge{ s.triangles[t * 3 + corner_of(s, t, from)] };
+				wedge = wedge_map[0][0] == wedge ? wedge_map[0][1] : wedge_map[1][1];
+			}
+
+			add_quadric(s.quadrics[to], s.quadrics[from]);
+
+			// The triangles around these positions changed, so their collapses have to wait for the next pass.
+			s.is_locked[from] = 1;
+			s.is_locked[to] = 1;
+			for (const u32 neighbour : from_neighbours) s.is_locked[neighbour] = 1;
+
+			return true;
+		}
+
+		// Returns the number of collapses done in the pass.
+		u32 simplify_pass(Simplifier& s, u32 target_triangle_count) {
+			build_adjacency(s);
+
+			util::vector<u32> neighbours;
+			util::vector<u32> to_neighbours;
+			s.kinds.resize(s.vertex_count);
+
+			for (u32 i{ 0 }; i < s.vertex_count; ++i) {
+				s.kinds[i] = (s.offsets[i] != s.offsets[i + 1]) ? classify_vertex(s, i, neighbours) : VertexKind::LOCKED;
+			}
+
+			// Interior verticies can move to any neighbour. Verticies on borders and seams only move along them.
+			// Every edge is a candidate, so a vertex whose cheapest collapse turns out to be invalid can still take the next one.
+			util::vector<Collapse> collapses;
+			util::vector<f32> best_errors;
+
+			for (u32 from{ 0 }; from < s.vertex_count; ++from) {
+				const VertexKind::Kind kind{ (VertexKind::Kind)s.kinds[from] };
+				if (kind == VertexKind::LOCKED) continue;
+
+				const EdgeKind::Kind edge_kind{ kind == VertexKind::INTERIOR ? EdgeKind::REGULAR : kind == VertexKind::BORDER ? EdgeKind::BORDER : EdgeKind::SEAM };
+				const u32 first{ (u32)collapses.size() };
+				get_neighbours(s, from, neighbours);
+
+				for (const u32 to : neighbours) {
+					if (classify_edge(s, from, to) != edge_kind) continue;
+					collapses.emplace_back(Collapse{ from, to, collapse_error(s, from, to) });
+				}
+
+				if (first == collapses.size()) continue;
+
+				f32 best{ collapses[first].error };
+				for (u32 i{ first + 1 }; i < collapses.size(); ++i) best = std::min(best, collapses[i].error);
+				best_errors.emplace_back(best);
+			}
+
+			if (collapses.empty()) return 0;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				return a.error < b.error || (a.error == b.error && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+			});
+
+			// Collapses that are much worse than the ones needed to reach the target wait for the next pass,
+			// where the cheap collapses that were skipped because of a neighbour get their turn first.
+			const u32 triangle_count{ (u32)s.triangles.size() / 3 };
+			const u32 needed_collapses{ (triangle_count - target_triangle_count + 1) / 2 };
+			const u32 limit_index{ std::min((u32)best_errors.size() - 1, needed_collapses * 2) };
+			std::nth_element(best_errors.begin(), best_errors.begin() + limit_index, best_errors.end());
+			const f32 error_limit{ best_errors[limit_index] * 1.5f };
+
+			s.is_locked.resize(s.vertex_count);
+			memset(s.is_locked.data(), 0, s.is_locked.size());
+			s.is_removed.resize(triangle_count);
+			memset(s.is_removed.data(), 0, s.is_removed.size());
+
+			u32 removed_count{ 0 };
+			u32 collapse_count{ 0 };
+
+			for (const Collapse& c : collapses) {
+				if (triangle_count - removed_count <= target_triangle_count || c.error > error_limit) break;
+				if (s.is_locked[c.from] || s.is_locked[c.to]) continue;
+
+				if (try_collapse(s, c.from, c.to, triangle_count - removed_count, neighbours, to_neighbours, removed_count)) {
+					s.error = std::max(s.error, c.error);
+					++collapse_count;
+				}
+			}
+
+			u32 index{ 0 };
+			for (u32 t{ 0 }; t < triangle_count; ++t) {
+				if (s.is_removed[t]) continue;
+				memmove(&s.triangles[index], &s.triangles[t * 3], 3 * sizeof(u32));
+				s.normals[index / 3] = s.normals[t];
+				index += 3;
+			}
+			s.triangles.resize(index);
+			s.normals.resize(index / 3);
+
+			return collapse_count;
+		}
+	}
+
+	void simplify_mesh(const u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		f32 triangle_ratio, u32 level_count, util::vector<SimplifiedMesh>& levels) {
+
+		assert(indicies && index_count && !(index_count % 3) && positions && vertex_count);
+		assert(triangle_ratio > 0.f && triangle_ratio < 1.f);
+
+		levels.clear();
+		if (!level_count) return;
+
+		Simplifier s{};
+		f32 scale{ 1.f };
+		initialize(s, indicies, index_count, positions, vertex_count, scale);
+
+		u32 triangle_count{ (u32)s.triangles.size() / 3 };
+
+		for (u32 level{ 0 }; level < level_count; ++level) {
+			const u32 target_triangle_count{ (u32)((f32)triangle_count * triangle_ratio) };
+
+			while (s.triangles.size() / 3 > target_triangle_count) {
+				if (!simplify_pass(s, target_triangle_count)) break;
+			}
+
+			triangle_count = (u32)s.triangles.size() / 3;
+
+			SimplifiedMesh& simplified{ levels.emplace_back() };
+			simplified.indicies.resize(s.triangles.size());
+			memcpy(simplified.indicies.data(), s.triangles.data(), s.triangles.size() * sizeof(u32));
+			simplified.error = s.error * scale;
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace lightning::tools {
+
+	// One level of detail: indicies into the verticies of the input mesh, and the largest simplification error so far,
+	// which is roughly how far the surface moved, in the units of the positions.
+	struct SimplifiedMesh {
+		util::vector<u32> indicies;
+		f32 error;
+	};
+
+	// Simplifies the mesh with half-edge collapses ordered by the quadric error metric, and keeps a copy of the indicies
+	// each time about triangle_ratio of the triangles of the previous level are left. Collapses only move verticies onto
+	// other verticies, and verticies on UV seams, attribute discontinuities and open borders only move along them, so
+	// the simplified meshes keep using the attributes of the input. A level that can't be simplified any further is
+	// the same as the previous one. The result only depends on the input.
+	void simplify_mesh(const u32* const indicies, u32 index_count, const math::v3* const positions, u32 vertex_count,
+		f32 triangle_ratio, u32 level_count, util::vector<SimplifiedMesh>& levels);
+}
@@ -0,0 +1,307 @@
+#include "MipGeneration.h"
+#include "Utilities/Threading.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+
+// Levels are filtered separably in bands of rows. The source rows a band needs are converted to linear floats and
+// filtered horizontally, then the band is filtered vertically and converted back to the format of the level. A texel
+// is 4 floats, one SSE register, in the horizontal pass. The vertical pass works on whole rows, 8 floats at a time
+// with AVX2, 4 with SSE4.1. Box filters average the texels under the smaller texel, Kaiser filters are a Kaiser
+// windowed sinc that's 3 smaller texels wide on each side, which keeps more detail at the cost of some ringing.
+
+namespace lightning::tools {
+	namespace {
+
+		#if defined(__AVX2__)
+		constexpr u32 lane_count{ 8 };
+		using f32v = __m256;
+
+		inline f32v v_load(const f32* p) { return _mm256_loadu_ps(p); }
+		inline void v_store(f32* p, f32v a) { _mm256_storeu_ps(p, a); }
+		inline f32v v_set(f32 a) { return _mm256_set1_ps(a); }
+		inline f32v v_add(f32v a, f32v b) { return _mm256_add_ps(a, b); }
+		inline f32v v_mul(f32v a, f32v b) { return _mm256_mul_ps(a, b); }
+		#else
+		constexpr u32 lane_count{ 4 };
+		using f32v = __m128;
+
+		inline f32v v_load(const f32* p) { return _mm_loadu_ps(p); }
+		inline void v_store(f32* p, f32v a) { _mm_storeu_ps(p, a); }
+		inline f32v v_set(f32 a) { return _mm_set1_ps(a); }
+		inline f32v v_add(f32v a, f32v b) { return _mm_add_ps(a, b); }
+		inline f32v v_mul(f32v a, f32v b) { return _mm_mul_ps(a, b); }
+		#endif
+
+		constexpr u32 band_rows{ 16 };
+		constexpr f32 kaiser_radius{ 3.f };
+		constexpr f32 kaiser_alpha{ 4.f };
+
+		// Source texels and weights of each texel of the smaller level along one axis. Every texel has tap_count taps,
+		// the ones it doesn't need have 0 weight. Texels outside the level are clamped to the edge.
+		struct Kernel {
+			util::vector<u32> indicies;
+			util::vector<f32> weights;
+			u32 tap_count;
+		};
+
+		// Modified Bessel function of the first kind and order 0.
+		f32 bessel0(f32 x) {
+			const f32 half_x{ x * .5f };
+			f32 term{ 1.f };
+			f32 sum{ 1.f };
+
+			for (u32 k{ 1 }; term > sum * 1e-7f; ++k) {
+				term *= (half_x / (f32)k) * (half_x / (f32)k);
+				sum += term;
+			}
+
+			return sum;
+		}
+
+		// x is in texels of the smaller level.
+		f32 kaiser(f32 x) {
+			const f32 t{ x / kaiser_radius };
+			if (std::abs(t) >= 1.f) return 0.f;
+
+			const f32 sinc{ std::abs(x) < 1e-5f ? 1.f : std::sin(math::PI * x) / (math::PI * x) };
+			return sinc * bessel0(kaiser_alpha * std::sqrt(1.f - t * t)) / bessel0(kaiser_alpha);
+		}
+
+		Kernel make_kernel(u32 source_size, u32 size, MipFilter::Type filter) {
+			Kernel kernel{};
+
+			if (source_size == size) {
+				kernel.tap_count = 1;
+				kernel.indicies.resize(size);
+				kernel.weights.resize(size, 1.f);
+				for (u32 i{ 0 }; i < size; ++i) kernel.indicies[i] = i;
+
+				return kernel;
+			}
+
+			const f32 scale{ (f32)source_size / (f32)size };
+			const f32 support{ filter == MipFilter::BOX ? scale * .5f : kaiser_radius * scale };
+			util::vector<s32> first(size);
+			util::vector<s32> last(size);
+			kernel.tap_count = 0;
+
+			for (u32 i{ 0 }; i < size; ++i) {
+				const f32 center{ ((f32)i + .5f) * scale };
+
+				if (filter == MipFilter::BOX) {
+					first[i] = (s32)std::floor(center - support);
+					last[i] = (s32)std::ceil(center + support) - 1;
+				}
+				else {
+					first[i] = (s32)std::ceil(center - support - .5f);
+					last[i] = (s32)std::floor(center + support - .5f);
+				}
+
+				kernel.tap_count = std::max(kernel.tap_count, (u32)(last[i] - first[i] + 1));
+			}
+
+			kernel.indicies.resize(size * kernel.tap_count);
+			kernel.weights.resize(size * kernel.tap_count);
+
+			for (u32 i{ 0 }; i < size; ++i) {
+				const f32 center{ ((f32)i + .5f) * scale };
+				u32* const indicies{ &kernel.indicies[i * kernel.tap_count] };
+				f32* const weights{ &kernel.weights[i * kernel.tap_count] };
+				f32 sum{ 0.f };
+
+				for (u32 k{ 0 }; k < kernel.tap_count; ++k) {
+					const s32 j{ std::min(first[i] + (s32)k, last[i]) };
+					f32 weight{ 0.f };
+
+					if (first[i] + (s32)k <= last[i]) {
+						weight = filter == MipFilter::BOX ?
+							std::min((f32)(j + 1), center + support) - std::max((f32)j, center - support) :
+							kaiser(((f32)j + .5f - center) / scale);
+					}
+
+					indicies[k] = (u32)std::clamp(j, 0, (s32)source_size - 1);
+					weights[k] = weight;
+					sum += weight;
+				}
+
+				for (u32 k{ 0 }; k < kernel.tap_count; ++k) weights[k] /= sum;
+			}
+
+			return kernel;
+		}
+
+		struct SrgbTables {
+			f32 to_linear[256];
+			u8 from_linear[65536];
+
+			SrgbTables() {
+				for (u32 i{ 0 }; i < 256; ++i) {
+					const f32 c{ (f32)i / 255.f };
+					to_linear[i] = c <= .04045f ? c / 12.92f : std::pow((c + .055f) / 1.055f, 2.4f);
+				}
+
+				for (u32 i{ 0 }; i < 65536; ++i) {
+					const f32 c{ (f32)i / 65535.f };
+					const f32 srgb{ c <= .0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - .055f };
+					from_linear[i] = (u8)(srgb * 255.f + .5f);
+				}
+			}
+		};
+
+		const SrgbTables& get_srgb_tables() {
+			static const SrgbTables tables{};
+			return tables;
+		}
+
+		// Returns the row as linear floats, either in buffer or straight from the source if it's already in that format.
+		const f32* load_row(const u8* const source, u32 width, MipFormat::Type format, f32* const buffer) {
+			if (format == MipFormat::RGBA32_FLOAT) return (const f32*)source;
+
+			if (format == MipFormat::RGBA8_UNORM) {
+				const __m128 scale{ _mm_set1_ps(1.f / 255.f) };
+
+				for (u32 x{ 0 }; x < width; ++x) {
+					const __m128i texel{ _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const s32*)&source[x * 4])) };
+					_mm_storeu_ps(&buffer[x * 4], _mm_mul_ps(_mm_cvtepi32_ps(texel), scale));
+				}
+			}
+			else {
+				const f32* const to_linear{ get_srgb_tables().to_linear };
+
+				for (u32 x{ 0 }; x < width; ++x) {
+					const u8* const texel{ &source[x * 4] };
+					_mm_storeu_ps(&buffer[x * 4], _mm_set_ps((f32)texel[3] * (1.f / 255.f), to_linear[texel[2]], to_linear[texel[1]], to_linear[texel[0]]));
+				}
+			}
+
+			return buffer;
+		}
+
+		void store_row(const f32* const row, u32 width, MipFormat::Type format, u8* const destination) {
+			if (format == MipFormat::RGBA32_FLOAT) {
+				memcpy(destination, row, width * 4 * sizeof(f32));
+				return;
+			}
+
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.f) };
+
+			if (format == MipFormat::RGBA8_UNORM) {
+				const __m128 scale{ _mm_set1_ps(255.f) };
+				const __m128 half{ _mm_set1_ps(.5f) };
+
+				for (u32 x{ 0 }; x < width; ++x) {
+					const __m128 texel{ _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&row[x * 4]), zero), one) };
+					const __m128i bytes{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, scale), half)) };
+					*(s32*)&destination[x * 4] = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(bytes, bytes), bytes));
+				}
+			}
+			else {
+				const u8* const from_linear{ get_srgb_tables().from_linear };
+				const __m128 scale{ _mm_setr_ps(65535.f, 65535.f, 65535.f, 255.f) };
+				const __m128 half{ _mm_set1_ps(.5f) };
+				alignas(16) s32 values[4];
+
+				for (u32 x{ 0 }; x < width; ++x) {
+					const __m128 texel{ _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&row[x * 4]), zero), one) };
+					_mm_store_si128((__m128i*)values, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, scale), half)));
+
+					u8* const out{ &destination[x * 4] };
+					out[0] = from_linear[values[0]];
+					out[1] = from_linear[values[1]];
+					out[2] = from_linear[values[2]];
+					out[3] = (u8)values[3];
+				}
+			}
+		}
+
+		void filter_row(const f32* const source, const Kernel& kernel, u32 width, f32* const out) {
+			const u32 tap_count{ kernel.tap_count };
+
+			for (u32 x{ 0 }; x < width; ++x) {
+				const u32* const indicies{ &kernel.indicies[x * tap_count] };
+				const f32* const weights{ &kernel.weights[x * tap_count] };
+				__m128 sum{ _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(&source[indicies[0] * 4])) };
+
+				for (u32 k{ 1 }; k < tap_count; ++k) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(&source[indicies[k] * 4])));
+				}
+
+				_mm_storeu_ps(&out[x * 4], sum);
+			}
+		}
+
+		void filter_column(const f32* const* const rows, const f32* const weights, u32 tap_count, u32 float_count, f32* const out) {
+			u32 i{ 0 };
+
+			for (; i + lane_count <= float_count; i += lane_count) {
+				f32v sum{ v_mul(v_set(weights[0]), v_load(&rows[0][i])) };
+
+				for (u32 k{ 1 }; k < tap_count; ++k) {
+					sum = v_add(sum, v_mul(v_set(weights[k]), v_load(&rows[k][i])));
+				}
+
+				v_store(&out[i], sum);
+			}
+
+			for (; i < float_count; ++i) {
+				f32 sum{ 0.f };
+				for (u32 k{ 0 }; k < tap_count; ++k) sum += weights[k] * rows[k][i];
+				out[i] = sum;
+			}
+		}
+
+		// Filters rows [first_row, last_row) of destination from source.
+		void filter_band(const MipSurface& source, const MipSurface& destination, const Kernel& horizontal, const Kernel& vertical, MipFormat::Type format, u32 first_row, u32 last_row) {
+			const u32 tap_count{ vertical.tap_count };
+			const u32 first_source_row{ vertical.indicies[first_row * tap_count] };
+			const u32 last_source_row{ vertical.indicies[(last_row - 1) * tap_count + tap_count - 1] };
+			const u32 float_count{ destination.width * 4 };
+
+			util::vector<f32> rows((last_source_row - first_source_row + 1) * float_count);
+			util::vector<f32> buffer(format == MipFormat::RGBA32_FLOAT ? 0 : source.width * 4);
+			util::vector<f32> out(float_count);
+			util::vector<const f32*> tap_rows(tap_count);
+
+			for (u32 y{ first_source_row }; y <= last_source_row; ++y) {
+				const f32* const row{ load_row(&source.pixels[(u64)y * source.row_pitch], source.width, format, buffer.data()) };
+				filter_row(row, horizontal, destination.width, &rows[(y - first_source_row) * float_count]);
+			}
+
+			for (u32 y{ first_row }; y < last_row; ++y) {
+				const u32* const indicies{ &vertical.indicies[y * tap_count] };
+
+				for (u32 k{ 0 }; k < tap_count; ++k) tap_rows[k] = &rows[(indicies[k] - first_source_row) * float_count];
+
+				filter_column(tap_rows.data(), &vertical.weights[y * tap_count], tap_count, float_count, out.data());
+				store_row(out.data(), destination.width, format, &destination.pixels[(u64)y * destination.row_pitch]);
+			}
+		}
+	}
+
+	void generate_mip_chains(const MipSurface* const surfaces, u32 chain_count, u32 mip_levels, MipFormat::Type format, MipFilter::Type filter) {
+		assert(surfaces && chain_count && mip_levels);
+		assert(format < MipFormat::count && filter < MipFilter::count);
+
+		if (format == MipFormat::RGBA8_SRGB) get_srgb_tables();
+
+		for (u32 level{ 1 }; level < mip_levels; ++level) {
+			const MipSurface& source{ surfaces[level - 1] };
+			const MipSurface& destination{ surfaces[level] };
+			assert(destination.width == std::max(source.width >> 1, 1u) && destination.height == std::max(source.height >> 1, 1u));
+
+			const Kernel horizontal{ make_kernel(source.width, destination.width, filter) };
+			const Kernel vertical{ make_kernel(source.height, destination.height, filter) };
+			const u32 band_count{ (destination.height + band_rows - 1) / band_rows };
+
+			util::parallel_for(chain_count * band_count, [&](u32 i) {
+				const MipSurface* const chain{ &surfaces[(i / band_count) * mip_levels] };
+				const u32 first_row{ (i % band_count) * band_rows };
+
+				filter_band(chain[level - 1], chain[level], horizontal, vertical, format, first_row, std::min(first_row + band_rows, destination.height));
+			});
+		}
+	}
+}
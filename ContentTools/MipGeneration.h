@@ -0,0 +1,37 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace lightning::tools {
+
+	struct MipFilter {
+		enum Type : u32 {
+			BOX = 0,
+			KAISER,
+
+			count
+		};
+	};
+
+	// 8 bit formats are RGBA or BGRA, only the sRGB one is converted to linear for filtering. Alpha is always linear.
+	struct MipFormat {
+		enum Type : u32 {
+			RGBA8_UNORM = 0,
+			RGBA8_SRGB,
+			RGBA32_FLOAT,
+
+			count
+		};
+	};
+
+	// One mip level of a texture, cube face or array slice.
+	struct MipSurface {
+		u8* pixels;
+		u32 width;
+		u32 height;
+		u32 row_pitch;
+	};
+
+	// Fills in levels 1 to mip_levels - 1 of every chain from level 0. The surfaces are mip_levels consecutive levels for each
+	// chain, all chains have the same size. Each level is filtered from the one above it, all chains at once on all hardware threads.
+	void generate_mip_chains(const MipSurface* const surfaces, u32 chain_count, u32 mip_levels, MipFormat::Type format, MipFilter::Type filter);
+}
@@ -2,13 +2,82 @@
 #include "Content/ContentToEngine.h"
 #include "Utilities/IOStream.h"
 #include <DirectXTex.h>
+#include <immintrin.h>
 
 using namespace DirectX;
 using namespace Microsoft::WRL;
 
+// The image is split into a grid of strata and a run of consecutive pixels is sampled at a random position in each
+// stratum. The strata are visited in rounds that each cover the whole image, and after every round the statistics
+// are checked to see if they're already conclusive. Runs are evaluated 8 pixels at a time with AVX2, 4 with SSE4.1.
+
 namespace lightning::tools {
 	namespace {
 
+		#if defined(__AVX2__)
+		constexpr u32 lane_count{ 8 };
+		using f32v = __m256;
+
+		inline f32v v_set(f32 a) { return _mm256_set1_ps(a); }
+		inline f32v v_zero() { return _mm256_setzero_ps(); }
+		inline f32v v_add(f32v a, f32v b) { return _mm256_add_ps(a, b); }
+		inline f32v v_sub(f32v a, f32v b) { return _mm256_sub_ps(a, b); }
+		inline f32v v_mul(f32v a, f32v b) { return _mm256_mul_ps(a, b); }
+		inline f32v v_lt(f32v a, f32v b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		inline f32v v_le(f32v a, f32v b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		inline f32v v_and(f32v a, f32v b) { return _mm256_and_ps(a, b); }
+		inline f32v v_or(f32v a, f32v b) { return _mm256_or_ps(a, b); }
+		inline f32v v_andnot(f32v a, f32v b) { return _mm256_andnot_ps(a, b); }
+		inline u32 v_count(f32v mask) { return (u32)_mm_popcnt_u32((u32)_mm256_movemask_ps(mask)); }
+		inline f32 v_sum(f32v a) {
+			const __m128 s{ _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)) };
+			const __m128 t{ _mm_add_ps(s, _mm_movehl_ps(s, s)) };
+			return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+		}
+
+		// Splits 8 RGBA8 pixels into the 4 channels, as floats from 0 to 255.
+		inline void v_load_pixels(const u8* const pixels, const __m128i shuffle, f32v (&channels)[4]) {
+			const __m256i grouped{ _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)pixels), _mm256_broadcastsi128_si256(shuffle)) };
+			const __m256i ordered{ _mm256_permutevar8x32_epi32(grouped, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)) };
+			const __m128i low{ _mm256_castsi256_si128(ordered) };
+			const __m128i high{ _mm256_extracti128_si256(ordered, 1) };
+
+			channels[0] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(low));
+			channels[1] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+			channels[2] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(high));
+			channels[3] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+		}
+		#else
+		constexpr u32 lane_count{ 4 };
+		using f32v = __m128;
+
+		inline f32v v_set(f32 a) { return _mm_set1_ps(a); }
+		inline f32v v_zero() { return _mm_setzero_ps(); }
+		inline f32v v_add(f32v a, f32v b) { return _mm_add_ps(a, b); }
+		inline f32v v_sub(f32v a, f32v b) { return _mm_sub_ps(a, b); }
+		inline f32v v_mul(f32v a, f32v b) { return _mm_mul_ps(a, b); }
+		inline f32v v_lt(f32v a, f32v b) { return _mm_cmplt_ps(a, b); }
+		inline f32v v_le(f32v a, f32v b) { return _mm_cmple_ps(a, b); }
+		inline f32v v_and(f32v a, f32v b) { return _mm_and_ps(a, b); }
+		inline f32v v_or(f32v a, f32v b) { return _mm_or_ps(a, b); }
+		inline f32v v_andnot(f32v a, f32v b) { return _mm_andnot_ps(a, b); }
+		inline u32 v_count(f32v mask) { return (u32)_mm_popcnt_u32((u32)_mm_movemask_ps(mask)); }
+		inline f32 v_sum(f32v a) {
+			const __m128 t{ _mm_add_ps(a, _mm_movehl_ps(a, a)) };
+			return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+		}
+
+		// Splits 4 RGBA8 pixels into the 4 channels, as floats from 0 to 255.
+		inline void v_load_pixels(const u8* const pixels, const __m128i shuffle, f32v (&channels)[4]) {
+			const __m128i grouped{ _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pixels), shuffle) };
+
+			channels[0] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(grouped));
+			channels[1] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(grouped, 4)));
+			channels[2] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(grouped, 8)));
+			channels[3] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(grouped, 12)));
+		}
+		#endif
+
 		constexpr f32 inv_255{ 1.f / 255.f };
 		constexpr f32 min_avg_length_threshold{ .7f };
 		constexpr f32 max_avg_length_threshold{ 1.1f };
@@ -16,98 +85,140 @@ namespace lightning::tools {
 		constexpr f32 vector_length_sq_rejection_threshold{ min_avg_length_threshold * min_avg_length_threshold };
 		constexpr f32 rejection_ratio_threshold{ .33f };
 
-		struct Color {
-			f32 r, g, b, a;
-			bool is_transparent() const { return a < .001f; }
-			bool is_black() const { return r < .001f && g < .001f && b < .001f; }
-
-			Color operator+(Color c) {
-				r += c.r;
-				g += c.g;
-				b += c.b;
-				a += c.a;
+		// The statistics are conclusive when the rejected fraction is this many standard errors away from the threshold,
+		// and, to accept early, the average vector is this far inside the limits.
+		constexpr f32 conclusive_deviations{ 4.f };
+		constexpr f32 conclusive_margin{ .05f };
 
-				return *this;
-			}
-
-			Color operator+=(Color c) { return (*this) + c; }
+		constexpr u32 strata_per_side{ 32 };
+		constexpr u32 round_count{ 4 };
+		constexpr u32 run_length{ 16 };
 
-			Color operator*(f32 s) {
-				r *= s;
-				g *= s;
-				b *= s;
-				a *= s;
+		struct Statistics {
+			u32 sampled;
+			u32 accepted;
+			u32 rejected;
+			f32 sum[3];
+		};
 
-				return *this;
-			}
+		// A pixel that's black or transparent is ignored. Otherwise it's accepted if it's a unit-ish vector pointing out of the surface.
+		void evaluate_pixel(const u8* const pixel, bool is_bgr, Statistics& stats) {
+			const f32 r{ (f32)pixel[is_bgr ? 2 : 0] };
+			const f32 g{ (f32)pixel[1] };
+			const f32 b{ (f32)pixel[is_bgr ? 0 : 2] };
+			++stats.sampled;
 
-			Color operator*=(f32 s) { return (*this) * s; }
-			Color operator/=(f32 s) { return (*this) * (1.f / s); }
-		};
+			if (pixel[3] == 0 || (pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0)) return;
 
-		using sampler = Color(*)(const u8* const);
+			const f32 x{ r * 2.f * inv_255 - 1.f };
+			const f32 y{ g * 2.f * inv_255 - 1.f };
+			const f32 z{ b * 2.f * inv_255 - 1.f };
 
-		Color sample_pixel_rgb(const u8* const pixel) {
-			Color c{ (f32)pixel[0], (f32)pixel[1], (f32)pixel[2], (f32)pixel[3] };
-			return c * inv_255;
-		}
+			if (z < 0.f || x * x + y * y + z * z < vector_length_sq_rejection_threshold) {
+				++stats.rejected;
+				return;
+			}
 
-		Color sample_pixel_bgr(const u8* const pixel) {
-			Color c{ (f32)pixel[2], (f32)pixel[1], (f32)pixel[0], (f32)pixel[3] };
-			return c * inv_255;
+			++stats.accepted;
+			stats.sum[0] += r;
+			stats.sum[1] += g;
+			stats.sum[2] += b;
 		}
 
-		s32 evaluate_color(Color c) {
-			if (c.is_black() || c.is_transparent()) return 0;
+		void evaluate_run(const u8* const pixels, u32 count, bool is_bgr, Statistics& stats) {
+			const __m128i shuffle{ is_bgr ?
+				_mm_setr_epi8(2, 6, 10, 14, 1, 5, 9, 13, 0, 4, 8, 12, 3, 7, 11, 15) :
+				_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15) };
+			const f32v scale{ v_set(2.f * inv_255) };
+			const f32v one{ v_set(1.f) };
+			const f32v zero{ v_zero() };
+			const f32v min_byte{ v_set(.5f) };
+			const f32v min_length_sq{ v_set(vector_length_sq_rejection_threshold) };
+			f32v sum[3]{ zero, zero, zero };
+			u32 i{ 0 };
+
+			for (; i + lane_count <= count; i += lane_count) {
+				f32v c[4];
+				v_load_pixels(&pixels[i * 4], shuffle, c);
+
+				const f32v is_transparent{ v_lt(c[3], min_byte) };
+				const f32v is_black{ v_and(v_lt(c[0], min_byte), v_and(v_lt(c[1], min_byte), v_lt(c[2], min_byte))) };
+				const f32v is_ignored{ v_or(is_transparent, is_black) };
+
+				const f32v x{ v_sub(v_mul(c[0], scale), one) };
+				const f32v y{ v_sub(v_mul(c[1], scale), one) };
+				const f32v z{ v_sub(v_mul(c[2], scale), one) };
+				const f32v length_sq{ v_add(v_mul(x, x), v_add(v_mul(y, y), v_mul(z, z))) };
+				const f32v is_accepted{ v_andnot(is_ignored, v_and(v_le(zero, z), v_le(min_length_sq, length_sq))) };
+				const u32 accepted{ v_count(is_accepted) };
+
+				stats.accepted += accepted;
+				stats.rejected += lane_count - v_count(is_ignored) - accepted;
+
+				for (u32 k{ 0 }; k < 3; ++k) sum[k] = v_add(sum[k], v_and(c[k], is_accepted));
+			}
 
-			math::v3 v{ c.r * 2.f - 1.f, c.g * 2.f - 1.f, c.b * 2.f - 1.f };
-			const f32 v_length_sq{ v.x * v.x + v.y * v.y + v.z * v.z };
+			stats.sampled += i;
+			for (u32 k{ 0 }; k < 3; ++k) stats.sum[k] += v_sum(sum[k]);
 
-			return (v.z < 0.f || v_length_sq < vector_length_sq_rejection_threshold) ? -1 : 1;
+			for (; i < count; ++i) evaluate_pixel(&pixels[i * 4], is_bgr, stats);
 		}
 
-		bool evaluate_image(const Image* const image, sampler sample) {
-			constexpr u32 sample_count{ 4096 };
-			const size_t image_size{ image->slicePitch };
-			const size_t sample_interval{ std::max(image_size / sample_count, (size_t)4) };
-			const u32 min_sample_count{ std::max((u32)(image_size / sample_interval) >> 2, (u32)1) };
-			const u8* const pixels{ image->pixels };
+		// Returns 1 or -1 if the statistics say for sure whether it's a normal map or not, 0 if more samples are needed.
+		// Without is_final, the limits are tightened by the margins above.
+		s32 evaluate_statistics(const Statistics& stats, bool is_final) {
+			if (stats.accepted < std::max(stats.sampled >> 2, (u32)1)) return is_final ? -1 : 0;
 
-			u32 accepted_samples{ 0 };
-			u32 rejected_samples{ 0 };
-			Color average_color{};
+			const u32 evaluated{ stats.accepted + stats.rejected };
+			const f32 rejected_fraction{ (f32)stats.rejected / (f32)evaluated };
+			constexpr f32 threshold{ rejection_ratio_threshold / (1.f + rejection_ratio_threshold) };
+			const f32 deviation{ is_final ? 0.f : conclusive_deviations * std::sqrt(threshold * (1.f - threshold) / (f32)evaluated) };
+			const f32 margin{ is_final ? 0.f : conclusive_margin };
 
-			size_t offset{ sample_interval };
+			if (rejected_fraction > threshold + deviation) return -1;
+			if (rejected_fraction > threshold - deviation) return 0;
 
-			while (offset < image_size) {
-				const Color c{ sample(&pixels[offset]) };
-				const s32 result{ evaluate_color(c) };
+			const f32 inv_accepted{ 1.f / (f32)stats.accepted };
+			math::v3 v{ stats.sum[0] * inv_accepted * 2.f * inv_255 - 1.f, stats.sum[1] * inv_accepted * 2.f * inv_255 - 1.f, stats.sum[2] * inv_accepted * 2.f * inv_255 - 1.f };
+			const f32 avg_length{ sqrt(v.x * v.x + v.y * v.y + v.z * v.z) };
+			const f32 avg_normalized_z{ v.z / avg_length };
 
-				if (result < 0) {
-					++rejected_samples;
-				}
-				else if (result > 0) {
-					++accepted_samples;
-					average_color += c;
-				}
+			if (avg_length >= min_avg_length_threshold + margin && avg_length <= max_avg_length_threshold - margin && avg_normalized_z >= min_avg_z_threshold + margin) return 1;
 
-				offset += sample_interval;
-			}
-
-			if (accepted_samples >= min_sample_count) {
-				const f32 rejection_ratio{ (f32)rejected_samples / (f32)accepted_samples };
-
-				if (rejection_ratio > rejection_ratio_threshold) return false;
+			return is_final ? -1 : 0;
+		}
 
-				average_color /= (f32)accepted_samples;
-				math::v3 v{ average_color.r * 2.f - 1.f, average_color.g * 2.f - 1.f,average_color.b * 2.f - 1.f };
-				const f32 avg_length{ sqrt(v.x * v.x + v.y * v.y + v.z * v.z) };
-				const f32 avg_normalized_z{ v.z / avg_length };
+		bool evaluate_image(const Image* const image, bool is_bgr) {
+			const u32 width{ (u32)image->width };
+			const u32 height{ (u32)image->height };
+			const u32 strata_x{ std::min(strata_per_side, std::max(width / run_length, (u32)1)) };
+			const u32 strata_y{ std::min(strata_per_side, height) };
+			const u32 stratum_width{ width / strata_x };
+			const u32 stratum_height{ height / strata_y };
+			const u32 run{ std::min(run_length, stratum_width) };
+
+			Statistics stats{};
+
+			// Each round takes every other stratum in both directions, offset by the round, so it's spread over the image.
+			for (u32 round{ 0 }; round < round_count; ++round) {
+				for (u32 sy{ round >> 1 }; sy < strata_y; sy += 2) {
+					for (u32 sx{ round & 1 }; sx < strata_x; sx += 2) {
+						u32 h{ (sy * strata_per_side + sx) * 2654435761u };
+						h ^= h >> 15;
+
+						const u32 x{ sx * stratum_width + (h % (stratum_width - run + 1)) };
+						const u32 y{ sy * stratum_height + ((h >> 16) % stratum_height) };
+
+						evaluate_run(&image->pixels[(u64)y * image->rowPitch + x * 4], run, is_bgr, stats);
+					}
+				}
 
-				return avg_length >= min_avg_length_threshold && avg_length <= max_avg_length_threshold && avg_normalized_z >= min_avg_z_threshold;
+				if (round + 1 < round_count) {
+					if (const s32 result{ evaluate_statistics(stats, false) }) return result > 0;
+				}
 			}
 
-			return false;
+			return evaluate_statistics(stats, true) > 0;
 		}
 	}
 
@@ -116,6 +227,6 @@ namespace lightning::tools {
 
 		if (BitsPerPixel(image_format) != 32 || BitsPerColor(image_format) != 8) return false;
 
-		return evaluate_image(image, IsBGR(image_format) ? sample_pixel_bgr : sample_pixel_rgb);
+		return evaluate_image(image, IsBGR(image_format));
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,425 @@
+#include "Geometry.h"
+#include "SceneImporter.h"
+#include "Utilities/Threading.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <filesystem>
+
+namespace lightning::tools {
+	namespace {
+
+		// The file is cut into chunks of about this size at line ends, and the chunks are parsed in parallel.
+		constexpr u64 obj_chunk_size{ 1 << 20 };
+
+		struct ObjMarkerType {
+			enum Type : u32 {
+				OBJECT = 0,		// 'o' and 'g' lines
+				MATERIAL,		// 'usemtl' lines
+			};
+		};
+
+		// A line that changes the object or the material of the faces after it.
+		struct ObjMarker {
+			std::string_view name;
+			u32 triangle;			// number of triangles in the chunk before the line
+			ObjMarkerType::Type type;
+		};
+
+		// 0-based indicies of the position, uv and normal of a corner, u32_invalid_id if the corner doesn't have one.
+		struct ObjCorner {
+			u32 position;
+			u32 uv;
+			u32 normal;
+		};
+
+		struct ObjChunk {
+			util::vector<math::v3> positions;
+			util::vector<math::v2> uvs;
+			util::vector<math::v3> normals;
+			util::vector<ObjCorner> corners;		// 3 per triangle, polygons are triangulated as fans
+			util::vector<ObjMarker> markers;
+			// Negative indicies count back from the last element before the face. They can point into earlier chunks,
+			// so they are stored relative to the start of the chunk until the chunk offsets are known. These are
+			// the elements that need fixing up, as corner * 3 + 0 (position), 1 (uv) or 2 (normal).
+			util::vector<u32> relative;
+		};
+
+		// Faces only refer to earlier elements, so the elements of all chunks are concatenated before the meshes are built.
+		struct ObjData {
+			util::vector<math::v3> positions;
+			util::vector<math::v2> uvs;
+			util::vector<math::v3> normals;
+			util::vector<ObjCorner> corners;
+		};
+
+		// A run of triangles that becomes one mesh.
+		struct ObjObject {
+			std::string_view name;
+			u32 first_triangle;
+			u32 end_triangle;
+			util::vector<math::u32v2> materials;	// first triangle and material of each run of triangles with the same material
+		};
+
+		[[nodiscard]] const char* skip_spaces(const char* at, const char* const end) {
+			while (at < end && (*at == ' ' || *at == '\t')) ++at;
+			return at;
+		}
+
+		[[nodiscard]] std::string_view trim(const char* begin, const char* end) {
+			begin = skip_spaces(begin, end);
+			while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) --end;
+			return { begin, (size_t)(end - begin) };
+		}
+
+		// Missing or malformed values read as 0.
+		f32 parse_float(const char*& at, const char* const end) {
+			at = skip_spaces(at, end);
+			if (at < end && *at == '+') ++at;
+
+			f32 value{ 0.f };
+			const std::from_chars_result result{ std::from_chars(at, end, value) };
+			if (result.ec == std::errc{}) at = result.ptr;
+
+			return value;
+		}
+
+		// Parses one "v", "v/vt", "v//vn" or "v/vt/vn" corner. Returns false if there are no more corners on the line.
+		bool parse_corner(const char*& at, const char* const end, s32(&indicies)[3]) {
+			at = skip_spaces(at, end);
+			if (at >= end || *at == '\r') return false;
+
+			const char* const token{ at };
+			indicies[0] = indicies[1] = indicies[2] = 0;
+
+			for (u32 i{ 0 }; i < 3; ++i) {
+				if (at < end && *at != '/') {
+					const std::from_chars_result result{ std::from_chars(at, end, indicies[i]) };
+					if (result.ec == std::errc{}) at = result.ptr;
+				}
+
+				if (at >= end || *at != '/') break;
+				++at;
+			}
+
+			// Skip whatever is left of a malformed token, so the line can't stall.
+			while (at < end && *at != ' ' && *at != '\t' && *at != '\r') ++at;
+
+			return at != token;
+		}
+
+		void parse_face(const char* at, const char* const end, ObjChunk& chunk, util::vector<ObjCorner>& face, util::vector<u8>& face_relative) {
+			face.clear();
+			face_relative.clear();
+
+			const u32 counts[3]{ (u32)chunk.positions.size(), (u32)chunk.uvs.size(), (u32)chunk.normals.size() };
+			s32 indicies[3];
+
+			while (parse_corner(at, end, indicies)) {
+				u32 corner[3];
+				u8 relative{ 0 };
+
+				for (u32 i{ 0 }; i < 3; ++i) {
+					if (indicies[i] > 0) {
+						corner[i] = (u32)indicies[i] - 1;
+					}
+					else if (indicies[i] < 0) {
+						corner[i] = (u32)((s32)counts[i] + indicies[i]);
+						relative |= 1 << i;
+					}
+					else {
+						corner[i] = u32_invalid_id;
+					}
+				}
+
+				face.emplace_back(ObjCorner{ corner[0], corner[1], corner[2] });
+				face_relative.emplace_back(relative);
+			}
+
+			for (u32 i{ 2 }; i < face.size(); ++i) {
+				const u32 corners[3]{ 0, i - 1, i };
+
+				for (const u32 c : corners) {
+					const u32 index{ (u32)chunk.corners.size() };
+					chunk.corners.emplace_back(face[c]);
+
+					for (u32 j{ 0 }; j < 3; ++j) {
+						if (face_relative[c] & (1 << j)) chunk.relative.emplace_back(index * 3 + j);
+					}
+				}
+			}
+		}
+
+		void parse_chunk(const char* at, const char* const end, ObjChunk& chunk) {
+			util::vector<ObjCorner> face;
+			util::vector<u8> face_relative;
+
+			while (at < end) {
+				const char* line_end{ (const char*)memchr(at, '\n', end - at) };
+				if (!line_end) line_end = end;
+
+				at = skip_spaces(at, line_end);
+				const u64 length{ (u64)(line_end - at) };
+
+				if (length > 2 && at[0] == 'v' && (at[1] == ' ' || at[1] == '\t')) {
+					const char* p{ at + 2 };
+					const f32 x{ parse_float(p, line_end) };
+					const f32 y{ parse_float(p, line_end) };
+					const f32 z{ parse_float(p, line_end) };
+					chunk.positions.emplace_back(x, y, z);
+				}
+				else if (length > 3 && at[0] == 'v' && at[1] == 't' && (at[2] == ' ' || at[2] == '\t')) {
+					const char* p{ at + 3 };
+					const f32 u{ parse_float(p, line_end) };
+					const f32 v{ parse_float(p, line_end) };
+					// OBJ puts the origin of the uvs at the bottom left.
+					chunk.uvs.emplace_back(u, 1.f - v);
+				}
+				else if (length > 3 && at[0] == 'v' && at[1] == 'n' && (at[2] == ' ' || at[2] == '\t')) {
+					const char* p{ at + 3 };
+					const f32 x{ parse_float(p, line_end) };
+					const f32 y{ parse_float(p, line_end) };
+					const f32 z{ parse_float(p, line_end) };
+					chunk.normals.emplace_back(x, y, z);
+				}
+				else if (length > 2 && at[0] == 'f' && (at[1] == ' ' || at[1] == '\t')) {
+					parse_face(at + 2, line_end, chunk, face, face_relative);
+				}
+				else if (length > 1 && (at[0] == 'o' || at[0] == 'g') && (at[1] == ' ' || at[1] == '\t' || at[1] == '\r')) {
+					chunk.markers.emplace_back(ObjMarker{ trim(at + 1, line_end), (u32)chunk.corners.size() / 3, ObjMarkerType::OBJECT });
+				}
+				else if (length > 7 && !memcmp(at, "usemtl", 6) && (at[6] == ' ' || at[6] == '\t')) {
+					chunk.markers.emplace_back(ObjMarker{ trim(at + 7, line_end), (u32)chunk.corners.size() / 3, ObjMarkerType::MATERIAL });
+				}
+
+				at = line_end + 1;
+			}
+		}
+
+		// Concatenates the elements of the chunks and resolves the relative indicies.
+		void merge_chunks(util::vector<ObjChunk>& chunks, ObjData& obj) {
+			const u32 num_chunks{ (u32)chunks.size() };
+			util::vector<math::u32v4> offsets(num_chunks + 1, math::u32v4{ 0, 0, 0, 0 });
+
+			for (u32 i{ 0 }; i < num_chunks; ++i) {
+				const ObjChunk& chunk{ chunks[i] };
+				offsets[i + 1] = {
+					offsets[i].x + (u32)chunk.positions.size(),
+					offsets[i].y + (u32)chunk.uvs.size(),
+					offsets[i].z + (u32)chunk.normals.size(),
+					offsets[i].w + (u32)chunk.corners.size()
+				};
+			}
+
+			obj.positions.resize(offsets[num_chunks].x);
+			obj.uvs.resize(offsets[num_chunks].y);
+			obj.normals.resize(offsets[num_chunks].z);
+			obj.corners.resize(offsets[num_chunks].w);
+
+			util::parallel_for(num_chunks, [&](u32 i) {
+				ObjChunk& chunk{ chunks[i] };
+				const math::u32v4& offset{ offsets[i] };
+
+				for (const u32 r : chunk.relative) {
+					ObjCorner& corner{ chunk.corners[r / 3] };
+					u32& element{ r % 3 == 0 ? corner.position : r % 3 == 1 ? corner.uv : corner.normal };
+					const u32 base{ r % 3 == 0 ? offset.x : r % 3 == 1 ? offset.y : offset.z };
+					const s64 index{ (s64)(s32)element + base };
+					element = index >= 0 ? (u32)index : u32_invalid_id;
+				}
+
+				if (chunk.positions.size()) memcpy(&obj.positions[offset.x], chunk.positions.data(), chunk.positions.size() * sizeof(math::v3));
+				if (chunk.uvs.size()) memcpy(&obj.uvs[offset.y], chunk.uvs.data(), chunk.uvs.size() * sizeof(math::v2));
+				if (chunk.normals.size()) memcpy(&obj.normals[offset.z], chunk.normals.data(), chunk.normals.size() * sizeof(math::v3));
+				if (chunk.corners.size()) memcpy(&obj.corners[offset.w], chunk.corners.data(), chunk.corners.size() * sizeof(ObjCorner));
+			});
+		}
+
+		// Every 'o' or 'g' line starts a new mesh, unless there were no faces since the previous one. Materials are
+		// numbered in the order they first appear in. Returns the number of materials.
+		u32 get_objects(const util::vector<ObjChunk>& chunks, util::vector<ObjObject>& objects) {
+			std::unordered_map<std::string_view, u32> material_ids;
+			u32 material{ u32_invalid_id };
+			u32 triangle_offset{ 0 };
+
+			objects.emplace_back(ObjObject{ {}, 0, 0, {} });
+
+			for (const ObjChunk& chunk : chunks) {
+				for (const ObjMarker& marker : chunk.markers) {
+					const u32 triangle{ triangle_offset + marker.triangle };
+					ObjObject* object{ &objects.back() };
+
+					if (marker.type == ObjMarkerType::OBJECT) {
+						if (triangle > object->first_triangle) {
+							object->end_triangle = triangle;
+							object = &objects.emplace_back(ObjObject{ {}, triangle, 0, {} });
+							if (material != u32_invalid_id) object->materials.emplace_back(triangle, material);
+						}
+
+						object->name = marker.name;
+					}
+					else {
+						material = material_ids.try_emplace(marker.name, (u32)material_ids.size()).first->second;
+
+						if (object->materials.size() && object->materials.back().x == triangle) {
+							object->materials.back().y = material;
+						}
+						else {
+							object->materials.emplace_back(triangle, material);
+						}
+					}
+				}
+
+				triangle_offset += (u32)chunk.corners.size() / 3;
+			}
+
+			objects.back().end_triangle = triangle_offset;
+			if (objects.back().end_triangle == objects.back().first_triangle) objects.resize(objects.size() - 1);
+
+			return (u32)material_ids.size();
+		}
+
+		// Returns false if the mesh has no valid triangles. Triangles that refer to positions the file doesn't have are left
+		// out. Normals and uvs are only used if every corner has one.
+		bool get_mesh(const ObjData& obj, const ObjObject& object, u32 num_materials, Mesh& m) {
+			const u32 num_positions{ (u32)obj.positions.size() };
+			u32 min_position{ u32_invalid_id };
+			u32 max_position{ 0 };
+			u32 num_triangles{ 0 };
+			bool has_uvs{ true };
+			bool has_normals{ true };
+
+			for (u32 t{ object.first_triangle }; t < object.end_triangle; ++t) {
+				const ObjCorner* const corners{ &obj.corners[t * 3] };
+				if (corners[0].position >= num_positions || corners[1].position >= num_positions || corners[2].position >= num_positions) continue;
+
+				for (u32 i{ 0 }; i < 3; ++i) {
+					min_position = std::min(min_position, corners[i].position);
+					max_position = std::max(max_position, corners[i].position);
+					has_uvs &= corners[i].uv < obj.uvs.size();
+					has_normals &= corners[i].normal < obj.normals.size();
+				}
+
+				++num_triangles;
+			}
+
+			if (!num_triangles) return false;
+
+			m.raw_indicies.resize(num_triangles * 3);
+			if (has_normals) m.normals.resize(num_triangles * 3);
+			if (has_uvs) {
+				m.uv_sets.resize(1);
+				m.uv_sets[0].resize(num_triangles * 3);
+			}
+			if (object.materials.size()) m.material_indicies.resize(num_triangles);
+
+			util::vector<u32> vertex_ref(max_position - min_position + 1, u32_invalid_id);
+			u32 material_run{ 0 };
+			u32 material{ num_materials };
+			u32 index{ 0 };
+
+			for (u32 t{ object.first_triangle }; t < object.end_triangle; ++t) {
+				while (material_run < object.materials.size() && object.materials[material_run].x <= t) {
+					material = object.materials[material_run++].y;
+				}
+
+				const ObjCorner* const corners{ &obj.corners[t * 3] };
+				if (corners[0].position >= num_positions || corners[1].position >= num_positions || corners[2].position >= num_positions) continue;
+
+				if (m.material_indicies.size()) {
+					m.material_indicies[index / 3] = material;
+					if (std::find(m.material_used.begin(), m.material_used.end(), material) == m.material_used.end()) {
+						m.material_used.emplace_back(material);
+					}
+				}
+
+				for (u32 i{ 0 }; i < 3; ++i, ++index) {
+					const ObjCorner& c{ corners[i] };
+					u32& ref{ vertex_ref[c.position - min_position] };
+
+					if (ref == u32_invalid_id) {
+						ref = (u32)m.positions.size();
+						m.positions.emplace_back(obj.positions[c.position]);
+					}
+
+					m.raw_indicies[index] = ref;
+					if (has_normals) m.normals[index] = obj.normals[c.normal];
+					if (has_uvs) m.uv_sets[0][index] = obj.uvs[c.uv];
+				}
+			}
+
+			return true;
+		}
+
+		void load_obj(const char* file, const MappedFile& source, Scene& scene, SceneData* data, Progression* const progression) {
+			const char* const begin{ (const char*)source.data() };
+			const char* const end{ begin + source.size() };
+
+			// Chunks start after the first line end at or after each multiple of the chunk size.
+			util::vector<const char*> chunk_starts;
+			chunk_starts.emplace_back(begin);
+
+			for (const char* at{ begin + obj_chunk_size }; at < end; at += obj_chunk_size) {
+				at = std::max(at, chunk_starts.back());
+				const char* const line_end{ (const char*)memchr(at, '\n', end - at) };
+				if (!line_end || line_end + 1 >= end) break;
+
+				at = line_end + 1;
+				chunk_starts.emplace_back(at);
+			}
+
+			chunk_starts.emplace_back(end);
+
+			const u32 num_chunks{ (u32)chunk_starts.size() - 1 };
+			util::vector<ObjChunk> chunks(num_chunks);
+			util::parallel_for(num_chunks, [&](u32 i) { parse_chunk(chunk_starts[i], chunk_starts[i + 1], chunks[i]); });
+
+			ObjData obj{};
+			merge_chunks(chunks, obj);
+
+			util::vector<ObjObject> objects;
+			const u32 num_materials{ get_objects(chunks, objects) };
+			const u32 num_objects{ (u32)objects.size() };
+			if (!num_objects) return;
+
+			progression->callback(progression->value(), progression->max_value() + num_objects);
+
+			const std::string file_name{ std::filesystem::path{ file }.stem().string() };
+			util::vector<Mesh> meshes(num_objects);
+			util::vector<u8> is_valid(num_objects);
+
+			util::parallel_for(num_objects, [&](u32 i) {
+				Mesh& m{ meshes[i] };
+				m.name = objects[i].name.empty() ? file_name : std::string{ objects[i].name };
+				m.lod_id = 0;
+				m.lod_threshold = -1.f;
+				is_valid[i] = get_mesh(obj, objects[i], num_materials, m);
+				progression->advance();
+			});
+
+			const u32 num_meshes{ (u32)std::count(is_valid.begin(), is_valid.end(), (u8)1) };
+			scene.lod_groups.reserve(data->settings.coalesce_meshes ? 1 : num_meshes);
+			LodGroup* lod{ nullptr };
+
+			for (u32 i{ 0 }; i < num_objects; ++i) {
+				if (!is_valid[i]) continue;
+
+				if (meshes[i].normals.empty()) data->settings.calculate_normals = true;
+
+				if (!lod || !data->settings.coalesce_meshes) {
+					lod = &scene.lod_groups.emplace_back();
+					lod->name = meshes[i].name;
+					lod->meshes.reserve(data->settings.coalesce_meshes ? num_meshes : 1);
+				}
+
+				lod->meshes.emplace_back(std::move(meshes[i]));
+			}
+		}
+	}
+
+	EDITOR_INTERFACE void import_obj(const char* file, SceneData* data, Progression::progress_callback callback) {
+		assert(file && data);
+		import_scene(file, data, callback, load_obj);
+	}
+}
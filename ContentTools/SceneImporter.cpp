@@ -0,0 +1,170 @@
+#include "SceneImporter.h"
+#include "Geometry.h"
+#include "CookCache.h"
+
+#ifndef _WIN64
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace lightning::tools {
+	namespace {
+
+		// The key covers the source file, the files it depends on and the import settings. Returns false if one of the
+		// files can't be read.
+		// NOTE: the settings are hashed field by field, because the padding of the struct isn't initialized by the editor.
+		bool calc_cook_key(const char* file, const MappedFile& source, const GeometryImportSettings& settings,
+			dependency_hasher hash_dependencies, u64& key) {
+			cook_cache::KeyBuilder builder{};
+			builder.add(source.data(), source.size());
+			if (hash_dependencies && !hash_dependencies(file, source, builder)) return false;
+
+			builder.add(settings.smoothing_angle);
+			builder.add(settings.calculate_normals);
+			builder.add(settings.calculate_tangents);
+			builder.add(settings.reverse_handedness);
+			builder.add(settings.import_embeded_textures);
+			builder.add(settings.import_animations);
+			builder.add(settings.coalesce_meshes);
+			builder.add(settings.optimize_index_order);
+			builder.add(settings.generate_meshlets);
+			builder.add(settings.quantize_positions);
+			builder.add(settings.lod_count);
+			builder.add(settings.lod_triangle_ratio);
+
+			key = builder.key();
+			return true;
+		}
+
+		// Cache entries are the settings after importing, followed by the packed scene.
+		// The importer may change the settings, e.g. when normals couldn't be imported and have to be calculated.
+		bool load_cooked_scene(u64 key, SceneData* data) {
+			util::vector<u8> entry{};
+			if (!cook_cache::load(key, entry) || entry.size() <= sizeof(GeometryImportSettings)) return false;
+
+			const u64 scene_size{ entry.size() - sizeof(GeometryImportSettings) };
+			data->buffer = (u8*)CoTaskMemAlloc(scene_size);
+			if (!data->buffer) return false;
+
+			memcpy(&data->settings, entry.data(), sizeof(GeometryImportSettings));
+			memcpy(data->buffer, &entry[sizeof(GeometryImportSettings)], scene_size);
+			data->buffer_size = (u32)scene_size;
+
+			return true;
+		}
+
+		void store_cooked_scene(u64 key, const SceneData* data) {
+			util::vector<u8> entry(sizeof(GeometryImportSettings) + data->buffer_size);
+			memcpy(entry.data(), &data->settings, sizeof(GeometryImportSettings));
+			memcpy(&entry[sizeof(GeometryImportSettings)], data->buffer, data->buffer_size);
+
+			cook_cache::store(key, entry.data(), entry.size());
+		}
+	}
+
+	MappedFile::MappedFile(const char* file) {
+		assert(file);
+
+		#ifdef _WIN64
+		_file = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (_file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(_file, &size) || !size.QuadPart) {
+			close();
+			return;
+		}
+
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		_data = _mapping ? (const u8*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!_data) {
+			close();
+			return;
+		}
+
+		_size = (u64)size.QuadPart;
+		#else
+		const int fd{ open(file, O_RDONLY) };
+		if (fd < 0) return;
+
+		struct stat info {};
+		if (!fstat(fd, &info) && info.st_size > 0) {
+			void* const data{ mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) };
+			if (data != MAP_FAILED) {
+				_data = (const u8*)data;
+				_size = (u64)info.st_size;
+			}
+		}
+
+		::close(fd);
+		#endif
+	}
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& o) noexcept {
+		*this = std::move(o);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+		if (this != &o) {
+			close();
+			std::swap(_data, o._data);
+			std::swap(_size, o._size);
+			#ifdef _WIN64
+			std::swap(_file, o._file);
+			std::swap(_mapping, o._mapping);
+			#endif
+		}
+
+		return *this;
+	}
+
+	void MappedFile::close() {
+		#ifdef _WIN64
+		if (_data) UnmapViewOfFile(_data);
+		if (_mapping) CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+		_mapping = nullptr;
+		_file = INVALID_HANDLE_VALUE;
+		#else
+		if (_data) munmap((void*)_data, (size_t)_size);
+		#endif
+		_data = nullptr;
+		_size = 0;
+	}
+
+	void import_scene(const char* file, SceneData* data, Progression::progress_callback callback, scene_loader load_scene,
+		dependency_hasher hash_dependencies) {
+		assert(file && data && load_scene);
+		Progression progression{ callback };
+
+		const MappedFile source{ file };
+		if (!source.is_valid()) return;
+
+		// Look the file up before doing any work, unchanged assets don't have to be imported again.
+		u64 cook_key{ 0 };
+		const bool has_key{ calc_cook_key(file, source, data->settings, hash_dependencies, cook_key) };
+
+		if (has_key && load_cooked_scene(cook_key, data)) {
+			progression.callback(1, 1);
+			return;
+		}
+
+		Scene scene{};
+		load_scene(file, source, scene, data, &progression);
+
+		if (scene.lod_groups.empty()) {
+			return;
+		}
+
+		process_scene(scene, data->settings, &progression);
+		pack_data(scene, *data);
+
+		if (has_key && data->buffer && data->buffer_size) store_cooked_scene(cook_key, data);
+	}
+}
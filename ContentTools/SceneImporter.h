@@ -0,0 +1,50 @@
+#pragma once
+#include "ToolsCommon.h"
+
+namespace lightning::tools {
+
+	struct Scene;
+	struct SceneData;
+
+	namespace cook_cache {
+		class KeyBuilder;
+	}
+
+	// Read-only view of a whole file. The file stays mapped, and can't be changed by others, while the view is alive.
+	class MappedFile {
+		public:
+			MappedFile() = default;
+			explicit MappedFile(const char* file);
+			~MappedFile();
+			DISABLE_COPY(MappedFile);
+
+			MappedFile(MappedFile&& o) noexcept;
+			MappedFile& operator=(MappedFile&& o) noexcept;
+
+			[[nodiscard]] constexpr const u8* data() const { return _data; }
+			[[nodiscard]] constexpr u64 size() const { return _size; }
+			[[nodiscard]] constexpr bool is_valid() const { return _data != nullptr; }
+
+		private:
+			void close();
+
+			const u8* _data{ nullptr };
+			u64 _size{ 0 };
+			#ifdef _WIN64
+			HANDLE _file{ INVALID_HANDLE_VALUE };
+			HANDLE _mapping{ nullptr };
+			#endif
+	};
+
+	// Fills the scene from the source file. May change the settings in data, e.g. when the file has no normals and they
+	// have to be calculated.
+	using scene_loader = void(*)(const char* file, const MappedFile& source, Scene& scene, SceneData* data, Progression* const progression);
+
+	// Adds the other files the scene is loaded from to the cook key. Returns false if one of them can't be read.
+	using dependency_hasher = bool(*)(const char* file, const MappedFile& source, cook_cache::KeyBuilder& key);
+
+	// Shared by the importers: looks the file and the import settings up in the cook cache, and only loads, processes and
+	// packs the scene if there is no cooked version yet.
+	void import_scene(const char* file, SceneData* data, Progression::progress_callback callback, scene_loader load_scene,
+		dependency_hasher hash_dependencies = nullptr);
+}
@@ -1,8 +1,13 @@
 #include "ToolsCommon.h"
 #include "Content/ContentToEngine.h"
 #include "Utilities/IOStream.h"
+#include "BlockCompression.h"
+#include "MipGeneration.h"
 #include <DirectXTex.h>
 #include <dxgi1_6.h>
+#include <condition_variable>
+#include <functional>
+#include <future>
 
 using namespace DirectX;
 using namespace Microsoft::WRL;
@@ -40,6 +45,14 @@ namespace lightning::tools {
 			};
 		};
 
+		struct TextureEncoder {
+			enum Type : u32 {
+				DIRECTXTEX = 0,
+				GPU,
+				BLOCK_ENCODER,
+			};
+		};
+
 		struct TextureDimension {
 			enum Dimension : u32 {
 				TEXTURE_1D,
@@ -61,6 +74,8 @@ namespace lightning::tools {
 			u32 cubemap_size;
 			u32 mirror_cubemap;
 			u32 prefilter_cubemap;
+			u32 compression_quality;
+			u32 mip_filter;
 		};
 
 		struct TextureInfo {
@@ -85,12 +100,29 @@ namespace lightning::tools {
 
 		struct D3D12Device {
 			ComPtr<ID3D11Device> device;
-			std::mutex hw_compression_mutex;
+		};
+
+		// A job runs gpu_func on the first idle device. If that fails, or there's no device, cpu_func runs instead.
+		// Either of them can be empty.
+		struct TextureJob {
+			std::function<bool(ID3D11Device*)> gpu_func;
+			std::function<bool()> cpu_func;
+			std::promise<bool> result;
 		};
 
 		std::mutex device_creation_mutex;
 		util::vector<D3D12Device> d3d11_devices;
 
+		// Every device has a thread that pulls jobs from the queue as soon as the device is free. There's a single CPU
+		// thread, because the block encoder and DirectXTex spread each job over all hardware threads anyway. The CPU
+		// thread leaves the jobs that can run on the GPU alone while a device is idle, since the device will take them.
+		std::mutex job_mutex;
+		std::condition_variable job_cv;
+		util::deque<TextureJob> jobs;
+		util::vector<std::thread> job_threads;
+		u32 idle_devices{ 0 };
+		bool is_running{ false };
+
 		HMODULE dxgi_module{ nullptr };
 		HMODULE d3d11_module{ nullptr };
 
@@ -165,39 +197,104 @@ namespace lightning::tools {
 			}
 		}
 
-		bool try_create_device() {
+		// NOTE: job_mutex must be locked when calling this function.
+		util::deque<TextureJob>::iterator find_job(bool on_gpu) {
+			return std::find_if(jobs.begin(), jobs.end(), [on_gpu](const TextureJob& job) {
+				return on_gpu ? (bool)job.gpu_func : job.cpu_func && (!job.gpu_func || !idle_devices);
+			});
+		}
+
+		// Runs the jobs on the device, or on the CPU if device is nullptr, until the job threads are stopped.
+		void run_jobs(ID3D11Device* device) {
+			const bool on_gpu{ device != nullptr };
+			std::unique_lock lock{ job_mutex };
+
+			while (true) {
+				if (on_gpu) ++idle_devices;
+
+				auto job_it{ jobs.end() };
+				job_cv.wait(lock, [&] {
+					job_it = find_job(on_gpu);
+					return !is_running || job_it != jobs.end();
+					});
+
+				if (on_gpu) --idle_devices;
+				if (!is_running) break;
+
+				TextureJob job{ std::move(*job_it) };
+				jobs.erase(job_it);
+				lock.unlock();
+
+				// NOTE: with one less idle device the CPU thread may take a job that it had to leave alone before.
+				job_cv.notify_all();
+
+				bool result{ on_gpu && job.gpu_func(device) };
+				if (!result && job.cpu_func) result = job.cpu_func();
+				job.result.set_value(result);
+
+				lock.lock();
+			}
+		}
+
+		void start_job_threads() {
 			std::lock_guard lock{ device_creation_mutex };
-			static bool try_once = false;
+			if (!job_threads.empty()) return;
+
+			create_device();
+
+			{
+				std::lock_guard job_lock{ job_mutex };
+				is_running = true;
+			}
 
-			if (!try_once) {
-				try_once = true;
-				create_device();
+			for (const D3D12Device& device : d3d11_devices) {
+				job_threads.emplace_back(run_jobs, device.device.Get());
 			}
 
-			return d3d11_devices.size() > 0;
+			job_threads.emplace_back(run_jobs, nullptr);
 		}
 
-		template<typename T> bool run_on_gpu(T func) {
-			if (!try_create_device()) return false;
-			bool wait{ true };
-			bool result{ false };
+		void stop_job_threads() {
+			std::lock_guard lock{ device_creation_mutex };
 
-			while (wait) {
-				for (u32 i{ 0 }; i < d3d11_devices.size(); ++i) {
-					if (d3d11_devices[i].hw_compression_mutex.try_lock()) {
-						result = func(d3d11_devices[i].device.Get());
-						d3d11_devices[i].hw_compression_mutex.unlock();
-						wait = false;
-						break;
-					}
-				}
+			{
+				std::lock_guard job_lock{ job_mutex };
+				is_running = false;
+			}
 
-				if (wait) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			job_cv.notify_all();
+
+			for (std::thread& thread : job_threads) thread.join();
+			job_threads.clear();
+
+			for (TextureJob& job : jobs) job.result.set_value(false);
+			jobs.clear();
+		}
+
+		[[nodiscard]] std::future<bool> submit_job(std::function<bool(ID3D11Device*)> gpu_func, std::function<bool()> cpu_func) {
+			start_job_threads();
+
+			TextureJob job{ std::move(gpu_func), std::move(cpu_func) };
+			std::future<bool> result{ job.result.get_future() };
+
+			{
+				std::lock_guard lock{ job_mutex };
+				if (d3d11_devices.empty()) job.gpu_func = nullptr;
+
+				if (job.gpu_func || job.cpu_func) jobs.emplace_back(std::move(job));
+				else job.result.set_value(false);
 			}
 
+			job_cv.notify_all();
+
 			return result;
 		}
 
+		// Returns false if neither the device nor the CPU function succeeded, or if the job needs a device and there's none.
+		bool run_job(std::function<bool(ID3D11Device*)> gpu_func, std::function<bool()> cpu_func = {}) {
+			return submit_job(std::move(gpu_func), std::move(cpu_func)).get();
+		}
+
 		constexpr void set_or_clear_flags(u32& flags, u32 flag, bool set) {
 			if (set) flags |= flag;
 			else flags &= ~flag;
@@ -399,14 +496,63 @@ namespace lightning::tools {
 			return scratch;
 		}
 
-		[[nodiscard]] ScratchImage generate_mipmaps(const ScratchImage& source, TextureInfo& info, u32 mip_levels, bool is_3d) {
+		MipFormat::Type get_mip_format(DXGI_FORMAT format) {
+			switch (format) {
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_B8G8R8A8_UNORM: return MipFormat::RGBA8_UNORM;
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: return MipFormat::RGBA8_SRGB;
+			case DXGI_FORMAT_R32G32B32A32_FLOAT: return MipFormat::RGBA32_FLOAT;
+			}
+
+			return MipFormat::count;
+		}
+
+		// Generates the mip chains of all array slices and cube faces at once, from the first mip level of the source.
+		HRESULT generate_native_mipmaps(const ScratchImage& source, u32 mip_levels, MipFormat::Type format, MipFilter::Type filter, ScratchImage& mip_scratch) {
+			TexMetadata metadata{ source.GetMetadata() };
+			metadata.mipLevels = mip_levels;
+			HRESULT hr{ mip_scratch.Initialize(metadata) };
+			if (FAILED(hr)) return hr;
+
+			const u32 chain_count{ (u32)metadata.arraySize };
+			util::vector<MipSurface> surfaces(chain_count * mip_levels);
+
+			for (u32 chain{ 0 }; chain < chain_count; ++chain) {
+				for (u32 level{ 0 }; level < mip_levels; ++level) {
+					const Image& image{ *mip_scratch.GetImage(level, chain, 0) };
+					surfaces[chain * mip_levels + level] = { image.pixels, (u32)image.width, (u32)image.height, (u32)image.rowPitch };
+				}
+
+				const Image& source_image{ *source.GetImage(0, chain, 0) };
+				const Image& image{ *mip_scratch.GetImage(0, chain, 0) };
+				const u64 row_size{ std::min(source_image.rowPitch, image.rowPitch) };
+
+				for (u32 y{ 0 }; y < image.height; ++y) {
+					memcpy(&image.pixels[y * image.rowPitch], &source_image.pixels[y * source_image.rowPitch], row_size);
+				}
+			}
+
+			generate_mip_chains(surfaces.data(), chain_count, mip_levels, format, filter);
+
+			return S_OK;
+		}
+
+		// 2D textures, arrays and cube maps in the formats the native generator supports are filtered in linear space,
+		// with the filter from the import settings. Anything else goes to DirectXTex, which always uses its default filter.
+		[[nodiscard]] ScratchImage generate_mipmaps(const ScratchImage& source, TextureInfo& info, u32 mip_levels, bool is_3d, MipFilter::Type filter) {
 			const TexMetadata& metadata{ source.GetMetadata() };
-			mip_levels = math::clamp(mip_levels, (u32)0, get_max_mip_count((u32)metadata.width, (u32)metadata.height, (u32)metadata.depth));
+			const u32 max_mip_levels{ get_max_mip_count((u32)metadata.width, (u32)metadata.height, (u32)metadata.depth) };
+			mip_levels = math::clamp(mip_levels, (u32)0, max_mip_levels);
+			const MipFormat::Type mip_format{ get_mip_format(metadata.format) };
 			HRESULT hr{ S_OK };
 
 			ScratchImage mip_scratch{};
 
-			if (!is_3d) {
+			if (!is_3d && mip_format != MipFormat::count) {
+				hr = generate_native_mipmaps(source, mip_levels ? mip_levels : max_mip_levels, mip_format, filter, mip_scratch);
+			}
+			else if (!is_3d) {
 				hr = GenerateMipMaps(source.GetImages(), source.GetImageCount(), source.GetMetadata(), TEX_FILTER_DEFAULT, mip_levels, mip_scratch);
 			}
 			else {
@@ -442,13 +588,15 @@ namespace lightning::tools {
 					const Image& image{ images[0] };
 
 					if (math::is_equal((f32)image.width / (f32)image.height, 2.f)) {
-						if (!run_on_gpu([&](ID3D11Device* device) {
+						run_job([&](ID3D11Device* device) {
 							hr = equirectangular_to_cubemap(device, images.data(), array_size, settings.cubemap_size, settings.prefilter_cubemap, settings.mirror_cubemap, working_scratch);
 
 							return SUCCEEDED(hr);
-							})) {
+							}, [&]() {
 							hr = equirectangular_to_cubemap(images.data(), array_size, settings.cubemap_size, settings.prefilter_cubemap, settings.mirror_cubemap, working_scratch);
-						}
+
+							return SUCCEEDED(hr);
+							});
 					}
 					else if (array_size % 6 || image.width != image.height) {
 						data->info.import_error = ImportError::NEED_SIX_IMAGES;
@@ -474,13 +622,92 @@ namespace lightning::tools {
 			const bool generate_full_mipchain{ settings.prefilter_cubemap && settings.dimension == TextureDimension::TEXTURE_CUBE };
 
 			if (settings.mip_levels != 1 || generate_full_mipchain) {
-				scratch = generate_mipmaps(scratch, data->info, generate_full_mipchain ? 0 : settings.mip_levels, settings.dimension == TextureDimension::TEXTURE_3D);
+				const MipFilter::Type filter{ (MipFilter::Type)std::min(settings.mip_filter, (u32)MipFilter::count - 1) };
+				scratch = generate_mipmaps(scratch, data->info, generate_full_mipchain ? 0 : settings.mip_levels, settings.dimension == TextureDimension::TEXTURE_3D, filter);
 			}
 
 			return scratch;
 		}
 
-		DXGI_FORMAT determine_output_format(TextureData* const data, ScratchImage& scratch, const Image* const image) {
+		BlockFormat::Type get_block_format(DXGI_FORMAT format) {
+			switch (format) {
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB: return BlockFormat::BC1;
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB: return BlockFormat::BC3;
+			case DXGI_FORMAT_BC4_UNORM: return BlockFormat::BC4;
+			case DXGI_FORMAT_BC5_UNORM: return BlockFormat::BC5;
+			case DXGI_FORMAT_BC6H_UF16: return BlockFormat::BC6H;
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB: return BlockFormat::BC7;
+			}
+
+			return BlockFormat::count;
+		}
+
+		// BC6H and BC7 are compressed on the GPU if there's one. The rest, and BC6H and BC7 without a GPU, are compressed
+		// by the block encoder if it supports the format, by DirectXTex if it doesn't.
+		TextureEncoder::Type select_encoder(DXGI_FORMAT format) {
+			switch (format) {
+			case DXGI_FORMAT_BC6H_TYPELESS:
+			case DXGI_FORMAT_BC6H_UF16:
+			case DXGI_FORMAT_BC6H_SF16:
+			case DXGI_FORMAT_BC7_TYPELESS:
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB: {
+				return TextureEncoder::GPU;
+			}
+			}
+
+			return get_block_format(format) != BlockFormat::count ? TextureEncoder::BLOCK_ENCODER : TextureEncoder::DIRECTXTEX;
+		}
+
+		// Compresses with the in-house block encoder. The source is converted to 8 bit RGBA first (16 bit float RGBA for
+		// BC6H), keeping the color space as it is, just like DirectXTex doesn't convert between sRGB and linear when compressing.
+		HRESULT compress_with_block_encoder(const ScratchImage& scratch, DXGI_FORMAT output_format, const TextureImportSettings& settings, ScratchImage& bc_scratch) {
+			const BlockFormat::Type block_format{ get_block_format(output_format) };
+			assert(block_format != BlockFormat::count);
+			const TexMetadata& metadata{ scratch.GetMetadata() };
+			const DXGI_FORMAT source_format{
+				block_format == BlockFormat::BC6H ? DXGI_FORMAT_R16G16B16A16_FLOAT :
+				IsSRGB(metadata.format) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM };
+			const ScratchImage* source{ &scratch };
+			ScratchImage converted_scratch;
+			HRESULT hr{ S_OK };
+
+			if (metadata.format != source_format) {
+				hr = Convert(scratch.GetImages(), scratch.GetImageCount(), metadata, source_format, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, converted_scratch);
+				if (FAILED(hr)) return hr;
+				source = &converted_scratch;
+			}
+
+			TexMetadata bc_metadata{ metadata };
+			bc_metadata.format = output_format;
+			hr = bc_scratch.Initialize(bc_metadata);
+			if (FAILED(hr)) return hr;
+
+			const u32 image_count{ (u32)source->GetImageCount() };
+			assert(image_count == bc_scratch.GetImageCount());
+			const Image* const images{ source->GetImages() };
+			const Image* const bc_images{ bc_scratch.GetImages() };
+			util::vector<BlockSurface> surfaces(image_count);
+
+			for (u32 i{ 0 }; i < image_count; ++i) {
+				surfaces[i].source = images[i].pixels;
+				surfaces[i].destination = bc_images[i].pixels;
+				surfaces[i].width = (u32)images[i].width;
+				surfaces[i].height = (u32)images[i].height;
+				surfaces[i].source_pitch = (u32)images[i].rowPitch;
+				surfaces[i].destination_pitch = (u32)bc_images[i].rowPitch;
+			}
+
+			const BlockQuality::Type quality{ (BlockQuality::Type)std::min(settings.compression_quality, (u32)BlockQuality::count - 1) };
+			compress_blocks(surfaces.data(), image_count, block_format, quality, settings.alpha_threshold);
+
+			return S_OK;
+		}
+
+		DXGI_FORMAT determine_output_format(TextureData* const data, ScratchImage& scratch, const Image* const image, TextureEncoder::Type& encoder) {
 			using namespace lightning::content;
 
 			assert(data && data->import_settings.compress);
@@ -513,22 +740,10 @@ namespace lightning::tools {
 			assert(IsCompressed(output_format));
 			if (HasAlpha((DXGI_FORMAT)output_format)) data->info.flags |= TextureFlags::HAS_ALPHA;
 
-			return IsSRGB(image_format) ? MakeSRGB(output_format) : output_format;
-		}
+			output_format = IsSRGB(image_format) ? MakeSRGB(output_format) : output_format;
+			encoder = select_encoder(output_format);
 
-		bool can_use_gpu(DXGI_FORMAT format) {
-			switch (format) {
-			case DXGI_FORMAT_BC6H_TYPELESS:
-			case DXGI_FORMAT_BC6H_UF16:
-			case DXGI_FORMAT_BC6H_SF16:
-			case DXGI_FORMAT_BC7_TYPELESS:
-			case DXGI_FORMAT_BC7_UNORM:
-			case DXGI_FORMAT_BC7_UNORM_SRGB: {
-				return true;
-			}
-			}
-
-			return false;
+			return output_format;
 		}
 
 		[[nodiscard]] ScratchImage compress_image(TextureData* const data, ScratchImage& scratch) {
@@ -540,18 +755,32 @@ namespace lightning::tools {
 				return {};
 			}
 
-			const DXGI_FORMAT output_format{ determine_output_format(data, scratch, image) };
+			TextureEncoder::Type encoder{ TextureEncoder::DIRECTXTEX };
+			const DXGI_FORMAT output_format{ determine_output_format(data, scratch, image, encoder) };
 			HRESULT hr{ S_OK };
 			ScratchImage bc_scratch;
 
-			if (!(can_use_gpu(output_format) && run_on_gpu([&](ID3D11Device* device) {
-				hr = Compress(device, scratch.GetImages(), scratch.GetImageCount(), scratch.GetMetadata(), output_format, TEX_COMPRESS_DEFAULT, 1.f, bc_scratch);
+			std::function<bool(ID3D11Device*)> gpu_func{};
 
-				return SUCCEEDED(hr);
-				}))) {
-				hr = Compress(scratch.GetImages(), scratch.GetImageCount(), scratch.GetMetadata(), output_format, TEX_COMPRESS_PARALLEL, data->import_settings.alpha_threshold, bc_scratch);
+			if (encoder == TextureEncoder::GPU) {
+				gpu_func = [&](ID3D11Device* device) {
+					hr = Compress(device, scratch.GetImages(), scratch.GetImageCount(), scratch.GetMetadata(), output_format, TEX_COMPRESS_DEFAULT, 1.f, bc_scratch);
+
+					return SUCCEEDED(hr);
+					};
 			}
 
+			run_job(gpu_func, [&]() {
+				if (get_block_format(output_format) != BlockFormat::count) {
+					hr = compress_with_block_encoder(scratch, output_format, data->import_settings, bc_scratch);
+				}
+				else {
+					hr = Compress(scratch.GetImages(), scratch.GetImageCount(), scratch.GetMetadata(), output_format, TEX_COMPRESS_PARALLEL, data->import_settings.alpha_threshold, bc_scratch);
+				}
+
+				return SUCCEEDED(hr);
+				});
+
 			if (FAILED(hr)) {
 				data->info.import_error = ImportError::COMPRESS;
 				return {};
@@ -631,7 +860,7 @@ namespace lightning::tools {
 
 			constexpr u32 sample_count{ 1024 };
 
-			if (!run_on_gpu([&](ID3D11Device* device) {
+			if (!run_job([&](ID3D11Device* device) {
 				hr = filter_type == IBLFilter::DIFFUSE ? prefilter_diffuse(device, cubemaps, sample_count, cubemaps) : prefilter_specular(device, cubemaps, sample_count, cubemaps);
 
 				return SUCCEEDED(hr);
@@ -658,6 +887,7 @@ namespace lightning::tools {
 	}
 
 	void shutdown_texture_tools() {
+		stop_job_threads();
 		d3d11_devices.clear();
 
 		if (dxgi_module) {
@@ -686,7 +916,7 @@ namespace lightning::tools {
 		HRESULT hr{ S_OK };
 		ScratchImage brdf_lut{};
 
-		if (!run_on_gpu([&](ID3D11Device* device) {
+		if (!run_job([&](ID3D11Device* device) {
 			hr = brdf_integration_lut(device, sample_count, brdf_lut);
 
 			return SUCCEEDED(hr);
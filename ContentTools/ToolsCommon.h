@@ -7,6 +7,7 @@
 #endif
 
 #include <wrl.h>
+#include <mutex>
 
 #ifndef EDITOR_INTERFACE
 #define EDITOR_INTERFACE extern "C" __declspec(dllexport)
@@ -20,18 +21,28 @@ class Progression {
 		explicit Progression(progress_callback callback) : _callback{ callback } {};
 		DISABLE_COPY(Progression);
 
+		// Progress can be reported from several threads. Calls to the callback are serialized.
 		void callback(u32 value, u32 max_value) {
+			std::lock_guard lock{ _mutex };
 			_value = value;
 			_max_value = max_value;
 
 			if (_callback) _callback(value, max_value);
 		}
 
+		void advance(u32 steps = 1) {
+			std::lock_guard lock{ _mutex };
+			_value += steps;
+
+			if (_callback) _callback(_value, _max_value);
+		}
+
 		[[nodiscard]] constexpr u32 max_value() const { return _max_value; }
 		[[nodiscard]] constexpr u32 value() const { return _value; }
 
 	private:
 		progress_callback _callback{ nullptr };
+		std::mutex _mutex{};
 		u32 _value{ 0 };
 		u32 _max_value{ 0 };
 };
@@ -0,0 +1,16 @@
+﻿using System.ComponentModel;
+
+namespace Editor.Common.Enums
+{
+    public enum CompressionQuality : int
+    {
+        [Description("Fast")]
+        FAST = 0,
+
+        [Description("Normal")]
+        NORMAL,
+
+        [Description("Production")]
+        PRODUCTION,
+    }
+}
@@ -0,0 +1,8 @@
+﻿namespace Editor.Common.Enums
+{
+    [Flags]
+    public enum EntityFlags : int
+    {
+        QUATERNION_ROTATION = 0x01,
+    }
+}
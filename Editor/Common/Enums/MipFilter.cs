@@ -0,0 +1,13 @@
+﻿using System.ComponentModel;
+
+namespace Editor.Common.Enums
+{
+    public enum MipFilter : int
+    {
+        [Description("Box")]
+        BOX = 0,
+
+        [Description("Kaiser")]
+        KAISER,
+    }
+}
@@ -0,0 +1,8 @@
+﻿namespace Editor.Common.Enums
+{
+    public enum PositionFormat
+    {
+        F32 = 0,
+        UNORM16,
+    }
+}
@@ -55,14 +55,30 @@ namespace Editor.Components
 
         public override IMSComponent GetMultiselectComponents(MSEntityBase entity) => new MSTransform(entity);
 
-        public override void WriteToBinary(BinaryWriter bw)
+        public override void WriteToBinary(BinaryWriter bw) => WriteToBinary(bw, false);
+
+        // The engine can load quaternions without converting them, so cooked games store rotations that way.
+        public void WriteToBinary(BinaryWriter bw, bool asQuaternion)
         {
             bw.Write(_position.X);
             bw.Write(_position.Y);
             bw.Write(_position.Z);
-            bw.Write(_rotation.X);
-            bw.Write(_rotation.Y);
-            bw.Write(_rotation.Z);
+
+            if (asQuaternion)
+            {
+                var quaternion = Quaternion.CreateFromYawPitchRoll(_rotation.Y, _rotation.X, _rotation.Z);
+                bw.Write(quaternion.X);
+                bw.Write(quaternion.Y);
+                bw.Write(quaternion.Z);
+                bw.Write(quaternion.W);
+            }
+            else
+            {
+                bw.Write(_rotation.X);
+                bw.Write(_rotation.Y);
+                bw.Write(_rotation.Z);
+            }
+
             bw.Write(_scale.X);
             bw.Write(_scale.Y);
             bw.Write(_scale.Z);
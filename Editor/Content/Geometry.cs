@@ -7,6 +7,7 @@ using Editor.GameProject;
 using Editor.Utilities;
 using System.Diagnostics;
 using System.IO;
+using System.Numerics;
 using System.Text;
 using System.Windows;
 using System.Windows.Media;
@@ -19,6 +20,9 @@ public class Geometry : Asset
 {
     private static readonly Lock _lock = new();
 
+    // Has to match geometry_section_alignment in the engine.
+    private const int SectionAlignment = 4096;
+
     private readonly List<LODGroup> _lodGroups = [];
 
     public static AssetInfo? Default = DefaultAssets.DefaultGeometry;
@@ -167,6 +171,8 @@ public class Geometry : Asset
         var ext = Path.GetExtension(file).ToLower();
 
         if (ext == ".fbx") return ImportFbx(file);
+        if (ext == ".obj") return ImportNative(file, ContentToolsAPI.ImportObj);
+        if (ext == ".gltf" || ext == ".glb") return ImportNative(file, ContentToolsAPI.ImportGltf);
 
         return false;
 
@@ -228,53 +234,88 @@ public class Geometry : Asset
 
     /// <summary>
     /// Packs the geometry into a byte array wich can be used by the Engine.
+    /// Every LOD is a separate section, so the engine can load the coarsest LOD first and stream in the others.
     /// </summary>
     /// <returns>
     /// struct {
     ///     u32 lod_count,
-    ///     
+    ///     u32 base_size,                          // header and coarsest LOD section
+    ///
     ///     struct {
     ///         f32 lod_threshold,
     ///         u32 submesh_count,
-    ///         u32 size_of_submeshes,
-    ///         
+    ///         u32 section_offset,                 // from the start of the geometry
+    ///         u32 section_size,
+    ///     } LodHeaders[lod_count]
+    ///
+    ///     struct {
+    ///         u32 element_size,
+    ///         u32 vertex_count,
+    ///         u32 index_count,
+    ///         u32 elements_type,                  // position format in the high byte
+    ///         u32 primitive_topology,
+    ///         f32 position_scale[3],              // only if the positions are quantized
+    ///         f32 position_offset[3],             // only if the positions are quantized
+    ///     } SubmeshHeaders[submesh_count]         // all LODs, finest LOD first
+    ///
+    ///     struct {
     ///         struct {
-    ///             u32 element_size,
-    ///             u32 vertex_count,
-    ///             u32 index_count,
-    ///             u32 elements_type,
-    ///             u32 primitive_topology,
-    ///             u8 positions[sizeof(f32) * 3 * vertex_count],
-    ///             u8 elements[sizeof(element_size) * vertex_count],
+    ///             u8 positions[position_size * vertex_count],         // padded to 4 bytes
+    ///             u8 elements[sizeof(element_size) * vertex_count],   // padded to 4 bytes
     ///             u8 indices[index_size * index_count]
-    ///         } Submeshes[submesh_vount]
-    ///     } MeshLods[lod_count]
+    ///         } Submeshes[submesh_count]
+    ///     } LodSections[lod_count]                // coarsest LOD first, aligned to SectionAlignment
     /// } Geometry
     /// </returns>
     public override byte[] PackForEngine()
     {
         byte[]? data = null;
+        var lods = GetLodGroup()!.LODs;
 
         using var writer = new BinaryWriter(new MemoryStream());
-        writer.Write(GetLodGroup()!.LODs.Count);
+        writer.Write(lods.Count);
+        writer.Write(0);
+
+        var lodHeadersPosition = writer.BaseStream.Position;
 
-        foreach (var lod in GetLodGroup()!.LODs)
+        // NOTE: the section offsets and sizes are filled in once the sections are written.
+        foreach (var lod in lods)
         {
             writer.Write(lod.LODThreshold);
             writer.Write(lod.Meshes.Count);
-
-            var sizeOfSubmeshesPosition = writer.BaseStream.Position;
-
             writer.Write(0);
+            writer.Write(0);
+        }
 
+        foreach (var lod in lods)
+        {
             foreach (var mesh in lod.Meshes)
             {
                 writer.Write(mesh.ElementSize);
                 writer.Write(mesh.VertexCount);
                 writer.Write(mesh.IndexCount);
-                writer.Write((int)mesh.ElementsType);
+                writer.Write((int)mesh.ElementsType | ((int)mesh.PositionFormat << 24));
                 writer.Write((int)mesh.PrimitiveTopology);
 
+                if (mesh.PositionFormat != PositionFormat.F32)
+                {
+                    WriteVector3(writer, mesh.PositionScale);
+                    WriteVector3(writer, mesh.PositionOffset);
+                }
+            }
+        }
+
+        var sectionOffsets = new int[lods.Count];
+        var sectionSizes = new int[lods.Count];
+        var baseSize = 0;
+
+        for (int i = lods.Count - 1; i >= 0; --i)
+        {
+            writer.Write(new byte[MathUtilities.AlignSizeUp(writer.BaseStream.Position, SectionAlignment) - writer.BaseStream.Position]);
+            sectionOffsets[i] = (int)writer.BaseStream.Position;
+
+            foreach (var mesh in lods[i].Meshes)
+            {
                 var alignedPositionBuffer = new byte[MathUtilities.AlignSizeUp(mesh.Positions.Length, 4)];
                 Array.Copy(mesh.Positions, alignedPositionBuffer, mesh.Positions.Length);
                 var alignedElementBuffer = new byte[MathUtilities.AlignSizeUp(mesh.Elements.Length, 4)];
@@ -285,14 +326,24 @@ public class Geometry : Asset
                 writer.Write(mesh.Indicies);
             }
 
-            var endOfSubmeshes = writer.BaseStream.Position;
-            var sizeOfSubmeshes = (int)(endOfSubmeshes - sizeOfSubmeshesPosition - sizeof(int));
+            sectionSizes[i] = (int)writer.BaseStream.Position - sectionOffsets[i];
+
+            if (i == lods.Count - 1) baseSize = (int)writer.BaseStream.Position;
+        }
+
+        var endOfGeometry = writer.BaseStream.Position;
+
+        writer.BaseStream.Position = sizeof(int);
+        writer.Write(baseSize);
 
-            writer.BaseStream.Position = sizeOfSubmeshesPosition;
-            writer.Write(sizeOfSubmeshes);
-            writer.BaseStream.Position = endOfSubmeshes;
+        for (int i = 0; i < lods.Count; ++i)
+        {
+            writer.BaseStream.Position = lodHeadersPosition + i * 4 * sizeof(int) + 2 * sizeof(int);
+            writer.Write(sectionOffsets[i]);
+            writer.Write(sectionSizes[i]);
         }
 
+        writer.BaseStream.Position = endOfGeometry;
         writer.Flush();
 
         data = (writer.BaseStream as MemoryStream)?.ToArray();
@@ -457,6 +508,7 @@ public class Geometry : Asset
 
         mesh.ElementSize = reader.ReadInt32();
         mesh.ElementsType = (ElementsType)reader.ReadInt32();
+        ReadPositionFormat(reader, mesh);
         mesh.PrimitiveTopology = PrimitiveTopology.TRIANGLE_LIST;
         mesh.VertexCount = reader.ReadInt32();
         mesh.IndexSize = reader.ReadInt32();
@@ -466,10 +518,12 @@ public class Geometry : Asset
         var elementsBufferSize = mesh.ElementSize * mesh.VertexCount;
         var indexBufferSize = mesh.IndexSize * mesh.IndexCount;
 
-        mesh.Positions = reader.ReadBytes(Mesh.PositionSize * mesh.VertexCount);
+        mesh.Positions = reader.ReadBytes(mesh.PositionSize * mesh.VertexCount);
         mesh.Elements = reader.ReadBytes(elementsBufferSize);
         mesh.Indicies = reader.ReadBytes(indexBufferSize);
 
+        ReadMeshlets(reader, mesh);
+
         MeshLOD lod;
 
         if (Id.IsValid(lodId) && lodIds.Contains(lodId))
@@ -488,6 +542,53 @@ public class Geometry : Asset
         lod.Meshes.Add(mesh);
     }
 
+    private static void ReadPositionFormat(BinaryReader reader, Mesh mesh)
+    {
+        mesh.PositionFormat = (PositionFormat)reader.ReadInt32();
+        mesh.PositionScale = ReadVector3(reader);
+        mesh.PositionOffset = ReadVector3(reader);
+    }
+
+    private static void WritePositionFormat(BinaryWriter writer, Mesh mesh)
+    {
+        writer.Write((int)mesh.PositionFormat);
+        WriteVector3(writer, mesh.PositionScale);
+        WriteVector3(writer, mesh.PositionOffset);
+    }
+
+    private static Vector3 ReadVector3(BinaryReader reader) => new(reader.ReadSingle(), reader.ReadSingle(), reader.ReadSingle());
+
+    private static void WriteVector3(BinaryWriter writer, Vector3 value)
+    {
+        writer.Write(value.X);
+        writer.Write(value.Y);
+        writer.Write(value.Z);
+    }
+
+    private static void ReadMeshlets(BinaryReader reader, Mesh mesh)
+    {
+        mesh.MeshletCount = reader.ReadInt32();
+
+        if (mesh.MeshletCount == 0) return;
+
+        mesh.MeshletVertexCount = reader.ReadInt32();
+        mesh.MeshletTriangleCount = reader.ReadInt32();
+        mesh.Meshlets = reader.ReadBytes(mesh.MeshletBufferSize);
+    }
+
+    private static void WriteMeshlets(BinaryWriter writer, Mesh mesh)
+    {
+        writer.Write(mesh.MeshletCount);
+
+        if (mesh.MeshletCount == 0) return;
+
+        Debug.Assert(mesh.Meshlets.Length == mesh.MeshletBufferSize);
+
+        writer.Write(mesh.MeshletVertexCount);
+        writer.Write(mesh.MeshletTriangleCount);
+        writer.Write(mesh.Meshlets);
+    }
+
     private static void GenerateAndSetIcons(List<MeshInfo> meshes, MeshLOD lod)
     {
         var iconList = GenerateIcons(lod, true);
@@ -509,6 +610,7 @@ public class Geometry : Asset
             writer.Write(mesh.Name);
             writer.Write(mesh.ElementSize);
             writer.Write((int)mesh.ElementsType);
+            WritePositionFormat(writer, mesh);
             writer.Write((int)mesh.PrimitiveTopology);
             writer.Write(mesh.VertexCount);
             writer.Write(mesh.IndexSize);
@@ -516,6 +618,7 @@ public class Geometry : Asset
             writer.Write(mesh.Positions);
             writer.Write(mesh.Elements);
             writer.Write(mesh.Indicies);
+            WriteMeshlets(writer, mesh);
         }
 
         var meshDataSize = writer.BaseStream.Position - meshDataBegin;
@@ -542,15 +645,17 @@ public class Geometry : Asset
                 Name = reader.ReadString(),
                 ElementSize = reader.ReadInt32(),
                 ElementsType = (ElementsType)reader.ReadInt32(),
-                PrimitiveTopology = (PrimitiveTopology)reader.ReadInt32(),
-                VertexCount = reader.ReadInt32(),
-                IndexSize = reader.ReadInt32(),
-                IndexCount = reader.ReadInt32(),
             };
 
-            mesh.Positions = reader.ReadBytes(Mesh.PositionSize * mesh.VertexCount);
+            ReadPositionFormat(reader, mesh);
+            mesh.PrimitiveTopology = (PrimitiveTopology)reader.ReadInt32();
+            mesh.VertexCount = reader.ReadInt32();
+            mesh.IndexSize = reader.ReadInt32();
+            mesh.IndexCount = reader.ReadInt32();
+            mesh.Positions = reader.ReadBytes(mesh.PositionSize * mesh.VertexCount);
             mesh.Elements = reader.ReadBytes(mesh.ElementSize * mesh.VertexCount);
             mesh.Indicies = reader.ReadBytes(mesh.IndexSize * mesh.IndexCount);
+            ReadMeshlets(reader, mesh);
 
             lod.Meshes.Add(mesh);
         }
@@ -606,4 +711,25 @@ public class Geometry : Asset
 
         return result;
     }
+
+    // The file is read in place, so buffers and material libraries next to it are found by their relative paths.
+    private bool ImportNative(string file, Action<string, Geometry> import)
+    {
+        Logger.LogAsync(LogLevel.INFO, $"Importing {Path.GetExtension(file).TrimStart('.').ToUpper()} file {file}");
+
+        try
+        {
+            import(file, this);
+            return true;
+        }
+        catch (Exception ex)
+        {
+            Debug.WriteLine(ex.Message);
+            var msg = $"Failed to read {file} for import";
+            Debug.WriteLine(msg);
+            Logger.LogAsync(LogLevel.ERROR, msg);
+        }
+
+        return false;
+    }
 }
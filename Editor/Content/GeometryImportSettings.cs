@@ -1,11 +1,16 @@
 ﻿using Editor.Common;
 using Editor.Utilities;
+using System.Diagnostics;
 using System.IO;
 
 namespace Editor.Content
 {
     public class GeometryImportSettings : ViewModelBase, IAssetImportSettings
     {
+        // 0: up to CoalesceMeshes
+        // 1: adds OptimizeIndexOrder, GenerateMeshlets, QuantizePositions, LodCount and LodTriangleRatio
+        private const int Version = 1;
+
         private bool _calculateNormals;
         private bool _calculateTangents;
         private float _smoothingAngle;
@@ -13,6 +18,11 @@ namespace Editor.Content
         private bool _importEmbeddedTextures;
         private bool _importAnimations;
         private bool _coalesceMeshes;
+        private bool _optimizeIndexOrder;
+        private bool _generateMeshlets;
+        private bool _quantizePositions;
+        private int _lodCount;
+        private float _lodTriangleRatio;
 
         public bool CalculateNormals
         {
@@ -105,6 +115,71 @@ namespace Editor.Content
             }
         }
 
+        public bool OptimizeIndexOrder
+        {
+            get => _optimizeIndexOrder;
+            set
+            {
+                if (_optimizeIndexOrder != value)
+                {
+                    _optimizeIndexOrder = value;
+                    OnPropertyChanged(nameof(OptimizeIndexOrder));
+                }
+            }
+        }
+
+        public bool GenerateMeshlets
+        {
+            get => _generateMeshlets;
+            set
+            {
+                if (_generateMeshlets != value)
+                {
+                    _generateMeshlets = value;
+                    OnPropertyChanged(nameof(GenerateMeshlets));
+                }
+            }
+        }
+
+        public bool QuantizePositions
+        {
+            get => _quantizePositions;
+            set
+            {
+                if (_quantizePositions != value)
+                {
+                    _quantizePositions = value;
+                    OnPropertyChanged(nameof(QuantizePositions));
+                }
+            }
+        }
+
+        public int LodCount
+        {
+            get => _lodCount;
+            set
+            {
+                if (_lodCount != value)
+                {
+                    _lodCount = value;
+                    OnPropertyChanged(nameof(LodCount));
+                }
+            }
+        }
+
+        public float LodTriangleRatio
+        {
+            get => _lodTriangleRatio;
+            set
+            {
+                if (!_lodTriangleRatio.IsEqual(value))
+                {
+                    _lodTriangleRatio = value;
+                    OnPropertyChanged(nameof(LodTriangleRatio));
+                }
+            }
+        }
+
         public GeometryImportSettings()
         {
             CalculateNormals = false;
@@ -114,10 +189,16 @@ namespace Editor.Content
             ImportEmbeddedTextures = true;
             ImportAnimations = true;
             CoalesceMeshes = false;
+            OptimizeIndexOrder = false;
+            GenerateMeshlets = false;
+            QuantizePositions = false;
+            LodCount = 0;
+            LodTriangleRatio = .5f;
         }
 
         public void ToBinary(BinaryWriter writer)
         {
+            IAssetImportSettings.WriteVersion(writer, Version);
             writer.Write(CalculateNormals);
             writer.Write(CalculateTangents);
             writer.Write(SmoothingAngle);
@@ -125,10 +206,19 @@ namespace Editor.Content
             writer.Write(ImportEmbeddedTextures);
             writer.Write(ImportAnimations);
             writer.Write(CoalesceMeshes);
+            writer.Write(OptimizeIndexOrder);
+            writer.Write(GenerateMeshlets);
+            writer.Write(QuantizePositions);
+            writer.Write(LodCount);
+            writer.Write(LodTriangleRatio);
         }
 
         public void FromBinary(BinaryReader reader)
         {
+            var version = IAssetImportSettings.ReadVersion(reader);
+
+            Debug.Assert(version <= Version);
+
             CalculateNormals = reader.ReadBoolean();
             CalculateTangents = reader.ReadBoolean();
             SmoothingAngle = reader.ReadSingle();
@@ -136,6 +226,24 @@ namespace Editor.Content
             ImportEmbeddedTextures = reader.ReadBoolean();
             ImportAnimations = reader.ReadBoolean();
             CoalesceMeshes = reader.ReadBoolean();
+
+            if (version < 1)
+            {
+                // Older assets were imported without any of these.
+                OptimizeIndexOrder = false;
+                GenerateMeshlets = false;
+                QuantizePositions = false;
+                LodCount = 0;
+                LodTriangleRatio = .5f;
+
+                return;
+            }
+
+            OptimizeIndexOrder = reader.ReadBoolean();
+            GenerateMeshlets = reader.ReadBoolean();
+            QuantizePositions = reader.ReadBoolean();
+            LodCount = reader.ReadInt32();
+            LodTriangleRatio = reader.ReadSingle();
         }
     }
 }
@@ -1,4 +1,5 @@
-﻿using System.IO;
+﻿using System.Diagnostics;
+using System.IO;
 
 namespace Editor.Content
 {
@@ -27,6 +28,29 @@ namespace Editor.Content
             to.FromBinary(reader);
         }
 
+        // Settings written before they were versioned start with a bool or a string. BinaryWriter never writes a bool or
+        // a string length that starts with these bytes, so older settings are read as version 0.
+        private static readonly byte[] _versionTag = [0x80, 0x00];
+
+        static void WriteVersion(BinaryWriter writer, int version)
+        {
+            writer.Write(_versionTag);
+            writer.Write(version);
+        }
+
+        static int ReadVersion(BinaryReader reader)
+        {
+            Debug.Assert(reader.BaseStream.CanSeek);
+
+            var position = reader.BaseStream.Position;
+
+            if (reader.ReadByte() == _versionTag[0] && reader.ReadByte() == _versionTag[1]) return reader.ReadInt32();
+
+            reader.BaseStream.Position = position;
+
+            return 0;
+        }
+
         void ToBinary(BinaryWriter writer);
         void FromBinary(BinaryReader reader);
     }
@@ -1,5 +1,7 @@
 ﻿using Editor.Common;
 using Editor.Common.Enums;
+using Editor.Utilities;
+using System.Numerics;
 
 namespace Editor.Content;
 
@@ -11,14 +13,30 @@ public class Mesh : ViewModelBase
     private int _indexCount;
     private string? _name;
 
-    public static int PositionSize => sizeof(float) * 3;
+    public static int MeshletSize => sizeof(int) * 4 + sizeof(float) * 8;
 
     public ElementsType ElementsType { get; set; }
     public PrimitiveTopology PrimitiveTopology { get; set; }
+
+    // Quantized positions are decoded as PositionOffset + position * PositionScale.
+    public PositionFormat PositionFormat { get; set; }
+    public Vector3 PositionScale { get; set; }
+    public Vector3 PositionOffset { get; set; }
+    public int PositionSize => PositionFormat == PositionFormat.UNORM16 ? sizeof(ushort) * 3 : sizeof(float) * 3;
+
     public byte[] Positions { get; set; } = [];
     public byte[] Elements { get; set; } = [];
     public byte[] Indicies { get; set; } = [];
 
+    // Optional, filled by ContentTools when meshlet generation is enabled. Meshlets holds the meshlet structs, the
+    // meshlet vertex indicies and the local triangle indicies (3 bytes per triangle, padded to 4 bytes), in this order.
+    public int MeshletCount { get; set; }
+    public int MeshletVertexCount { get; set; }
+    public int MeshletTriangleCount { get; set; }
+    public byte[] Meshlets { get; set; } = [];
+    public int MeshletBufferSize =>
+        MeshletSize * MeshletCount + sizeof(int) * MeshletVertexCount + (int)MathUtilities.AlignSizeUp(3 * MeshletTriangleCount, 4);
+
     public int ElementSize
     {
         get => _elementSize;
@@ -2,12 +2,17 @@
 using Editor.Common.Enums;
 using Editor.Utilities;
 using System.Collections.ObjectModel;
+using System.Diagnostics;
 using System.IO;
 
 namespace Editor.Content
 {
     public class TextureImportSettings : ViewModelBase, IAssetImportSettings
     {
+        // 0: up to PrefilterCubemap
+        // 1: adds CompressionQuality and MipFilter
+        private const int Version = 1;
+
         private TextureDimension _dimension = TextureDimension.TEXTURE_2D;
         private int _mipLevels;
         private float _alphaThreshold;
@@ -17,6 +22,8 @@ namespace Editor.Content
         private int _cubemapSize;
         private bool _mirrorCubemap;
         private bool _prefilterCubemap;
+        private int _compressionQuality;
+        private int _mipFilter;
 
         public ObservableCollection<string> Sources { get; } = new();
 
@@ -141,6 +148,34 @@ namespace Editor.Content
             }
         }
 
+        public int CompressionQuality
+        {
+            get => _compressionQuality;
+            set
+            {
+                value = Math.Clamp(value, 0, Enum.GetValues<Common.Enums.CompressionQuality>().Length - 1);
+                if (_compressionQuality != value)
+                {
+                    _compressionQuality = value;
+                    OnPropertyChanged(nameof(CompressionQuality));
+                }
+            }
+        }
+
+        public int MipFilter
+        {
+            get => _mipFilter;
+            set
+            {
+                value = Math.Clamp(value, 0, Enum.GetValues<Common.Enums.MipFilter>().Length - 1);
+                if (_mipFilter != value)
+                {
+                    _mipFilter = value;
+                    OnPropertyChanged(nameof(MipFilter));
+                }
+            }
+        }
+
         public DXGIFormat OutputFormat =>
             Compress ? (DXGIFormat)Enum.GetValues<BCFormat>()[FormatIndex] : DXGIFormat.DXGI_FORMAT_UNKNOWN;
 
@@ -154,10 +189,16 @@ namespace Editor.Content
             CubemapSize = 256;
             MirrorCubemap = true;
             PrefilterCubemap = true;
+            CompressionQuality = (int)Common.Enums.CompressionQuality.NORMAL;
+            MipFilter = (int)Common.Enums.MipFilter.BOX;
         }
 
         public void FromBinary(BinaryReader reader)
         {
+            var version = IAssetImportSettings.ReadVersion(reader);
+
+            Debug.Assert(version <= Version);
+
             Sources.Clear();
 
             reader.ReadString().Split(';').Where(x => !string.IsNullOrEmpty(x)).ToList().ForEach(x => Sources.Add(x));
@@ -171,10 +212,22 @@ namespace Editor.Content
             CubemapSize = reader.ReadInt32();
             MirrorCubemap = reader.ReadBoolean();
             PrefilterCubemap = reader.ReadBoolean();
+
+            if (version < 1)
+            {
+                CompressionQuality = (int)Common.Enums.CompressionQuality.NORMAL;
+                MipFilter = (int)Common.Enums.MipFilter.BOX;
+
+                return;
+            }
+
+            CompressionQuality = reader.ReadInt32();
+            MipFilter = reader.ReadInt32();
         }
 
         public void ToBinary(BinaryWriter writer)
         {
+            IAssetImportSettings.WriteVersion(writer, Version);
             writer.Write(string.Join(';', Sources.ToArray()));
             writer.Write((int)Dimension);
             writer.Write(MipLevels);
@@ -185,6 +238,8 @@ namespace Editor.Content
             writer.Write(CubemapSize);
             writer.Write(MirrorCubemap);
             writer.Write(PrefilterCubemap);
+            writer.Write(CompressionQuality);
+            writer.Write(MipFilter);
         }
     }
 }
@@ -20,6 +20,12 @@ static partial class ContentToolsAPI
     [DllImport(_contentToolsDll, EntryPoint = "import_fbx")]
     private static extern void ImportFbx(string file, [In, Out] SceneData data, ProgressCallback? callback);
 
+    [DllImport(_contentToolsDll, EntryPoint = "import_obj")]
+    private static extern void ImportObj(string file, [In, Out] SceneData data, ProgressCallback? callback);
+
+    [DllImport(_contentToolsDll, EntryPoint = "import_gltf")]
+    private static extern void ImportGltf(string file, [In, Out] SceneData data, ProgressCallback? callback);
+
     [DllImport(_contentToolsDll, EntryPoint = "import")]
     private static extern void Import([In, Out] TextureData data);
 
@@ -38,6 +44,16 @@ static partial class ContentToolsAPI
     [DllImport(_contentToolsDll, EntryPoint = "compute_brdf_integration_lut")]
     private static extern void ComputeBRDFIntegrationLUT([In, Out] TextureData data);
 
+    [DllImport(_contentToolsDll, EntryPoint = "pack_assets")]
+    [return: MarshalAs(UnmanagedType.I1)]
+    private static extern bool PackAssets(
+        string[] files,
+        string[]? names,
+        int fileCount,
+        string archivePath,
+        [MarshalAs(UnmanagedType.I1)] bool compress
+    );
+
     public static void CreatePrimitiveMesh(Geometry geometry, PrimitiveInitInfo info) =>
         GeometryFromSceneData(
             geometry,
@@ -54,6 +70,24 @@ static partial class ContentToolsAPI
             ImportFbx(file, sceneData, callback), $"Failed to import from FBX file: {file}");
     }
 
+    public static void ImportObj(string file, Geometry geometry)
+    {
+        var item = ImportingItemCollection.GetItem(geometry);
+        ProgressCallback? callback = item is not null ? item.SetProgress : null;
+
+        GeometryFromSceneData(geometry, (sceneData) =>
+            ImportObj(file, sceneData, callback), $"Failed to import from OBJ file: {file}");
+    }
+
+    public static void ImportGltf(string file, Geometry geometry)
+    {
+        var item = ImportingItemCollection.GetItem(geometry);
+        ProgressCallback? callback = item is not null ? item.SetProgress : null;
+
+        GeometryFromSceneData(geometry, (sceneData) =>
+            ImportGltf(file, sceneData, callback), $"Failed to import from glTF file: {file}");
+    }
+
     public static void Import(Texture texture)
     {
         Debug.Assert(texture.ImportSettings.Sources.Any());
@@ -188,6 +222,28 @@ static partial class ContentToolsAPI
         }
     }
 
+    public static bool PackAssets(string[] files, string[] names, string archivePath, bool compress)
+    {
+        Debug.Assert(files.Length > 0 && files.Length == names.Length);
+
+        try
+        {
+            if (!PackAssets(files, names, files.Length, archivePath, compress))
+            {
+                throw new Exception($"Error while trying to pack {files.Length} file(s) into {archivePath}");
+            }
+
+            return true;
+        }
+        catch (Exception ex)
+        {
+            Logger.LogAsync(LogLevel.ERROR, $"Failed to pack assets into {archivePath}");
+            Debug.WriteLine(ex.Message);
+
+            return false;
+        }
+    }
+
     private static void GeometryFromSceneData(
         Geometry geometry,
         Action<SceneData> sceneDataGenerator,
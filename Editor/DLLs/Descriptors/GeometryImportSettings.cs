@@ -13,6 +13,11 @@ namespace Editor.DLLs.Descriptors
         public byte ImportEmbededTextures = 1;
         public byte ImportAnimations = 1;
         public byte CoalesceMeshes = 0;
+        public byte OptimizeIndexOrder = 0;
+        public byte GenerateMeshlets = 0;
+        public byte QuantizePositions = 0;
+        public byte LodCount = 0;
+        public float LodTriangleRatio = .5f;
 
         public void FromContentSettings(Geometry geometry)
         {
@@ -25,6 +30,11 @@ namespace Editor.DLLs.Descriptors
             ImportEmbededTextures = ToByte(settings.ImportEmbeddedTextures);
             ImportAnimations = ToByte(settings.ImportAnimations);
             CoalesceMeshes = ToByte(settings.CoalesceMeshes);
+            OptimizeIndexOrder = ToByte(settings.OptimizeIndexOrder);
+            GenerateMeshlets = ToByte(settings.GenerateMeshlets);
+            QuantizePositions = ToByte(settings.QuantizePositions);
+            LodCount = (byte)settings.LodCount;
+            LodTriangleRatio = settings.LodTriangleRatio;
         }
 
         private byte ToByte(bool value) => value ? (byte)1 : (byte)0;
@@ -16,6 +16,8 @@ namespace Editor.DLLs.Descriptors
         public int CubemapSize;
         public int MirrorCubemap;
         public int PrefilterCubemap;
+        public int CompressionQuality;
+        public int MipFilter;
 
         public void FromContentSettings(Content.TextureImportSettings settings)
         {
@@ -30,6 +32,8 @@ namespace Editor.DLLs.Descriptors
             CubemapSize = settings.CubemapSize;
             MirrorCubemap = settings.MirrorCubemap ? 1 : 0;
             PrefilterCubemap = settings.PrefilterCubemap ? 1 : 0;
+            CompressionQuality = settings.CompressionQuality;
+            MipFilter = settings.MipFilter;
         }
     }
 }
@@ -175,9 +175,20 @@ public class MeshRenderer : ViewModelBase
             {
                 for (int i = 0; i < mesh.VertexCount; ++i)
                 {
-                    var posX = reader.ReadSingle();
-                    var posY = reader.ReadSingle();
-                    var posZ = reader.ReadSingle();
+                    double posX, posY, posZ;
+
+                    if (mesh.PositionFormat == PositionFormat.UNORM16)
+                    {
+                        posX = mesh.PositionOffset.X + reader.ReadUInt16() * mesh.PositionScale.X;
+                        posY = mesh.PositionOffset.Y + reader.ReadUInt16() * mesh.PositionScale.Y;
+                        posZ = mesh.PositionOffset.Z + reader.ReadUInt16() * mesh.PositionScale.Z;
+                    }
+                    else
+                    {
+                        posX = reader.ReadSingle();
+                        posY = reader.ReadSingle();
+                        posZ = reader.ReadSingle();
+                    }
 
                     vertexData.Positions.Add(new Point3D(posX, posY, posZ));
 
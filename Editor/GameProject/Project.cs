@@ -26,6 +26,8 @@ public class Project : ViewModelBase
     private string[] _availableScripts = [];
 
     public static readonly string Extension = ".lng";
+    // Lets the engine load entity rotations without converting them from Euler angles.
+    private const bool CookRotationsAsQuaternions = true;
     public static Project? Current { get; private set; }
     public static UndoRedo UndoRedo { get; } = new UndoRedo();
     public static event EventHandler? SceneUpdated;
@@ -269,6 +271,7 @@ public class Project : ViewModelBase
         if (MSBuild.BuildSucceeded)
         {
             SaveToBinary();
+            PackGameData();
             await Task.Run(() => ICodeEditor.Current.Run(debug));
         }
     }
@@ -286,17 +289,32 @@ public class Project : ViewModelBase
 
         foreach (var entity in ActiveScene.Entities)
         {
-            bw.Write(0);
+            bw.Write(CookRotationsAsQuaternions ? (int)EntityFlags.QUATERNION_ROTATION : 0);
             bw.Write(entity.Components.Count);
 
             foreach (var component in entity.Components)
             {
                 bw.Write((int)component.ToEnumType());
-                component.WriteToBinary(bw);
+
+                if (component is Transform transform) transform.WriteToBinary(bw, CookRotationsAsQuaternions);
+                else component.WriteToBinary(bw);
             }
         }
     }
 
+    // The engine reads game.pak before falling back to loose files, so the archive has to be rebuilt every time
+    // game.bin changes. A stale archive would otherwise hide the new scene.
+    private void PackGameData()
+    {
+        var folder = $@"{Path}x64\{MSBuild.GetConfigurationName(StandaloneBuildConfig)}\";
+        var archive = $"{folder}game.pak";
+
+        if (!ContentToolsAPI.PackAssets([$"{folder}game.bin"], ["game.bin"], archive, true) && File.Exists(archive))
+        {
+            File.Delete(archive);
+        }
+    }
+
     private void SetCommands()
     {
         AddSceneCommand = new RelayCommand<object>(x =>
@@ -11,7 +11,7 @@ namespace Editor.Utilities;
 
 public static class ContentHelper
 {
-    public static string[] MeshFileExtensions { get; } = [".fbx"];
+    public static string[] MeshFileExtensions { get; } = [".fbx", ".obj", ".gltf", ".glb"];
 
     public static string[] ImageFileExtensions { get; } = [
         ".bmp",
@@ -62,6 +62,27 @@ namespace lightning::game_entity {
         return new_entity;
     }
 
+    u32 create(const EntityInfo* const infos, u32 count, Entity* const entities) {
+        assert(infos && count && entities);
+
+        // Grow every component array once instead of once per entity.
+        const u64 reused_ids{ free_ids.size() > id::min_deleted_elements ? free_ids.size() - id::min_deleted_elements : 0 };
+        const u64 capacity{ generations.size() + (count > reused_ids ? count - reused_ids : 0) };
+
+        generations.reserve(capacity);
+        transforms.reserve(capacity);
+        scripts.reserve(capacity);
+        geometries.reserve(capacity);
+        transform::reserve((u32)capacity);
+
+        for (u32 i{ 0 }; i < count; ++i) {
+            entities[i] = create(infos[i]);
+            if (!entities[i].is_valid()) return i;
+        }
+
+        return count;
+    }
+
     bool update_component(entity_id id, EntityInfo info, ComponentType::Type type) {
         assert(is_alive(id) && type != ComponentType::TRANSFORM);
 
@@ -32,6 +32,8 @@ namespace lightning {
         };
 
         Entity create(EntityInfo info);
+        // Creates entities in bulk. Returns the number of entities created, which is less than count if one failed.
+        u32 create(const EntityInfo* const infos, u32 count, Entity* const entities);
         bool update_component(entity_id id, EntityInfo info, ComponentType::Type type);
         void remove(entity_id id);
         bool is_alive(entity_id id);
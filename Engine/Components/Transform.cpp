@@ -129,6 +129,17 @@ namespace lightning::transform {
 		return Component{ transform_id{ entity.get_id()} };
 	}
 
+	void reserve(u32 count) {
+		to_world.reserve(count);
+		inv_world.reserve(count);
+		positions.reserve(count);
+		local_frames.reserve(count);
+		rotations.reserve(count);
+		scales.reserve(count);
+		has_transform.reserve(count);
+		changes_from_previous_frame.reserve(count);
+	}
+
 	void remove([[maybe_unused]] Component component) {
 		assert(component.is_valid());
 	}
@@ -28,6 +28,7 @@ namespace lightning::transform {
     };
 
     Component create(InitInfo info, game_entity::Entity entity);
+    void reserve(u32 count);
     void remove(Component component);
     void get_transform_matrices(const game_entity::entity_id id, math::m4x4& world, math::m4x4& inverse_world);
     void get_updated_component_flags(const game_entity::entity_id* const ids, u32 count, u8* const flags);
@@ -0,0 +1,91 @@
+#pragma once
+#include "CommonHeaders.h"
+
+namespace lightning::content::archive {
+
+	// Archive layout:
+	//
+	// ArchiveHeader
+	// TocEntry[entry_count]  (sorted by name_hash)
+	// payloads               (each payload starts at a page_size aligned offset)
+	//
+	// Compressed payloads start with a table of u32 block sizes followed by the blocks. Every block except the last
+	// one decompresses to block_size bytes. A block whose stored size equals its raw size isn't compressed.
+	//
+	// NOTE: this header is shared with ContentTools which writes the archives.
+	constexpr u32 archive_magic{ 0x4b50454c }; // "LEPK"
+	constexpr u32 archive_version{ 2 };
+	constexpr u32 archive_page_size{ 4096 };
+
+	struct EntryFlags {
+		enum Flags : u32 {
+			NONE = 0x00,
+			COMPRESSED = 0x01,
+		};
+	};
+
+	struct ArchiveHeader {
+		u32 magic;
+		u32 version;
+		u32 entry_count;
+		u32 page_size;
+		u64 toc_offset;
+		u64 file_size;
+	};
+
+	struct TocEntry {
+		u64 name_hash;
+		u64 offset;
+		u64 size;
+		u64 raw_size;
+		u32 block_size;
+		u32 flags;
+	};
+
+	static_assert(sizeof(ArchiveHeader) == 32);
+	static_assert(sizeof(TocEntry) == 40);
+
+	// 64-bit FNV-1a of the asset name. Names are case insensitive and both '/' and '\' are treated as separators,
+	// so the same asset can be looked up with paths coming from the editor and the engine.
+	[[nodiscard]] constexpr u64 hash_asset_name(const char* name) {
+		assert(name);
+		u64 hash{ 0xcbf29ce484222325ull };
+
+		for (const char* c{ name }; *c; ++c) {
+			char ch{ *c == '\\' ? '/' : *c };
+			if (ch >= 'A' && ch <= 'Z') ch += 'a' - 'A';
+			hash ^= (u8)ch;
+			hash *= 0x100000001b3ull;
+		}
+
+		return hash;
+	}
+
+	[[nodiscard]] constexpr u32 block_count(const TocEntry& entry) {
+		assert(entry.block_size);
+		return (u32)((entry.raw_size + entry.block_size - 1) / entry.block_size);
+	}
+
+	DEFINE_TYPED_ID(archive_id);
+
+	// A view into an opened archive. data points to the memory mapped payload which stays valid
+	// until the archive is closed. offset is the position of the payload in the archive file.
+	// If the payload is compressed, size is the stored size and raw_size is the size after decompression.
+	struct AssetView {
+		const u8* data{ nullptr };
+		u64 offset{ 0 };
+		u64 size{ 0 };
+		u64 raw_size{ 0 };
+		u32 block_size{ 0 };
+		bool is_compressed{ false };
+	};
+
+	[[nodiscard]] archive_id open_archive(const char* path);
+	void close_archive(archive_id id);
+	bool find_asset(archive_id id, u64 name_hash, AssetView& view);
+	bool find_asset(archive_id id, const char* name, AssetView& view);
+
+	// Copies the asset into a new buffer. Compressed blocks are decompressed in parallel; each thread faults in
+	// the pages of the blocks it works on, so reading from disk overlaps with decompression.
+	bool read_asset(const AssetView& view, std::unique_ptr<u8[]>& data, u64& size);
+}
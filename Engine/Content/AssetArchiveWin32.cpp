@@ -0,0 +1,180 @@
+#include "AssetArchive.h"
+#include "Utilities/Compression.h"
+#include "Utilities/Threading.h"
+
+#ifdef _WIN64
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+#include <algorithm>
+
+namespace lightning::content::archive {
+	namespace {
+
+		struct Archive {
+			HANDLE file{ INVALID_HANDLE_VALUE };
+			HANDLE mapping{ nullptr };
+			const u8* base{ nullptr };
+			const TocEntry* toc{ nullptr };
+			u32 entry_count{ 0 };
+		};
+
+		util::free_list<Archive> archives;
+		std::mutex archive_mutex;
+
+		void release_archive(Archive& archive) {
+			if (archive.base) UnmapViewOfFile(archive.base);
+			if (archive.mapping) CloseHandle(archive.mapping);
+			if (archive.file != INVALID_HANDLE_VALUE) CloseHandle(archive.file);
+			archive = {};
+		}
+
+		bool validate_archive(const u8* const base, u64 file_size) {
+			if (file_size < sizeof(ArchiveHeader)) return false;
+
+			const ArchiveHeader& header{ *(const ArchiveHeader*)base };
+
+			if (header.magic != archive_magic || header.version != archive_version || header.file_size != file_size) return false;
+			if (!header.page_size || (header.page_size & (header.page_size - 1))) return false;
+			if (header.toc_offset < sizeof(ArchiveHeader) || (header.toc_offset & (alignof(TocEntry) - 1))) return false;
+			if (header.toc_offset > file_size || (u64)header.entry_count * sizeof(TocEntry) > file_size - header.toc_offset) return false;
+
+			const TocEntry* const toc{ (const TocEntry*)&base[header.toc_offset] };
+
+			for (u32 i{ 0 }; i < header.entry_count; ++i) {
+				const TocEntry& entry{ toc[i] };
+
+				if (entry.offset & (header.page_size - 1)) return false;
+				if (entry.offset > file_size || entry.size > file_size - entry.offset) return false;
+
+				if (entry.flags & EntryFlags::COMPRESSED) {
+					if (!entry.block_size || (u64)block_count(entry) * sizeof(u32) > entry.size) return false;
+				}
+				else if (entry.size != entry.raw_size) return false;
+				if (i && toc[i - 1].name_hash >= entry.name_hash) return false;
+			}
+
+			return true;
+		}
+	}
+
+	archive_id open_archive(const char* path) {
+		assert(path);
+		Archive archive{};
+
+		archive.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+		if (archive.file == INVALID_HANDLE_VALUE) return archive_id{ id::invalid_id };
+
+		LARGE_INTEGER file_size{};
+
+		if (!GetFileSizeEx(archive.file, &file_size) || !file_size.QuadPart) {
+			release_archive(archive);
+			return archive_id{ id::invalid_id };
+		}
+
+		archive.mapping = CreateFileMappingA(archive.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		archive.base = archive.mapping ? (const u8*)MapViewOfFile(archive.mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+		if (!archive.base || !validate_archive(archive.base, (u64)file_size.QuadPart)) {
+			release_archive(archive);
+			return archive_id{ id::invalid_id };
+		}
+
+		const ArchiveHeader& header{ *(const ArchiveHeader*)archive.base };
+		archive.toc = (const TocEntry*)&archive.base[header.toc_offset];
+		archive.entry_count = header.entry_count;
+
+		std::lock_guard lock{ archive_mutex };
+		return archive_id{ archives.add(archive) };
+	}
+
+	void close_archive(archive_id id) {
+		std::lock_guard lock{ archive_mutex };
+		assert(id::is_valid(id));
+
+		release_archive(archives[id]);
+		archives.remove(id);
+	}
+
+	bool find_asset(archive_id id, u64 name_hash, AssetView& view) {
+		std::lock_guard lock{ archive_mutex };
+		assert(id::is_valid(id));
+
+		const Archive& archive{ archives[id] };
+		const TocEntry* const begin{ archive.toc };
+		const TocEntry* const end{ archive.toc + archive.entry_count };
+		const TocEntry* const entry{ std::lower_bound(begin, end, name_hash, [](const TocEntry& e, u64 hash) { return e.name_hash < hash; }) };
+
+		if (entry == end || entry->name_hash != name_hash) return false;
+
+		view.data = &archive.base[entry->offset];
+		view.offset = entry->offset;
+		view.size = entry->size;
+		view.raw_size = entry->raw_size;
+		view.block_size = entry->block_size;
+		view.is_compressed = entry->flags & EntryFlags::COMPRESSED;
+
+		return true;
+	}
+
+	bool find_asset(archive_id id, const char* name, AssetView& view) {
+		return find_asset(id, hash_asset_name(name), view);
+	}
+
+	bool read_asset(const AssetView& view, std::unique_ptr<u8[]>& data, u64& size) {
+		assert(view.data);
+		data = std::make_unique<u8[]>(view.raw_size);
+		size = view.raw_size;
+
+		if (!view.is_compressed) {
+			memcpy(data.get(), view.data, view.size);
+			return true;
+		}
+
+		TocEntry entry{};
+		entry.raw_size = view.raw_size;
+		entry.block_size = view.block_size;
+
+		const u32 count{ block_count(entry) };
+		const u32* const block_sizes{ (const u32*)view.data };
+
+		// Prefix sum of the block sizes gives the position of every block, so they can be decompressed independently.
+		util::vector<u64> block_offsets(count);
+		u64 offset{ count * sizeof(u32) };
+
+		for (u32 i{ 0 }; i < count; ++i) {
+			block_offsets[i] = offset;
+			offset += block_sizes[i];
+		}
+
+		if (offset != view.size) return false;
+
+		std::atomic<bool> result{ true };
+
+		util::parallel_for(count, [&](u32 i) {
+			const u64 raw_offset{ (u64)i * view.block_size };
+			const u32 raw_size{ (u32)std::min((u64)view.block_size, view.raw_size - raw_offset) };
+			const u8* const src{ &view.data[block_offsets[i]] };
+			u8* const dst{ &data[raw_offset] };
+
+			if (block_sizes[i] == raw_size) {
+				memcpy(dst, src, raw_size);
+			}
+			else if (!compression::decompress_block(src, block_sizes[i], dst, raw_size)) {
+				result = false;
+			}
+		});
+
+		return result;
+	}
+}
+
+#endif
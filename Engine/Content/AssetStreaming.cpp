@@ -0,0 +1,417 @@
+#include "AssetStreaming.h"
+
+#include <thread>
+#include <condition_variable>
+#include <queue>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <filesystem>
+
+namespace lightning::content::streaming {
+	namespace {
+
+		struct RequestStage {
+			enum Stage : u32 {
+				QUEUED_FOR_IO,
+				READING,
+				QUEUED_FOR_PROCESSING,
+				PROCESSING,
+			};
+		};
+
+		struct Request {
+			std::string path;
+			std::unique_ptr<u8[]> data;
+			range_callback callback{ nullptr };
+			u64 user_data{ 0 };
+			u64 offset{ 0 };
+			u64 size{ 0 };
+			AssetType::Type type{ AssetType::UNKNOWN };
+			RequestStage::Stage stage{ RequestStage::QUEUED_FOR_IO };
+			u32 priority{ RequestPriority::NORMAL };
+			u32 version{ 0 };
+			bool cancel_requested{ false };
+		};
+
+		// Requests are never removed from the queues when they are reprioritized or canceled. Instead the request's
+		// version is bumped and stale entries are skipped when they reach the top of the queue.
+		struct QueueEntry {
+			u64 sequence;
+			id::id_type request;
+			u32 priority;
+			u32 version;
+
+			constexpr bool operator<(const QueueEntry& o) const {
+				return priority < o.priority || (priority == o.priority && sequence > o.sequence);
+			}
+		};
+
+		std::unordered_map<id::id_type, Request> requests;
+		std::priority_queue<QueueEntry> io_queue;
+		std::priority_queue<QueueEntry> processing_queue;
+		std::condition_variable io_cv;
+		std::condition_variable processing_cv;
+		std::mutex request_mutex;
+
+		util::vector<CompletedRequest> completed_requests;
+		std::mutex completed_mutex;
+
+		util::vector<std::thread> io_threads;
+		util::vector<std::thread> worker_threads;
+
+		id::id_type next_request_id{ 0 };
+		u64 next_sequence{ 0 };
+		bool is_running{ false };
+
+		bool read_file(const std::filesystem::path& path, std::unique_ptr<u8[]>& data, u64& size) {
+			if (!std::filesystem::exists(path)) return false;
+			size = std::filesystem::file_size(path);
+			if (!size) return false;
+			data = std::make_unique<u8[]>(size);
+			std::ifstream file{ path, std::ios::in | std::ios::binary };
+
+			if (!file || !file.read((char*)data.get(), size)) {
+				file.close();
+				return false;
+			}
+
+			file.close();
+
+			return true;
+		}
+
+		bool read_file_part(const std::filesystem::path& path, u64 offset, u64 size, std::unique_ptr<u8[]>& data) {
+			assert(size);
+			std::ifstream file{ path, std::ios::in | std::ios::binary };
+			if (!file || !file.seekg(offset)) return false;
+
+			data = std::make_unique<u8[]>(size);
+
+			return (bool)file.read((char*)data.get(), size);
+		}
+
+		// A geometry starts with its LOD count and the size of its header and coarsest LOD. That's all that is read,
+		// the finer LODs are streamed in by content::update_geometry_residency().
+		bool read_geometry_base(const std::filesystem::path& path, std::unique_ptr<u8[]>& data, u64& size) {
+			u32 header[2]{};
+			std::ifstream file{ path, std::ios::in | std::ios::binary };
+			if (!file || !file.read((char*)&header[0], sizeof(header)) || !header[0] || header[1] < sizeof(header)) return false;
+
+			size = header[1];
+			data = std::make_unique<u8[]>(size);
+			memcpy(data.get(), &header[0], sizeof(header));
+
+			return (bool)file.read((char*)&data[sizeof(header)], size - sizeof(header));
+		}
+
+		// NOTE: request_mutex must be locked when calling this function.
+		void push_to_queue(std::priority_queue<QueueEntry>& queue, id::id_type id, const Request& request) {
+			queue.push(QueueEntry{ next_sequence++, id, request.priority, request.version });
+		}
+
+		// NOTE: request_mutex must be locked when calling this function.
+		void complete_request(id::id_type id, id::id_type asset_id, RequestStatus::Status status) {
+			auto pair = requests.find(id);
+			assert(pair != requests.end());
+
+			if (pair->second.callback) {
+				requests.erase(pair);
+				return;
+			}
+
+			const CompletedRequest completed{ request_id{ id }, asset_id, pair->second.type, status };
+			requests.erase(pair);
+
+			std::lock_guard lock{ completed_mutex };
+			completed_requests.emplace_back(completed);
+		}
+
+		// Pops the next valid entry from the queue. Returns nullptr if the queue only contained stale entries.
+		// NOTE: request_mutex must be locked when calling this function.
+		Request* pop_request(std::priority_queue<QueueEntry>& queue, RequestStage::Stage expected_stage, id::id_type& id) {
+			while (!queue.empty()) {
+				const QueueEntry entry{ queue.top() };
+				queue.pop();
+
+				auto pair = requests.find(entry.request);
+
+				if (pair == requests.end()) continue;
+
+				Request& request{ pair->second };
+
+				if (request.stage != expected_stage || request.version != entry.version) continue;
+
+				id = entry.request;
+				return &request;
+			}
+
+			return nullptr;
+		}
+
+		void io_thread_proc() {
+			while (true) {
+				std::unique_lock lock{ request_mutex };
+				io_cv.wait(lock, [] { return !is_running || !io_queue.empty(); });
+
+				if (!is_running) return;
+
+				id::id_type id{ id::invalid_id };
+				Request* const request{ pop_request(io_queue, RequestStage::QUEUED_FOR_IO, id) };
+
+				if (!request) continue;
+
+				request->stage = RequestStage::READING;
+				const std::filesystem::path path{ request->path };
+				const range_callback callback{ request->callback };
+				const u64 user_data{ request->user_data };
+				const u64 offset{ request->offset };
+				u64 size{ request->size };
+				const AssetType::Type type{ request->type };
+				lock.unlock();
+
+				std::unique_ptr<u8[]> data{};
+				const bool result{
+					callback ? read_file_part(path, offset, size, data) :
+					type == AssetType::MESH ? read_geometry_base(path, data, size) :
+					read_file(path, data, size)
+				};
+
+				if (!result && callback) callback(nullptr, 0, user_data);
+
+				// NOTE: requests in READING stage are only removed by this thread, so the pointer is still valid.
+				lock.lock();
+
+				if (!result || request->cancel_requested) {
+					complete_request(id, id::invalid_id, result ? RequestStatus::CANCELED : RequestStatus::FAILED);
+					continue;
+				}
+
+				request->data = std::move(data);
+				request->stage = RequestStage::QUEUED_FOR_PROCESSING;
+				push_to_queue(processing_queue, id, *request);
+				processing_cv.notify_one();
+			}
+		}
+
+		void worker_thread_proc() {
+			while (true) {
+				std::unique_lock lock{ request_mutex };
+				processing_cv.wait(lock, [] { return !is_running || !processing_queue.empty(); });
+
+				if (!is_running) return;
+
+				id::id_type id{ id::invalid_id };
+				Request* const request{ pop_request(processing_queue, RequestStage::QUEUED_FOR_PROCESSING, id) };
+
+				if (!request) continue;
+
+				request->stage = RequestStage::PROCESSING;
+				const std::unique_ptr<u8[]> data{ std::move(request->data) };
+				const AssetType::Type type{ request->type };
+				const range_callback callback{ request->callback };
+				lock.unlock();
+
+				if (callback) {
+					callback(data.get(), request->size, request->user_data);
+
+					lock.lock();
+					complete_request(id, id::invalid_id, RequestStatus::SUCCEEDED);
+					continue;
+				}
+
+				// NOTE: meshes are created from their coarsest LOD. The path is kept to stream in the finer LODs.
+				const id::id_type asset_id{ content::create_resource(data.get(), type, type == AssetType::MESH ? request->path.c_str() : nullptr) };
+
+				lock.lock();
+
+				if (!id::is_valid(asset_id)) {
+					complete_request(id, id::invalid_id, RequestStatus::FAILED);
+				}
+				else if (request->cancel_requested) {
+					// The resource was already created when cancel() was called, so nobody is going to own it.
+					content::destroy_resource(asset_id, type);
+					complete_request(id, id::invalid_id, RequestStatus::CANCELED);
+				}
+				else {
+					complete_request(id, asset_id, RequestStatus::SUCCEEDED);
+				}
+			}
+		}
+	}
+
+	bool initialize(StreamingInitInfo info) {
+		assert(!is_running);
+		if (is_running) return false;
+
+		const u32 hardware_threads{ std::max(std::thread::hardware_concurrency(), (u32)2) };
+		const u32 io_thread_count{ std::max(info.io_thread_count, (u32)1) };
+		const u32 worker_thread_count{ info.worker_thread_count ? info.worker_thread_count : (hardware_threads > io_thread_count + 1 ? hardware_threads - io_thread_count - 1 : 1) };
+
+		is_running = true;
+
+		io_threads.reserve(io_thread_count);
+		worker_threads.reserve(worker_thread_count);
+
+		for (u32 i{ 0 }; i < io_thread_count; ++i) {
+			io_threads.emplace_back(io_thread_proc);
+		}
+
+		for (u32 i{ 0 }; i < worker_thread_count; ++i) {
+			worker_threads.emplace_back(worker_thread_proc);
+		}
+
+		return true;
+	}
+
+	void shutdown() {
+		{
+			std::lock_guard lock{ request_mutex };
+			if (!is_running) return;
+			is_running = false;
+		}
+
+		io_cv.notify_all();
+		processing_cv.notify_all();
+
+		for (auto& thread : io_threads) thread.join();
+		for (auto& thread : worker_threads) thread.join();
+
+		io_threads.clear();
+		worker_threads.clear();
+
+		// The owners of range requests wait for their callback, so the ones that were still queued are failed.
+		// NOTE: the threads are joined, so nothing else touches the requests anymore.
+		for (const auto& pair : requests) {
+			if (pair.second.callback) pair.second.callback(nullptr, 0, pair.second.user_data);
+		}
+
+		requests.clear();
+		io_queue = {};
+		processing_queue = {};
+
+		// Destroy resources that were loaded but never collected by the caller.
+		std::lock_guard lock{ completed_mutex };
+
+		for (const auto& completed : completed_requests) {
+			if (completed.status == RequestStatus::SUCCEEDED) {
+				content::destroy_resource(completed.asset_id, completed.type);
+			}
+		}
+
+		completed_requests.clear();
+	}
+
+	request_id load_asset(const char* path, AssetType::Type type, u32 priority) {
+		assert(path && is_running);
+		assert(type == AssetType::MESH || type == AssetType::TEXTURE);
+
+		if (!path || !is_running || !(type == AssetType::MESH || type == AssetType::TEXTURE)) return request_id{ id::invalid_id };
+
+		std::lock_guard lock{ request_mutex };
+
+		const id::id_type id{ next_request_id };
+		next_request_id = (next_request_id + 1) & id::internal::index_mask;
+
+		assert(requests.find(id) == requests.end());
+
+		Request& request{ requests[id] };
+		request.path = path;
+		request.type = type;
+		request.priority = priority;
+
+		push_to_queue(io_queue, id, request);
+		io_cv.notify_one();
+
+		return request_id{ id };
+	}
+
+	bool read_file_range(const char* path, u64 offset, u64 size, range_callback callback, u64 user_data, u32 priority) {
+		assert(path && size && callback);
+
+		std::lock_guard lock{ request_mutex };
+
+		if (!path || !size || !callback || !is_running) return false;
+
+		const id::id_type id{ next_request_id };
+		next_request_id = (next_request_id + 1) & id::internal::index_mask;
+
+		assert(requests.find(id) == requests.end());
+
+		Request& request{ requests[id] };
+		request.path = path;
+		request.callback = callback;
+		request.user_data = user_data;
+		request.offset = offset;
+		request.size = size;
+		request.priority = priority;
+
+		push_to_queue(io_queue, id, request);
+		io_cv.notify_one();
+
+		return true;
+	}
+
+	bool set_priority(request_id id, u32 priority) {
+		std::lock_guard lock{ request_mutex };
+
+		auto pair = requests.find(id);
+
+		if (pair == requests.end()) return false;
+
+		Request& request{ pair->second };
+
+		if (request.priority == priority) return true;
+
+		request.priority = priority;
+
+		if (request.stage == RequestStage::QUEUED_FOR_IO) {
+			++request.version;
+			push_to_queue(io_queue, id, request);
+			return true;
+		}
+
+		if (request.stage == RequestStage::QUEUED_FOR_PROCESSING) {
+			++request.version;
+			push_to_queue(processing_queue, id, request);
+			return true;
+		}
+
+		// The request is already being read or processed.
+		return false;
+	}
+
+	bool cancel(request_id id) {
+		std::lock_guard lock{ request_mutex };
+
+		auto pair = requests.find(id);
+
+		if (pair == requests.end()) return false;
+
+		Request& request{ pair->second };
+
+		if (request.stage == RequestStage::QUEUED_FOR_IO || request.stage == RequestStage::QUEUED_FOR_PROCESSING) {
+			complete_request(id, id::invalid_id, RequestStatus::CANCELED);
+		}
+		else {
+			// The thread that owns the request will finish it.
+			request.cancel_requested = true;
+		}
+
+		return true;
+	}
+
+	u32 get_completed_requests(util::vector<CompletedRequest>& completed) {
+		assert(completed.empty());
+
+		std::lock_guard lock{ completed_mutex };
+		completed.swap(completed_requests);
+
+		return (u32)completed.size();
+	}
+
+	u32 in_flight_request_count() {
+		std::lock_guard lock{ request_mutex };
+		return (u32)requests.size();
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "CommonHeaders.h"
+#include "ContentToEngine.h"
+
+namespace lightning::content::streaming {
+
+	DEFINE_TYPED_ID(request_id);
+
+	struct RequestPriority {
+		enum Priority : u32 {
+			LOW = 0,
+			NORMAL = 100,
+			HIGH = 200,
+			CRITICAL = 300,
+		};
+	};
+
+	struct RequestStatus {
+		enum Status : u32 {
+			SUCCEEDED = 0,
+			FAILED,
+			CANCELED,
+		};
+	};
+
+	struct CompletedRequest {
+		request_id id{ id::invalid_id };
+		id::id_type asset_id{ id::invalid_id };
+		AssetType::Type type{ AssetType::UNKNOWN };
+		RequestStatus::Status status{ RequestStatus::FAILED };
+	};
+
+	// Called on a worker thread with the data that was read, or with nullptr if the file couldn't be read.
+	// Requests that are still queued when the service shuts down are called with nullptr from shutdown().
+	// The data is freed when the callback returns.
+	using range_callback = void(*)(const u8* const data, u64 size, u64 user_data);
+
+	struct StreamingInitInfo {
+		u32 io_thread_count{ 2 };
+		u32 worker_thread_count{ 0 }; // 0: use the available hardware threads
+	};
+
+	bool initialize(StreamingInitInfo info = {});
+	void shutdown();
+
+	// Queues a file to be read on an I/O thread and turned into an engine resource on a worker thread.
+	// Higher priority requests are serviced first. Only the coarsest LOD of a mesh is read, the finer LODs are streamed
+	// in when they are needed.
+	[[nodiscard]] request_id load_asset(const char* path, AssetType::Type type, u32 priority = RequestPriority::NORMAL);
+
+	// Queues a part of a file to be read and passed to the callback. These requests aren't returned by get_completed_requests().
+	bool read_file_range(const char* path, u64 offset, u64 size, range_callback callback, u64 user_data, u32 priority = RequestPriority::NORMAL);
+	bool set_priority(request_id id, u32 priority);
+	bool cancel(request_id id);
+
+	// Call this from the main thread (once per frame) to collect the finished requests.
+	u32 get_completed_requests(util::vector<CompletedRequest>& completed);
+	[[nodiscard]] u32 in_flight_request_count();
+}
@@ -1,8 +1,11 @@
 #include "ContentLoader.h"
+#include "AssetArchive.h"
+#include "AssetStreaming.h"
 #include "Components/Entity.h"
 #include "Components/Transform.h"
 #include "Components/Script.h"
 #include "Graphics/Renderer.h"
+#include "Utilities/Threading.h"
 
 #if !defined(SHIPPING) && defined(_WIN64)
 
@@ -41,62 +44,173 @@ namespace lightning::content {
 			}
 		}
 
+		// NOTE: this used to be an unused entity type field, so files written by older editors have no flags set.
+		struct EntityFlags {
+			enum Flags : u32 {
+				QUATERNION_ROTATION = 0x01, // transform rotation is stored as a quaternion instead of Euler angles
+			};
+		};
+
+		// Location of an entity's components in game.bin, filled in by a single validating pass over the file.
+		struct EntityRecord {
+			const u8* transform;
+			const u8* script_name;
+			u32 script_name_length;
+			u32 flags;
+		};
+
+		constexpr u32 euler_transform_size{ sizeof(f32) * (3 + 3 + 3) };
+		constexpr u32 quaternion_transform_size{ sizeof(f32) * (3 + 4 + 3) };
+		constexpr u32 max_script_name_length{ 255 };
+		constexpr u32 entities_per_task{ 1024 };
+		constexpr const char* game_archive_path{ "game.pak" };
+
 		util::vector<game_entity::Entity> entities;
-		transform::InitInfo transform_info{};
-		script::InitInfo script_info{}; 
+		// NOTE: only opened and closed by load_game() and unload_game(), so reading it doesn't need a lock.
+		archive::archive_id game_archive{ id::invalid_id };
+
+		[[nodiscard]] bool read_u32(const u8*& at, const u8* const end, u32& value) {
+			if (end - at < (s64)sizeof(u32)) return false;
+			memcpy(&value, at, sizeof(u32));
+			at += sizeof(u32);
+			return true;
+		}
+
+		bool index_game_data(const u8* const data, u64 size, util::vector<EntityRecord>& records) {
+			const u8* at{ data };
+			const u8* const end{ data + size };
+			u32 entity_count{ 0 };
+
+			if (!read_u32(at, end, entity_count) || !entity_count) return false;
+
+			records.resize(entity_count);
+
+			for (auto& record : records) {
+				record = {};
+				u32 component_count{ 0 };
+
+				if (!read_u32(at, end, record.flags) || !read_u32(at, end, component_count) || !component_count) return false;
+
+				for (u32 i{ 0 }; i < component_count; ++i) {
+					u32 component_type{ ComponentType::count };
+					if (!read_u32(at, end, component_type)) return false;
 
-		bool read_transform(const u8*& data, game_entity::EntityInfo& info) {
+					switch (component_type) {
+						case ComponentType::TRANSFORM: {
+							const u32 transform_size{ (record.flags & EntityFlags::QUATERNION_ROTATION) ? quaternion_transform_size : euler_transform_size };
+							if (record.transform || end - at < (s64)transform_size) return false;
+							record.transform = at;
+							at += transform_size;
+						} break;
+						case ComponentType::SCRIPT: {
+							if (record.script_name || !read_u32(at, end, record.script_name_length)) return false;
+							if (!record.script_name_length || record.script_name_length > max_script_name_length) return false;
+							if (end - at < (s64)record.script_name_length) return false;
+							record.script_name = at;
+							at += record.script_name_length;
+						} break;
+						default:
+							// NOTE: geometry components can't be loaded from game.bin yet.
+							return false;
+					}
+				}
+
+				if (!record.transform) return false;
+			}
+
+			return at == end;
+		}
+
+		// Converts 4 sets of Euler angles (pitch, yaw, roll) to quaternions with one sin/cos evaluation per angle.
+		// Same result as XMQuaternionRotationRollPitchYawFromVector.
+		void euler_to_quaternion_x4(const math::v3* const angles, math::v4* const quaternions) {
 			using namespace DirectX;
-			
-			f32 rotation[3];
+			XMVECTOR sp, cp, sy, cy, sr, cr;
 
-			assert(!info.transform);
-			memcpy(&transform_info.position[0], data, sizeof(transform_info.position));
-			data += sizeof(transform_info.position);
-			memcpy(&rotation[0], data, sizeof(rotation));
-			data += sizeof(rotation);
-			memcpy(&transform_info.scale[0], data, sizeof(transform_info.scale));
-			data += sizeof(transform_info.scale);
+			XMVectorSinCos(&sp, &cp, XMVectorScale(XMVectorSet(angles[0].x, angles[1].x, angles[2].x, angles[3].x), .5f));
+			XMVectorSinCos(&sy, &cy, XMVectorScale(XMVectorSet(angles[0].y, angles[1].y, angles[2].y, angles[3].y), .5f));
+			XMVectorSinCos(&sr, &cr, XMVectorScale(XMVectorSet(angles[0].z, angles[1].z, angles[2].z, angles[3].z), .5f));
 
-			XMFLOAT3A rot{ &rotation[0] };
-			XMVECTOR quat{ XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3A(&rot)) };
-			XMFLOAT4A rot_quat{};
-			XMStoreFloat4A(&rot_quat, quat);
-			memcpy(&transform_info.rotation[0], &rot_quat.x, sizeof(transform_info.rotation));
+			const XMVECTOR cp_cy{ XMVectorMultiply(cp, cy) };
+			const XMVECTOR sp_sy{ XMVectorMultiply(sp, sy) };
+			const XMVECTOR sp_cy{ XMVectorMultiply(sp, cy) };
+			const XMVECTOR cp_sy{ XMVectorMultiply(cp, sy) };
 
-			info.transform = &transform_info;
+			XMMATRIX q{
+				XMVectorMultiplyAdd(sp_cy, cr, XMVectorMultiply(cp_sy, sr)),
+				XMVectorNegativeMultiplySubtract(sp_cy, sr, XMVectorMultiply(cp_sy, cr)),
+				XMVectorNegativeMultiplySubtract(sp_sy, cr, XMVectorMultiply(cp_cy, sr)),
+				XMVectorMultiplyAdd(cp_cy, cr, XMVectorMultiply(sp_sy, sr)),
+			};
 
-			return true;
+			q = XMMatrixTranspose(q);
+
+			for (u32 i{ 0 }; i < 4; ++i) {
+				XMStoreFloat4(&quaternions[i], q.r[i]);
+			}
 		}
 
-		bool read_script(const u8*& data, game_entity::EntityInfo& info) {
-			assert(!info.script);
-			const u32 name_length{ *data };
-			data += sizeof(u32);
-			if (!name_length) return false;
-			assert(name_length < 256);
-			char script_name[256];
-			memcpy(&script_name[0], data, name_length);
-			data += name_length;
-			script_name[name_length] = 0;
-			script_info.script_creator = script::detail::get_script_creator_from_engine(script::detail::string_hash()(script_name));
-
-			info.script = &script_info;
-
-			return script_info.script_creator != nullptr;
+		void decode_transforms(const EntityRecord* const records, transform::InitInfo* const transforms, u32 count) {
+			// Entities with Euler angles are gathered in groups of 4 for the SIMD conversion.
+			u32 batch[4]{};
+			math::v3 angles[4]{};
+			math::v4 quaternions[4]{};
+			u32 batch_size{ 0 };
+
+			auto flush = [&]() {
+				for (u32 i{ batch_size }; i < 4; ++i) angles[i] = {};
+				euler_to_quaternion_x4(&angles[0], &quaternions[0]);
+
+				for (u32 i{ 0 }; i < batch_size; ++i) {
+					memcpy(&transforms[batch[i]].rotation[0], &quaternions[i], sizeof(transform::InitInfo::rotation));
+				}
+
+				batch_size = 0;
+			};
+
+			for (u32 i{ 0 }; i < count; ++i) {
+				const u8* at{ records[i].transform };
+				transform::InitInfo& info{ transforms[i] };
+
+				memcpy(&info.position[0], at, sizeof(info.position));
+				at += sizeof(info.position);
+
+				if (records[i].flags & EntityFlags::QUATERNION_ROTATION) {
+					memcpy(&info.rotation[0], at, sizeof(info.rotation));
+					at += sizeof(info.rotation);
+				}
+				else {
+					memcpy(&angles[batch_size], at, sizeof(math::v3));
+					at += sizeof(math::v3);
+					batch[batch_size++] = i;
+
+					if (batch_size == 4) flush();
+				}
+
+				memcpy(&info.scale[0], at, sizeof(info.scale));
+			}
+
+			if (batch_size) flush();
 		}
 
-		bool read_geometry(const u8*&, game_entity::EntityInfo&) { return false; }
+		[[nodiscard]] bool decode_script(const EntityRecord& record, script::InitInfo& info) {
+			if (!record.script_name) return true;
 
-		using component_reader = bool(*)(const u8*&, game_entity::EntityInfo&);
-		component_reader component_readers[] {
-			read_transform,
-			read_script,
-			read_geometry
-		};
-		static_assert(_countof(component_readers) == ComponentType::count);
+			char script_name[max_script_name_length + 1];
+			memcpy(&script_name[0], record.script_name, record.script_name_length);
+			script_name[record.script_name_length] = 0;
+			info.script_creator = script::detail::get_script_creator_from_engine(script::detail::string_hash()(script_name));
+
+			return info.script_creator != nullptr;
+		}
 
+		// Files packed into game.pak are read from the archive, anything else is read from disk.
 		bool read_file(std::filesystem::path path, std::unique_ptr<u8[]>& data, u64& size) {
+			archive::AssetView view{};
+			if (id::is_valid(game_archive) && archive::find_asset(game_archive, path.lexically_normal().string().c_str(), view)) {
+				return archive::read_asset(view, data, size);
+			}
+
 			if (!std::filesystem::exists(path)) return false;
 			size = std::filesystem::file_size(path);
 			assert(size);
@@ -116,46 +230,69 @@ namespace lightning::content {
 	}
 
 	bool load_game() {
+		// NOTE: the streaming service is started before any entity is created, so that scripts can request their
+		//       meshes and textures as soon as they are constructed. It's stopped again in unload_game().
+		if (!streaming::initialize()) return false;
+
+		assert(!id::is_valid(game_archive));
+		if (std::filesystem::exists(game_archive_path)) {
+			game_archive = archive::open_archive(game_archive_path);
+			if (!id::is_valid(game_archive)) return false;
+		}
+
 		std::unique_ptr<u8[]> game_data{};
 		u64 size{ 0 };
 		if (!read_file("game.bin", game_data, size)) return false;
 		assert(game_data.get());
-		const u8* at{ game_data.get() };
-		constexpr u32 su32{ sizeof(u32) };
-		const u32 num_entities{ *at };
-		
-		at += su32;
-		if (!num_entities) return false;
-		for (u32 entity_index{ 0 }; entity_index < num_entities; ++entity_index) {
-			game_entity::EntityInfo info{};
-			//const u32 entity_type{ *at };
-			at += su32;
-			const u32 num_components{ *at };
-			at += su32;
-			if (!num_components) return false;
-
-			for (u32 component_index{ 0 }; component_index < num_components; ++component_index) {
-				u32 component_type{ *at };
-				at += su32;
-
-				assert(component_type < ComponentType::count);
-
-				if (!component_readers[component_type](at, info)) return false;
+
+		util::vector<EntityRecord> records;
+		if (!index_game_data(game_data.get(), size, records)) return false;
+
+		const u32 entity_count{ (u32)records.size() };
+		util::vector<transform::InitInfo> transforms(entity_count);
+		util::vector<script::InitInfo> scripts(entity_count);
+		util::vector<game_entity::EntityInfo> infos(entity_count);
+		std::atomic<bool> result{ true };
+
+		util::parallel_for((entity_count + entities_per_task - 1) / entities_per_task, [&](u32 task) {
+			const u32 first{ task * entities_per_task };
+			const u32 count{ std::min(entities_per_task, entity_count - first) };
+
+			decode_transforms(&records[first], &transforms[first], count);
+
+			for (u32 i{ first }; i < first + count; ++i) {
+				if (!decode_script(records[i], scripts[i])) result = false;
+
+				infos[i].transform = &transforms[i];
+				infos[i].script = records[i].script_name ? &scripts[i] : nullptr;
 			}
-			assert(info.transform);
+		});
 
-			game_entity::Entity entity{ game_entity::create(info) };
-			if (!entity.is_valid()) return false;
-			entities.emplace_back(entity);
-		}
-		assert(at == game_data.get() + size);
-		return true;
+		if (!result) return false;
+
+		const u64 first_entity{ entities.size() };
+		entities.resize(first_entity + entity_count);
+
+		const u32 created_count{ game_entity::create(infos.data(), entity_count, &entities[first_entity]) };
+		entities.resize(first_entity + created_count);
+
+		return created_count == entity_count;
 	}
 
 	void unload_game() {
+		// Stop streaming first, so that no request completes for an entity that is being removed.
+		streaming::shutdown();
+
 		for (auto entity : entities) {
 			game_entity::remove(entity.get_id());
 		}
+
+		entities.clear();
+
+		if (id::is_valid(game_archive)) {
+			archive::close_archive(game_archive);
+			game_archive = archive::archive_id{ id::invalid_id };
+		}
 	}
 
 	bool load_engine_shaders(std::unique_ptr<u8[]>& shaders, u64& size) {
@@ -1,19 +1,83 @@
 #include "ContentToEngine.h"
 #include "Graphics/Renderer.h"
 #include "Utilities/IOStream.h"
+#include "AssetStreaming.h"
+
+#include <algorithm>
+#include <condition_variable>
 
 namespace lightning::content {
 	namespace {
 
-		struct NoexceptMap {
-			std::unordered_map<u32, std::unique_ptr<u8[]>> map;
-			NoexceptMap() = default;
-			NoexceptMap(const NoexceptMap&) = default;
-			NoexceptMap(NoexceptMap&&) noexcept = default;
-			NoexceptMap& operator=(const NoexceptMap&) = default;
-			NoexceptMap& operator=(NoexceptMap&&) noexcept = default;
+		// A shader group is a single allocation with the following layout:
+		//
+		// u32 shader_count
+		// u32 keys[shader_count]         (sorted)
+		// u64 offsets[shader_count]      (8 byte aligned)
+		// compiled shaders               (8 byte aligned)
+		class ShaderGroupStream {
+			public:
+				DISABLE_COPY_AND_MOVE(ShaderGroupStream);
+				explicit ShaderGroupStream(const u8* const buffer) {
+					assert(buffer);
+					_shader_count = *((const u32*)buffer);
+					_keys = (const u32*)(&buffer[sizeof(u32)]);
+					_offsets = (const u64*)(&buffer[keys_size(_shader_count)]);
+					_buffer = buffer;
+				}
+
+				[[nodiscard]] constexpr static u64 keys_size(u32 shader_count) {
+					return math::align_size_up<sizeof(u64)>(sizeof(u32) * (1 + (u64)shader_count));
+				}
+
+				[[nodiscard]] constexpr static u64 header_size(u32 shader_count) {
+					return keys_size(shader_count) + sizeof(u64) * shader_count;
+				}
+
+				[[nodiscard]] compiled_shader_ptr find(u32 key) const {
+					const u32* const end{ _keys + _shader_count };
+					const u32* const at{ std::lower_bound(_keys, end, key) };
+
+					if (at == end || *at != key) return nullptr;
+
+					return (compiled_shader_ptr)&_buffer[_offsets[at - _keys]];
+				}
+
+			private:
+				const u8* _buffer;
+				const u32* _keys;
+				const u64* _offsets;
+				u32 _shader_count;
+		};
+
+		struct LodResidency {
+			enum State : u32 {
+				EVICTED = 0,
+				LOADING,
+				UPLOADING,
+				RESIDENT,
+				UNAVAILABLE,
+			};
+		};
+
+		// get_lod_offsets() reads the residency without locking. Everything else is only used with geometry_mutex
+		// locked.
+		struct LodState {
+			std::atomic<u32> residency{ LodResidency::EVICTED };
+			u32 last_used_frame{ 0 };
+			u32 section_offset{ 0 };
+			u32 section_size{ 0 };
 		};
 
+		// A geometry hierarchy is a single allocation with the following layout:
+		//
+		// u32 lod_count
+		// u32 stream_key                      (u32_invalid_id if the LODs aren't streamed)
+		// f32 thresholds[lod_count]
+		// LodOffset lod_offsets[lod_count]
+		// LodState lod_states[lod_count]
+		// id::id_type gpu_ids[submesh_count]
+		// char source_path[]                  (only if the LODs are streamed)
 		class GeometryHierarchyStream {
 			public:
 				DISABLE_COPY_AND_MOVE(GeometryHierarchyStream);
@@ -21,9 +85,16 @@ namespace lightning::content {
 					assert(buffer && lods);
 					if (lods != u32_invalid_id) *((u32*)buffer) = lods;
 					_lod_count = *((u32*)buffer);
-					_thresholds = (f32*)(&buffer[sizeof(u32)]);
+					_stream_key = (u32*)(&buffer[sizeof(u32)]);
+					_thresholds = (f32*)(&buffer[2 * sizeof(u32)]);
 					_lod_offsets = (LodOffset*)(&_thresholds[_lod_count]);
-					_gpu_ids = (id::id_type*)(&_lod_offsets[_lod_count]);
+					_lod_states = (LodState*)(&_lod_offsets[_lod_count]);
+					_gpu_ids = (id::id_type*)(&_lod_states[_lod_count]);
+				}
+
+				[[nodiscard]] constexpr static u64 buffer_size(u32 lod_count, u32 submesh_count, u64 path_length) {
+					return 2 * sizeof(u32) + (sizeof(f32) + sizeof(LodOffset) + sizeof(LodState)) * lod_count +
+						sizeof(id::id_type) * submesh_count + (path_length ? path_length + 1 : 0);
 				}
 
 				constexpr void gpu_ids(u32 lod, id::id_type*& ids, u32& id_count) {
@@ -45,67 +116,302 @@ namespace lightning::content {
 				}
 
 				[[nodiscard]] constexpr u32 lod_count() const { return _lod_count; }
+				[[nodiscard]] constexpr u32& stream_key() const { return *_stream_key; }
+				[[nodiscard]] constexpr bool is_streamed() const { return *_stream_key != u32_invalid_id; }
 				[[nodiscard]] constexpr f32* thresholds() const { return _thresholds; }
 				[[nodiscard]] constexpr LodOffset* lod_offsets() const { return _lod_offsets; }
+				[[nodiscard]] constexpr LodState* lod_states() const { return _lod_states; }
 				[[nodiscard]] constexpr id::id_type* gpu_ids() const { return _gpu_ids; }
 
+				[[nodiscard]] char* source_path() const {
+					const LodOffset& last{ _lod_offsets[_lod_count - 1] };
+					return (char*)(&_gpu_ids[last.offset + last.count]);
+				}
+
 			private:
+				u32* _stream_key;
 				f32* _thresholds;
 				LodOffset* _lod_offsets;
+				LodState* _lod_states;
 				id::id_type* _gpu_ids;
 				u32 _lod_count;
 		};
 
+		// Geometry data, as it's packed by the editor:
+		//
+		// u32 lod_count
+		// u32 base_size                       size of the header and the coarsest LOD, the part that is always loaded
+		// GeometryLodHeader lods[lod_count]   finest LOD first
+		// submesh headers                     for every LOD, finest LOD first
+		// LOD sections                        coarsest LOD first, each starts at a multiple of geometry_section_alignment
+		//
+		// A LOD section holds the buffers of the LOD's submeshes, in the order of their headers.
+		struct GeometryLodHeader {
+			f32 threshold;
+			u32 submesh_count;
+			u32 section_offset;
+			u32 section_size;
+		};
+
+		constexpr u32 geometry_section_alignment{ 4096 };
+
+		[[nodiscard]] const GeometryLodHeader* get_lod_headers(const u8* const data) {
+			return (const GeometryLodHeader*)&data[2 * sizeof(u32)];
+		}
+
+		// Slots can be read without locking while another thread adds or removes items. Pages are never moved or
+		// freed before shutdown, so a reader always sees a valid slot. Writers have to be serialized by the caller.
+		template<typename T> class SlotTable {
+			static_assert(std::is_pointer_v<T>);
+
+			public:
+				SlotTable() = default;
+				DISABLE_COPY_AND_MOVE(SlotTable);
+
+				~SlotTable() {
+					for (auto& page : _pages) delete[] page.load(std::memory_order_relaxed);
+				}
+
+				[[nodiscard]] u32 add(T value) {
+					u32 id{ u32_invalid_id };
+
+					if (!_free_slots.empty()) {
+						id = _free_slots.back();
+						_free_slots.resize(_free_slots.size() - 1);
+					}
+					else {
+						id = _count++;
+						assert(id < page_size * max_pages);
+						std::atomic<std::atomic<T>*>& page{ _pages[id >> page_bits] };
+
+						if (!page.load(std::memory_order_relaxed)) {
+							page.store(new std::atomic<T>[page_size]{}, std::memory_order_release);
+						}
+					}
+
+					slot(id).store(value, std::memory_order_release);
+					return id;
+				}
+
+				T remove(u32 id) {
+					const T value{ slot(id).exchange(nullptr, std::memory_order_acq_rel) };
+					assert(value);
+					_free_slots.emplace_back(id);
+					return value;
+				}
+
+				[[nodiscard]] T operator[](u32 id) const {
+					const T value{ slot(id).load(std::memory_order_acquire) };
+					assert(value);
+					return value;
+				}
+
+			private:
+				[[nodiscard]] std::atomic<T>& slot(u32 id) const {
+					assert((id >> page_bits) < max_pages);
+					std::atomic<T>* const page{ _pages[id >> page_bits].load(std::memory_order_acquire) };
+					assert(page);
+					return page[id & (page_size - 1)];
+				}
+
+				constexpr static u32 page_bits{ 10 };
+				constexpr static u32 page_size{ 1 << page_bits };
+				constexpr static u32 max_pages{ 1024 };
+
+				std::atomic<std::atomic<T>*> _pages[max_pages]{};
+				util::vector<u32> _free_slots;
+				u32 _count{ 0 };
+		};
+
+		// Epoch based reclamation for buffers that are read without locking. Readers register in the current epoch
+		// for the duration of a read. Writers retire buffers instead of freeing them. A retired buffer is only freed
+		// once every reader that entered before (or during) the epoch it was retired in has left.
+		class EpochManager {
+			public:
+				class ReadGuard {
+					public:
+						explicit ReadGuard(EpochManager& manager) : _manager{ manager }, _epoch{ manager.enter() } {}
+						~ReadGuard() { _manager.leave(_epoch); }
+						DISABLE_COPY_AND_MOVE(ReadGuard);
+
+					private:
+						EpochManager& _manager;
+						const u64 _epoch;
+				};
+
+				EpochManager() = default;
+				DISABLE_COPY_AND_MOVE(EpochManager);
+
+				~EpochManager() {
+					for (const auto& retired : _retired) free(retired.pointer);
+				}
+
+				// NOTE: retire() and reclaim() must be called with the writers' mutex locked.
+				void retire(void* const pointer) {
+					assert(pointer);
+					_retired.emplace_back(RetiredBuffer{ pointer, _epoch.load(std::memory_order_relaxed) });
+				}
+
+				// ReadGuard calls these. They're public for readers that can't keep a guard on the stack.
+				[[nodiscard]] u64 enter() {
+					while (true) {
+						const u64 epoch{ _epoch.load(std::memory_order_acquire) };
+						_readers[epoch & 1].fetch_add(1, std::memory_order_seq_cst);
+
+						// The epoch may have moved on between reading it and registering. Register again if it did,
+						// otherwise a writer could already be waiting on the other counter.
+						if (_epoch.load(std::memory_order_seq_cst) == epoch) return epoch;
+
+						_readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+					}
+				}
+
+				void leave(u64 epoch) {
+					_readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+				}
+
+				void reclaim() {
+					// Two steps, so buffers retired in the current epoch are freed right away when there are no readers.
+					for (u32 i{ 0 }; i < 2 && !_retired.empty(); ++i) {
+						const u64 epoch{ _epoch.load(std::memory_order_relaxed) };
+
+						// Readers that entered in the previous epoch still hold on to buffers retired before now.
+						if (_readers[(epoch - 1) & 1].load(std::memory_order_seq_cst)) return;
+
+						u32 count{ 0 };
+
+						for (const auto& retired : _retired) {
+							if (retired.epoch < epoch) free(retired.pointer);
+							else _retired[count++] = retired;
+						}
+
+						_retired.resize(count);
+						_epoch.store(epoch + 1, std::memory_order_seq_cst);
+					}
+				}
+
+			private:
+				struct RetiredBuffer {
+					void* pointer;
+					u64 epoch;
+				};
+
+				std::atomic<u64> _epoch{ 1 };
+				std::atomic<u32> _readers[2]{};
+				util::vector<RetiredBuffer> _retired;
+		};
+
 		constexpr uintptr_t single_mesh_marker{ (uintptr_t)0x01 };
-		util::free_list<u8*> geometry_hierarchies;
+		SlotTable<u8*> geometry_hierarchies;
+		EpochManager geometry_epochs;
 		std::mutex geometry_mutex;
 
-		util::free_list<NoexceptMap> shader_groups;
+		// Hierarchies that stream their LODs from a file, by stream key.
+		std::unordered_map<u32, id::id_type> streamed_geometries;
+		u32 next_stream_key{ 0 };
+		u32 residency_frame{ 0 };
+
+		// Signaled when a LOD section has been uploaded. Streamed hierarchies aren't destroyed while one of their LODs is
+		// being uploaded.
+		std::condition_variable lod_upload_cv;
+
+		// LODs that get_lod_offsets() drew or would have drawn, as (stream key << 32) | lod. They are marked used, and
+		// read if they aren't resident, by update_geometry_residency().
+		util::vector<u64> lod_requests;
+		std::mutex lod_request_mutex;
+
+		SlotTable<u8*> shader_groups;
+		EpochManager shader_epochs;
 		std::mutex shader_mutex;
 
-		u32 get_geometry_hierarchy_buffer_size(const void* const data) {
-			assert(data);
-			util::BlobStreamReader blob{ (const u8*)data };
-			const u32 lod_count{ blob.read<u32>() };
-			assert(lod_count);
+		struct CachedResource {
+			util::vector<u8> key;
+			u64 hash;
+			u32 ref_count;
+		};
 
-			u32 size{ sizeof(u32) + (sizeof(f32) + sizeof(LodOffset)) * lod_count };
+		// Resources are deduplicated by their source data. Every create_resource() call for the same data returns the same
+		// id and adds a reference. The resource is only destroyed when the last reference is released.
+		// The key bytes are kept so that a hash collision can't hand out the wrong resource. An empty key means that the
+		// resource can't be looked up anymore, but it's still reference counted.
+		std::unordered_map<id::id_type, CachedResource> cached_resources[AssetType::count];
+		std::unordered_map<u64, id::id_type> resource_lookup[AssetType::count];
+		ResourceCacheStats resource_cache_stats{};
+		std::mutex resource_cache_mutex;
+
+		[[nodiscard]] u32 get_submesh_count(const void* const data) {
+			const u32 lod_count{ *(const u32*)data };
+			const GeometryLodHeader* const lods{ get_lod_headers((const u8*)data) };
+			u32 submesh_count{ 0 };
 
 			for (u32 lod_idx{ 0 }; lod_idx < lod_count; ++lod_idx) {
-				blob.skip(sizeof(f32));
-				size += sizeof(id::id_type) * blob.read<u32>();
-				blob.skip(blob.read<u32>());
+				submesh_count += lods[lod_idx].submesh_count;
 			}
 
-			return size;
+			return submesh_count;
+		}
+
+		void upload_lod_section(const GeometryHierarchyStream& stream, u32 lod, const u8* const data, [[maybe_unused]] u64 size) {
+			const LodOffset lod_offset{ stream.lod_offsets()[lod] };
+			const u8* at{ data };
+
+			for (u32 i{ 0 }; i < lod_offset.count; ++i) {
+				graphics::upload_submesh(stream.gpu_ids()[lod_offset.offset + i], at);
+			}
+
+			assert((u64)(at - data) == size);
 		}
 
-		id::id_type create_mesh_hierarchy(const void* const data) {
+		// Only the coarsest LOD is uploaded when the geometry has a source file, the other LODs are read from the file
+		// when they are needed. The data then only has to contain the header and the coarsest LOD.
+		id::id_type create_mesh_hierarchy(const void* const data, const char* const source_path) {
 			assert(data);
-			const u32 size{ get_geometry_hierarchy_buffer_size(data) };
+			const u8* const geometry{ (const u8*)data };
+			const u32 lod_count{ *(const u32*)geometry };
+			assert(lod_count);
+			const GeometryLodHeader* const lods{ get_lod_headers(geometry) };
+			const u32 submesh_count{ get_submesh_count(data) };
+			const u64 path_length{ source_path ? strlen(source_path) : 0 };
+			const bool is_streamed{ path_length && lod_count > 1 };
+
+			const u64 size{ GeometryHierarchyStream::buffer_size(lod_count, submesh_count, is_streamed ? path_length : 0) };
 			u8* const hierarchy_buffer{ (u8* const)malloc(size) };
+			assert(hierarchy_buffer);
 
-			util::BlobStreamReader blob{ (const u8*)data };
-			const u32 lod_count{ blob.read<u32>() };
-			assert(lod_count);
 			GeometryHierarchyStream stream{ hierarchy_buffer, lod_count };
+			stream.stream_key() = u32_invalid_id;
+
+			// Submesh headers follow the LOD headers. They are added right away, so render items can be created for every LOD.
+			const u8* at{ (const u8*)&lods[lod_count] };
 			u32 submesh_index{ 0 };
 			id::id_type* const gpu_ids{ stream.gpu_ids() };
 
 			for (u32 lod_idx{ 0 }; lod_idx < lod_count; ++lod_idx) {
-				stream.thresholds()[lod_idx] = blob.read<f32>();
-				const u32 id_count{ blob.read<u32>() };
-				assert(id_count < (1 << 16));
-				stream.lod_offsets()[lod_idx] = { (u16)submesh_index, (u16)id_count };
-				blob.skip(sizeof(u32));
-				for (u32 id_idx{ 0 }; id_idx < id_count; ++id_idx) {
-					const u8* at{ blob.position() };
+				const GeometryLodHeader& lod{ lods[lod_idx] };
+				assert(lod.submesh_count && lod.submesh_count < (1 << 16));
+				assert(!(lod.section_offset % geometry_section_alignment));
+
+				stream.thresholds()[lod_idx] = lod.threshold;
+				stream.lod_offsets()[lod_idx] = { (u16)submesh_index, (u16)lod.submesh_count };
+
+				LodState* const state{ new (&stream.lod_states()[lod_idx]) LodState{} };
+				state->section_offset = lod.section_offset;
+				state->section_size = lod.section_size;
+
+				for (u32 i{ 0 }; i < lod.submesh_count; ++i) {
 					gpu_ids[submesh_index++] = graphics::add_submesh(at);
-					blob.skip((u32)(at - blob.position()));
 					assert(submesh_index < (1 << 16));
 				}
 			}
 
+			assert(submesh_index == submesh_count);
+
+			for (u32 lod_idx{ is_streamed ? lod_count - 1 : 0 }; lod_idx < lod_count; ++lod_idx) {
+				LodState& state{ stream.lod_states()[lod_idx] };
+				upload_lod_section(stream, lod_idx, &geometry[state.section_offset], state.section_size);
+				state.residency.store(LodResidency::RESIDENT, std::memory_order_relaxed);
+			}
+
 			assert([&]() {
 				f32 previous_threshold{ stream.thresholds()[0] };
 				for (u32 i{ 1 }; i < lod_count; ++i) {
@@ -115,16 +421,28 @@ namespace lightning::content {
 				return true;
 			}());
 
+			if (is_streamed) memcpy(stream.source_path(), source_path, path_length + 1);
+
 			std::lock_guard lock{ geometry_mutex };
-			return geometry_hierarchies.add(hierarchy_buffer);
+
+			if (!is_streamed) return geometry_hierarchies.add(hierarchy_buffer);
+
+			stream.stream_key() = next_stream_key++;
+			const id::id_type id{ geometry_hierarchies.add(hierarchy_buffer) };
+			assert(streamed_geometries.find(stream.stream_key()) == streamed_geometries.end());
+			streamed_geometries[stream.stream_key()] = id;
+
+			return id;
 		}
 
 		id::id_type create_single_submesh(const void* const data) {
 			assert(data);
-			util::BlobStreamReader blob{ (const u8*)data };
-			blob.skip(sizeof(u32) + sizeof(f32) + sizeof(u32) + sizeof(u32));
-			const u8* at{ blob.position() };
+			const u8* const geometry{ (const u8*)data };
+			const GeometryLodHeader* const lods{ get_lod_headers(geometry) };
+			const u8* at{ (const u8*)&lods[1] };
 			const id::id_type gpu_id{ graphics::add_submesh(at) };
+			at = &geometry[lods[0].section_offset];
+			graphics::upload_submesh(gpu_id, at);
 
 			static_assert(sizeof(uintptr_t) > sizeof(id::id_type));
 			constexpr u8 shift_bits{ (sizeof(uintptr_t) - sizeof(id::id_type)) << 3 };
@@ -138,13 +456,11 @@ namespace lightning::content {
 
 		bool is_single_mesh(const void* const data) {
 			assert(data);
-			util::BlobStreamReader blob{ (const u8*)data };
-			const u32 lod_count{ blob.read<u32>() };
+			const u32 lod_count{ *(const u32*)data };
 			assert(lod_count);
 			if (lod_count > 1) return false;
 
-			blob.skip(sizeof(u32));
-			const u32 submesh_count{ blob.read<u32>() };
+			const u32 submesh_count{ get_lod_headers((const u8*)data)[0].submesh_count };
 			assert(submesh_count);
 			return submesh_count == 1;
 		}
@@ -157,13 +473,21 @@ namespace lightning::content {
 			return (((uintptr_t)pointer) >> shift_bits) & (uintptr_t)id::invalid_id;
 		}
 
-		[[nodiscard]] id::id_type create_geometry_resource(const void* const data) {
+		[[nodiscard]] id::id_type create_geometry_resource(const void* const data, const char* const source_path) {
 			assert(data);
-			return is_single_mesh(data) ? create_single_submesh(data) : create_mesh_hierarchy(data);
+			return is_single_mesh(data) ? create_single_submesh(data) : create_mesh_hierarchy(data, source_path);
+		}
+
+		[[nodiscard]] bool is_uploading_lods(const GeometryHierarchyStream& stream) {
+			for (u32 lod{ 0 }; lod < stream.lod_count(); ++lod) {
+				if (stream.lod_states()[lod].residency.load(std::memory_order_relaxed) == LodResidency::UPLOADING) return true;
+			}
+
+			return false;
 		}
 
 		void destroy_geometry_resource(id::id_type id) {
-			std::lock_guard lock{ geometry_mutex };
+			std::unique_lock lock{ geometry_mutex };
 			u8* const pointer{ geometry_hierarchies[id] };
 
 			if ((uintptr_t)pointer & single_mesh_marker) {
@@ -172,6 +496,8 @@ namespace lightning::content {
 			else {
 
 				GeometryHierarchyStream stream{ pointer };
+				if (stream.is_streamed()) lod_upload_cv.wait(lock, [&]() { return !is_uploading_lods(stream); });
+
 				const u32 lod_count{ stream.lod_count() };
 				u32 id_index{ 0 };
 
@@ -181,10 +507,82 @@ namespace lightning::content {
 					}
 				}
 
-				free(pointer);
+				// NOTE: LOD sections that are still being read are dropped when they arrive.
+				if (stream.is_streamed()) streamed_geometries.erase(stream.stream_key());
+
+				// NOTE: get_lod_offsets() and get_submesh_gpu_ids() may still be reading the hierarchy.
+				geometry_epochs.retire(pointer);
 			}
 
 			geometry_hierarchies.remove(id);
+			geometry_epochs.reclaim();
+		}
+
+		// Called on a streaming worker thread when a LOD section was read. The buffers are created without holding
+		// geometry_mutex, the UPLOADING state keeps the hierarchy from being destroyed in the meantime.
+		void load_lod_section(const u8* const data, u64 size, u64 user_data) {
+			const u32 stream_key{ (u32)(user_data >> 32) };
+			const u32 lod{ (u32)user_data };
+			u8* pointer{ nullptr };
+
+			{
+				std::lock_guard lock{ geometry_mutex };
+				auto pair = streamed_geometries.find(stream_key);
+
+				if (pair == streamed_geometries.end()) return;
+
+				pointer = geometry_hierarchies[pair->second];
+				const GeometryHierarchyStream stream{ pointer };
+				assert(lod < stream.lod_count());
+				LodState& state{ stream.lod_states()[lod] };
+				assert(state.residency.load(std::memory_order_relaxed) == LodResidency::LOADING);
+
+				if (!data || size != state.section_size) {
+					state.residency.store(LodResidency::UNAVAILABLE, std::memory_order_relaxed);
+					return;
+				}
+
+				state.residency.store(LodResidency::UPLOADING, std::memory_order_relaxed);
+			}
+
+			const GeometryHierarchyStream stream{ pointer };
+			upload_lod_section(stream, lod, data, size);
+
+			{
+				// NOTE: the buffers are uploaded before the LOD is marked resident, get_lod_offsets() may pick it up right away.
+				std::lock_guard lock{ geometry_mutex };
+				stream.lod_states()[lod].residency.store(LodResidency::RESIDENT, std::memory_order_release);
+			}
+
+			lod_upload_cv.notify_all();
+		}
+
+		// Returns the finest resident LOD that isn't finer than the requested one. The coarsest LOD is never evicted, so
+		// there is always one to fall back to. Only reads the hierarchy, it's called without locking.
+		[[nodiscard]] u32 get_resident_lod(const GeometryHierarchyStream& stream, u32 lod) {
+			const LodState* const states{ stream.lod_states() };
+
+			while (states[lod].residency.load(std::memory_order_acquire) != LodResidency::RESIDENT) {
+				++lod;
+				assert(lod < stream.lod_count());
+			}
+
+			return lod;
+		}
+
+		// NOTE: geometry_mutex must be locked when calling this function.
+		void request_lod(const GeometryHierarchyStream& stream, u32 lod) {
+			LodState& state{ stream.lod_states()[lod] };
+			state.last_used_frame = residency_frame;
+
+			if (state.residency.load(std::memory_order_relaxed) != LodResidency::EVICTED) return;
+
+			state.residency.store(LodResidency::LOADING, std::memory_order_relaxed);
+			const u64 user_data{ ((u64)stream.stream_key() << 32) | lod };
+
+			if (!streaming::read_file_range(stream.source_path(), state.section_offset, state.section_size, load_lod_section, user_data)) {
+				state.residency.store(LodResidency::EVICTED, std::memory_order_relaxed);
+			}
 		}
 
 		[[nodiscard]] id::id_type create_material_resource(const void* const data) {
@@ -204,11 +602,167 @@ namespace lightning::content {
 		void destroy_texture_resource(id::id_type id) {
 			graphics::remove_texture(id);
 		}
+
+		// NOTE: streamed meshes only come with their header and coarsest LOD.
+		u64 get_mesh_data_size(const void* const data, bool is_streamed) {
+			const u32 lod_count{ *(const u32*)data };
+			assert(lod_count);
+
+			if (is_streamed) return ((const u32*)data)[1];
+
+			const GeometryLodHeader* const lods{ get_lod_headers((const u8*)data) };
+			u64 size{ 0 };
+
+			for (u32 lod_idx{ 0 }; lod_idx < lod_count; ++lod_idx) {
+				size = std::max(size, (u64)lods[lod_idx].section_offset + lods[lod_idx].section_size);
+			}
+
+			return size;
+		}
+
+		u64 get_texture_data_size(const void* const data) {
+			util::BlobStreamReader blob{ (const u8*)data };
+			blob.skip(2 * sizeof(u32));
+			u32 array_size{ blob.read<u32>() };
+			const u32 flags{ blob.read<u32>() };
+			const u32 mip_levels{ blob.read<u32>() };
+			blob.skip(sizeof(u32));
+
+			const bool is_3d{ (flags & TextureFlags::IS_VOLUME_MAP) != 0 };
+			u32 depth{ 1 };
+
+			if (is_3d) {
+				depth = array_size;
+				array_size = 1;
+			}
+
+			for (u32 i{ 0 }; i < array_size; ++i) {
+				u32 depth_per_mip{ depth };
+
+				for (u32 j{ 0 }; j < mip_levels; ++j) {
+					blob.skip(sizeof(u32));
+					const u32 slice_pitch{ blob.read<u32>() };
+					blob.skip((u64)slice_pitch * depth_per_mip);
+					depth_per_mip = std::max(depth_per_mip >> 1, (u32)1);
+				}
+			}
+
+			return blob.offset();
+		}
+
+		// Layout of a material's cache key. The texture ids come last.
+		constexpr u64 material_key_texture_ids_offset{ sizeof(graphics::MaterialSurface) + sizeof(u32) * 2 + sizeof(graphics::MaterialInitInfo::shader_ids) };
+
+		// NOTE: the texture ids are keyed by value, so materials that use the same textures are shared too.
+		//       Texture ids are reused, see forget_materials_using_texture().
+		void get_material_key(const graphics::MaterialInitInfo& info, util::vector<u8>& key) {
+			key.resize(material_key_texture_ids_offset + sizeof(id::id_type) * info.texture_count);
+			util::BlobStreamWriter blob{ key.data(), key.size() };
+			blob.write((const u8*)&info.surface, sizeof(graphics::MaterialSurface));
+			blob.write((u32)info.type);
+			blob.write(info.texture_count);
+			blob.write((const u8*)&info.shader_ids[0], sizeof(info.shader_ids));
+			if (info.texture_count) blob.write((const u8*)info.texture_ids, sizeof(id::id_type) * info.texture_count);
+		}
+
+		// NOTE: streamed meshes are also keyed by their source file, since only a part of the file is read.
+		[[nodiscard]] bool get_resource_key(const void* const data, AssetType::Type type, const char* const source_path, util::vector<u8>& key) {
+			switch (type) {
+				case AssetType::MATERIAL:
+					get_material_key(*(const graphics::MaterialInitInfo* const)data, key);
+					return true;
+				case AssetType::MESH: {
+					const u64 data_size{ get_mesh_data_size(data, source_path != nullptr) };
+					const u32 path_length{ source_path ? (u32)strlen(source_path) : 0 };
+					key.resize(sizeof(u32) + path_length + data_size);
+					util::BlobStreamWriter blob{ key.data(), key.size() };
+					blob.write(path_length);
+					if (path_length) blob.write((const u8*)source_path, path_length);
+					blob.write((const u8*)data, data_size);
+					return true;
+				}
+				case AssetType::TEXTURE:
+					key.resize(get_texture_data_size(data));
+					memcpy(key.data(), data, key.size());
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		void destroy_uncached_resource(id::id_type id, AssetType::Type type) {
+			assert(id::is_valid(id));
+
+			switch (type) {
+				case AssetType::ANIMATION:
+					break;
+				case AssetType::AUDIO:
+					break;
+				case AssetType::MATERIAL:
+					destroy_material_resource(id);
+					break;
+				case AssetType::MESH:
+					destroy_geometry_resource(id);
+					break;
+				case AssetType::SKELETON:
+					break;
+				case AssetType::TEXTURE:
+					destroy_texture_resource(id); 
+					break;
+				default:
+					assert(false);
+					break;
+			}
+		}
+
+		// NOTE: resource_cache_mutex must be locked when calling this function.
+		[[nodiscard]] id::id_type add_reference(AssetType::Type type, u64 hash, const util::vector<u8>& key) {
+			auto lookup_pair = resource_lookup[type].find(hash);
+
+			if (lookup_pair == resource_lookup[type].end()) return id::invalid_id;
+
+			CachedResource& resource{ cached_resources[type][lookup_pair->second] };
+
+			if (resource.key.size() != key.size() || memcmp(resource.key.data(), key.data(), key.size())) return id::invalid_id;
+
+			++resource.ref_count;
+			return lookup_pair->second;
+		}
+
+		// A removed texture's id will be given to another texture. Materials that reference the removed texture must not
+		// be returned for new materials that reference the new one. They stay alive until their references are released.
+		// NOTE: resource_cache_mutex must be locked when calling this function.
+		void forget_materials_using_texture(id::id_type texture_id) {
+			for (auto& [material_id, resource] : cached_resources[AssetType::MATERIAL]) {
+				if (resource.key.empty()) continue;
+
+				const u64 texture_count{ (resource.key.size() - material_key_texture_ids_offset) / sizeof(id::id_type) };
+				const id::id_type* const texture_ids{ (const id::id_type*)&resource.key[material_key_texture_ids_offset] };
+
+				if (std::find(texture_ids, texture_ids + texture_count, texture_id) == texture_ids + texture_count) continue;
+
+				resource_lookup[AssetType::MATERIAL].erase(resource.hash);
+				resource.key.clear();
+			}
+		}
 	}
 
-	id::id_type create_resource(const void* const data, AssetType::Type type) {
+	id::id_type create_resource(const void* const data, AssetType::Type type, const char* const source_path) {
 		assert(data);
 		id::id_type id{ id::invalid_id };
+		util::vector<u8> key;
+		const bool is_cacheable{ get_resource_key(data, type, source_path, key) };
+		const u64 hash{ is_cacheable ? math::calc_hash_u64(key.data(), key.size()) : 0 };
+
+		if (is_cacheable) {
+			std::lock_guard lock{ resource_cache_mutex };
+			id = add_reference(type, hash, key);
+
+			if (id::is_valid(id)) {
+				++resource_cache_stats.hits;
+				return id;
+			}
+		}
 
 		switch (type) {
 			case AssetType::ANIMATION:
@@ -219,7 +773,7 @@ namespace lightning::content {
 				id = create_material_resource(data);
 				break;
 			case AssetType::MESH:
-				id = create_geometry_resource(data);
+				id = create_geometry_resource(data, source_path);
 				break;
 			case AssetType::SKELETON:
 				break;
@@ -229,51 +783,105 @@ namespace lightning::content {
 		}
 
 		assert(id::is_valid(id));
+
+		if (is_cacheable && id::is_valid(id)) {
+			std::unique_lock lock{ resource_cache_mutex };
+
+			// Another thread may have created the same resource in the meantime. Keep that one.
+			const id::id_type cached_id{ add_reference(type, hash, key) };
+
+			if (id::is_valid(cached_id)) {
+				++resource_cache_stats.hits;
+				lock.unlock();
+				destroy_uncached_resource(id, type);
+				return cached_id;
+			}
+
+			++resource_cache_stats.misses;
+
+			// NOTE: on a hash collision the new resource isn't cached, but it's still destroyed by destroy_resource().
+			if (resource_lookup[type].find(hash) == resource_lookup[type].end()) {
+				resource_lookup[type][hash] = id;
+				cached_resources[type][id] = { std::move(key), hash, 1 };
+			}
+		}
+
 		return id;
 	}
 
 	void destroy_resource(id::id_type id, AssetType::Type type) {
 		assert(id::is_valid(id));
 
-		switch (type) {
-			case AssetType::ANIMATION:
-				break;
-			case AssetType::AUDIO:
-				break;
-			case AssetType::MATERIAL:
-				destroy_material_resource(id);
-				break;
-			case AssetType::MESH:
-				destroy_geometry_resource(id);
-				break;
-			case AssetType::SKELETON:
-				break;
-			case AssetType::TEXTURE:
-				destroy_texture_resource(id); 
-				break;
-			default:
-				assert(false);
-				break;
+		if (type < AssetType::count) {
+			std::lock_guard lock{ resource_cache_mutex };
+			auto pair = cached_resources[type].find(id);
+
+			if (pair != cached_resources[type].end()) {
+				assert(pair->second.ref_count);
+
+				if (--pair->second.ref_count) return;
+
+				if (!pair->second.key.empty()) resource_lookup[type].erase(pair->second.hash);
+				cached_resources[type].erase(pair);
+			}
+
+			if (type == AssetType::TEXTURE) forget_materials_using_texture(id);
+		}
+
+		destroy_uncached_resource(id, type);
+	}
+
+	ResourceCacheStats get_resource_cache_stats() {
+		std::lock_guard lock{ resource_cache_mutex };
+		ResourceCacheStats stats{ resource_cache_stats };
+
+		for (u32 i{ 0 }; i < AssetType::count; ++i) {
+			stats.cached_resources += (u32)resource_lookup[i].size();
 		}
+
+		return stats;
 	}
 
 	id::id_type add_shader_group(const u8* const* shaders, u64 num_shaders, const u32* const keys) {
 		assert(shaders && num_shaders && keys);
-		NoexceptMap group;
+		assert(num_shaders < u32_invalid_id);
+
+		const u32 shader_count{ (u32)num_shaders };
+		util::vector<u32> order(shader_count);
+		u64 size{ ShaderGroupStream::header_size(shader_count) };
 
-		for (u32 i{ 0 }; i < num_shaders; ++i) {
+		for (u32 i{ 0 }; i < shader_count; ++i) {
 			assert(shaders[i]);
+			order[i] = i;
+			size += math::align_size_up<sizeof(u64)>(((const compiled_shader_ptr)shaders[i])->buffer_size());
+		}
+
+		std::sort(order.begin(), order.end(), [keys](u32 a, u32 b) { return keys[a] < keys[b]; });
+
+		u8* const buffer{ (u8* const)malloc(size) };
+		assert(buffer);
+		u32* const sorted_keys{ (u32*)&buffer[sizeof(u32)] };
+		u64* const offsets{ (u64*)&buffer[ShaderGroupStream::keys_size(shader_count)] };
+		u64 offset{ ShaderGroupStream::header_size(shader_count) };
+
+		*((u32*)buffer) = shader_count;
 
-			const compiled_shader_ptr shader_ptr{ (const compiled_shader_ptr)shaders[i] };
-			const u64 size{ shader_ptr->buffer_size() };
-			std::unique_ptr<u8[]> shader{ std::make_unique<u8[]>(size) };
-			memcpy(shader.get(), shaders[i], size);
-			group.map[keys[i]] = std::move(shader);
+		for (u32 i{ 0 }; i < shader_count; ++i) {
+			const u8* const shader{ shaders[order[i]] };
+			const u64 shader_size{ ((const compiled_shader_ptr)shader)->buffer_size() };
+			assert(!i || keys[order[i - 1]] != keys[order[i]]);
+
+			sorted_keys[i] = keys[order[i]];
+			offsets[i] = offset;
+			memcpy(&buffer[offset], shader, shader_size);
+			offset += math::align_size_up<sizeof(u64)>(shader_size);
 		}
 
+		assert(offset == size);
+
 		std::lock_guard lock{ shader_mutex };
 
-		return shader_groups.add(std::move(group));
+		return shader_groups.add(buffer);
 	}
 
 	void remove_shader_group(id::id_type id) {
@@ -281,26 +889,30 @@ namespace lightning::content {
 
 		assert(id::is_valid(id));
 
-		shader_groups[id].map.clear();
-		shader_groups.remove(id);
+		// NOTE: a holder of a ShaderReadGuard may still be using shaders from the group.
+		shader_epochs.retire(shader_groups.remove(id));
+		shader_epochs.reclaim();
 	}
 
-	compiled_shader_ptr get_shader(id::id_type id, u32 shader_key) {
-		std::lock_guard lock{ shader_mutex };
+	ShaderReadGuard::ShaderReadGuard() : _epoch{ shader_epochs.enter() } {}
 
+	ShaderReadGuard::~ShaderReadGuard() {
+		shader_epochs.leave(_epoch);
+	}
+
+	compiled_shader_ptr get_shader(id::id_type id, u32 shader_key) {
 		assert(id::is_valid(id));
 
-		for (const auto& [key, value] : shader_groups[id].map) {
-			if (key == shader_key) {
-				return (const compiled_shader_ptr)value.get();
-			}
-		}
-		assert(false);
-		return nullptr;
+		// NOTE: the caller holds a ShaderReadGuard, so the group can't be freed while it's being read.
+		const ShaderGroupStream stream{ shader_groups[id] };
+		const compiled_shader_ptr shader{ stream.find(shader_key) };
+
+		assert(shader);
+		return shader;
 	}
 
 	void get_submesh_gpu_ids(id::id_type geometry_content_id, u32 id_count, id::id_type* const gpu_ids) {
-		std::lock_guard lock{ geometry_mutex };
+		EpochManager::ReadGuard guard{ geometry_epochs };
 
 		u8* const pointer{ geometry_hierarchies[geometry_content_id] };
 
@@ -326,7 +938,8 @@ namespace lightning::content {
 		assert(geometry_ids && thresholds && id_count);
 		assert(offsets.empty());
 
-		std::lock_guard lock{ geometry_mutex };
+		EpochManager::ReadGuard guard{ geometry_epochs };
+		util::vector<u64> requests;
 
 		for (u32 i{ 0 }; i < id_count; ++i) {
 			u8* const pointer{ geometry_hierarchies[geometry_ids[i]] };
@@ -336,9 +949,66 @@ namespace lightning::content {
 			}
 			else {
 				GeometryHierarchyStream stream{ pointer };
-				const u32 lod{ stream.lod_from_threshold(thresholds[i]) };
+				u32 lod{ stream.lod_from_threshold(thresholds[i]) };
+
+				if (stream.is_streamed()) {
+					const u32 resident_lod{ get_resident_lod(stream, lod) };
+					requests.emplace_back(((u64)stream.stream_key() << 32) | lod);
+					if (resident_lod != lod) requests.emplace_back(((u64)stream.stream_key() << 32) | resident_lod);
+					lod = resident_lod;
+				}
+
 				offsets.emplace_back(stream.lod_offsets()[lod]);
 			}
 		}
+
+		if (requests.empty()) return;
+
+		std::lock_guard lock{ lod_request_mutex };
+		const u64 request_count{ lod_requests.size() };
+		lod_requests.resize(request_count + requests.size());
+		memcpy(&lod_requests[request_count], requests.data(), requests.size() * sizeof(u64));
+	}
+
+	void update_geometry_residency(u32 frames_to_keep) {
+		util::vector<u64> requests;
+
+		{
+			std::lock_guard lock{ lod_request_mutex };
+			requests.swap(lod_requests);
+		}
+
+		std::lock_guard lock{ geometry_mutex };
+		const u32 frame{ ++residency_frame };
+
+		// Requests for hierarchies that were destroyed since are dropped.
+		for (const u64 request : requests) {
+			auto pair = streamed_geometries.find((u32)(request >> 32));
+			if (pair == streamed_geometries.end()) continue;
+
+			const GeometryHierarchyStream stream{ geometry_hierarchies[pair->second] };
+			request_lod(stream, (u32)request);
+		}
+
+		for (const auto& pair : streamed_geometries) {
+			const GeometryHierarchyStream stream{ geometry_hierarchies[pair.second] };
+			const u32 lod_count{ stream.lod_count() };
+
+			// The coarsest LOD stays resident.
+			for (u32 lod{ 0 }; lod < lod_count - 1; ++lod) {
+				LodState& state{ stream.lod_states()[lod] };
+
+				if (state.residency.load(std::memory_order_relaxed) != LodResidency::RESIDENT) continue;
+				if (frame - state.last_used_frame <= frames_to_keep) continue;
+
+				state.residency.store(LodResidency::EVICTED, std::memory_order_relaxed);
+
+				const LodOffset lod_offset{ stream.lod_offsets()[lod] };
+
+				for (u32 i{ 0 }; i < lod_offset.count; ++i) {
+					graphics::evict_submesh(stream.gpu_ids()[lod_offset.offset + i]);
+				}
+			}
+		}
 	}
 }
\ No newline at end of file
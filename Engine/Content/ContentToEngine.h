@@ -48,8 +48,31 @@ namespace lightning::content {
 		u16 count;
 	};
 
-	id::id_type create_resource(const void* const data, AssetType::Type type);
+	struct ResourceCacheStats {
+		u64 hits;
+		u64 misses;
+		u32 cached_resources;
+	};
+
+	// Creating a resource from data that is already loaded returns the existing id and adds a reference to it.
+	// Each create_resource() call has to be matched by a destroy_resource() call.
+	// A mesh that is given its source file only needs the header and the coarsest LOD in data. Its finer LODs are
+	// read from the file when get_lod_offsets() has asked for them.
+	id::id_type create_resource(const void* const data, AssetType::Type type, const char* const source_path = nullptr);
 	void destroy_resource(id::id_type id, AssetType::Type type);
+	[[nodiscard]] ResourceCacheStats get_resource_cache_stats();
+
+	// Keeps removed shader groups from being freed while it's alive. get_shader() doesn't lock, so hold a guard
+	// around the call and for as long as the returned shader is used.
+	class ShaderReadGuard {
+		public:
+			ShaderReadGuard();
+			~ShaderReadGuard();
+			DISABLE_COPY_AND_MOVE(ShaderReadGuard);
+
+		private:
+			const u64 _epoch;
+	};
 
 	id::id_type add_shader_group(const u8* const* shaders, u64 num_shaders, const u32* const keys);
 	void remove_shader_group(id::id_type id);
@@ -57,4 +80,9 @@ namespace lightning::content {
 
 	void get_submesh_gpu_ids(id::id_type geometry_content_id, u32 id_count, id::id_type* const gpu_ids);
 	void get_lod_offsets(const id::id_type* const geometry_ids, const f32* const thresholds, u32 id_count, util::vector<LodOffset>& offsets);
+
+	// Starts reading the streamed LODs that get_lod_offsets() asked for since the last call, and evicts the ones that
+	// weren't drawn in the last frames_to_keep frames.
+	// Call this from the main thread once per frame, when no frame is being rendered.
+	void update_geometry_residency(u32 frames_to_keep = 120);
 }
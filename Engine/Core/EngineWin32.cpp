@@ -3,6 +3,7 @@
 #include <thread>
 
 #include "Content/ContentLoader.h"
+#include "Content/ContentToEngine.h"
 #include "Components/Script.h"
 #include "Platform/PlatformTypes.h"
 #include "Platform/Platform.h"
@@ -47,6 +48,7 @@ bool engine_initialize() {
 
 void engine_update() {
 	script::update(10.f);
+	content::update_geometry_residency();
 	std::this_thread::sleep_for(std::chrono::milliseconds(10));
 }
 
@@ -27,6 +27,7 @@ namespace lightning::graphics::direct3d12::content {
 			D3D12_INDEX_BUFFER_VIEW index_buffer_view{};
 			D3D_PRIMITIVE_TOPOLOGY primitive_topology{};
 			u32 element_type{};
+			submesh::PositionDecode position_decode{};
 		};
 
 		struct D3D12RenderItem {
@@ -324,6 +325,9 @@ namespace lightning::graphics::direct3d12::content {
 
 			d3dx::D3D12PipelineStateSubobjectStream& stream{ *(d3dx::D3D12PipelineStateSubobjectStream* const)stream_ptr };
 
+			// NOTE: the shader byte code in the stream is only safe to read while the guard is alive.
+			const lightning::content::ShaderReadGuard shader_guard{};
+
 			{
 				std::lock_guard lock{ material_mutex };
 				const D3D12MaterialStream material{ materials[material_id].get() };
@@ -544,46 +548,91 @@ namespace lightning::graphics::direct3d12::content {
 			const u32 element_size{ blob.read<u32>()};
 			const u32 vertex_count{ blob.read<u32>() };
 			const u32 index_count{ blob.read<u32>() };
-			const u32 elements_type{ blob.read<u32>() };
+
+			// NOTE: the position format is in the high byte of the elements type, so older files read as F32 positions.
+			const u32 elements_type_and_format{ blob.read<u32>() };
+			const u32 elements_type{ elements_type_and_format & 0x00ffffff };
 			const u32 primitive_topology{ blob.read<u32>() };
 			const u32 index_size{ (vertex_count < (1 << 16)) ? sizeof(u16) : sizeof(u32) };
 
-			const u32 position_buffer_size{ sizeof(math::v3) * vertex_count };
-			const u32 element_buffer_size{ element_size * vertex_count };
-			const u32 index_buffer_size{ index_size * index_count };
-
-			constexpr u32 alignment{ D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_MULTIPLE };
-			const u32 aligned_position_buffer_size{ (u32)math::align_size_up<alignment>(position_buffer_size) };
-			const u32 aligned_element_buffer_size{ (u32)math::align_size_up<alignment>(element_buffer_size) };
-			const u32 total_buffer_size{ aligned_position_buffer_size + aligned_element_buffer_size + index_buffer_size };
+			PositionDecode position_decode{};
+			position_decode.format = (PositionFormat::Type)(elements_type_and_format >> 24);
+			assert(position_decode.format < PositionFormat::count);
 
-			ID3D12Resource* resource{ d3dx::create_buffer(blob.position(), total_buffer_size) };
+			if (position_decode.format == PositionFormat::UNORM16) {
+				blob.read((u8*)&position_decode.scale, sizeof(math::v3));
+				blob.read((u8*)&position_decode.offset, sizeof(math::v3));
+			}
 
-			blob.skip(total_buffer_size);
 			data = blob.position();
 
+			const u32 position_size{ position_decode.format == PositionFormat::UNORM16 ? 3 * sizeof(u16) : sizeof(math::v3) };
+
+			// NOTE: the buffer locations are set when the buffers are uploaded.
 			SubmeshView view{};
-			view.position_buffer_view.BufferLocation = resource->GetGPUVirtualAddress();
-			view.position_buffer_view.SizeInBytes = position_buffer_size;
-			view.position_buffer_view.StrideInBytes = sizeof(math::v3);
+			view.position_buffer_view.SizeInBytes = position_size * vertex_count;
+			view.position_buffer_view.StrideInBytes = position_size;
 
 			if (element_size) {
-				view.element_buffer_view.BufferLocation = resource->GetGPUVirtualAddress() + aligned_position_buffer_size;
-				view.element_buffer_view.SizeInBytes = element_buffer_size;
+				view.element_buffer_view.SizeInBytes = element_size * vertex_count;
 				view.element_buffer_view.StrideInBytes = element_size;
 			}
 
-			view.index_buffer_view.BufferLocation = resource->GetGPUVirtualAddress() + aligned_position_buffer_size + aligned_element_buffer_size;
 			view.index_buffer_view.Format = (index_size == sizeof(u16)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
-			view.index_buffer_view.SizeInBytes = index_buffer_size;
+			view.index_buffer_view.SizeInBytes = index_size * index_count;
 
 			view.element_type = elements_type;
+			view.position_decode = position_decode;
 			view.primitive_topology = get_d3d_primitive_topology((PrimitiveTopology::Type)primitive_topology);
 
 			std::lock_guard lock{ submesh_mutex };
-			submesh_buffers.add(resource);
+			submesh_buffers.add(nullptr);
 			return submesh_views.add(view);
-		} 
+		}
+
+		void upload(id::id_type id, const u8*& data) {
+			assert(data);
+			SubmeshView view{};
+
+			{
+				std::lock_guard lock{ submesh_mutex };
+				assert(!submesh_buffers[id]);
+				view = submesh_views[id];
+			}
+
+			constexpr u32 alignment{ D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_MULTIPLE };
+			const u32 aligned_position_buffer_size{ (u32)math::align_size_up<alignment>(view.position_buffer_view.SizeInBytes) };
+			const u32 aligned_element_buffer_size{ (u32)math::align_size_up<alignment>(view.element_buffer_view.SizeInBytes) };
+			const u32 total_buffer_size{ aligned_position_buffer_size + aligned_element_buffer_size + view.index_buffer_view.SizeInBytes };
+
+			ID3D12Resource* resource{ d3dx::create_buffer(data, total_buffer_size) };
+			data += total_buffer_size;
+
+			const D3D12_GPU_VIRTUAL_ADDRESS address{ resource->GetGPUVirtualAddress() };
+
+			std::lock_guard lock{ submesh_mutex };
+			SubmeshView& stored_view{ submesh_views[id] };
+			stored_view.position_buffer_view.BufferLocation = address;
+
+			if (stored_view.element_buffer_view.StrideInBytes) {
+				stored_view.element_buffer_view.BufferLocation = address + aligned_position_buffer_size;
+			}
+
+			stored_view.index_buffer_view.BufferLocation = address + aligned_position_buffer_size + aligned_element_buffer_size;
+			submesh_buffers[id] = resource;
+		}
+
+		// The view stays valid, so render items that were created for the submesh can still be drawn once the buffers
+		// are uploaded again.
+		void evict(id::id_type id) {
+			std::lock_guard lock{ submesh_mutex };
+			SubmeshView& view{ submesh_views[id] };
+			view.position_buffer_view.BufferLocation = 0;
+			view.element_buffer_view.BufferLocation = 0;
+			view.index_buffer_view.BufferLocation = 0;
+
+			core::deferred_release(submesh_buffers[id]);
+		}
 
 		void remove(id::id_type id) {
 			std::lock_guard lock{ submesh_mutex };
@@ -595,7 +644,7 @@ namespace lightning::graphics::direct3d12::content {
 
 		void get_views(const id::id_type* const gpu_ids, u32 id_count, const ViewsCache& cache) {
 			assert(gpu_ids && id_count);
-			assert(cache.position_buffers && cache.element_buffers && cache.index_buffer_views && cache.primitive_topologies && cache.elements_types);
+			assert(cache.position_buffers && cache.element_buffers && cache.index_buffer_views && cache.primitive_topologies && cache.elements_types && cache.position_decodes);
 
 			std::lock_guard lock{ submesh_mutex };
 
@@ -606,6 +655,7 @@ namespace lightning::graphics::direct3d12::content {
 				cache.index_buffer_views[i] = view.index_buffer_view;
 				cache.primitive_topologies[i] = view.primitive_topology;
 				cache.elements_types[i] = view.element_type;
+				cache.position_decodes[i] = view.position_decode;
 			}
 		}
 	}
@@ -694,7 +744,8 @@ namespace lightning::graphics::direct3d12::content {
 				(D3D12_GPU_VIRTUAL_ADDRESS* const)alloca(material_count * sizeof(D3D12_GPU_VIRTUAL_ADDRESS)),
 				(D3D12_INDEX_BUFFER_VIEW* const)alloca(material_count * sizeof(D3D12_INDEX_BUFFER_VIEW)),
 				(D3D_PRIMITIVE_TOPOLOGY* const)alloca(material_count * sizeof(D3D_PRIMITIVE_TOPOLOGY)),
-				(u32* const)alloca(material_count * sizeof(u32))
+				(u32* const)alloca(material_count * sizeof(u32)),
+				(submesh::PositionDecode* const)alloca(material_count * sizeof(submesh::PositionDecode))
 			};
 
 			submesh::get_views(gpu_ids, material_count, views_cache);
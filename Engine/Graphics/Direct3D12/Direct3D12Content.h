@@ -8,15 +8,24 @@ namespace lightning::graphics::direct3d12::content {
 
 	namespace submesh {
 
+		struct PositionDecode {
+			math::v3 scale;
+			math::v3 offset;
+			PositionFormat::Type format;
+		};
+
 		struct ViewsCache {
 			D3D12_GPU_VIRTUAL_ADDRESS* const position_buffers;
 			D3D12_GPU_VIRTUAL_ADDRESS* const element_buffers;
 			D3D12_INDEX_BUFFER_VIEW* const index_buffer_views;
 			D3D_PRIMITIVE_TOPOLOGY* const primitive_topologies;
 			u32* const elements_types;
+			PositionDecode* const position_decodes;
 		};
 
 		id::id_type add(const u8*& data);
+		void upload(id::id_type id, const u8*& data);
+		void evict(id::id_type id);
 		void remove(id::id_type id);
 		void get_views(const id::id_type* const gpu_ids, u32 id_count, const ViewsCache& cache);
 	}
@@ -53,6 +53,7 @@ namespace lightning::graphics::direct3d12::gpass {
 			D3D12_INDEX_BUFFER_VIEW* index_buffer_views{ nullptr };
 			D3D_PRIMITIVE_TOPOLOGY* primitive_topologies{ nullptr };
 			u32* elements_types{ nullptr };
+			content::submesh::PositionDecode* position_decodes{ nullptr };
 			D3D12_GPU_VIRTUAL_ADDRESS* per_object_data{ nullptr };
 			D3D12_GPU_VIRTUAL_ADDRESS* srv_indices{ nullptr };
 
@@ -72,7 +73,8 @@ namespace lightning::graphics::direct3d12::gpass {
 					element_buffers,
 					index_buffer_views,
 					primitive_topologies,
-					elements_types
+					elements_types,
+					position_decodes
 				};
 			}
 
@@ -116,7 +118,8 @@ namespace lightning::graphics::direct3d12::gpass {
 					index_buffer_views = (D3D12_INDEX_BUFFER_VIEW*)&element_buffers[items_count];
 					primitive_topologies = (D3D_PRIMITIVE_TOPOLOGY*)&index_buffer_views[items_count];
 					elements_types = (u32*)&primitive_topologies[items_count];
-					per_object_data = (D3D12_GPU_VIRTUAL_ADDRESS*)&elements_types[items_count];
+					position_decodes = (content::submesh::PositionDecode*)&elements_types[items_count];
+					per_object_data = (D3D12_GPU_VIRTUAL_ADDRESS*)&position_decodes[items_count];
 					srv_indices = (D3D12_GPU_VIRTUAL_ADDRESS*)&per_object_data[items_count];
 				}
 			}
@@ -138,6 +141,7 @@ namespace lightning::graphics::direct3d12::gpass {
 					sizeof(D3D12_INDEX_BUFFER_VIEW) +
 					sizeof(D3D_PRIMITIVE_TOPOLOGY) +
 					sizeof(u32) +
+					sizeof(content::submesh::PositionDecode) +
 					sizeof(D3D12_GPU_VIRTUAL_ADDRESS) + 
 					sizeof(D3D12_GPU_VIRTUAL_ADDRESS)
 				};
@@ -197,14 +201,19 @@ namespace lightning::graphics::direct3d12::gpass {
 			const GPassCache& cache{ frame_cache };
 			const u32 render_items_count{ (u32)cache.size() };
 			id::id_type current_entity_id{ id::invalid_id };
+			const content::submesh::PositionDecode* current_decode{ nullptr };
 			hlsl::PerObjectData* current_data_pointer{ nullptr };
 
 			ConstantBuffer& cbuffer{ core::c_buffer() };
 
 			using namespace DirectX;
 			for (u32 i{ 0 }; i < render_items_count; ++i) {
-				if (current_entity_id != cache.entity_ids[i]) {
+				// Submeshes of the same entity share their per-object data, unless their positions are decoded differently.
+				const content::submesh::PositionDecode* const decode{ &cache.position_decodes[i] };
+
+				if (current_entity_id != cache.entity_ids[i] || memcmp(current_decode, decode, sizeof(content::submesh::PositionDecode))) {
 					current_entity_id = cache.entity_ids[i];
+					current_decode = decode;
 					hlsl::PerObjectData data{};
 					transform::get_transform_matrices(game_entity::entity_id{ current_entity_id }, data.world, data.inv_world);
 					XMMATRIX world{ XMLoadFloat4x4(&data.world) };
@@ -214,6 +223,10 @@ namespace lightning::graphics::direct3d12::gpass {
 					const MaterialSurface* const surface{ materials_cache.material_surfaces[i] };
 					memcpy(&data.base_color, surface, sizeof(MaterialSurface));
 
+					data.position_format = decode->format;
+					data.position_scale = decode->scale;
+					data.position_offset = decode->offset;
+
 					current_data_pointer = cbuffer.allocate<hlsl::PerObjectData>();
 					memcpy(current_data_pointer, &data, sizeof(hlsl::PerObjectData));
 				}
@@ -35,6 +35,8 @@ namespace lightning::graphics::direct3d12 {
 		pi.camera.get_parameter = camera::get_parameter;
 
 		pi.resources.add_submesh = content::submesh::add;
+		pi.resources.upload_submesh = content::submesh::upload;
+		pi.resources.evict_submesh = content::submesh::evict;
 		pi.resources.remove_submesh = content::submesh::remove;
 		pi.resources.add_texture = content::texture::add;
 		pi.resources.remove_texture = content::texture::remove;
@@ -7,3 +7,6 @@ static const float PI = 3.1415926535897932384626433832795f;
 static const uint LIGHT_TYPE_DIRECTIONAL_LIGHT = 0;
 static const uint LIGHT_TYPE_POINT_LIGHT = 1;
 static const uint LIGHT_TYPE_SPOTLIGHT = 2;
+
+static const uint POSITION_FORMAT_F32 = 0;
+static const uint POSITION_FORMAT_UNORM16 = 1;
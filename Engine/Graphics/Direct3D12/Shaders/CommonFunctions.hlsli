@@ -33,6 +33,21 @@ bool cone_inside_plane(Cone cone, Plane plane)
     return point_inside_plane(cone.tip, plane) && point_inside_plane(Q, plane);
 }
 
+// Positions are packed without padding, either as 3 floats or as 3 16-bit unsigned normalized values.
+float3 load_position(ByteAddressBuffer positions, uint vertex_index, uint format, float3 scale, float3 offset)
+{
+    if (format == POSITION_FORMAT_UNORM16)
+    {
+        uint address = vertex_index * 6;
+        uint2 words = positions.Load2(address & ~3);
+        uint3 q = (address & 2) ? uint3(words.x >> 16, words.y & 0xffff, words.y >> 16) : uint3(words.x & 0xffff, words.x >> 16, words.y & 0xffff);
+
+        return offset + float3(q) * scale;
+    }
+
+    return asfloat(positions.Load3(vertex_index * 12));
+}
+
 float4 unproject_uv(float2 uv, float depth, float4x4 inverse)
 {
     float4 clip = float4(float2(uv.x, 1.f - uv.y) * 2.f - 1.f, depth, 1.f);
@@ -113,7 +113,12 @@ struct PerObjectData
     float emissive_intensity;
     float metallic;
     float roughness;
-    uint2 _pad;
+    uint position_format;
+    uint _pad;
+    float3 position_scale;
+    float _pad1;
+    float3 position_offset;
+    float _pad2;
 };
 
 #ifdef __cplusplus
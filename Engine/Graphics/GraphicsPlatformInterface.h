@@ -38,6 +38,8 @@ namespace lightning::graphics {
 
 		struct {
 			id::id_type(*add_submesh)(const u8*&);
+			void(*upload_submesh)(id::id_type, const u8*&);
+			void(*evict_submesh)(id::id_type);
 			void(*remove_submesh)(id::id_type);
 			id::id_type(*add_texture)(const u8* const);
 			void(*remove_texture)(id::id_type);
@@ -324,6 +324,14 @@ namespace lightning::graphics {
 		return gfx.resources.add_submesh(data);
 	}
 
+	void upload_submesh(id::id_type id, const u8*& data) {
+		gfx.resources.upload_submesh(id, data);
+	}
+
+	void evict_submesh(id::id_type id) {
+		gfx.resources.evict_submesh(id);
+	}
+
 	void remove_submesh(id::id_type id) {
 		gfx.resources.remove_submesh(id);
 	}
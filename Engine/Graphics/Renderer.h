@@ -244,6 +244,15 @@ namespace lightning::graphics {
 		};
 	};
 
+	struct PositionFormat {
+		enum Type : u32 {
+			F32 = 0,	// 3 floats
+			UNORM16,	// 3 16-bit unsigned normalized values, decoded as offset + position * scale
+
+			count
+		};
+	};
+
 	// Use this if the Engine supports multiple graphics renderers
 	enum class GraphicsPlatform : u32 {
 		DIRECT3D12 = 0,
@@ -266,7 +275,10 @@ namespace lightning::graphics {
 	Camera create_camera(CameraInitInfo info);
 	void remove_camera(camera_id id);
 
+	// A submesh is added from its header and drawn once its buffers are uploaded. Evicting the buffers keeps the submesh id valid.
 	id::id_type add_submesh(const u8*& data);
+	void upload_submesh(id::id_type id, const u8*& data);
+	void evict_submesh(id::id_type id);
 	void remove_submesh(id::id_type id);
 
 	id::id_type add_texture(const u8* const data);
@@ -0,0 +1,169 @@
+#pragma once
+#include "CommonHeaders.h"
+#include <algorithm>
+
+// Small, dependency free LZ77 codec for asset payloads. The stream is a series of sequences:
+//
+// token       u8: high 4 bits literal count, low 4 bits match length - min_match (15 means more bytes follow)
+// [literal count extension]   255 bytes until a byte < 255
+// literals
+// offset      u16: distance back to the start of the match
+// [match length extension]    255 bytes until a byte < 255
+//
+// The last sequence only has literals. Blocks are independent, so they can be decompressed in parallel.
+namespace lightning::compression {
+	constexpr u32 min_match{ 4 };
+	constexpr u32 max_offset{ 0xffff };
+	constexpr u32 default_block_size{ 128 * 1024 };
+
+	namespace internal {
+		constexpr u32 hash_bits{ 12 };
+
+		[[nodiscard]] inline u32 read_u32(const u8* const p) {
+			u32 value;
+			memcpy(&value, p, sizeof(u32));
+			return value;
+		}
+
+		[[nodiscard]] constexpr u32 hash(u32 sequence) {
+			return (sequence * 2654435761u) >> (32 - hash_bits);
+		}
+
+		[[nodiscard]] inline bool write_length(u8*& dst, const u8* const dst_end, u32 length) {
+			while (length >= 255) {
+				if (dst >= dst_end) return false;
+				*dst++ = 255;
+				length -= 255;
+			}
+
+			if (dst >= dst_end) return false;
+			*dst++ = (u8)length;
+			return true;
+		}
+
+		[[nodiscard]] inline bool read_length(const u8*& src, const u8* const src_end, u32& length) {
+			u8 byte;
+
+			do {
+				if (src >= src_end) return false;
+				byte = *src++;
+				length += byte;
+			} while (byte == 255);
+
+			return true;
+		}
+
+		[[nodiscard]] inline bool write_sequence(u8*& dst, const u8* const dst_end, const u8* literals, u32 literal_count, u32 offset, u32 match_length) {
+			if (dst >= dst_end) return false;
+
+			u8* const token{ dst++ };
+			*token = (u8)(std::min(literal_count, 15u) << 4);
+
+			if (literal_count >= 15 && !write_length(dst, dst_end, literal_count - 15)) return false;
+			if ((u64)(dst_end - dst) < literal_count) return false;
+
+			memcpy(dst, literals, literal_count);
+			dst += literal_count;
+
+			if (!match_length) return true;
+
+			assert(match_length >= min_match && offset && offset <= max_offset);
+
+			if (dst_end - dst < 2) return false;
+
+			*dst++ = (u8)(offset & 0xff);
+			*dst++ = (u8)(offset >> 8);
+
+			const u32 length{ match_length - min_match };
+			*token |= (u8)std::min(length, 15u);
+
+			return length < 15 || write_length(dst, dst_end, length - 15);
+		}
+	}
+
+	// Worst case size of a compressed block: everything is stored as literals.
+	[[nodiscard]] constexpr u32 max_compressed_size(u32 size) {
+		return size + size / 255 + 16;
+	}
+
+	// Returns the compressed size or 0 if the compressed data doesn't fit in dst.
+	[[nodiscard]] inline u32 compress_block(const u8* const src, u32 src_size, u8* const dst, u32 dst_capacity) {
+		using namespace internal;
+		assert(src && dst);
+
+		u32 table[1 << hash_bits];
+		memset(table, 0xff, sizeof(table));
+
+		const u8* const dst_end{ dst + dst_capacity };
+		u8* out{ dst };
+		u32 anchor{ 0 };
+		u32 position{ 0 };
+
+		while (position + min_match <= src_size) {
+			const u32 sequence{ read_u32(&src[position]) };
+			const u32 h{ hash(sequence) };
+			const u32 candidate{ table[h] };
+			table[h] = position;
+
+			if (candidate == u32_invalid_id || position - candidate > max_offset || read_u32(&src[candidate]) != sequence) {
+				// Skip faster through data that doesn't compress.
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			u32 length{ min_match };
+			while (position + length < src_size && src[candidate + length] == src[position + length]) ++length;
+
+			if (!write_sequence(out, dst_end, &src[anchor], position - anchor, position - candidate, length)) return 0;
+
+			position += length;
+			anchor = position;
+		}
+
+		if (!write_sequence(out, dst_end, &src[anchor], src_size - anchor, 0, 0)) return 0;
+
+		return (u32)(out - dst);
+	}
+
+	// Returns false if the data is corrupt or doesn't decompress to exactly dst_size bytes.
+	[[nodiscard]] inline bool decompress_block(const u8* src, u32 src_size, u8* const dst, u32 dst_size) {
+		using namespace internal;
+		assert(src && dst);
+
+		const u8* const src_end{ src + src_size };
+		u8* out{ dst };
+		u8* const dst_end{ dst + dst_size };
+
+		while (src < src_end) {
+			const u8 token{ *src++ };
+			u32 literal_count{ (u32)(token >> 4) };
+
+			if (literal_count == 15 && !read_length(src, src_end, literal_count)) return false;
+			if ((u64)(src_end - src) < literal_count || (u64)(dst_end - out) < literal_count) return false;
+
+			memcpy(out, src, literal_count);
+			src += literal_count;
+			out += literal_count;
+
+			if (src == src_end) break;
+			if (src_end - src < 2) return false;
+
+			const u32 offset{ (u32)src[0] | ((u32)src[1] << 8) };
+			src += 2;
+
+			u32 match_length{ (u32)(token & 0xf) };
+
+			if (match_length == 15 && !read_length(src, src_end, match_length)) return false;
+
+			match_length += min_match;
+
+			if (!offset || offset > (u64)(out - dst) || (u64)(dst_end - out) < match_length) return false;
+
+			// NOTE: the match may overlap the output, so it has to be copied byte by byte.
+			const u8* match{ out - offset };
+			for (u32 i{ 0 }; i < match_length; ++i) *out++ = *match++;
+		}
+
+		return out == dst_end;
+	}
+}
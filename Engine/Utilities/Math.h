@@ -90,6 +90,60 @@ namespace lightning::math {
 		return crc;
  	}
 
+	// Fast non-cryptographic 64-bit hash. Four independent lanes keep the multipliers busy on large buffers.
+	[[nodiscard]] inline u64 calc_hash_u64(const u8* const data, u64 size, u64 seed = 0) {
+		constexpr u64 prime1{ 0x9e3779b185ebca87ull };
+		constexpr u64 prime2{ 0xc2b2ae3d27d4eb4full };
+		constexpr u64 prime3{ 0x165667b19e3779f9ull };
+
+		auto round = [](u64 acc, u64 value) {
+			acc += value * prime2;
+			acc = (acc << 31) | (acc >> 33);
+			return acc * prime1;
+		};
+
+		auto read_u64 = [](const u8* const p) {
+			u64 value;
+			memcpy(&value, p, sizeof(u64));
+			return value;
+		};
+
+		const u8* at{ data };
+		const u8* const end{ data + size };
+		u64 hash{ seed + prime3 + size };
+
+		if (size >= 32) {
+			u64 lanes[4]{ seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+			const u8* const block_end{ data + align_size_down<32>(size) };
+
+			while (at < block_end) {
+				for (u32 i{ 0 }; i < 4; ++i) lanes[i] = round(lanes[i], read_u64(&at[i * sizeof(u64)]));
+				at += 32;
+			}
+
+			for (u32 i{ 0 }; i < 4; ++i) hash = (hash ^ round(0, lanes[i])) * prime1 + prime3;
+		}
+
+		while (at + sizeof(u64) <= end) {
+			const u64 value{ hash ^ round(0, read_u64(at)) };
+			hash = ((value << 27) | (value >> 37)) * prime1 + prime3;
+			at += sizeof(u64);
+		}
+
+		while (at < end) {
+			hash = (hash ^ (*at++ * prime3)) * prime1;
+			hash = (hash << 11) | (hash >> 53);
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
 	[[nodiscard]] inline u8 log2(u64 value) {
 		unsigned long mssb;
 		unsigned long lssb;
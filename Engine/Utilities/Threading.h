@@ -1,6 +1,9 @@
 #pragma once
 
 #include "CommonHeaders.h"
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 
 namespace lightning::util {
 	#if _WIN64
@@ -50,4 +53,122 @@ namespace lightning::util {
 			std::atomic<u64> _serving{ 0 };
 	};
 	#endif
+
+	namespace detail {
+		// A parallel_for call. Workers join it while it's queued and leave when its indices run out.
+		struct ParallelJob {
+			void (*invoke)(void* context, u32 index);
+			void* context;
+			u32 count;
+			u32 max_helpers;
+			u32 helper_count{ 0 };
+			u32 active_helpers{ 0 };
+			bool is_queued{ true };
+			std::atomic<u32> next_index{ 0 };
+
+			void run() {
+				for (u32 i{ next_index++ }; i < count; i = next_index++) invoke(context, i);
+			}
+		};
+
+		// One set of worker threads shared by every parallel_for in the module. The pool is created on first use and is
+		// never destroyed, so the workers don't have to be joined while statics are torn down or a DLL is detaching.
+		class WorkerPool {
+			public:
+				DISABLE_COPY_AND_MOVE(WorkerPool);
+
+				static WorkerPool& get() {
+					static WorkerPool* const pool{ new WorkerPool{} };
+					return *pool;
+				}
+
+				[[nodiscard]] static bool is_worker_thread() { return _is_worker; }
+				[[nodiscard]] u32 worker_count() const { return (u32)_workers.size(); }
+
+				void run(ParallelJob& job) {
+					{
+						std::lock_guard lock{ _mutex };
+						_jobs.push_back(&job);
+					}
+
+					job.max_helpers == 1 ? _job_cv.notify_one() : _job_cv.notify_all();
+					job.run();
+
+					std::unique_lock lock{ _mutex };
+					dequeue(job);
+					_done_cv.wait(lock, [&] { return !job.active_helpers; });
+				}
+
+			private:
+				WorkerPool() {
+					const u32 worker_count{ std::max(std::thread::hardware_concurrency(), 2u) - 1 };
+					_workers.reserve(worker_count);
+
+					for (u32 i{ 0 }; i < worker_count; ++i) {
+						_workers.emplace_back([this] { work(); });
+						_workers.back().detach();
+					}
+				}
+
+				void dequeue(ParallelJob& job) {
+					if (!job.is_queued) return;
+					_jobs.erase(std::find(_jobs.begin(), _jobs.end(), &job));
+					job.is_queued = false;
+				}
+
+				void work() {
+					_is_worker = true;
+					std::unique_lock lock{ _mutex };
+
+					while (true) {
+						_job_cv.wait(lock, [this] { return !_jobs.empty(); });
+
+						ParallelJob& job{ *_jobs.front() };
+						++job.active_helpers;
+						if (++job.helper_count == job.max_helpers || job.next_index >= job.count) dequeue(job);
+
+						lock.unlock();
+						job.run();
+						lock.lock();
+
+						dequeue(job);
+						if (!--job.active_helpers) _done_cv.notify_all();
+					}
+				}
+
+				std::mutex _mutex;
+				std::condition_variable _job_cv;
+				std::condition_variable _done_cv;
+				util::deque<ParallelJob*> _jobs;
+				util::vector<std::thread> _workers;
+				inline static thread_local bool _is_worker{ false };
+		};
+	}
+
+	// Calls func(index) for every index in [0, count) on up to max_threads threads (0: use all hardware threads).
+	// The calling thread also does work. Indices are handed out one by one, so the cost per item can vary.
+	// The work is shared with a persistent pool of worker threads. A parallel_for inside another one's func runs inline
+	// on the worker that calls it, so nesting doesn't multiply the threads.
+	template<typename F> void parallel_for(u32 count, F&& func, u32 max_threads = 0) {
+		if (count <= 1 || max_threads == 1 || detail::WorkerPool::is_worker_thread()) {
+			for (u32 i{ 0 }; i < count; ++i) func(i);
+			return;
+		}
+
+		detail::WorkerPool& pool{ detail::WorkerPool::get() };
+		const u32 helper_count{ std::min(count, max_threads ? std::min(max_threads, pool.worker_count() + 1) : pool.worker_count() + 1) - 1 };
+
+		if (!helper_count) {
+			for (u32 i{ 0 }; i < count; ++i) func(i);
+			return;
+		}
+
+		detail::ParallelJob job{};
+		job.invoke = [](void* context, u32 index) { (*(std::remove_reference_t<F>*)context)(index); };
+		job.context = (void*)&func;
+		job.count = count;
+		job.max_helpers = helper_count;
+
+		pool.run(job);
+	}
 }
\ No newline at end of file
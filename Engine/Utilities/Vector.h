@@ -73,8 +73,15 @@ namespace lightning::util {
 
 				if (new_size > _size) {
 					reserve(new_size);
-					while (_size < new_size) {
-						emplace_back();
+					if constexpr (std::is_trivially_default_constructible<T>::value) {
+						// Value initializing these types is zeroing them.
+						memset(_data + _size, 0, (new_size - _size) * sizeof(T));
+						_size = new_size;
+					}
+					else {
+						while (_size < new_size) {
+							emplace_back();
+						}
 					}
 				}
 				else if (new_size < _size) {
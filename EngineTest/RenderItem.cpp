@@ -1,5 +1,6 @@
 #include "CommonHeaders.h"
 #include "Content/ContentToEngine.h"
+#include "Content/AssetStreaming.h"
 #include "Graphics/Renderer.h"
 #include "../EngineDLL/ShaderCompilation.h"
 #include "Components/Entity.h"
@@ -17,8 +18,6 @@ using namespace lightning;
 game_entity::Entity create_one_game_entity(math::v3 position, math::v3 rotation, geometry::InitInfo* geometry_info, const char* script_name);
 void remove_game_entity(game_entity::entity_id id);
 
-bool read_file(std::filesystem::path, std::unique_ptr<u8[]>&, u64&);
-
 namespace {
 	id::id_type building_model_id{ id::invalid_id };
 	id::id_type fan_model_id{ id::invalid_id };
@@ -59,24 +58,11 @@ namespace {
 
 	graphics::Light ibl_light{};
 
-	[[nodiscard]] id::id_type load_asset(const char* path, content::AssetType::Type type) {
-		std::unique_ptr<u8[]> buffer;
-		u64 size{ 0 };
-		read_file(path, buffer, size);
-
-		const id::id_type asset_id{ content::create_resource(buffer.get(), type) };
-		assert(id::is_valid(asset_id));
-
-		return asset_id;
-	}
-
-	[[nodiscard]] id::id_type load_model(const char* path) {
-		return load_asset(path, content::AssetType::MESH);
-	}
-
-	[[nodiscard]] id::id_type load_texture(const char* path) {
-		return load_asset(path, content::AssetType::TEXTURE);
-	}
+	struct StreamedAsset {
+		const char* path;
+		content::AssetType::Type type;
+		id::id_type* asset_id;
+	};
 
 	void load_shaders() {
 		ShaderFileInfo info{};
@@ -190,29 +176,56 @@ namespace {
 void create_render_items() {
 	memset(&texture_ids[0], 0xff, sizeof(id::id_type) * _countof(texture_ids));
 
-	std::thread threads[]{
-		std::thread{ [] { texture_ids[TextureUsage::AMBIENT_OCCLUSION] = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/ambient_occlusion.img"); }},
-		std::thread{ [] { texture_ids[TextureUsage::BASE_COLOR] = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/base_color.img"); }},
-		std::thread{ [] { texture_ids[TextureUsage::EMISSIVE] = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/emissive.img"); }},
-		std::thread{ [] { texture_ids[TextureUsage::METAL_ROUGH] = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/metal_rough.img"); }},
-		std::thread{ [] { texture_ids[TextureUsage::NORMAL] = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/normal.img"); }},
-
-		std::thread{ [] { ibl_brdf_lut_id = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/brdf_lut.texture"); }},
-		std::thread{ [] { ibl_diffuse_id = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/diffuse6.texture"); }},
-		std::thread{ [] { ibl_specular_id = load_texture("C:/Users/balin/Documents/Lightning-Engine/EngineTest/specular6.texture"); }},
-
-		std::thread{ [] { building_model_id = load_model("C:/Users/balin/Documents/Lightning-Engine/EngineTest/ground.model"); }},
-		std::thread{ [] { fan_model_id = load_model("C:/Users/balin/Documents/Lightning-Engine/EngineTest/topdown.model"); }},
-		std::thread{ [] { blades_model_id = load_model("C:/Users/balin/Documents/Lightning-Engine/EngineTest/blades.model"); }},
-		std::thread{ [] { fembot_model_id = load_model("C:/Users/balin/Documents/Lightning-Engine/EngineTest/fembot.model"); }},
-		std::thread{ [] { sphere_model_id = load_model("C:/Users/balin/Documents/Lightning-Engine/EngineTest/sphere.model"); }},
-		std::thread{ [] { load_shaders(); } },
+	using content::AssetType;
+	const StreamedAsset assets[]{
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/ambient_occlusion.img", AssetType::TEXTURE, &texture_ids[TextureUsage::AMBIENT_OCCLUSION] },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/base_color.img", AssetType::TEXTURE, &texture_ids[TextureUsage::BASE_COLOR] },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/emissive.img", AssetType::TEXTURE, &texture_ids[TextureUsage::EMISSIVE] },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/metal_rough.img", AssetType::TEXTURE, &texture_ids[TextureUsage::METAL_ROUGH] },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/normal.img", AssetType::TEXTURE, &texture_ids[TextureUsage::NORMAL] },
+
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/brdf_lut.texture", AssetType::TEXTURE, &ibl_brdf_lut_id },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/diffuse6.texture", AssetType::TEXTURE, &ibl_diffuse_id },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/specular6.texture", AssetType::TEXTURE, &ibl_specular_id },
+
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/ground.model", AssetType::MESH, &building_model_id },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/topdown.model", AssetType::MESH, &fan_model_id },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/blades.model", AssetType::MESH, &blades_model_id },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/fembot.model", AssetType::MESH, &fembot_model_id },
+		{ "C:/Users/balin/Documents/Lightning-Engine/EngineTest/sphere.model", AssetType::MESH, &sphere_model_id },
 	};
 
-	for (auto& t : threads) {
-		t.join();
+	std::unordered_map<id::id_type, id::id_type*> pending_requests;
+
+	for (const auto& asset : assets) {
+		const content::streaming::request_id id{ content::streaming::load_asset(asset.path, asset.type) };
+		assert(id::is_valid(id));
+		pending_requests[id] = asset.asset_id;
 	}
 
+	// Compile the shaders while the assets are being streamed in.
+	std::thread shader_thread{ [] { load_shaders(); } };
+
+	util::vector<content::streaming::CompletedRequest> completed_requests;
+
+	while (!pending_requests.empty()) {
+		completed_requests.clear();
+		content::streaming::get_completed_requests(completed_requests);
+
+		for (const auto& request : completed_requests) {
+			auto pair = pending_requests.find(request.id);
+			assert(pair != pending_requests.end());
+			assert(request.status == content::streaming::RequestStatus::SUCCEEDED);
+
+			*pair->second = request.asset_id;
+			pending_requests.erase(pair);
+		}
+
+		if (!pending_requests.empty()) std::this_thread::yield();
+	}
+
+	shader_thread.join();
+
 	create_ibl_light();
 
 	create_material();
@@ -6,6 +6,10 @@
 #define TEST_ENTITY_COMPONENTS 0
 #define TEST_WINDOW 0
 #define TEST_RENDERER 1
+#define TEST_ASSET_ARCHIVE 0
+#define TEST_MESH_OPTIMIZATION 0
+#define TEST_BLOCK_COMPRESSION 0
+#define TEST_SCENE_IMPORT 0
 
 class Test {
 	public:
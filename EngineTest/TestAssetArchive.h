@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Test.h"
+#include "Content/AssetArchive.h"
+#include "../ContentTools/AssetPacker.h"
+
+#include <filesystem>
+#include <string>
+
+using namespace lightning;
+
+// Compares loading every model and texture in EngineTest from loose files against loading them from an archive.
+// "Cold" passes use unbuffered reads so the file system cache doesn't hide the cost of opening and reading the files.
+// Warm archive passes copy (and decompress) every asset into its own buffer, like the loose file passes do.
+// The archives are packed by ContentTools.dll, the same way the editor packs game.pak, so the DLL (built with one of
+// the editor configurations) has to be next to the executable.
+class EngineTest : public Test {
+	public:
+		bool initialize() override {
+			for (const auto& entry : std::filesystem::directory_iterator{ _asset_path }) {
+				const auto extension{ entry.path().extension() };
+				if (extension != ".model" && extension != ".texture") continue;
+
+				_files.emplace_back(entry.path().string());
+				_names.emplace_back(entry.path().filename().string());
+			}
+
+			if (_files.empty()) return false;
+
+			_content_tools = LoadLibraryA("ContentTools.dll");
+			if (!_content_tools) return false;
+
+			const auto pack_assets{ (decltype(&tools::pack_assets))GetProcAddress(_content_tools, "pack_assets") };
+			if (!pack_assets) return false;
+
+			util::vector<const char*> files;
+			util::vector<const char*> names;
+
+			for (u32 i{ 0 }; i < _files.size(); ++i) {
+				files.emplace_back(_files[i].c_str());
+				names.emplace_back(_names[i].c_str());
+			}
+
+			return pack_assets(files.data(), names.data(), (u32)files.size(), _archive_path, false) &&
+				pack_assets(files.data(), names.data(), (u32)files.size(), _compressed_archive_path, true);
+		}
+
+		void run() override {
+			constexpr u32 iterations{ 10 };
+			f32 loose_cold{ 0 }, archive_cold{ 0 }, loose_warm{ 0 }, archive_warm{ 0 }, compressed_warm{ 0 };
+			u64 loose_bytes{ 0 }, archive_bytes{ 0 }, compressed_bytes{ 0 };
+
+			for (u32 i{ 0 }; i < iterations; ++i) {
+				loose_cold += measure([&] { loose_bytes = load_loose_files(true); });
+				archive_cold += measure([&] { archive_bytes = load_archive_unbuffered(); });
+				loose_warm += measure([&] { loose_bytes = load_loose_files(false); });
+				archive_warm += measure([&] { archive_bytes = load_archive_mapped(_archive_path); });
+				compressed_warm += measure([&] { compressed_bytes = load_archive_mapped(_compressed_archive_path); });
+			}
+
+			assert(loose_bytes == archive_bytes && loose_bytes == compressed_bytes);
+
+			std::string result{ "Asset archive benchmark (" + std::to_string(_files.size()) + " files, " + std::to_string(loose_bytes >> 10) + " KB)\n" };
+			result += "  loose files,   cold (ms): " + std::to_string(loose_cold / iterations) + "\n";
+			result += "  archive,       cold (ms): " + std::to_string(archive_cold / iterations) + "\n";
+			result += "  loose files,   warm (ms): " + std::to_string(loose_warm / iterations) + "\n";
+			result += "  archive (map), warm (ms): " + std::to_string(archive_warm / iterations) + "\n";
+			result += "  compressed,    warm (ms): " + std::to_string(compressed_warm / iterations) + "\n";
+			result += "  compressed archive size (KB): " + std::to_string(std::filesystem::file_size(_compressed_archive_path) >> 10) + "\n";
+			OutputDebugStringA(result.c_str());
+
+			PostQuitMessage(0);
+		}
+
+		void shutdown() override {
+			std::filesystem::remove(_archive_path);
+			std::filesystem::remove(_compressed_archive_path);
+
+			if (_content_tools) FreeLibrary(_content_tools);
+		}
+
+	private:
+		template<typename F> f32 measure(F&& f) {
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			f();
+			return std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		// NOTE: unbuffered reads need sector aligned buffers, offsets and sizes. Page alignment satisfies all of them.
+		u64 read_file(HANDLE file, u64 offset, u64 size) {
+			const u64 aligned_size{ math::align_size_up<content::archive::archive_page_size>(size) };
+			u8* const buffer{ (u8*)_aligned_malloc(aligned_size, content::archive::archive_page_size) };
+			assert(buffer);
+
+			OVERLAPPED overlapped{};
+			overlapped.Offset = (DWORD)offset;
+			overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+			DWORD bytes_read{ 0 };
+			ReadFile(file, buffer, (DWORD)aligned_size, &bytes_read, &overlapped);
+			_aligned_free(buffer);
+
+			return std::min((u64)bytes_read, size);
+		}
+
+		u64 load_loose_files(bool unbuffered) {
+			u64 total_size{ 0 };
+
+			for (const auto& path : _files) {
+				const DWORD flags{ FILE_ATTRIBUTE_NORMAL | (unbuffered ? FILE_FLAG_NO_BUFFERING : 0u) };
+				HANDLE file{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr) };
+				assert(file != INVALID_HANDLE_VALUE);
+
+				LARGE_INTEGER size{};
+				GetFileSizeEx(file, &size);
+				total_size += read_file(file, 0, (u64)size.QuadPart);
+				CloseHandle(file);
+			}
+
+			return total_size;
+		}
+
+		u64 load_archive_unbuffered() {
+			using namespace content::archive;
+			HANDLE file{ CreateFileA(_archive_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, nullptr) };
+			assert(file != INVALID_HANDLE_VALUE);
+
+			// The header and the table of contents are small enough to be read in one go.
+			const u64 toc_size{ math::align_size_up<archive_page_size>(sizeof(ArchiveHeader) + _files.size() * sizeof(TocEntry)) };
+			u8* const toc_buffer{ (u8*)_aligned_malloc(toc_size, archive_page_size) };
+			DWORD bytes_read{ 0 };
+			ReadFile(file, toc_buffer, (DWORD)toc_size, &bytes_read, nullptr);
+
+			const ArchiveHeader& header{ *(const ArchiveHeader*)toc_buffer };
+			const TocEntry* const toc{ (const TocEntry*)&toc_buffer[header.toc_offset] };
+			u64 total_size{ 0 };
+
+			for (const auto& name : _names) {
+				const u64 hash{ hash_asset_name(name.c_str()) };
+				const TocEntry* const entry{ std::lower_bound(toc, toc + header.entry_count, hash, [](const TocEntry& e, u64 h) { return e.name_hash < h; }) };
+				assert(entry != toc + header.entry_count && entry->name_hash == hash);
+
+				total_size += read_file(file, entry->offset, entry->size);
+			}
+
+			_aligned_free(toc_buffer);
+			CloseHandle(file);
+
+			return total_size;
+		}
+
+		u64 load_archive_mapped(const char* path) {
+			using namespace content::archive;
+			const archive_id id{ open_archive(path) };
+			assert(id::is_valid(id));
+
+			u64 total_size{ 0 };
+
+			for (const auto& name : _names) {
+				AssetView view{};
+				[[maybe_unused]] const bool found{ find_asset(id, name.c_str(), view) };
+				assert(found);
+
+				std::unique_ptr<u8[]> data{};
+				u64 size{ 0 };
+				[[maybe_unused]] const bool result{ read_asset(view, data, size) };
+				assert(result);
+
+				total_size += size;
+			}
+
+			close_archive(id);
+
+			return total_size;
+		}
+
+		constexpr static const char* _asset_path{ "../../EngineTest/" };
+		constexpr static const char* _archive_path{ "../../EngineTest/benchmark.pak" };
+		constexpr static const char* _compressed_archive_path{ "../../EngineTest/benchmark_compressed.pak" };
+
+		util::vector<std::string> _files;
+		util::vector<std::string> _names;
+		HMODULE _content_tools{ nullptr };
+};
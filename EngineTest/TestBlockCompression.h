@@ -0,0 +1,295 @@
+#pragma once
+
+#include "Test.h"
+#include "../ContentTools/BlockCompression.cpp"
+
+#include <DirectXTex.h>
+#include <DirectXPackedVector.h>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+using namespace lightning;
+using namespace DirectX::PackedVector;
+
+// Compresses a synthetic LDR image to BC7 and a synthetic HDR environment map to BC6H at every quality level, and reports
+// the throughput in MPix/s and the PSNR of the blocks, decoded by DirectXTex, against the source. Every PSNR has to reach
+// a lower bound. The HDR PSNR is measured after a Reinhard tone map, so that the error in the bright areas doesn't drown
+// out the rest of the image.
+// BC1, BC3, BC4 and BC5 are checked with single blocks they should reproduce closely, also decoded by DirectXTex.
+class EngineTest : public Test {
+	public:
+		bool initialize() override {
+			make_ldr_image();
+			make_hdr_image();
+
+			return true;
+		}
+
+		void run() override {
+			constexpr const char* quality_names[tools::BlockQuality::count]{ "fast", "normal", "production" };
+			std::string result{ "Block compression (" + std::to_string(image_size) + "x" + std::to_string(image_size) + ", " + std::to_string(HW_THREADS) + " threads)\n" };
+			bool is_passed{ true };
+
+			for (u32 format{ tools::BlockFormat::BC6H }; format <= tools::BlockFormat::BC7; ++format) {
+				const bool is_hdr{ format == tools::BlockFormat::BC6H };
+				result += is_hdr ? "  BC6H\n" : "  BC7\n";
+
+				for (u32 quality{ 0 }; quality < tools::BlockQuality::count; ++quality) {
+					const Result r{ measure((tools::BlockFormat::Type)format, (tools::BlockQuality::Type)quality) };
+					const bool is_good{ r.psnr >= (is_hdr ? min_psnr_bc6h : min_psnr_bc7) };
+					is_passed &= is_good;
+
+					result += "    " + std::string{ quality_names[quality] } + ": " + std::to_string(r.mpix_per_second) + " MPix/s, PSNR " +
+						std::to_string(r.psnr) + " dB" + (is_good ? "\n" : ", FAILED\n");
+				}
+			}
+
+			is_passed &= check_round_trips(result);
+
+			OutputDebugStringA(result.c_str());
+			assert(is_passed);
+
+			PostQuitMessage(0);
+		}
+
+		void shutdown() override {}
+
+	private:
+		static constexpr u32 image_size{ 512 };
+		static constexpr u32 blocks_per_row{ image_size / 4 };
+		static constexpr u32 block_count{ blocks_per_row * blocks_per_row };
+
+		// A few dB below what the encoder reaches at its fastest quality level.
+		static constexpr double min_psnr_bc6h{ 57.0 };
+		static constexpr double min_psnr_bc7{ 43.0 };
+
+		struct Result {
+			double mpix_per_second;
+			double psnr;
+		};
+
+		// A 4x4 block with a gradient from first to last, left to right. The leftmost transparent_columns get alpha 0.
+		// No channel may decode further than max_error from the source.
+		struct RoundTripCase {
+			const char* name;
+			tools::BlockFormat::Type format;
+			u8 first[4];
+			u8 last[4];
+			u32 transparent_columns;
+			u32 max_error;
+		};
+
+		util::vector<u8> _ldr_pixels;
+		util::vector<u16> _hdr_pixels;
+		util::vector<u8> _blocks;
+
+		static f32 noise(u32 x, u32 y) {
+			u32 h{ x * 374761393u + y * 668265263u };
+			h = (h ^ (h >> 13)) * 1274126177u;
+			return (f32)((h ^ (h >> 16)) & 0xffff) / 65535.f;
+		}
+
+		// Gradients, hard edges between differently colored regions, a noisy area and a soft alpha falloff.
+		void make_ldr_image() {
+			_ldr_pixels.resize(image_size * image_size * 4);
+
+			for (u32 y{ 0 }; y < image_size; ++y) {
+				for (u32 x{ 0 }; x < image_size; ++x) {
+					const f32 u{ (f32)x / image_size };
+					const f32 v{ (f32)y / image_size };
+					const bool checker{ ((x / 24) + (y / 24)) & 1 };
+					const f32 grain{ y > image_size / 2 ? noise(x, y) * .25f : 0.f };
+					const f32 r{ checker ? u : .8f - .5f * v };
+					const f32 g{ checker ? v * .7f + .2f : .3f + .5f * std::sin(u * 12.f) * .5f };
+					const f32 b{ checker ? .5f + .5f * std::cos((u + v) * 7.f) : .2f + .6f * u * v };
+					const f32 dx{ u - .5f };
+					const f32 dy{ v - .5f };
+					const f32 a{ std::clamp(1.5f - 3.f * std::sqrt(dx * dx + dy * dy), 0.f, 1.f) };
+					u8* const pixel{ &_ldr_pixels[(y * image_size + x) * 4] };
+
+					pixel[0] = (u8)(std::clamp(r + grain, 0.f, 1.f) * 255.f + .5f);
+					pixel[1] = (u8)(std::clamp(g + grain, 0.f, 1.f) * 255.f + .5f);
+					pixel[2] = (u8)(std::clamp(b + grain, 0.f, 1.f) * 255.f + .5f);
+					pixel[3] = (u8)(a * 255.f + .5f);
+				}
+			}
+		}
+
+		// An equirectangular sky: a gradient from the horizon to the zenith, a sun much brighter than the rest, and a dim ground.
+		void make_hdr_image() {
+			_hdr_pixels.resize(image_size * image_size * 4);
+
+			for (u32 y{ 0 }; y < image_size; ++y) {
+				for (u32 x{ 0 }; x < image_size; ++x) {
+					const f32 u{ (f32)x / image_size };
+					const f32 v{ (f32)y / image_size };
+					f32 color[3]{};
+
+					if (v < .5f) {
+						const f32 t{ v * 2.f };
+						color[0] = .2f + .8f * t;
+						color[1] = .4f + .6f * t;
+						color[2] = 1.2f + .3f * t;
+
+						const f32 dx{ u - .3f };
+						const f32 dy{ v - .2f };
+						const f32 sun{ 64.f * std::exp(-(dx * dx + dy * dy) * 4000.f) };
+						color[0] += sun;
+						color[1] += sun * .9f;
+						color[2] += sun * .7f;
+					}
+					else {
+						const f32 grain{ noise(x, y) * .05f };
+						color[0] = .15f + grain;
+						color[1] = .12f + grain;
+						color[2] = .08f + grain;
+					}
+
+					u16* const pixel{ &_hdr_pixels[(y * image_size + x) * 4] };
+
+					for (u32 c{ 0 }; c < 3; ++c) pixel[c] = XMConvertFloatToHalf(color[c]);
+					pixel[3] = XMConvertFloatToHalf(1.f);
+				}
+			}
+		}
+
+		Result measure(tools::BlockFormat::Type format, tools::BlockQuality::Type quality) {
+			_blocks.resize(block_count * 16);
+
+			tools::BlockSurface surface{};
+			surface.source = format == tools::BlockFormat::BC6H ? (const u8*)_hdr_pixels.data() : _ldr_pixels.data();
+			surface.destination = _blocks.data();
+			surface.width = image_size;
+			surface.height = image_size;
+			surface.source_pitch = image_size * (format == tools::BlockFormat::BC6H ? 8 : 4);
+			surface.destination_pitch = blocks_per_row * 16;
+
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			tools::compress_blocks(&surface, 1, format, quality);
+			const double seconds{ std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() };
+
+			const double mpix_per_second{ (double)image_size * image_size / seconds * 1e-6 };
+			const bool is_hdr{ format == tools::BlockFormat::BC6H };
+			DirectX::ScratchImage decoded{};
+
+			if (!decompress(_blocks.data(), image_size, image_size, is_hdr ? DXGI_FORMAT_BC6H_UF16 : DXGI_FORMAT_BC7_UNORM,
+				is_hdr ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM, decoded)) {
+				return { mpix_per_second, 0.0 };
+			}
+
+			const DirectX::Image& image{ *decoded.GetImage(0, 0, 0) };
+			double squared_error{ 0.0 };
+
+			for (u32 y{ 0 }; y < image_size; ++y) {
+				for (u32 x{ 0 }; x < image_size; ++x) {
+					if (is_hdr) {
+						const u16* const pixel{ (const u16*)&image.pixels[y * image.rowPitch + x * 8] };
+						const u16* const source{ &_hdr_pixels[(y * image_size + x) * 4] };
+
+						for (u32 c{ 0 }; c < 3; ++c) {
+							const double error{ tone_map(pixel[c]) - tone_map(source[c]) };
+							squared_error += error * error;
+						}
+					}
+					else {
+						const u8* const pixel{ &image.pixels[y * image.rowPitch + x * 4] };
+						const u8* const source{ &_ldr_pixels[(y * image_size + x) * 4] };
+
+						for (u32 c{ 0 }; c < 4; ++c) {
+							const double error{ ((double)pixel[c] - (double)source[c]) / 255.0 };
+							squared_error += error * error;
+						}
+					}
+				}
+			}
+
+			const u32 channel_count{ is_hdr ? 3u : 4u };
+			const double mse{ squared_error / ((double)image_size * image_size * channel_count) };
+
+			return { mpix_per_second, mse > 0.0 ? -10.0 * std::log10(mse) : 99.0 };
+		}
+
+		// A flat color and a gradient between two colors for each format, and a BC1 block whose left half is transparent,
+		// which has to use the 3 color mode with transparent black. BC4 only has red, BC5 red and green.
+		bool check_round_trips(std::string& result) {
+			static constexpr RoundTripCase cases[]{
+				{ "BC1 flat", tools::BlockFormat::BC1, { 200, 100, 50, 255 }, { 200, 100, 50, 255 }, 0, 4 },
+				{ "BC1 gradient", tools::BlockFormat::BC1, { 240, 32, 16, 255 }, { 16, 96, 240, 255 }, 0, 4 },
+				{ "BC1 punch-through alpha", tools::BlockFormat::BC1, { 40, 160, 220, 255 }, { 40, 160, 220, 255 }, 2, 4 },
+				{ "BC3 flat", tools::BlockFormat::BC3, { 200, 100, 50, 128 }, { 200, 100, 50, 128 }, 0, 4 },
+				{ "BC3 gradient", tools::BlockFormat::BC3, { 240, 32, 16, 0 }, { 16, 96, 240, 255 }, 0, 4 },
+				{ "BC4 flat", tools::BlockFormat::BC4, { 90, 0, 0, 255 }, { 90, 0, 0, 255 }, 0, 1 },
+				{ "BC4 gradient", tools::BlockFormat::BC4, { 100, 0, 0, 255 }, { 170, 0, 0, 255 }, 0, 4 },
+				{ "BC5 flat", tools::BlockFormat::BC5, { 90, 180, 0, 255 }, { 90, 180, 0, 255 }, 0, 1 },
+				{ "BC5 gradient", tools::BlockFormat::BC5, { 100, 200, 0, 255 }, { 170, 130, 0, 255 }, 0, 4 },
+			};
+
+			constexpr DXGI_FORMAT block_formats[]{ DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_BC5_UNORM };
+			constexpr DXGI_FORMAT formats[]{ DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8_UNORM, DXGI_FORMAT_R8G8_UNORM };
+			constexpr u32 channel_counts[]{ 4, 4, 1, 2 };
+
+			bool is_passed{ true };
+			result += "  Round trip\n";
+
+			for (const RoundTripCase& c : cases) {
+				u8 pixels[16][4];
+
+				for (u32 p{ 0 }; p < 16; ++p) {
+					const u32 x{ p % 4 };
+					for (u32 k{ 0 }; k < 4; ++k) pixels[p][k] = (u8)((c.first[k] * (3 - x) + c.last[k] * x + 1) / 3);
+					if (x < c.transparent_columns) pixels[p][3] = 0;
+				}
+
+				u8 block[16]{};
+				const tools::BlockSurface surface{ &pixels[0][0], block, 4, 4, 16, tools::get_block_size(c.format) };
+				tools::compress_blocks(&surface, 1, c.format);
+
+				DirectX::ScratchImage decoded{};
+
+				if (!decompress(block, 4, 4, block_formats[c.format], formats[c.format], decoded)) {
+					result += "    " + std::string{ c.name } + ": can't be decoded, FAILED\n";
+					is_passed = false;
+					continue;
+				}
+
+				const DirectX::Image& image{ *decoded.GetImage(0, 0, 0) };
+				const u32 channel_count{ channel_counts[c.format] };
+				u32 max_error{ 0 };
+
+				for (u32 p{ 0 }; p < 16; ++p) {
+					const u8* const pixel{ &image.pixels[(p / 4) * image.rowPitch + (p % 4) * channel_count] };
+
+					for (u32 k{ 0 }; k < channel_count; ++k) {
+						// Transparent BC1 pixels decode to black, only their alpha is compared.
+						if (pixels[p][3] < 128 && c.format == tools::BlockFormat::BC1 && k < 3) continue;
+						max_error = std::max(max_error, (u32)std::abs((s32)pixel[k] - (s32)pixels[p][k]));
+					}
+				}
+
+				const bool is_good{ max_error <= c.max_error };
+				is_passed &= is_good;
+				result += "    " + std::string{ c.name } + ": max error " + std::to_string(max_error) + (is_good ? "\n" : ", FAILED\n");
+			}
+
+			return is_passed;
+		}
+
+		static double tone_map(u16 half) {
+			const double value{ std::max((double)XMConvertHalfToFloat(half), 0.0) };
+			return value / (1.0 + value);
+		}
+
+		// DirectXTex decodes every mode of every format, so the blocks are checked by a decoder that wasn't written along
+		// with the encoder.
+		static bool decompress(const u8* const blocks, u32 width, u32 height, DXGI_FORMAT block_format, DXGI_FORMAT format, DirectX::ScratchImage& result) {
+			DirectX::Image image{};
+			image.width = width;
+			image.height = height;
+			image.format = block_format;
+			image.pixels = (u8*)blocks;
+
+			return SUCCEEDED(DirectX::ComputePitch(block_format, width, height, image.rowPitch, image.slicePitch)) &&
+				SUCCEEDED(DirectX::Decompress(image, format, result));
+		}
+};
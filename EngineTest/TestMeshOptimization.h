@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Test.h"
+#include "../ContentTools/MeshOptimization.cpp"
+#include "Utilities/IOStream.h"
+#include "Graphics/Renderer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace lightning;
+
+// Reports the post-transform vertex cache efficiency of every submesh of the models in EngineTest, before and after
+// reordering the triangles the way the importer does it, and how many verticies are left after merging the identical ones.
+// Then builds the meshlets twice, to time them and to check that the result is deterministic.
+// Models are in the format that content::create_resource() reads.
+class EngineTest : public Test {
+	public:
+		bool initialize() override {
+			for (const auto& entry : std::filesystem::directory_iterator{ _asset_path }) {
+				if (entry.path().extension() == ".model") _files.emplace_back(entry.path().string());
+			}
+
+			return !_files.empty();
+		}
+
+		void run() override {
+			std::string result{ "Vertex cache optimization (cache size " + std::to_string(tools::default_vertex_cache_size) + ")\n" };
+
+			for (const auto& file : _files) {
+				util::vector<u8> data{};
+				if (!read_file(file, data)) continue;
+
+				result += "  " + std::filesystem::path{ file }.filename().string() + "\n";
+				analyze_model(data.data(), result);
+			}
+
+			OutputDebugStringA(result.c_str());
+
+			PostQuitMessage(0);
+		}
+
+		void shutdown() override {}
+
+	private:
+		bool read_file(const std::string& path, util::vector<u8>& data) {
+			std::ifstream file{ path, std::ios::in | std::ios::binary };
+			if (!file) return false;
+
+			data.resize(std::filesystem::file_size(path));
+			return (bool)file.read((char*)data.data(), data.size());
+		}
+
+		static bool is_equal(const tools::MeshletData& a, const tools::MeshletData& b) {
+			return
+				a.meshlets.size() == b.meshlets.size() && a.verticies.size() == b.verticies.size() && a.triangles.size() == b.triangles.size() &&
+				!memcmp(a.meshlets.data(), b.meshlets.data(), a.meshlets.size() * sizeof(tools::Meshlet)) &&
+				!memcmp(a.verticies.data(), b.verticies.data(), a.verticies.size() * sizeof(u32)) &&
+				!memcmp(a.triangles.data(), b.triangles.data(), a.triangles.size());
+		}
+
+		void analyze_model(const u8* const data, std::string& result) {
+			// NOTE: matches the submesh layout read by the renderer, where buffers are aligned to 4 bytes.
+			constexpr u32 alignment{ 4 };
+			util::BlobStreamReader blob{ data };
+			const u32 lod_count{ blob.read<u32>() };
+			blob.skip(sizeof(u32));
+
+			// The submesh headers follow the LOD headers, the buffers are in a separate section for each LOD.
+			util::BlobStreamReader lods{ blob.position() };
+			blob.skip(4 * sizeof(u32) * lod_count);
+
+			for (u32 lod{ 0 }; lod < lod_count; ++lod) {
+				lods.skip(sizeof(f32));
+				const u32 submesh_count{ lods.read<u32>() };
+				util::BlobStreamReader section{ &data[lods.read<u32>()] };
+				lods.skip(sizeof(u32));
+
+				for (u32 submesh{ 0 }; submesh < submesh_count; ++submesh) {
+					const u32 element_size{ blob.read<u32>() };
+					const u32 vertex_count{ blob.read<u32>() };
+					const u32 index_count{ blob.read<u32>() };
+					const bool quantized{ (blob.read<u32>() >> 24) == graphics::PositionFormat::UNORM16 };
+					blob.skip(sizeof(u32));
+
+					math::v3 scale{}, offset{};
+					if (quantized) {
+						blob.read((u8*)&scale, sizeof(math::v3));
+						blob.read((u8*)&offset, sizeof(math::v3));
+					}
+
+					const u32 index_size{ (vertex_count < (1 << 16)) ? sizeof(u16) : sizeof(u32) };
+					const u32 position_size{ quantized ? 3 * sizeof(u16) : sizeof(math::v3) };
+					const u32 position_buffer_size{ (u32)math::align_size_up<alignment>(position_size * vertex_count) };
+					const u32 element_buffer_size{ (u32)math::align_size_up<alignment>(element_size * vertex_count) };
+
+					const u8* const position_data{ section.position() };
+					const u8* const elements{ section.position() + position_buffer_size };
+					section.skip(position_buffer_size + element_buffer_size);
+
+					util::vector<math::v3> positions(vertex_count);
+					for (u32 i{ 0 }; i < vertex_count; ++i) {
+						if (quantized) {
+							const u16* const q{ (const u16*)position_data + i * 3 };
+							positions[i] = { offset.x + q[0] * scale.x, offset.y + q[1] * scale.y, offset.z + q[2] * scale.z };
+						}
+						else {
+							memcpy(&positions[i], position_data + i * sizeof(math::v3), sizeof(math::v3));
+						}
+					}
+
+					util::vector<u32> indicies(index_count);
+					for (u32 i{ 0 }; i < index_count; ++i) {
+						indicies[i] = index_size == sizeof(u16) ? ((const u16*)section.position())[i] : ((const u32*)section.position())[i];
+					}
+					section.skip(index_size * index_count);
+
+					if (index_count < 3 || index_count % 3) continue;
+
+					const tools::VertexCacheStats before{ tools::analyze_vertex_cache(indicies.data(), index_count, vertex_count) };
+
+					// Same order as the importer: merge the identical verticies first, so the cache sees the shared ones.
+					const tools::VertexStream streams[]{ { position_data, position_size }, { elements, element_size } };
+					util::vector<u32> remap(vertex_count);
+					const u32 new_vertex_count{ tools::generate_vertex_remap(indicies.data(), index_count, vertex_count, streams, element_size ? 2 : 1, remap.data()) };
+					tools::remap_indicies(indicies.data(), index_count, remap.data());
+
+					util::vector<math::v3> new_positions(new_vertex_count);
+					tools::remap_verticies(new_positions.data(), positions.data(), vertex_count, sizeof(math::v3), remap.data());
+
+					const auto start{ std::chrono::high_resolution_clock::now() };
+					tools::optimize_index_order(indicies.data(), index_count, new_positions.data(), new_vertex_count);
+					const f32 time{ std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count() };
+
+					const tools::VertexCacheStats after{ tools::analyze_vertex_cache(indicies.data(), index_count, new_vertex_count) };
+
+					tools::MeshletData meshlets{};
+					const auto meshlet_start{ std::chrono::high_resolution_clock::now() };
+					tools::build_meshlets(indicies.data(), index_count, new_positions.data(), new_vertex_count, meshlets);
+					const f32 meshlet_time{ std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - meshlet_start).count() };
+
+					tools::MeshletData meshlets_again{};
+					tools::build_meshlets(indicies.data(), index_count, new_positions.data(), new_vertex_count, meshlets_again);
+					const bool is_deterministic{ is_equal(meshlets, meshlets_again) };
+
+					const u32 meshlet_count{ (u32)meshlets.meshlets.size() };
+					u32 cone_count{ 0 };
+					for (const auto& meshlet : meshlets.meshlets) cone_count += meshlet.cone_cutoff < 1.f;
+
+					char line[512];
+					sprintf_s(line, "    LOD %u submesh %u, %u triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.2f ms), %u -> %u verticies\n"
+						"      %u meshlets, %.1f verticies and %.1f triangles on average, %u with a normal cone (%.2f ms%s)\n",
+						lod, submesh, index_count / 3, before.acmr, after.acmr, before.atvr, after.atvr, time, vertex_count, new_vertex_count,
+						meshlet_count, (f32)meshlets.verticies.size() / meshlet_count, (f32)(index_count / 3) / meshlet_count, cone_count,
+						meshlet_time, is_deterministic ? "" : ", NOT DETERMINISTIC");
+					result += line;
+				}
+			}
+		}
+
+		constexpr static const char* _asset_path{ "../../EngineTest/" };
+
+		util::vector<std::string> _files;
+};
@@ -3,6 +3,7 @@
 #include "Graphics/Renderer.h"
 #include "Graphics/Direct3D12/Direct3D12Core.h"
 #include "Content/ContentToEngine.h"
+#include "Content/AssetStreaming.h"
 #include "Components/Entity.h"
 #include "Components/Transform.h"
 #include "Components/Script.h"
@@ -237,6 +238,7 @@
 		}
 
 		if (!graphics::initialize(graphics::GraphicsPlatform::DIRECT3D12)) return false;
+		if (!content::streaming::initialize()) return false;
 
 		platform::WindowInitInfo info[]{
 			{&win_proc, nullptr, L"TestWindow1", 100, 100, 400, 400},
@@ -294,6 +296,9 @@
 	}
 
 	void test_shutdown() {
+		const content::ResourceCacheStats cache_stats{ content::get_resource_cache_stats() };
+		OutputDebugStringA(("Resource cache hits: " + std::to_string(cache_stats.hits) + ", misses: " + std::to_string(cache_stats.misses) + "\n").c_str());
+
 		input::unbind(std::hash<std::string>()("move"));
 		destroy_render_items();
 		remove_lights();
@@ -302,6 +307,7 @@
 		for (u32 i{ 0 }; i < _countof(_surfaces); ++i) {
 			destroy_camera_surface(_surfaces[i]);
 		}
+		content::streaming::shutdown();
 		graphics::shutdown();
 	}
 
@@ -335,6 +341,8 @@
 				_surfaces[i].surface.surface.render(info);
 			}
 		}
+
+		content::update_geometry_residency();
 		timer.end();
 	}
 
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Test.h"
+#include "../ContentTools/SceneImporter.cpp"
+#include "../ContentTools/ObjImporter.cpp"
+#include "../ContentTools/GltfImporter.cpp"
+#include "../ContentTools/Geometry.cpp"
+#include "../ContentTools/CookCache.cpp"
+#include "../ContentTools/MeshOptimization.cpp"
+#include "../ContentTools/MeshSimplification.cpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace lightning;
+using namespace DirectX;
+
+// Loads a small OBJ file and a small glTF file and checks the scenes the importers make of them: the number of meshes
+// and triangles, that the progress reaches its maximum, and that a triangle placed by a mirroring node still faces the
+// way its normals point. Only the loaders run, the scenes aren't processed or cooked.
+class EngineTest : public Test {
+	public:
+		bool initialize() override {
+			std::filesystem::create_directories(_path);
+
+			return write_file(_obj_file, _obj_source) && write_file(_gltf_file, _gltf_source);
+		}
+
+		void run() override {
+			std::string result{ "Scene import\n" };
+			bool is_passed{ true };
+
+			is_passed &= check(result, "OBJ", [this](std::string& errors) { return test_obj(errors); });
+			is_passed &= check(result, "glTF", [this](std::string& errors) { return test_gltf(errors); });
+
+			OutputDebugStringA(result.c_str());
+			assert(is_passed);
+
+			PostQuitMessage(0);
+		}
+
+		void shutdown() override {
+			std::filesystem::remove_all(_path);
+		}
+
+	private:
+		// Two objects: a quad, which is triangulated as a fan, and a triangle.
+		static constexpr const char* _obj_source{
+			"o quad\n"
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+			"vn 0 0 1\n"
+			"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+			"f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+			"o triangle\n"
+			"v 0 0 1\nv 1 0 1\nv 0 1 1\n"
+			"f 5/1/1 6/2/1 7/4/1\n"
+		};
+
+		// One triangle, (0, 0, 0) (1, 0, 0) (0, 1, 0) with all normals (0, 0, 1), placed by two root nodes. The second node
+		// mirrors it along x. The buffer holds the 3 positions and then the 3 normals.
+		static constexpr const char* _gltf_source{ R"({
+			"asset": { "version": "2.0" },
+			"scene": 0,
+			"scenes": [ { "nodes": [ 0, 1 ] } ],
+			"nodes": [
+				{ "name": "original", "mesh": 0 },
+				{ "name": "mirrored", "mesh": 0, "scale": [ -1, 1, 1 ] }
+			],
+			"meshes": [ { "primitives": [ { "attributes": { "POSITION": 0, "NORMAL": 1 } } ] } ],
+			"accessors": [
+				{ "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" },
+				{ "bufferView": 1, "componentType": 5126, "count": 3, "type": "VEC3" }
+			],
+			"bufferViews": [
+				{ "buffer": 0, "byteOffset": 0, "byteLength": 36 },
+				{ "buffer": 0, "byteOffset": 36, "byteLength": 36 }
+			],
+			"buffers": [ {
+				"byteLength": 72,
+				"uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAAAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/AAAAAAAAAAAAAIA/"
+			} ]
+		})" };
+
+		template<typename F> static bool check(std::string& result, const char* name, F&& test) {
+			std::string errors;
+			const bool is_passed{ test(errors) };
+			result += "  " + std::string{ name } + (is_passed ? ": passed\n" : ": FAILED\n" + errors);
+			return is_passed;
+		}
+
+		static bool write_file(const std::string& path, const char* text) {
+			std::ofstream file{ path, std::ios::out | std::ios::binary | std::ios::trunc };
+			return file && file.write(text, strlen(text));
+		}
+
+		static u32 triangle_count(const tools::Mesh& m) {
+			return (u32)m.raw_indicies.size() / 3;
+		}
+
+		// True if every triangle winds counterclockwise around the normal of its first corner.
+		static bool faces_normals(const tools::Mesh& m) {
+			for (u32 i{ 0 }; i + 2 < m.raw_indicies.size(); i += 3) {
+				const XMVECTOR p0{ XMLoadFloat3(&m.positions[m.raw_indicies[i]]) };
+				const XMVECTOR p1{ XMLoadFloat3(&m.positions[m.raw_indicies[i + 1]]) };
+				const XMVECTOR p2{ XMLoadFloat3(&m.positions[m.raw_indicies[i + 2]]) };
+				const XMVECTOR face_normal{ XMVector3Cross(p1 - p0, p2 - p0) };
+
+				if (XMVectorGetX(XMVector3Dot(face_normal, XMLoadFloat3(&m.normals[i]))) <= 0.f) return false;
+			}
+
+			return true;
+		}
+
+		static void expect(bool condition, const char* message, std::string& errors) {
+			if (!condition) errors += "    " + std::string{ message } + "\n";
+		}
+
+		bool test_obj(std::string& errors) {
+			const tools::MappedFile source{ _obj_file.c_str() };
+			tools::Scene scene{};
+			tools::SceneData data{};
+			Progression progression{};
+
+			expect(source.is_valid(), "the file can't be opened", errors);
+			if (!errors.empty()) return false;
+
+			tools::load_obj(_obj_file.c_str(), source, scene, &data, &progression);
+
+			expect(scene.lod_groups.size() == 2, "expected a LOD group per object", errors);
+			if (!errors.empty()) return false;
+
+			const tools::Mesh& quad{ scene.lod_groups[0].meshes[0] };
+			const tools::Mesh& triangle{ scene.lod_groups[1].meshes[0] };
+
+			expect(quad.name == "quad" && triangle.name == "triangle", "the meshes aren't named after the objects", errors);
+			expect(triangle_count(quad) == 2 && triangle_count(triangle) == 1, "wrong number of triangles", errors);
+			expect(quad.positions.size() == 4 && triangle.positions.size() == 3, "wrong number of positions", errors);
+			expect(faces_normals(quad) && faces_normals(triangle), "triangles wind against their normals", errors);
+			expect(progression.max_value() == 2 && progression.value() == progression.max_value(), "the progress doesn't reach its maximum", errors);
+
+			return errors.empty();
+		}
+
+		bool test_gltf(std::string& errors) {
+			const tools::MappedFile source{ _gltf_file.c_str() };
+			tools::Scene scene{};
+			tools::SceneData data{};
+			Progression progression{};
+
+			expect(source.is_valid(), "the file can't be opened", errors);
+			if (!errors.empty()) return false;
+
+			tools::load_gltf(_gltf_file.c_str(), source, scene, &data, &progression);
+
+			expect(scene.lod_groups.size() == 2, "expected a LOD group per root node", errors);
+			if (!errors.empty()) return false;
+
+			const tools::Mesh& original{ scene.lod_groups[0].meshes[0] };
+			const tools::Mesh& mirrored{ scene.lod_groups[1].meshes[0] };
+
+			expect(original.name == "original" && mirrored.name == "mirrored", "the meshes aren't named after the nodes", errors);
+			expect(triangle_count(original) == 1 && triangle_count(mirrored) == 1, "wrong number of triangles", errors);
+			expect(mirrored.positions.size() == 3 && mirrored.positions[1].x == -1.f, "the node transform isn't applied", errors);
+			expect(faces_normals(original), "the triangle winds against its normals", errors);
+			expect(faces_normals(mirrored), "the mirrored triangle is inside out", errors);
+			expect(progression.max_value() == 2 && progression.value() == progression.max_value(), "the progress doesn't reach its maximum", errors);
+
+			return errors.empty();
+		}
+
+		const std::string _path{ "scene_import_test/" };
+		const std::string _obj_file{ _path + "test.obj" };
+		const std::string _gltf_file{ _path + "test.gltf" };
+};
@@ -65,7 +65,7 @@ const static float inv_intervals = 2.f / ((1 << 16) - 1);
 ConstantBuffer<GlobalShaderData> global_data : register(b0, space0);
 ConstantBuffer<PerObjectData> per_object_buffer : register(b1, space0);
 
-StructuredBuffer<float3> vertex_positions : register(t0, space0);
+ByteAddressBuffer vertex_positions : register(t0, space0);
 StructuredBuffer<VertexElement> elements : register(t1, space0);
 StructuredBuffer<uint> srv_indicies : register(t2, space0);
 StructuredBuffer<DirectionalLightParameters> directional_lights : register(t3, space0);
@@ -80,7 +80,8 @@ SamplerState anisotropic_sampler : register(s2, space0);
 VertexOut test_shader_vs(in uint vertex_idx : SV_VertexID) {
     VertexOut vs_out;
     
-    float4 position = float4(vertex_positions[vertex_idx], 1.f);
+    float3 object_position = load_position(vertex_positions, vertex_idx, per_object_buffer.position_format, per_object_buffer.position_scale, per_object_buffer.position_offset);
+    float4 position = float4(object_position, 1.f);
     float4 world_position = mul(per_object_buffer.world, position);
     
     #if ELEMENTS_TYPE == ELEMENTS_TYPE_STATIC_NORMAL
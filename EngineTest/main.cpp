@@ -8,6 +8,14 @@
 #include "TestWindow.h"
 #elif TEST_RENDERER
 #include "TestRenderer.h"
+#elif TEST_ASSET_ARCHIVE
+#include "TestAssetArchive.h"
+#elif TEST_MESH_OPTIMIZATION
+#include "TestMeshOptimization.h"
+#elif TEST_BLOCK_COMPRESSION
+#include "TestBlockCompression.h"
+#elif TEST_SCENE_IMPORT
+#include "TestSceneImport.h"
 #else
 #error One of the tests need to be enabled
 #endif